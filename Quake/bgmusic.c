@@ -72,6 +72,249 @@ static music_handler_t *music_handlers = NULL;
 
 static snd_stream_t *bgmstream = NULL;
 
+/*
+===============================================================================
+
+Decode-ahead
+
+A worker task keeps a ring of decoded PCM, in the stream's own format, a few
+seconds ahead of the mixer, so BGM_UpdateStream only copies samples and codec
+work and file I/O never happen on the main thread. The start of the track is
+kept as well: a loop replays it while the worker rewinds, and a track shorter
+than that loops without touching the codec again.
+
+===============================================================================
+*/
+
+#define BGM_RING_SECONDS 4
+#define BGM_HEAD_SECONDS 2
+#define BGM_DECODE_CHUNK 16384
+
+typedef enum
+{
+	BGM_DECODE_OK,
+	BGM_DECODE_FINISHED,
+	BGM_DECODE_READ_ERROR,
+	BGM_DECODE_SEEK_ERROR,
+	BGM_DECODE_EOF_ERROR,
+} bgm_decode_t;
+
+typedef struct
+{
+	task_handle_t	task;
+	atomic_uint32_t busy;
+	atomic_uint32_t quit;
+	atomic_uint32_t status; // bgm_decode_t, the main thread reports errors once the ring drained
+	int				error;
+
+	byte		   *ring;
+	uint32_t		ring_size; // power of two, so it is a multiple of the frame size
+	atomic_uint32_t ring_head; // only written by the worker
+	atomic_uint32_t ring_tail; // only written by the main thread
+
+	byte	*start;		 // first start_len bytes of the track
+	int		 start_size; // capacity of start
+	int		 start_len;
+	qboolean start_whole; // the whole track fits in start
+	int		 pos;		  // bytes decoded since the last rewind, -1 after a jump
+	int		 replay;	  // offset into start being replayed, -1 while decoding
+	qboolean rewind;	  // rewind and skip start_len bytes once the replay is done
+} bgmdecoder_t;
+
+static bgmdecoder_t *bgmdecoder = NULL;
+
+/*
+=================
+BGM_Decode
+
+Fills the ring from the start buffer or the codec, returns the number of
+bytes written or a negative codec error
+=================
+*/
+static int BGM_Decode (bgmdecoder_t *dec, byte *dst, int bytes)
+{
+	int res;
+
+	if (dec->replay >= 0)
+	{
+		res = q_min (bytes, dec->start_len - dec->replay);
+		memcpy (dst, dec->start + dec->replay, res);
+		dec->replay += res;
+		if (dec->replay == dec->start_len)
+			dec->replay = dec->start_whole ? 0 : -1;
+		return res;
+	}
+
+	if (dec->rewind)
+	{
+		byte skip[BGM_DECODE_CHUNK];
+		int	 left;
+
+		dec->rewind = false;
+		res = S_CodecRewindStream (bgmstream);
+		if (res != 0)
+		{
+			dec->error = res;
+			return -BGM_DECODE_SEEK_ERROR;
+		}
+		for (left = dec->start_len; left > 0; left -= res)
+		{
+			res = S_CodecReadStream (bgmstream, q_min (left, (int)sizeof (skip)), skip);
+			if (res <= 0)
+				break;
+		}
+		dec->pos = dec->start_len - q_max (left, 0);
+	}
+
+	res = S_CodecReadStream (bgmstream, bytes, dst);
+	if (res > 0 && dec->pos >= 0)
+	{
+		if (dec->pos == dec->start_len && dec->start_len < dec->start_size)
+		{
+			const int n = q_min (res, dec->start_size - dec->start_len);
+			memcpy (dec->start + dec->start_len, dst, n);
+			dec->start_len += n;
+		}
+		dec->pos += res;
+	}
+	else if (res == 0) /* EOF */
+	{
+		if (!bgmstream->loop)
+			return -BGM_DECODE_FINISHED;
+		if (dec->pos == 0)
+			return -BGM_DECODE_EOF_ERROR; /* keeps returning EOF */
+		if (dec->pos == dec->start_len)
+			dec->start_whole = true;
+		if (dec->start_len > 0)
+		{
+			dec->replay = 0;
+			dec->rewind = !dec->start_whole;
+		}
+		else
+		{
+			res = S_CodecRewindStream (bgmstream);
+			if (res != 0)
+			{
+				dec->error = res;
+				return -BGM_DECODE_SEEK_ERROR;
+			}
+			dec->pos = 0;
+		}
+		return 0;
+	}
+	else if (res < 0) /* some read error */
+	{
+		dec->error = res;
+		return -BGM_DECODE_READ_ERROR;
+	}
+	return res;
+}
+
+/*
+=================
+BGM_DecodeTask
+=================
+*/
+static void BGM_DecodeTask (void *payload)
+{
+	bgmdecoder_t  *dec = *(bgmdecoder_t **)payload;
+	const int	   framesize = bgmstream->info.width * bgmstream->info.channels;
+	const uint32_t mask = dec->ring_size - 1;
+	uint32_t	   head = Atomic_LoadUInt32 (&dec->ring_head);
+
+	while (!Atomic_LoadUInt32 (&dec->quit))
+	{
+		const uint32_t space = dec->ring_size - (head - Atomic_LoadUInt32 (&dec->ring_tail));
+		int			   bytes = q_min (q_min (space, dec->ring_size - (head & mask)), BGM_DECODE_CHUNK);
+
+		bytes -= bytes % framesize;
+		if (bytes <= 0)
+			break;
+
+		const int res = BGM_Decode (dec, dec->ring + (head & mask), bytes);
+		if (res < 0)
+		{
+			Atomic_StoreUInt32 (&dec->status, -res);
+			break;
+		}
+		head += res;
+		Atomic_StoreUInt32 (&dec->ring_head, head);
+	}
+
+	Atomic_StoreUInt32 (&dec->busy, false);
+}
+
+/*
+=================
+BGM_KickDecoder
+
+Starts a decode task once a good part of the ring has been played
+=================
+*/
+static void BGM_KickDecoder (void)
+{
+	bgmdecoder_t *dec = bgmdecoder;
+
+	if (Atomic_LoadUInt32 (&dec->busy) || Atomic_LoadUInt32 (&dec->status) != BGM_DECODE_OK)
+		return;
+	if (dec->ring_size - (Atomic_LoadUInt32 (&dec->ring_head) - Atomic_LoadUInt32 (&dec->ring_tail)) < dec->ring_size / 4)
+		return;
+
+	if (dec->task != INVALID_TASK_HANDLE)
+		Task_Join (dec->task, SDL_MUTEX_MAXWAIT);
+	Atomic_StoreUInt32 (&dec->busy, true);
+	dec->task = Task_AllocateAssignFuncAndSubmit (BGM_DecodeTask, &dec, sizeof (dec));
+}
+
+/*
+=================
+BGM_HaltDecoder
+
+Waits for the decode task so the main thread may touch the stream
+=================
+*/
+static void BGM_HaltDecoder (void)
+{
+	bgmdecoder_t *dec = bgmdecoder;
+
+	if (dec->task == INVALID_TASK_HANDLE)
+		return;
+	Atomic_StoreUInt32 (&dec->quit, true);
+	Task_Join (dec->task, SDL_MUTEX_MAXWAIT);
+	Atomic_StoreUInt32 (&dec->quit, false);
+	dec->task = INVALID_TASK_HANDLE;
+}
+
+/*
+=================
+BGM_OpenStream
+=================
+*/
+static qboolean BGM_OpenStream (const char *filename, unsigned int type)
+{
+	bgmdecoder_t *dec;
+	int			  bytes_per_second;
+
+	bgmstream = S_CodecOpenStreamType (filename, type, bgmloop);
+	if (!bgmstream)
+		return false;
+
+	bytes_per_second = bgmstream->info.rate * bgmstream->info.width * bgmstream->info.channels;
+	dec = (bgmdecoder_t *)Mem_Alloc (sizeof (bgmdecoder_t));
+	dec->task = INVALID_TASK_HANDLE;
+	dec->ring_size = 1;
+	while (dec->ring_size < (uint32_t)(bytes_per_second * BGM_RING_SECONDS))
+		dec->ring_size <<= 1;
+	dec->ring = (byte *)Mem_AllocNonZero (dec->ring_size);
+	dec->start_size = bytes_per_second * BGM_HEAD_SECONDS;
+	dec->start = (byte *)Mem_AllocNonZero (dec->start_size);
+	dec->replay = -1;
+	bgmdecoder = dec;
+
+	BGM_KickDecoder ();
+	return true;
+}
+
 static void BGM_Play_f (void)
 {
 	if (Cmd_Argc () == 2)
@@ -106,7 +349,10 @@ static void BGM_Loop_f (void)
 			bgmloop = !bgmloop;
 
 		if (bgmstream)
+		{
+			BGM_HaltDecoder ();
 			bgmstream->loop = bgmloop;
+		}
 	}
 
 	if (bgmloop)
@@ -128,7 +374,13 @@ static void BGM_Jump_f (void)
 	}
 	else if (bgmstream)
 	{
+		BGM_HaltDecoder ();
 		S_CodecJumpToOrder (bgmstream, atoi (Cmd_Argv (1)));
+		/* drop what was decoded ahead, the start is still valid */
+		Atomic_StoreUInt32 (&bgmdecoder->ring_tail, Atomic_LoadUInt32 (&bgmdecoder->ring_head));
+		bgmdecoder->pos = -1;
+		bgmdecoder->replay = -1;
+		bgmdecoder->rewind = false;
 	}
 }
 
@@ -215,8 +467,7 @@ static void BGM_Play_noext (const char *filename, unsigned int allowed_types)
 			/* not supported in quake */
 			break;
 		case BGM_STREAMER:
-			bgmstream = S_CodecOpenStreamType (tmp, handler->type, bgmloop);
-			if (bgmstream)
+			if (BGM_OpenStream (tmp, handler->type))
 				return; /* success */
 			break;
 		case BGM_NONE:
@@ -272,8 +523,7 @@ void BGM_Play (const char *filename)
 		/* not supported in quake */
 		break;
 	case BGM_STREAMER:
-		bgmstream = S_CodecOpenStreamType (tmp, handler->type, bgmloop);
-		if (bgmstream)
+		if (BGM_OpenStream (tmp, handler->type))
 			return; /* success */
 		break;
 	case BGM_NONE:
@@ -335,8 +585,7 @@ void BGM_PlayCDtrack (byte track, qboolean looping)
 	else
 	{
 		q_snprintf (tmp, sizeof (tmp), "%s/track%02d.%s", MUSIC_DIRNAME, (int)track, ext);
-		bgmstream = S_CodecOpenStreamType (tmp, type, bgmloop);
-		if (!bgmstream)
+		if (!BGM_OpenStream (tmp, type))
 			Con_Printf ("Couldn't handle music file %s\n", tmp);
 	}
 }
@@ -345,6 +594,10 @@ void BGM_Stop (void)
 {
 	if (bgmstream)
 	{
+		BGM_HaltDecoder ();
+		Mem_Free (bgmdecoder->ring);
+		Mem_Free (bgmdecoder->start);
+		SAFE_FREE (bgmdecoder);
 		bgmstream->status = STREAM_NONE;
 		S_CodecCloseStream (bgmstream);
 		bgmstream = NULL;
@@ -372,12 +625,13 @@ void BGM_Resume (void)
 
 static void BGM_UpdateStream (void)
 {
-	qboolean did_rewind = false;
-	int		 res; /* Number of bytes read. */
-	int		 bufferSamples;
-	int		 fileSamples;
-	int		 fileBytes;
-	byte	 raw[16384];
+	bgmdecoder_t  *dec = bgmdecoder;
+	const int	   framesize = bgmstream->info.width * bgmstream->info.channels;
+	const uint32_t mask = dec->ring_size - 1;
+	uint32_t	   tail = Atomic_LoadUInt32 (&dec->ring_tail);
+	int			   bufferSamples;
+	int			   fileSamples;
+	int			   bytes;
 
 	if (bgmstream->status != STREAM_PLAY)
 		return;
@@ -394,65 +648,47 @@ static void BGM_UpdateStream (void)
 	{
 		bufferSamples = MAX_RAW_SAMPLES - (s_rawend - paintedtime);
 
-		/* decide how much data needs to be read from the file */
+		/* decide how much data needs to be taken from the ring */
 		fileSamples = bufferSamples * bgmstream->info.rate / shm->speed;
 		if (!fileSamples)
-			return;
+			break;
 
-		/* our max buffer size */
-		fileBytes = fileSamples * (bgmstream->info.width * bgmstream->info.channels);
-		if (fileBytes > (int)sizeof (raw))
-		{
-			fileBytes = (int)sizeof (raw);
-			fileSamples = fileBytes / (bgmstream->info.width * bgmstream->info.channels);
-		}
+		bytes = q_min ((uint32_t)(fileSamples * framesize), Atomic_LoadUInt32 (&dec->ring_head) - tail);
+		bytes = q_min ((uint32_t)bytes, dec->ring_size - (tail & mask));
+		if (bytes < framesize)
+			break;
 
-		/* Read */
-		res = S_CodecReadStream (bgmstream, fileBytes, raw);
-		if (res < fileBytes)
-		{
-			fileBytes = res;
-			fileSamples = res / (bgmstream->info.width * bgmstream->info.channels);
-		}
+		S_RawSamples (bytes / framesize, bgmstream->info.rate, bgmstream->info.width, bgmstream->info.channels, dec->ring + (tail & mask), bgmvolume.value);
+		tail += bytes;
+		Atomic_StoreUInt32 (&dec->ring_tail, tail);
+	}
 
-		if (res > 0) /* data: add to raw buffer */
-		{
-			S_RawSamples (fileSamples, bgmstream->info.rate, bgmstream->info.width, bgmstream->info.channels, raw, bgmvolume.value);
-			did_rewind = false;
-		}
-		else if (res == 0) /* EOF */
-		{
-			if (bgmloop)
-			{
-				if (did_rewind)
-				{
-					Con_Printf ("Stream keeps returning EOF.\n");
-					BGM_Stop ();
-					return;
-				}
-
-				res = S_CodecRewindStream (bgmstream);
-				if (res != 0)
-				{
-					Con_Printf ("Stream seek error (%i), stopping.\n", res);
-					BGM_Stop ();
-					return;
-				}
-				did_rewind = true;
-			}
-			else
-			{
-				BGM_Stop ();
-				return;
-			}
-		}
-		else /* res < 0: some read error */
+	/* the worker stopped: report it once everything it decoded was played */
+	if (Atomic_LoadUInt32 (&dec->ring_head) == tail && !Atomic_LoadUInt32 (&dec->busy))
+	{
+		switch (Atomic_LoadUInt32 (&dec->status))
 		{
-			Con_Printf ("Stream read error (%i), stopping.\n", res);
+		case BGM_DECODE_OK:
+			break;
+		case BGM_DECODE_FINISHED:
+			BGM_Stop ();
+			return;
+		case BGM_DECODE_READ_ERROR:
+			Con_Printf ("Stream read error (%i), stopping.\n", dec->error);
+			BGM_Stop ();
+			return;
+		case BGM_DECODE_SEEK_ERROR:
+			Con_Printf ("Stream seek error (%i), stopping.\n", dec->error);
+			BGM_Stop ();
+			return;
+		case BGM_DECODE_EOF_ERROR:
+			Con_Printf ("Stream keeps returning EOF.\n");
 			BGM_Stop ();
 			return;
 		}
 	}
+
+	BGM_KickDecoder ();
 }
 
 void BGM_Update (void)
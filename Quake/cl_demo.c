@@ -367,6 +367,7 @@ static void CL_Record_Prespawn (void)
 	}
 
 	// static sounds
+	SDL_LockMutex (snd_mutex); // keep the mixer thread off the channels
 	for (i = NUM_AMBIENTS; i < total_channels; i++)
 	{
 		channel_t  *ss = &snd_channels[i];
@@ -403,6 +404,7 @@ static void CL_Record_Prespawn (void)
 			SZ_Clear (&net_message);
 		}
 	}
+	SDL_UnlockMutex (snd_mutex);
 
 #ifdef PSET_SCRIPT
 	// particleindexes
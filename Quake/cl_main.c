@@ -96,17 +96,10 @@ void CL_FreeState (void)
 	for (i = 0; i < MAX_CL_STATS; i++)
 		Mem_Free (cl.statss[i]);
 	PR_ClearProgs (&cl.qcvm);
-	Mem_Free (cl.entities);
-	for (i = 0; i < cl.num_statics; i += 64)
-		Mem_Free (cl.static_entities[i]);
 	Mem_Free (cl.static_entities);
 	Mem_Free (cl.scores);
-	for (i = 0; i < MAX_PARTICLETYPES; ++i)
-		Mem_Free (cl.particle_precache[i].name);
-	for (i = 0; i < cl.num_efragallocs; ++i)
-		Mem_Free (cl.efrag_allocs[i]);
-	Mem_Free (cl.efrag_allocs);
 	memset (&cl, 0, sizeof (cl));
+	Mem_ArenaReset (MEM_TAG_CLIENT);
 }
 
 /*
@@ -133,10 +126,11 @@ void CL_ClearState (void)
 
 	// johnfitz -- cl_entities is now dynamically allocated
 	cl.max_edicts = CLAMP (MIN_EDICTS, (int)max_edicts.value, MAX_EDICTS);
-	cl.entities = (entity_t *)Mem_Alloc (cl.max_edicts * sizeof (entity_t));
+	cl.entities = (entity_t *)Mem_ArenaAlloc (MEM_TAG_CLIENT, cl.max_edicts * sizeof (entity_t));
 	// johnfitz
 
 	cl.viewent.netstate = nullentitystate;
+	CL_ClearPrediction ();
 #ifdef PSET_SCRIPT
 	// Spike -- this stuff needs to get reset to defaults.
 	PScript_Shutdown ();
@@ -622,67 +616,47 @@ static void CL_RocketTrail (entity_t *ent, int type)
 	VectorCopy (ent->origin, ent->trailorg);
 }
 
-/*
-===============
-CL_RelinkEntities
-===============
-*/
-void CL_RelinkEntities (void)
-{
-	entity_t *ent;
-	int		  i, j;
-	float	  frac, d;
-	float	  bobjrotate;
-	vec3_t	  oldorg;
-	dlight_t *dl;
-	float	  frametime;
-	int		  modelflags;
-
-	// determine partial update time
-	frac = CL_LerpPoint ();
-
-	frametime = cl.time - cl.oldtime;
-	if (frametime < 0)
-		frametime = 0;
-	if (frametime > 0.1)
-		frametime = 0.1;
-
-	if (cl_numvisedicts + 256 > cl_maxvisedicts)
-	{
-		cl_maxvisedicts += cl_maxvisedicts ? 256 : 4096;
-		cl_visedicts = Mem_Realloc (cl_visedicts, sizeof (*cl_visedicts) * cl_maxvisedicts);
-		cl_visedicts_alpha = Mem_Realloc (cl_visedicts_alpha, sizeof (*cl_visedicts_alpha) * cl_maxvisedicts);
-	}
-	cl_numvisedicts = 0;
+#define RELINK_CHUNK_SIZE 256
 
-	//
-	// interpolate player info
-	//
-	for (i = 0; i < 3; i++)
-		cl.velocity[i] = cl.mvelocity[1][i] + frac * (cl.mvelocity[0][i] - cl.mvelocity[1][i]);
+typedef struct
+{
+	int	   entnum;
+	vec3_t oldorg;
+} relink_candidate_t;
 
-	SCR_UpdateZoom ();
+typedef struct
+{
+	float frac;
+	float bobjrotate;
+} relink_args_t;
 
-	if (cls.demoplayback)
-	{
-		// interpolate the angles
-		for (j = 0; j < 3; j++)
-		{
-			d = cl.mviewangles[0][j] - cl.mviewangles[1][j];
-			if (d > 180)
-				d -= 360;
-			else if (d < -180)
-				d += 360;
-			cl.viewangles[j] = cl.mviewangles[1][j] + frac * d;
-		}
-	}
+static relink_candidate_t *relink_candidates; // RELINK_CHUNK_SIZE slots per chunk
+static int				  *relink_numcandidates;
+static qboolean			  *relink_removed;
+static int				   relink_maxchunks;
 
-	bobjrotate = anglemod (100 * cl.time);
+/*
+===============
+CL_LerpEntitiesTask
 
-	// start on the entity after the world
-	ent = (cl.entities != NULL) ? (cl.entities + 1) : NULL;
-	for (i = 1; i < cl.num_entities; i++, ent++)
+Interpolates one chunk of entities and collects the ones that are still in the snapshot
+into the chunk's candidate slice. Only touches the entities of the chunk, so chunks can
+run in parallel. Attachments, particles and dlights are left to CL_UpdateEntityEffects.
+===============
+*/
+static void CL_LerpEntitiesTask (int chunk, relink_args_t *args)
+{
+	const int			first = q_max (1, chunk * RELINK_CHUNK_SIZE);
+	const int			last = q_min (cl.num_entities, (chunk + 1) * RELINK_CHUNK_SIZE);
+	relink_candidate_t *candidates = relink_candidates + chunk * RELINK_CHUNK_SIZE;
+	int					numcandidates = 0;
+	qboolean			removed = false;
+	entity_t		   *ent;
+	int					i;
+
+	for (i = first; i < last; i++)
 	{
+		ent = &cl.entities[i];
 		if (!ent->model)
 		{ // empty slot, ish.
 
@@ -699,192 +673,326 @@ void CL_RelinkEntities (void)
 		{
 			ent->model = NULL;
 			ent->lerpflags |= LERP_RESETMOVE | LERP_RESETANIM; // johnfitz -- next time this entity slot is reused, the lerp will need to be reset
-			InvalidateTraceLineCache ();
+			removed = true;
 			continue;
 		}
 
-		VectorCopy (ent->origin, oldorg);
+		candidates[numcandidates].entnum = i;
+		VectorCopy (ent->origin, candidates[numcandidates].oldorg);
+		++numcandidates;
 
-		if (CL_LerpEntity (ent, ent->origin, ent->angles, frac))
+		if (CL_LerpEntity (ent, ent->origin, ent->angles, args->frac))
 			ent->lerpflags |= LERP_RESETMOVE;
 
 		if (cl.time < cl.oldtime)
 			ent->lerpflags |= LERP_RESETMOVE | LERP_RESETANIM;
 
-		if (ent->netstate.tagentity)
-			if (!CL_AttachEntity (ent, frac))
-			{
-				// can't draw it if we don't know where its parent is.
-				continue;
-			}
+		if (!ent->netstate.tagentity)
+		{
+			if (ent->forcelink || ent->lerpflags & LERP_RESETMOVE)
+				CL_ResetTrail (ent);
+
+			// rotate binary objects locally
+			if ((((ent->effects >> 24) & 0xff) | ent->model->flags) & EF_ROTATE)
+				ent->angles[1] = args->bobjrotate;
+		}
+	}
+
+	relink_numcandidates[chunk] = numcandidates;
+	relink_removed[chunk] = removed;
+}
+
+/*
+===============
+CL_UpdateEntityEffects
+
+Serial part of the relink: attachments, trails, particles and dlights.
+Returns false if the entity shouldn't be added to the visedicts.
+===============
+*/
+static qboolean CL_UpdateEntityEffects (entity_t *ent, int i, vec3_t oldorg, float frac, float frametime, float bobjrotate)
+{
+	dlight_t *dl;
+	int		  modelflags;
+
+	if (ent->netstate.tagentity)
+		if (!CL_AttachEntity (ent, frac))
+		{
+			// can't draw it if we don't know where its parent is.
+			return false;
+		}
 
-		modelflags = (ent->effects >> 24) & 0xff;
-		modelflags |= ent->model->flags;
+	modelflags = (ent->effects >> 24) & 0xff;
+	modelflags |= ent->model->flags;
 
+	if (ent->netstate.tagentity)
+	{
+		// attached entities were left alone by CL_LerpEntitiesTask because they need their parent's origin
 		if (ent->forcelink || ent->lerpflags & LERP_RESETMOVE)
 			CL_ResetTrail (ent);
 
 		// rotate binary objects locally
 		if (modelflags & EF_ROTATE)
 			ent->angles[1] = bobjrotate;
+	}
 
-		if (ent->effects & EF_BRIGHTFIELD)
-			R_EntityParticles (ent);
+	if (ent->effects & EF_BRIGHTFIELD)
+		R_EntityParticles (ent);
 
-		if (ent->effects & EF_MUZZLEFLASH)
-		{
-			vec3_t fv, rv, uv;
+	if (ent->effects & EF_MUZZLEFLASH)
+	{
+		vec3_t fv, rv, uv;
 
-			dl = CL_AllocDlight (i);
-			VectorCopy (ent->origin, dl->origin);
-			dl->origin[2] += 16;
-			AngleVectors (ent->angles, fv, rv, uv);
+		dl = CL_AllocDlight (i);
+		VectorCopy (ent->origin, dl->origin);
+		dl->origin[2] += 16;
+		AngleVectors (ent->angles, fv, rv, uv);
 
-			VectorMA (dl->origin, 18, fv, dl->origin);
-			dl->radius = 200 + (rand () & 31);
-			dl->minlight = 32;
-			dl->die = cl.time + 0.1;
+		VectorMA (dl->origin, 18, fv, dl->origin);
+		dl->radius = 200 + (rand () & 31);
+		dl->minlight = 32;
+		dl->die = cl.time + 0.1;
 
-			// johnfitz -- assume muzzle flash accompanied by muzzle flare, which looks bad when lerped
-			if (r_lerpmodels.value != 2)
-			{
-				if (ent == &cl.entities[cl.viewentity])
-					cl.viewent.lerpflags |= LERP_RESETANIM | LERP_RESETANIM2; // no lerping for two frames
-				else
-					ent->lerpflags |= LERP_RESETANIM | LERP_RESETANIM2; // no lerping for two frames
-			}
-			// johnfitz
-		}
-		if (ent->effects & EF_BRIGHTLIGHT)
+		// johnfitz -- assume muzzle flash accompanied by muzzle flare, which looks bad when lerped
+		if (r_lerpmodels.value != 2)
 		{
-			dl = CL_AllocDlight (i);
-			VectorCopy (ent->origin, dl->origin);
-			dl->origin[2] += 16;
-			dl->radius = 400 + (rand () & 31);
-			dl->die = cl.time + 0.001;
-		}
-		if (ent->effects & EF_DIMLIGHT)
-		{
-			dl = CL_AllocDlight (i);
-			VectorCopy (ent->origin, dl->origin);
-			dl->radius = 200 + (rand () & 31);
-			dl->die = cl.time + 0.001;
-		}
-		if (ent->effects & EF_QEX_QUADLIGHT)
-		{
-			dl = CL_AllocDlight (i);
-			VectorCopy (ent->origin, dl->origin);
-			dl->radius = 200 + (rand () & 31);
-			dl->die = cl.time + 0.001;
-			dl->color[0] = 0.25f;
-			dl->color[1] = 0.25f;
-			dl->color[2] = 1.0f;
-		}
-		if (ent->effects & EF_QEX_PENTALIGHT)
-		{
-			dl = CL_AllocDlight (i);
-			VectorCopy (ent->origin, dl->origin);
-			dl->radius = 200 + (rand () & 31);
-			dl->die = cl.time + 0.001;
-			dl->color[0] = 1.0f;
-			dl->color[1] = 0.25f;
-			dl->color[2] = 0.25f;
+			if (ent == &cl.entities[cl.viewentity])
+				cl.viewent.lerpflags |= LERP_RESETANIM | LERP_RESETANIM2; // no lerping for two frames
+			else
+				ent->lerpflags |= LERP_RESETANIM | LERP_RESETANIM2; // no lerping for two frames
 		}
+		// johnfitz
+	}
+	if (ent->effects & EF_BRIGHTLIGHT)
+	{
+		dl = CL_AllocDlight (i);
+		VectorCopy (ent->origin, dl->origin);
+		dl->origin[2] += 16;
+		dl->radius = 400 + (rand () & 31);
+		dl->die = cl.time + 0.001;
+	}
+	if (ent->effects & EF_DIMLIGHT)
+	{
+		dl = CL_AllocDlight (i);
+		VectorCopy (ent->origin, dl->origin);
+		dl->radius = 200 + (rand () & 31);
+		dl->die = cl.time + 0.001;
+	}
+	if (ent->effects & EF_QEX_QUADLIGHT)
+	{
+		dl = CL_AllocDlight (i);
+		VectorCopy (ent->origin, dl->origin);
+		dl->radius = 200 + (rand () & 31);
+		dl->die = cl.time + 0.001;
+		dl->color[0] = 0.25f;
+		dl->color[1] = 0.25f;
+		dl->color[2] = 1.0f;
+	}
+	if (ent->effects & EF_QEX_PENTALIGHT)
+	{
+		dl = CL_AllocDlight (i);
+		VectorCopy (ent->origin, dl->origin);
+		dl->radius = 200 + (rand () & 31);
+		dl->die = cl.time + 0.001;
+		dl->color[0] = 1.0f;
+		dl->color[1] = 0.25f;
+		dl->color[2] = 0.25f;
+	}
 
 #ifdef PSET_SCRIPT
-		if (cl.paused)
-			;
-		else if (ent->netstate.traileffectnum > 0 && ent->netstate.traileffectnum < MAX_PARTICLETYPES)
-		{
-			vec3_t axis[3];
-			AngleVectors (ent->angles, axis[0], axis[1], axis[2]);
-			PScript_ParticleTrail (oldorg, ent->origin, cl.particle_precache[ent->netstate.traileffectnum].index, frametime, i, axis, &ent->trailstate);
-		}
-		else if (ent->model->traileffect >= 0)
-		{
-			vec3_t axis[3];
-			AngleVectors (ent->angles, axis[0], axis[1], axis[2]);
-			PScript_ParticleTrail (oldorg, ent->origin, ent->model->traileffect, frametime, i, axis, &ent->trailstate);
-		}
-		else
+	if (cl.paused)
+		;
+	else if (ent->netstate.traileffectnum > 0 && ent->netstate.traileffectnum < MAX_PARTICLETYPES)
+	{
+		vec3_t axis[3];
+		AngleVectors (ent->angles, axis[0], axis[1], axis[2]);
+		PScript_ParticleTrail (oldorg, ent->origin, cl.particle_precache[ent->netstate.traileffectnum].index, frametime, i, axis, &ent->trailstate);
+	}
+	else if (ent->model->traileffect >= 0)
+	{
+		vec3_t axis[3];
+		AngleVectors (ent->angles, axis[0], axis[1], axis[2]);
+		PScript_ParticleTrail (oldorg, ent->origin, ent->model->traileffect, frametime, i, axis, &ent->trailstate);
+	}
+	else
 #else
 #define PScript_EntParticleTrail(a, b, c) 1
 #endif
-			if (ent->model->flags & EF_GIB)
-		{
-			if (PScript_EntParticleTrail (oldorg, ent, "TR_BLOOD"))
-				CL_RocketTrail (ent, 2);
-		}
-		else if (ent->model->flags & EF_ZOMGIB)
-		{
-			if (PScript_EntParticleTrail (oldorg, ent, "TR_SLIGHTBLOOD"))
-				CL_RocketTrail (ent, 4);
-		}
-		else if (ent->model->flags & EF_TRACER)
-		{
-			if (PScript_EntParticleTrail (oldorg, ent, "TR_WIZSPIKE"))
-				CL_RocketTrail (ent, 3);
-		}
-		else if (ent->model->flags & EF_TRACER2)
-		{
-			if (PScript_EntParticleTrail (oldorg, ent, "TR_KNIGHTSPIKE"))
-				CL_RocketTrail (ent, 5);
-		}
-		else if (ent->model->flags & EF_ROCKET)
-		{
-			if (PScript_EntParticleTrail (oldorg, ent, "TR_ROCKET"))
-				CL_RocketTrail (ent, 0);
-			dl = CL_AllocDlight (i);
-			VectorCopy (ent->origin, dl->origin);
-			dl->radius = 200;
-			dl->die = cl.time + 0.01;
-		}
-		else if (ent->model->flags & EF_GRENADE)
-		{
-			if (PScript_EntParticleTrail (oldorg, ent, "TR_GRENADE"))
-				CL_RocketTrail (ent, 1);
-		}
-		else if (ent->model->flags & EF_TRACER3)
-		{
-			if (PScript_EntParticleTrail (oldorg, ent, "TR_VORESPIKE"))
-				CL_RocketTrail (ent, 6);
-		}
+		if (ent->model->flags & EF_GIB)
+	{
+		if (PScript_EntParticleTrail (oldorg, ent, "TR_BLOOD"))
+			CL_RocketTrail (ent, 2);
+	}
+	else if (ent->model->flags & EF_ZOMGIB)
+	{
+		if (PScript_EntParticleTrail (oldorg, ent, "TR_SLIGHTBLOOD"))
+			CL_RocketTrail (ent, 4);
+	}
+	else if (ent->model->flags & EF_TRACER)
+	{
+		if (PScript_EntParticleTrail (oldorg, ent, "TR_WIZSPIKE"))
+			CL_RocketTrail (ent, 3);
+	}
+	else if (ent->model->flags & EF_TRACER2)
+	{
+		if (PScript_EntParticleTrail (oldorg, ent, "TR_KNIGHTSPIKE"))
+			CL_RocketTrail (ent, 5);
+	}
+	else if (ent->model->flags & EF_ROCKET)
+	{
+		if (PScript_EntParticleTrail (oldorg, ent, "TR_ROCKET"))
+			CL_RocketTrail (ent, 0);
+		dl = CL_AllocDlight (i);
+		VectorCopy (ent->origin, dl->origin);
+		dl->radius = 200;
+		dl->die = cl.time + 0.01;
+	}
+	else if (ent->model->flags & EF_GRENADE)
+	{
+		if (PScript_EntParticleTrail (oldorg, ent, "TR_GRENADE"))
+			CL_RocketTrail (ent, 1);
+	}
+	else if (ent->model->flags & EF_TRACER3)
+	{
+		if (PScript_EntParticleTrail (oldorg, ent, "TR_VORESPIKE"))
+			CL_RocketTrail (ent, 6);
+	}
 
-		ent->forcelink = false;
+	ent->forcelink = false;
 
 #ifdef PSET_SCRIPT
-		if (ent->netstate.emiteffectnum > 0)
+	if (ent->netstate.emiteffectnum > 0)
+	{
+		vec3_t axis[3];
+		AngleVectors (ent->angles, axis[0], axis[1], axis[2]);
+		if (ent->model->type == mod_alias)
+			axis[0][2] *= -1; // stupid vanilla bug
+		PScript_RunParticleEffectState (ent->origin, axis[0], frametime, cl.particle_precache[ent->netstate.emiteffectnum].index, &ent->emitstate);
+	}
+	else if (ent->model->emiteffect >= 0)
+	{
+		vec3_t axis[3];
+		AngleVectors (ent->angles, axis[0], axis[1], axis[2]);
+		if (ent->model->flags & MOD_EMITFORWARDS)
 		{
-			vec3_t axis[3];
-			AngleVectors (ent->angles, axis[0], axis[1], axis[2]);
 			if (ent->model->type == mod_alias)
 				axis[0][2] *= -1; // stupid vanilla bug
-			PScript_RunParticleEffectState (ent->origin, axis[0], frametime, cl.particle_precache[ent->netstate.emiteffectnum].index, &ent->emitstate);
 		}
-		else if (ent->model->emiteffect >= 0)
+		else
+			VectorScale (axis[2], -1, axis[0]);
+		PScript_RunParticleEffectState (ent->origin, axis[0], frametime, ent->model->emiteffect, &ent->emitstate);
+		if (ent->model->flags & MOD_EMITREPLACE)
+			return false;
+	}
+#endif
+
+	if (i == cl.viewentity && !chase_active.value)
+		return false;
+
+	return true;
+
+}
+
+/*
+===============
+CL_RelinkEntities
+===============
+*/
+void CL_RelinkEntities (void)
+{
+	int			  i, j, chunk, numchunks;
+	float		  frac, d;
+	float		  bobjrotate;
+	float		  frametime;
+	relink_args_t args;
+
+	// determine partial update time
+	frac = CL_LerpPoint ();
+
+	frametime = cl.time - cl.oldtime;
+	if (frametime < 0)
+		frametime = 0;
+	if (frametime > 0.1)
+		frametime = 0.1;
+
+	if (cl_numvisedicts + 256 > cl_maxvisedicts)
+	{
+		cl_maxvisedicts += cl_maxvisedicts ? 256 : 4096;
+		cl_visedicts = Mem_Realloc (cl_visedicts, sizeof (*cl_visedicts) * cl_maxvisedicts);
+		cl_visedicts_alpha = Mem_Realloc (cl_visedicts_alpha, sizeof (*cl_visedicts_alpha) * cl_maxvisedicts);
+	}
+	cl_numvisedicts = 0;
+
+	//
+	// interpolate player info
+	//
+	for (i = 0; i < 3; i++)
+		cl.velocity[i] = cl.mvelocity[1][i] + frac * (cl.mvelocity[0][i] - cl.mvelocity[1][i]);
+
+	SCR_UpdateZoom ();
+
+	if (cls.demoplayback)
+	{
+		// interpolate the angles
+		for (j = 0; j < 3; j++)
 		{
-			vec3_t axis[3];
-			AngleVectors (ent->angles, axis[0], axis[1], axis[2]);
-			if (ent->model->flags & MOD_EMITFORWARDS)
-			{
-				if (ent->model->type == mod_alias)
-					axis[0][2] *= -1; // stupid vanilla bug
-			}
-			else
-				VectorScale (axis[2], -1, axis[0]);
-			PScript_RunParticleEffectState (ent->origin, axis[0], frametime, ent->model->emiteffect, &ent->emitstate);
-			if (ent->model->flags & MOD_EMITREPLACE)
-				continue;
+			d = cl.mviewangles[0][j] - cl.mviewangles[1][j];
+			if (d > 180)
+				d -= 360;
+			else if (d < -180)
+				d += 360;
+			cl.viewangles[j] = cl.mviewangles[1][j] + frac * d;
 		}
-#endif
+	}
 
-		if (i == cl.viewentity && !chase_active.value)
-			continue;
+	bobjrotate = anglemod (100 * cl.time);
+
+	//
+	// interpolate entities, in parallel if there are enough of them
+	//
+	numchunks = (cl.entities != NULL) ? (cl.num_entities + RELINK_CHUNK_SIZE - 1) / RELINK_CHUNK_SIZE : 0;
+	if (numchunks > relink_maxchunks)
+	{
+		relink_maxchunks = numchunks;
+		relink_candidates = Mem_Realloc (relink_candidates, sizeof (*relink_candidates) * RELINK_CHUNK_SIZE * relink_maxchunks);
+		relink_numcandidates = Mem_Realloc (relink_numcandidates, sizeof (*relink_numcandidates) * relink_maxchunks);
+		relink_removed = Mem_Realloc (relink_removed, sizeof (*relink_removed) * relink_maxchunks);
+	}
 
-		if (cl_numvisedicts < cl_maxvisedicts)
+	args.frac = frac;
+	args.bobjrotate = bobjrotate;
+	if (numchunks > 1 && Tasks_NumWorkers () > 1)
+	{
+		task_handle_t task =
+			Task_AllocateAssignIndexedFuncAndSubmit ((task_indexed_func_t)CL_LerpEntitiesTask, numchunks, &args, sizeof (args));
+		Task_Join (task, SDL_MUTEX_MAXWAIT);
+	}
+	else
+		for (chunk = 0; chunk < numchunks; chunk++)
+			CL_LerpEntitiesTask (chunk, &args);
+
+	//
+	// merge the chunks in entity order, applying the side effects serially so the results don't depend on scheduling
+	//
+	for (chunk = 0; chunk < numchunks; chunk++)
+	{
+		relink_candidate_t *candidates = relink_candidates + chunk * RELINK_CHUNK_SIZE;
+
+		if (relink_removed[chunk])
+			InvalidateTraceLineCache ();
+
+		for (j = 0; j < relink_numcandidates[chunk]; j++)
 		{
-			cl_visedicts[cl_numvisedicts] = ent;
-			cl_numvisedicts++;
+			entity_t *ent = &cl.entities[candidates[j].entnum];
+
+			if (!CL_UpdateEntityEffects (ent, candidates[j].entnum, candidates[j].oldorg, frac, frametime, bobjrotate))
+				continue;
+
+			if (cl_numvisedicts < cl_maxvisedicts)
+			{
+				cl_visedicts[cl_numvisedicts] = ent;
+				cl_numvisedicts++;
+			}
 		}
 	}
 
@@ -906,7 +1014,7 @@ int CL_GenerateRandomParticlePrecache (const char *pname)
 	{
 		if (!cl.particle_precache[i].name)
 		{
-			cl.particle_precache[i].name = q_strdup (pname);
+			cl.particle_precache[i].name = Mem_ArenaStrdup (MEM_TAG_CLIENT, pname);
 			cl.particle_precache[i].index = PScript_FindParticleType (cl.particle_precache[i].name);
 			return i;
 		}
@@ -954,6 +1062,7 @@ int CL_ReadFromServer (void)
 		Con_Printf ("\n");
 
 	CL_RelinkEntities ();
+	CL_PredictMove ();
 	needs_relink = false;
 	CL_UpdateTEnts ();
 
@@ -1042,6 +1151,9 @@ void CL_SendCmd (void)
 	cmd.seconds = cmd.servertime - cl.pendingcmd.servertime;
 
 	CL_FinishMove (&cmd);
+#ifdef _DEBUG
+	CL_PredictionTestInput (&cmd);
+#endif
 
 	if (cls.signon == SIGNONS)
 		CL_SendMove (&cmd); // send the unreliable message
@@ -1187,6 +1299,7 @@ void CL_Init (void)
 
 	CL_InitInput ();
 	CL_InitTEnts ();
+	CL_InitPrediction ();
 
 	Cvar_RegisterVariable (&cl_name);
 	Cvar_RegisterVariable (&cl_color);
@@ -0,0 +1,105 @@
+/*
+ * cl_null.c -- client stubs for the dedicated server build
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "quakedef.h"
+
+client_static_t cls;
+client_state_t	cl;
+
+dlight_t cl_dlights[MAX_DLIGHTS];
+entity_t cl_temp_entities[MAX_TEMP_ENTITIES];
+beam_t	 cl_beams[MAX_BEAMS];
+
+int fragsort[MAX_SCOREBOARD];
+int scoreboardlines;
+
+enum m_state_e m_state;
+enum m_state_e m_return_state;
+qboolean	   m_return_onerror;
+char		   m_return_reason[32];
+
+// never registered, but read by code shared with the client
+cvar_t cl_name = {"_cl_name", "player", CVAR_ARCHIVE};
+cvar_t cl_color = {"_cl_color", "0", CVAR_ARCHIVE};
+cvar_t cl_startdemos = {"cl_startdemos", "1", CVAR_ARCHIVE};
+
+void CL_Init (void) {}
+
+void CL_FreeState (void)
+{
+	memset (&cl, 0, sizeof (cl));
+}
+
+void CL_EstablishConnection (const char *host) {}
+
+void CL_Disconnect (void) {}
+
+void CL_Disconnect_f (void) {}
+
+void CL_NextDemo (void) {}
+
+void CL_StopPlayback (void) {}
+
+void CL_Stop_f (void) {}
+
+void CL_Resume_Record (qboolean recordsignons) {}
+
+void CL_AccumulateCmd (void) {}
+
+void CL_SendCmd (void) {}
+
+int CL_ReadFromServer (void)
+{
+	return 0;
+}
+
+void CL_RunParticles (void) {}
+
+void CL_DecayLights (void) {}
+
+dlight_t *CL_AllocDlight (int key)
+{
+	memset (&cl_dlights[0], 0, sizeof (cl_dlights[0]));
+	return &cl_dlights[0];
+}
+
+void CL_UpdateBeam (qmodel_t *m, const char *trailname, const char *impactname, int ent, float *start, float *end) {}
+
+void Chase_Init (void) {}
+
+void V_Init (void) {}
+
+void V_ResetBlend (void) {}
+
+float V_CalcRoll (vec3_t angles, vec3_t velocity)
+{
+	return 0.0f;
+}
+
+void Sbar_Init (void) {}
+
+void M_Init (void) {}
+
+void M_NewGame (void) {}
+
+void M_UpdateMouse () {}
+
+void M_Menu_Main_f (void) {}
+
+void M_Menu_Quit_f (void) {}
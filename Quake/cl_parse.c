@@ -123,9 +123,9 @@ entity_t *CL_EntityNum (int num)
 	return &cl.entities[num];
 }
 
-static int MSG_ReadSize16 (sizebuf_t *sb)
+static int MSG_ReadSize16 (msg_reader_t *reader)
 {
-	unsigned short ssolid = MSG_ReadShort ();
+	unsigned short ssolid = MSGR_ReadShort (reader);
 	if (ssolid == ES_SOLID_BSP)
 		return ssolid;
 	else
@@ -136,25 +136,25 @@ static int MSG_ReadSize16 (sizebuf_t *sb)
 		return solid;
 	}
 }
-static unsigned int CLFTE_ReadDelta (unsigned int entnum, entity_state_t *news, const entity_state_t *olds, const entity_state_t *baseline)
+static unsigned int CLFTE_ReadDelta (msg_reader_t *reader, unsigned int entnum, entity_state_t *news, const entity_state_t *olds, const entity_state_t *baseline)
 {
 	unsigned int predbits = 0;
 	unsigned int bits;
 
-	bits = MSG_ReadByte ();
+	bits = MSGR_ReadByte (reader);
 	if (bits & UF_EXTEND1)
-		bits |= MSG_ReadByte () << 8;
+		bits |= MSGR_ReadByte (reader) << 8;
 	if (bits & UF_EXTEND2)
-		bits |= MSG_ReadByte () << 16;
+		bits |= MSGR_ReadByte (reader) << 16;
 	if (bits & UF_EXTEND3)
-		bits |= MSG_ReadByte () << 24;
+		bits |= MSGR_ReadByte (reader) << 24;
 
 	if (cl_shownet.value >= 3)
-		Con_SafePrintf ("%3i:     Update %4i 0x%x\n", msg_readcount, entnum, bits);
+		Con_SafePrintf ("%3i:     Update %4i 0x%x\n", reader->readcount, entnum, bits);
 
 	if (bits & UF_RESET)
 	{
-		//		Con_Printf("%3i: Reset %i @ %i\n", msg_readcount, entnum, cls.netchan.incoming_sequence);
+		//		Con_Printf("%3i: Reset %i @ %i\n", reader->readcount, entnum, cls.netchan.incoming_sequence);
 		*news = *baseline;
 	}
 	else if (!olds)
@@ -179,47 +179,47 @@ static unsigned int CLFTE_ReadDelta (unsigned int entnum, entity_state_t *news,
 	if (bits & UF_FRAME)
 	{
 		if (bits & UF_16BIT)
-			news->frame = MSG_ReadShort ();
+			news->frame = MSGR_ReadShort (reader);
 		else
-			news->frame = MSG_ReadByte ();
+			news->frame = MSGR_ReadByte (reader);
 	}
 
 	if (bits & UF_ORIGINXY)
 	{
-		news->origin[0] = MSG_ReadCoord (cl.protocolflags);
-		news->origin[1] = MSG_ReadCoord (cl.protocolflags);
+		news->origin[0] = MSGR_ReadCoord (reader, cl.protocolflags);
+		news->origin[1] = MSGR_ReadCoord (reader, cl.protocolflags);
 	}
 	if (bits & UF_ORIGINZ)
-		news->origin[2] = MSG_ReadCoord (cl.protocolflags);
+		news->origin[2] = MSGR_ReadCoord (reader, cl.protocolflags);
 
 	if ((bits & UF_PREDINFO) && !(cl.protocol_pext2 & PEXT2_PREDINFO))
 	{
 		// predicted stuff gets more precise angles
 		if (bits & UF_ANGLESXZ)
 		{
-			news->angles[0] = MSG_ReadAngle16 (cl.protocolflags);
-			news->angles[2] = MSG_ReadAngle16 (cl.protocolflags);
+			news->angles[0] = MSGR_ReadAngle16 (reader, cl.protocolflags);
+			news->angles[2] = MSGR_ReadAngle16 (reader, cl.protocolflags);
 		}
 		if (bits & UF_ANGLESY)
-			news->angles[1] = MSG_ReadAngle16 (cl.protocolflags);
+			news->angles[1] = MSGR_ReadAngle16 (reader, cl.protocolflags);
 	}
 	else
 	{
 		if (bits & UF_ANGLESXZ)
 		{
-			news->angles[0] = MSG_ReadAngle (cl.protocolflags);
-			news->angles[2] = MSG_ReadAngle (cl.protocolflags);
+			news->angles[0] = MSGR_ReadAngle (reader, cl.protocolflags);
+			news->angles[2] = MSGR_ReadAngle (reader, cl.protocolflags);
 		}
 		if (bits & UF_ANGLESY)
-			news->angles[1] = MSG_ReadAngle (cl.protocolflags);
+			news->angles[1] = MSGR_ReadAngle (reader, cl.protocolflags);
 	}
 
 	if ((bits & (UF_EFFECTS | UF_EFFECTS2)) == (UF_EFFECTS | UF_EFFECTS2))
-		news->effects = MSG_ReadLong ();
+		news->effects = MSGR_ReadLong (reader);
 	else if (bits & UF_EFFECTS2)
-		news->effects = (unsigned short)MSG_ReadShort ();
+		news->effects = (unsigned short)MSGR_ReadShort (reader);
 	else if (bits & UF_EFFECTS)
-		news->effects = MSG_ReadByte ();
+		news->effects = MSGR_ReadByte (reader);
 
 	//	news->movement[0] = 0;
 	//	news->movement[1] = 0;
@@ -229,26 +229,26 @@ static unsigned int CLFTE_ReadDelta (unsigned int entnum, entity_state_t *news,
 	news->velocity[2] = 0;
 	if (bits & UF_PREDINFO)
 	{
-		predbits = MSG_ReadByte ();
+		predbits = MSGR_ReadByte (reader);
 
 		if (predbits & UFP_FORWARD)
-			/*news->movement[0] =*/MSG_ReadShort ();
+			/*news->movement[0] =*/MSGR_ReadShort (reader);
 		// else
 		//	news->movement[0] = 0;
 		if (predbits & UFP_SIDE)
-			/*news->movement[1] =*/MSG_ReadShort ();
+			/*news->movement[1] =*/MSGR_ReadShort (reader);
 		// else
 		//	news->movement[1] = 0;
 		if (predbits & UFP_UP)
-			/*news->movement[2] =*/MSG_ReadShort ();
+			/*news->movement[2] =*/MSGR_ReadShort (reader);
 		// else
 		//	news->movement[2] = 0;
 		if (predbits & UFP_MOVETYPE)
-			news->pmovetype = MSG_ReadByte ();
+			news->pmovetype = MSGR_ReadByte (reader);
 		if (predbits & UFP_VELOCITYXY)
 		{
-			news->velocity[0] = MSG_ReadShort ();
-			news->velocity[1] = MSG_ReadShort ();
+			news->velocity[0] = MSGR_ReadShort (reader);
+			news->velocity[1] = MSGR_ReadShort (reader);
 		}
 		else
 		{
@@ -256,11 +256,11 @@ static unsigned int CLFTE_ReadDelta (unsigned int entnum, entity_state_t *news,
 			news->velocity[1] = 0;
 		}
 		if (predbits & UFP_VELOCITYZ)
-			news->velocity[2] = MSG_ReadShort ();
+			news->velocity[2] = MSGR_ReadShort (reader);
 		else
 			news->velocity[2] = 0;
 		if (predbits & UFP_MSEC) // the msec value is how old the update is (qw clients normally predict without the server running an update every frame)
-			/*news->msec =*/MSG_ReadByte ();
+			/*news->msec =*/MSGR_ReadByte (reader);
 		// else
 		//	news->msec = 0;
 
@@ -270,11 +270,11 @@ static unsigned int CLFTE_ReadDelta (unsigned int entnum, entity_state_t *news,
 			{
 				if (bits & UF_ANGLESXZ)
 				{
-					/*news->vangle[0] =*/MSG_ReadShort ();
-					/*news->vangle[2] =*/MSG_ReadShort ();
+					/*news->vangle[0] =*/MSGR_ReadShort (reader);
+					/*news->vangle[2] =*/MSGR_ReadShort (reader);
 				}
 				if (bits & UF_ANGLESY)
-					/*news->vangle[1] =*/MSG_ReadShort ();
+					/*news->vangle[1] =*/MSGR_ReadShort (reader);
 			}
 		}
 		else
@@ -282,9 +282,9 @@ static unsigned int CLFTE_ReadDelta (unsigned int entnum, entity_state_t *news,
 			if (predbits & UFP_WEAPONFRAME_OLD)
 			{
 				int wframe;
-				wframe = MSG_ReadByte ();
+				wframe = MSGR_ReadByte (reader);
 				if (wframe & 0x80)
-					wframe = (wframe & 127) | (MSG_ReadByte () << 7);
+					wframe = (wframe & 127) | (MSGR_ReadByte (reader) << 7);
 			}
 		}
 	}
@@ -307,49 +307,49 @@ static unsigned int CLFTE_ReadDelta (unsigned int entnum, entity_state_t *news,
 	if (bits & UF_MODEL)
 	{
 		if (bits & UF_16BIT)
-			news->modelindex = MSG_ReadShort ();
+			news->modelindex = MSGR_ReadShort (reader);
 		else
-			news->modelindex = MSG_ReadByte ();
+			news->modelindex = MSGR_ReadByte (reader);
 	}
 	if (bits & UF_SKIN)
 	{
 		if (bits & UF_16BIT)
-			news->skin = MSG_ReadShort ();
+			news->skin = MSGR_ReadShort (reader);
 		else
-			news->skin = MSG_ReadByte ();
+			news->skin = MSGR_ReadByte (reader);
 	}
 	if (bits & UF_COLORMAP)
-		news->colormap = MSG_ReadByte ();
+		news->colormap = MSGR_ReadByte (reader);
 
 	if (bits & UF_SOLID)
-		/*news->solidsize =*/MSG_ReadSize16 (&net_message);
+		/*news->solidsize =*/MSG_ReadSize16 (reader);
 
 	if (bits & UF_FLAGS)
-		news->eflags = MSG_ReadByte ();
+		news->eflags = MSGR_ReadByte (reader);
 
 	if (bits & UF_ALPHA)
-		news->alpha = (MSG_ReadByte () + 1) & 0xff;
+		news->alpha = (MSGR_ReadByte (reader) + 1) & 0xff;
 	if (bits & UF_SCALE)
-		news->scale = MSG_ReadByte ();
+		news->scale = MSGR_ReadByte (reader);
 	if (bits & UF_BONEDATA)
 	{
-		unsigned char fl = MSG_ReadByte ();
+		unsigned char fl = MSGR_ReadByte (reader);
 		if (fl & 0x80)
 		{
 			// this is NOT finalized
 			int i;
-			int bonecount = MSG_ReadByte ();
+			int bonecount = MSGR_ReadByte (reader);
 			// short *bonedata = AllocateBoneSpace(newp, bonecount, &news->boneoffset);
 			for (i = 0; i < bonecount * 7; i++) /*bonedata[i] =*/
-				MSG_ReadShort ();
+				MSGR_ReadShort (reader);
 			// news->bonecount = bonecount;
 		}
 		// else
 		// news->bonecount = 0;	//oo, it went away.
 		if (fl & 0x40)
 		{
-			/*news->basebone =*/MSG_ReadByte ();
-			/*news->baseframe =*/MSG_ReadShort ();
+			/*news->basebone =*/MSGR_ReadByte (reader);
+			/*news->baseframe =*/MSGR_ReadShort (reader);
 		}
 		/*else
 		{
@@ -369,34 +369,34 @@ static unsigned int CLFTE_ReadDelta (unsigned int entnum, entity_state_t *news,
 
 	if (bits & UF_DRAWFLAGS)
 	{
-		int drawflags = MSG_ReadByte ();
+		int drawflags = MSGR_ReadByte (reader);
 		if ((drawflags & /*MLS_MASK*/ 7) == /*MLS_ABSLIGHT*/ 7)
-			/*news->abslight =*/MSG_ReadByte ();
+			/*news->abslight =*/MSGR_ReadByte (reader);
 		// else
 		//	news->abslight = 0;
 		// news->drawflags = drawflags;
 	}
 	if (bits & UF_TAGINFO)
 	{
-		news->tagentity = MSG_ReadEntity (cl.protocol_pext2);
-		news->tagindex = MSG_ReadByte ();
+		news->tagentity = MSGR_ReadEntity (reader, cl.protocol_pext2);
+		news->tagindex = MSGR_ReadByte (reader);
 	}
 	if (bits & UF_LIGHT)
 	{
-		/*news->light[0] =*/MSG_ReadShort ();
-		/*news->light[1] =*/MSG_ReadShort ();
-		/*news->light[2] =*/MSG_ReadShort ();
-		/*news->light[3] =*/MSG_ReadShort ();
-		/*news->lightstyle =*/MSG_ReadByte ();
-		/*news->lightpflags =*/MSG_ReadByte ();
+		/*news->light[0] =*/MSGR_ReadShort (reader);
+		/*news->light[1] =*/MSGR_ReadShort (reader);
+		/*news->light[2] =*/MSGR_ReadShort (reader);
+		/*news->light[3] =*/MSGR_ReadShort (reader);
+		/*news->lightstyle =*/MSGR_ReadByte (reader);
+		/*news->lightpflags =*/MSGR_ReadByte (reader);
 	}
 	if (bits & UF_TRAILEFFECT)
 	{
-		unsigned short v = MSG_ReadShort ();
+		unsigned short v = MSGR_ReadShort (reader);
 		news->emiteffectnum = 0;
 		news->traileffectnum = v & 0x3fff;
 		if (v & 0x8000)
-			news->emiteffectnum = MSG_ReadShort () & 0x3fff;
+			news->emiteffectnum = MSGR_ReadShort (reader) & 0x3fff;
 		if (news->traileffectnum >= MAX_PARTICLETYPES)
 			news->traileffectnum = 0;
 		if (news->emiteffectnum >= MAX_PARTICLETYPES)
@@ -405,36 +405,36 @@ static unsigned int CLFTE_ReadDelta (unsigned int entnum, entity_state_t *news,
 
 	if (bits & UF_COLORMOD)
 	{
-		news->colormod[0] = MSG_ReadByte ();
-		news->colormod[1] = MSG_ReadByte ();
-		news->colormod[2] = MSG_ReadByte ();
+		news->colormod[0] = MSGR_ReadByte (reader);
+		news->colormod[1] = MSGR_ReadByte (reader);
+		news->colormod[2] = MSGR_ReadByte (reader);
 	}
 	if (bits & UF_GLOW)
 	{
-		/*news->glowsize =*/MSG_ReadByte ();
-		/*news->glowcolour =*/MSG_ReadByte ();
-		/*news->glowmod[0] =*/MSG_ReadByte ();
-		/*news->glowmod[1] =*/MSG_ReadByte ();
-		/*news->glowmod[2] =*/MSG_ReadByte ();
+		/*news->glowsize =*/MSGR_ReadByte (reader);
+		/*news->glowcolour =*/MSGR_ReadByte (reader);
+		/*news->glowmod[0] =*/MSGR_ReadByte (reader);
+		/*news->glowmod[1] =*/MSGR_ReadByte (reader);
+		/*news->glowmod[2] =*/MSGR_ReadByte (reader);
 	}
 	if (bits & UF_FATNESS)
-		/*news->fatness =*/MSG_ReadByte ();
+		/*news->fatness =*/MSGR_ReadByte (reader);
 	if (bits & UF_MODELINDEX2)
 	{
 		if (bits & UF_16BIT)
-			/*news->modelindex2 =*/MSG_ReadShort ();
+			/*news->modelindex2 =*/MSGR_ReadShort (reader);
 		else
-			/*news->modelindex2 =*/MSG_ReadByte ();
+			/*news->modelindex2 =*/MSGR_ReadByte (reader);
 	}
 	if (bits & UF_GRAVITYDIR)
 	{
-		/*news->gravitydir[0] =*/MSG_ReadByte ();
-		/*news->gravitydir[1] =*/MSG_ReadByte ();
+		/*news->gravitydir[0] =*/MSGR_ReadByte (reader);
+		/*news->gravitydir[1] =*/MSGR_ReadByte (reader);
 	}
 	if (bits & UF_UNUSED2)
 	{
 #ifdef LERP_BANDAID
-		news->lerp = MSG_ReadShort ();
+		news->lerp = MSGR_ReadShort (reader);
 #else
 		Host_EndGame ("UF_UNUSED2 bit\n");
 #endif
@@ -447,7 +447,10 @@ static unsigned int CLFTE_ReadDelta (unsigned int entnum, entity_state_t *news,
 }
 static void CLFTE_ParseBaseline (entity_state_t *es)
 {
-	CLFTE_ReadDelta (0, es, &nullentitystate, &nullentitystate);
+	msg_reader_t reader;
+	MSGR_FromNetMessage (&reader);
+	CLFTE_ReadDelta (&reader, 0, es, &nullentitystate, &nullentitystate);
+	MSGR_ToNetMessage (&reader);
 }
 
 // called with both fte+dp deltas
@@ -556,24 +559,27 @@ static void CL_EntitiesDeltaed (void)
 
 static void CLFTE_ParseEntitiesUpdate (void)
 {
-	int		  newnum;
-	qboolean  removeflag;
-	entity_t *ent;
-	float	  newtime;
+	int			 newnum;
+	qboolean	 removeflag;
+	entity_t	*ent;
+	float		 newtime;
+	msg_reader_t reader;
 
 	// so the server can know when we got it, and guess which frames we didn't get
 	if (cls.netcon && cl.ackframes_count < sizeof (cl.ackframes) / sizeof (cl.ackframes[0]))
 		cl.ackframes[cl.ackframes_count++] = NET_QSocketGetSequenceIn (cls.netcon);
 
+	MSGR_FromNetMessage (&reader);
+
 	if (cl.protocol_pext2 & PEXT2_PREDINFO)
 	{
-		int seq = (cl.movemessages & 0xffff0000) | (unsigned short)MSG_ReadShort (); // an ack from our input sequences. strictly ascending-or-equal
+		int seq = (cl.movemessages & 0xffff0000) | (unsigned short)MSGR_ReadShort (&reader); // an ack from our input sequences. strictly ascending-or-equal
 		if (seq > cl.movemessages)
 			seq -= 0x10000; // check for cl.movemessages overflowing the low 16 bits, and compensate.
 		cl.ackedmovemessages = seq;
 	}
 
-	newtime = MSG_ReadFloat ();
+	newtime = MSGR_ReadFloat (&reader);
 	if (newtime != cl.mtime[0])
 	{ // don't mess up lerps if the server is splitting entities into multiple packets.
 		cl.mtime[1] = cl.mtime[0];
@@ -582,14 +588,14 @@ static void CLFTE_ParseEntitiesUpdate (void)
 
 	for (;;)
 	{
-		newnum = (unsigned short)(short)MSG_ReadShort ();
+		newnum = (unsigned short)(short)MSGR_ReadShort (&reader);
 		removeflag = !!(newnum & 0x8000);
 		if (newnum & 0x4000)
-			newnum = (newnum & 0x3fff) | (MSG_ReadByte () << 14);
+			newnum = (newnum & 0x3fff) | (MSGR_ReadByte (&reader) << 14);
 		else
 			newnum &= ~0x8000;
 
-		if ((!newnum && !removeflag) || msg_badread)
+		if ((!newnum && !removeflag) || reader.badread)
 			break;
 
 		ent = CL_EntityNum (newnum);
@@ -597,13 +603,13 @@ static void CLFTE_ParseEntitiesUpdate (void)
 		if (removeflag)
 		{ // removal.
 			if (cl_shownet.value >= 3)
-				Con_SafePrintf ("%3i:     Remove %i\n", msg_readcount, newnum);
+				Con_SafePrintf ("%3i:     Remove %i\n", reader.readcount, newnum);
 
 			if (!newnum)
 			{
 				/*removal of world - means forget all entities, aka a full reset*/
 				if (cl_shownet.value >= 3)
-					Con_SafePrintf ("%3i:     Reset all\n", msg_readcount);
+					Con_SafePrintf ("%3i:     Reset all\n", reader.readcount);
 				for (newnum = 1; newnum < cl.num_entities; newnum++)
 				{
 					CL_EntityNum (newnum)->netstate.pmovetype = 0;
@@ -620,7 +626,7 @@ static void CLFTE_ParseEntitiesUpdate (void)
 		}
 		else if (ent->update_type)
 		{ // simple update
-			CLFTE_ReadDelta (newnum, &ent->netstate, &ent->netstate, &ent->baseline);
+			CLFTE_ReadDelta (&reader, newnum, &ent->netstate, &ent->netstate, &ent->baseline);
 			if (ent->msgtime == cl.mtime[0])
 				// we did get an update for this entity, force processing by CL_EntitiesDeltaed
 				// even if qcvm time is frozen (sv_freezenonclients support)
@@ -629,12 +635,13 @@ static void CLFTE_ParseEntitiesUpdate (void)
 		else
 		{ // we had no previous copy of this entity...
 			ent->update_type = true;
-			CLFTE_ReadDelta (newnum, &ent->netstate, NULL, &ent->baseline);
+			CLFTE_ReadDelta (&reader, newnum, &ent->netstate, NULL, &ent->baseline);
 
 			// stupid interpolation junk.
 			ent->lerpflags |= LERP_RESETMOVE | LERP_RESETANIM;
 		}
 	}
+	MSGR_ToNetMessage (&reader);
 
 	CL_EntitiesDeltaed ();
 
@@ -1479,7 +1486,7 @@ static void CL_ParseStatic (int version) // johnfitz -- added a parameter
 	{
 		int		   ec = 64;
 		entity_t **newstatics = Mem_Realloc (cl.static_entities, sizeof (*newstatics) * (cl.max_static_entities + ec));
-		entity_t  *newents = Mem_Alloc (sizeof (*newents) * ec);
+		entity_t  *newents = Mem_ArenaAlloc (MEM_TAG_CLIENT, sizeof (*newents) * ec);
 		if (!newstatics || !newents)
 			Host_Error ("Too many static entities");
 		cl.static_entities = newstatics;
@@ -1565,12 +1572,12 @@ static void CL_ParsePrecache (void)
 		{
 			if (*name)
 			{
-				cl.particle_precache[index].name = q_strdup (name);
+				cl.particle_precache[index].name = Mem_ArenaStrdup (MEM_TAG_CLIENT, name);
 				cl.particle_precache[index].index = PScript_FindParticleType (cl.particle_precache[index].name);
 			}
 			else
 			{
-				SAFE_FREE (cl.particle_precache[index].name);
+				cl.particle_precache[index].name = NULL;
 				cl.particle_precache[index].index = -1;
 			}
 		}
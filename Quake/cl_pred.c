@@ -0,0 +1,1216 @@
+/*
+Copyright (C) 1996-2001 Id Software, Inc.
+Copyright (C) 2002-2009 John Fitzgibbons and others
+Copyright (C) 2010-2014 QuakeSpasm developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// cl_pred.c -- client side player movement prediction
+
+#include "quakedef.h"
+
+/*
+
+The server acks the last movement command it applied to the player (PEXT2_PREDINFO)
+and sends the player's origin, velocity and movetype along with it. Starting from that
+state, every command the server has not acknowledged yet is replayed through a copy of
+SV_ClientThink / SV_Physics_Client that traces against cl.worldmodel and the brush
+entities the client knows about.
+
+The physics settings (gravity, friction, speeds) come from the server's serverinfo,
+which the server keeps up to date with "svi" for PEXT2_PREDINFO clients. Without them,
+or without a movetype (sv_predictmovetype on the server), nothing is predicted.
+
+When the server state comes back different from what was predicted for the same command,
+the difference is folded into a view offset that decays over cl_prediction_smooth
+seconds instead of snapping the view.
+
+*/
+
+cvar_t cl_prediction = {"cl_prediction", "0", CVAR_ARCHIVE};
+cvar_t cl_prediction_smooth = {"cl_prediction_smooth", "0.1", CVAR_ARCHIVE};
+
+extern kbutton_t in_jump;
+
+int SV_HullPointContents (hull_t *hull, int num, vec3_t p);
+int ClipVelocity (vec3_t in, vec3_t normal, vec3_t out, float overbounce);
+
+#define STOP_EPSILON	0.1
+#define MAX_CLIP_PLANES 5
+#define STEPSIZE		18
+#define MAX_FRAMETIME	0.1f
+#define SNAP_DISTANCE	64.0f
+
+static vec3_t player_mins = {-16, -16, -24};
+static vec3_t player_maxs = {16, 16, 32};
+
+typedef struct
+{
+	vec3_t	 origin;
+	vec3_t	 velocity;
+	int		 movetype;
+	int		 waterlevel;
+	int		 watertype;
+	qboolean onground;
+	qboolean jumpreleased;
+} predstate_t;
+
+// the server's physics settings, sent as serverinfo keys. the local sv_ cvars say nothing about a remote server
+typedef struct
+{
+	float friction;
+	float edgefriction;
+	float stopspeed;
+	float gravity;
+	float maxvelocity;
+	float nostep;
+	float maxspeed;
+	float accelerate;
+	float altnoclip;
+} predvars_t;
+
+static const struct
+{
+	const char *key;
+	size_t		offset;
+} pred_varkeys[] = {
+	{"sv_friction", offsetof (predvars_t, friction)},	  {"edgefriction", offsetof (predvars_t, edgefriction)},
+	{"sv_stopspeed", offsetof (predvars_t, stopspeed)},	  {"sv_gravity", offsetof (predvars_t, gravity)},
+	{"sv_maxvelocity", offsetof (predvars_t, maxvelocity)}, {"sv_nostep", offsetof (predvars_t, nostep)},
+	{"sv_maxspeed", offsetof (predvars_t, maxspeed)},	  {"sv_accelerate", offsetof (predvars_t, accelerate)},
+	{"sv_altnoclip", offsetof (predvars_t, altnoclip)},
+};
+
+static predvars_t predvars;
+
+static struct
+{
+	predstate_t states[countof (cl.movecmds)]; // state after each command, indexed by sequence
+	int			sequences[countof (cl.movecmds)];
+	int			lastacked;
+	vec3_t		offset; // reconciliation error still to be blended out of the view
+	float		error;
+	float		avgerror;
+	float		maxerror;
+	float		peakerror;
+	double		peaktime;
+} pred;
+
+#ifdef _DEBUG
+static struct
+{
+	qboolean active;
+	int		 segment;
+	int		 remaining;
+	int		 firstseq;
+	int		 lastseq;
+	int		 samples;
+	double	 sumerror;
+	float	 maxerror;
+	double	 endtime;
+} pred_test;
+#endif
+
+/*
+===============================================================================
+
+COLLISION
+
+===============================================================================
+*/
+
+/*
+==================
+CL_PredClipToModel
+==================
+*/
+static trace_t CL_PredClipToModel (qmodel_t *model, const vec3_t origin, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end)
+{
+	trace_t trace;
+	hull_t *hull;
+	vec3_t	size, offset;
+	vec3_t	start_l, end_l;
+
+	memset (&trace, 0, sizeof (trace_t));
+	trace.fraction = 1;
+	trace.allsolid = true;
+	VectorCopy (end, trace.endpos);
+
+	VectorSubtract (maxs, mins, size);
+	if (size[0] < 3)
+		hull = &model->hulls[0];
+	else if (size[0] <= 32)
+		hull = &model->hulls[1];
+	else
+		hull = &model->hulls[2];
+
+	VectorSubtract (hull->clip_mins, mins, offset);
+	VectorAdd (offset, origin, offset);
+	VectorSubtract (start, offset, start_l);
+	VectorSubtract (end, offset, end_l);
+
+	SV_RecursiveHullCheck (hull, start_l, end_l, &trace, CONTENTMASK_ANYSOLID);
+
+	if (trace.fraction != 1)
+		VectorAdd (trace.endpos, offset, trace.endpos);
+
+	return trace;
+}
+
+/*
+==================
+CL_PredTrace
+
+Like SV_Move for the player hull, but against the world and the brush entities from the
+last snapshot. Monsters and other players are not solid, the reconciliation takes care
+of the rare bumps into them.
+==================
+*/
+static trace_t CL_PredTrace (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end)
+{
+	trace_t	  best, trace;
+	vec3_t	  boxmins, boxmaxs;
+	entity_t *ent;
+	int		  i, j;
+
+	best = CL_PredClipToModel (cl.worldmodel, vec3_origin, start, mins, maxs, end);
+	if (best.allsolid)
+		return best;
+
+	for (j = 0; j < 3; j++)
+	{
+		boxmins[j] = q_min (start[j], end[j]) + mins[j] - 1;
+		boxmaxs[j] = q_max (start[j], end[j]) + maxs[j] + 1;
+	}
+
+	for (i = 1, ent = cl.entities + 1; i < cl.num_entities; i++, ent++)
+	{
+		if (i == cl.viewentity || !ent->model || ent->model->type != mod_brush || ent->model->name[0] != '*')
+			continue;
+		if (ent->msgtime != cl.mtime[0])
+			continue;
+		if (ent->netstate.angles[0] || ent->netstate.angles[1] || ent->netstate.angles[2])
+			continue; // rotating brushes are left to the server
+		if (boxmins[0] > ent->netstate.origin[0] + ent->model->maxs[0] || boxmins[1] > ent->netstate.origin[1] + ent->model->maxs[1] ||
+			boxmins[2] > ent->netstate.origin[2] + ent->model->maxs[2] || boxmaxs[0] < ent->netstate.origin[0] + ent->model->mins[0] ||
+			boxmaxs[1] < ent->netstate.origin[1] + ent->model->mins[1] || boxmaxs[2] < ent->netstate.origin[2] + ent->model->mins[2])
+			continue;
+
+		trace = CL_PredClipToModel (ent->model, ent->netstate.origin, start, mins, maxs, end);
+		if (trace.allsolid || trace.startsolid || trace.fraction < best.fraction)
+		{
+			if (best.startsolid)
+				trace.startsolid = true;
+			best = trace;
+			if (best.allsolid)
+				break;
+		}
+		else if (trace.startsolid)
+			best.startsolid = true;
+	}
+
+	return best;
+}
+
+/*
+==================
+CL_PredPointContents
+==================
+*/
+static int CL_PredPointContents (vec3_t p)
+{
+	int cont = SV_HullPointContents (&cl.worldmodel->hulls[0], 0, p);
+	if (cont <= CONTENTS_CURRENT_0 && cont >= CONTENTS_CURRENT_DOWN)
+		cont = CONTENTS_WATER;
+	return cont;
+}
+
+/*
+===============================================================================
+
+PHYSICS
+
+These mirror their SV_ counterparts in sv_user.c and sv_phys.c
+
+===============================================================================
+*/
+
+/*
+=============
+CL_PredCheckWater
+=============
+*/
+static qboolean CL_PredCheckWater (predstate_t *s)
+{
+	vec3_t point;
+	int	   cont;
+
+	point[0] = s->origin[0];
+	point[1] = s->origin[1];
+	point[2] = s->origin[2] + player_mins[2] + 1;
+
+	s->waterlevel = 0;
+	s->watertype = CONTENTS_EMPTY;
+	cont = CL_PredPointContents (point);
+	if (cont <= CONTENTS_WATER)
+	{
+		s->watertype = cont;
+		s->waterlevel = 1;
+		point[2] = s->origin[2] + (player_mins[2] + player_maxs[2]) * 0.5;
+		cont = CL_PredPointContents (point);
+		if (cont <= CONTENTS_WATER)
+		{
+			s->waterlevel = 2;
+			point[2] = s->origin[2] + cl.stats[STAT_VIEWHEIGHT];
+			cont = CL_PredPointContents (point);
+			if (cont <= CONTENTS_WATER)
+				s->waterlevel = 3;
+		}
+	}
+
+	return s->waterlevel > 1;
+}
+
+/*
+================
+CL_PredCheckVelocity
+================
+*/
+static void CL_PredCheckVelocity (predstate_t *s)
+{
+	int i;
+
+	for (i = 0; i < 3; i++)
+	{
+		if (IS_NAN (s->velocity[i]))
+			s->velocity[i] = 0;
+		if (s->velocity[i] > predvars.maxvelocity)
+			s->velocity[i] = predvars.maxvelocity;
+		else if (s->velocity[i] < -predvars.maxvelocity)
+			s->velocity[i] = -predvars.maxvelocity;
+	}
+}
+
+/*
+============
+CL_PredPushEntity
+============
+*/
+static trace_t CL_PredPushEntity (predstate_t *s, vec3_t push)
+{
+	trace_t trace;
+	vec3_t	end;
+
+	VectorAdd (s->origin, push, end);
+	trace = CL_PredTrace (s->origin, player_mins, player_maxs, end);
+	VectorCopy (trace.endpos, s->origin);
+	return trace;
+}
+
+/*
+============
+CL_PredFlyMove
+============
+*/
+static int CL_PredFlyMove (predstate_t *s, float time, trace_t *steptrace)
+{
+	int		bumpcount, numbumps;
+	vec3_t	dir;
+	float	d;
+	int		numplanes;
+	vec3_t	planes[MAX_CLIP_PLANES];
+	vec3_t	primal_velocity, original_velocity, new_velocity;
+	int		i, j;
+	trace_t trace;
+	vec3_t	end;
+	float	time_left;
+	int		blocked;
+
+	numbumps = 4;
+
+	blocked = 0;
+	VectorCopy (s->velocity, original_velocity);
+	VectorCopy (s->velocity, primal_velocity);
+	VectorCopy (s->velocity, new_velocity);
+	numplanes = 0;
+
+	time_left = time;
+
+	for (bumpcount = 0; bumpcount < numbumps; bumpcount++)
+	{
+		if (!s->velocity[0] && !s->velocity[1] && !s->velocity[2])
+			break;
+
+		for (i = 0; i < 3; i++)
+			end[i] = s->origin[i] + time_left * s->velocity[i];
+
+		trace = CL_PredTrace (s->origin, player_mins, player_maxs, end);
+
+		if (trace.allsolid)
+		{ // entity is trapped in another solid
+			VectorCopy (vec3_origin, s->velocity);
+			return 3;
+		}
+
+		if (trace.fraction > 0)
+		{ // actually covered some distance
+			VectorCopy (trace.endpos, s->origin);
+			VectorCopy (s->velocity, original_velocity);
+			numplanes = 0;
+		}
+
+		if (trace.fraction == 1)
+			break; // moved the entire distance
+
+		if (trace.plane.normal[2] > 0.7)
+		{
+			blocked |= 1; // floor
+			s->onground = true;
+		}
+		if (!trace.plane.normal[2])
+		{
+			blocked |= 2; // step
+			if (steptrace)
+				*steptrace = trace; // save for player extrafriction
+		}
+
+		time_left -= time_left * trace.fraction;
+
+		// cliped to another plane
+		if (numplanes >= MAX_CLIP_PLANES)
+		{ // this shouldn't really happen
+			VectorCopy (vec3_origin, s->velocity);
+			return 3;
+		}
+
+		VectorCopy (trace.plane.normal, planes[numplanes]);
+		numplanes++;
+
+		//
+		// modify original_velocity so it parallels all of the clip planes
+		//
+		for (i = 0; i < numplanes; i++)
+		{
+			ClipVelocity (original_velocity, planes[i], new_velocity, 1);
+			for (j = 0; j < numplanes; j++)
+				if (j != i)
+				{
+					if (DotProduct (new_velocity, planes[j]) < 0)
+						break; // not ok
+				}
+			if (j == numplanes)
+				break;
+		}
+
+		if (i != numplanes)
+		{ // go along this plane
+			VectorCopy (new_velocity, s->velocity);
+		}
+		else
+		{ // go along the crease
+			if (numplanes != 2)
+			{
+				VectorCopy (vec3_origin, s->velocity);
+				return 7;
+			}
+			CrossProduct (planes[0], planes[1], dir);
+			d = DotProduct (dir, s->velocity);
+			VectorScale (dir, d, s->velocity);
+		}
+
+		//
+		// if original velocity is against the original velocity, stop dead
+		// to avoid tiny occilations in sloping corners
+		//
+		if (DotProduct (s->velocity, primal_velocity) <= 0)
+		{
+			VectorCopy (vec3_origin, s->velocity);
+			return blocked;
+		}
+	}
+
+	return blocked;
+}
+
+/*
+============
+CL_PredWallFriction
+============
+*/
+static void CL_PredWallFriction (predstate_t *s, usercmd_t *cmd, trace_t *trace)
+{
+	vec3_t forward, right, up;
+	float  d, i;
+	vec3_t into, side;
+
+	AngleVectors (cmd->viewangles, forward, right, up);
+	d = DotProduct (trace->plane.normal, forward);
+
+	d += 0.5;
+	if (d >= 0)
+		return;
+
+	// cut the tangential velocity
+	i = DotProduct (trace->plane.normal, s->velocity);
+	VectorScale (trace->plane.normal, i, into);
+	VectorSubtract (s->velocity, into, side);
+
+	s->velocity[0] = side[0] * (1 + d);
+	s->velocity[1] = side[1] * (1 + d);
+}
+
+/*
+=====================
+CL_PredTryUnstick
+=====================
+*/
+static int CL_PredTryUnstick (predstate_t *s, vec3_t oldvel)
+{
+	static const float dirs[8][2] = {{2, 0}, {0, 2}, {-2, 0}, {0, -2}, {2, 2}, {-2, 2}, {2, -2}, {-2, -2}};
+	int				   i;
+	vec3_t			   oldorg;
+	vec3_t			   dir;
+	int				   clip;
+	trace_t			   steptrace;
+
+	VectorCopy (s->origin, oldorg);
+
+	for (i = 0; i < 8; i++)
+	{
+		// try pushing a little in an axial direction
+		dir[0] = dirs[i][0];
+		dir[1] = dirs[i][1];
+		dir[2] = 0;
+		CL_PredPushEntity (s, dir);
+
+		// retry the original move
+		s->velocity[0] = oldvel[0];
+		s->velocity[1] = oldvel[1];
+		s->velocity[2] = 0;
+		clip = CL_PredFlyMove (s, 0.1, &steptrace);
+
+		if (fabs (oldorg[1] - s->origin[1]) > 4 || fabs (oldorg[0] - s->origin[0]) > 4)
+			return clip;
+
+		// go back to the original pos and try again
+		VectorCopy (oldorg, s->origin);
+	}
+
+	VectorCopy (vec3_origin, s->velocity);
+	return 7; // still not moving
+}
+
+/*
+=====================
+CL_PredWalkMove
+=====================
+*/
+static void CL_PredWalkMove (predstate_t *s, usercmd_t *cmd, float frametime)
+{
+	vec3_t	 upmove, downmove;
+	vec3_t	 oldorg, oldvel;
+	vec3_t	 nosteporg, nostepvel;
+	int		 clip;
+	qboolean oldonground;
+	trace_t	 steptrace, downtrace;
+
+	//
+	// do a regular slide move unless it looks like you ran into a step
+	//
+	oldonground = s->onground;
+	s->onground = false;
+
+	VectorCopy (s->origin, oldorg);
+	VectorCopy (s->velocity, oldvel);
+
+	clip = CL_PredFlyMove (s, frametime, &steptrace);
+
+	if (!(clip & 2))
+		return; // move didn't block on a step
+
+	if (!oldonground && s->waterlevel == 0)
+		return; // don't stair up while jumping
+
+	if (predvars.nostep)
+		return;
+
+	VectorCopy (s->origin, nosteporg);
+	VectorCopy (s->velocity, nostepvel);
+
+	//
+	// try moving up and forward to go up a step
+	//
+	VectorCopy (oldorg, s->origin); // back to start pos
+
+	VectorCopy (vec3_origin, upmove);
+	VectorCopy (vec3_origin, downmove);
+	upmove[2] = STEPSIZE;
+	downmove[2] = -STEPSIZE + oldvel[2] * frametime;
+
+	// move up
+	CL_PredPushEntity (s, upmove);
+
+	// move forward
+	s->velocity[0] = oldvel[0];
+	s->velocity[1] = oldvel[1];
+	s->velocity[2] = 0;
+	clip = CL_PredFlyMove (s, frametime, &steptrace);
+
+	// check for stuckness, possibly due to the limited precision of floats
+	// in the clipping hulls
+	if (clip)
+	{
+		if (fabs (oldorg[1] - s->origin[1]) < 0.03125 && fabs (oldorg[0] - s->origin[0]) < 0.03125)
+		{ // stepping up didn't make any progress
+			clip = CL_PredTryUnstick (s, oldvel);
+		}
+	}
+
+	// extra friction based on view angle
+	if (clip & 2)
+		CL_PredWallFriction (s, cmd, &steptrace);
+
+	// move down
+	downtrace = CL_PredPushEntity (s, downmove);
+
+	if (downtrace.plane.normal[2] > 0.7)
+		s->onground = true;
+	else
+	{
+		// if the push down didn't end up on good ground, use the move without
+		// the step up.  This happens near wall / slope combinations, and can
+		// cause the player to hop up higher on a slope too steep to climb
+		VectorCopy (nosteporg, s->origin);
+		VectorCopy (nostepvel, s->velocity);
+	}
+}
+
+/*
+==================
+CL_PredUserFriction
+==================
+*/
+static void CL_PredUserFriction (predstate_t *s, float frametime)
+{
+	float  *vel;
+	float	speed, newspeed, control;
+	vec3_t	start, stop;
+	float	friction;
+	trace_t trace;
+
+	vel = s->velocity;
+
+	speed = sqrt (vel[0] * vel[0] + vel[1] * vel[1]);
+	if (!speed)
+		return;
+
+	// if the leading edge is over a dropoff, increase friction
+	start[0] = stop[0] = s->origin[0] + vel[0] / speed * 16;
+	start[1] = stop[1] = s->origin[1] + vel[1] / speed * 16;
+	start[2] = s->origin[2] + player_mins[2];
+	stop[2] = start[2] - 34;
+
+	trace = CL_PredTrace (start, vec3_origin, vec3_origin, stop);
+
+	if (trace.fraction == 1.0)
+		friction = predvars.friction * predvars.edgefriction;
+	else
+		friction = predvars.friction;
+
+	// apply friction
+	control = speed < predvars.stopspeed ? predvars.stopspeed : speed;
+	newspeed = speed - frametime * control * friction;
+
+	if (newspeed < 0)
+		newspeed = 0;
+	newspeed /= speed;
+
+	vel[0] = vel[0] * newspeed;
+	vel[1] = vel[1] * newspeed;
+	vel[2] = vel[2] * newspeed;
+}
+
+/*
+==============
+CL_PredAccelerate
+==============
+*/
+static void CL_PredAccelerate (predstate_t *s, float wishspeed, const vec3_t wishdir, float frametime)
+{
+	int	  i;
+	float addspeed, accelspeed, currentspeed;
+
+	currentspeed = DotProduct (s->velocity, wishdir);
+	addspeed = wishspeed - currentspeed;
+	if (addspeed <= 0)
+		return;
+	accelspeed = predvars.accelerate * frametime * wishspeed;
+	if (accelspeed > addspeed)
+		accelspeed = addspeed;
+
+	for (i = 0; i < 3; i++)
+		s->velocity[i] += accelspeed * wishdir[i];
+}
+
+static void CL_PredAirAccelerate (predstate_t *s, float wishspeed, vec3_t wishveloc, float frametime)
+{
+	int	  i;
+	float addspeed, wishspd, accelspeed, currentspeed;
+
+	wishspd = VectorNormalize (wishveloc);
+	if (wishspd > 30)
+		wishspd = 30;
+	currentspeed = DotProduct (s->velocity, wishveloc);
+	addspeed = wishspd - currentspeed;
+	if (addspeed <= 0)
+		return;
+	accelspeed = predvars.accelerate * wishspeed * frametime;
+	if (accelspeed > addspeed)
+		accelspeed = addspeed;
+
+	for (i = 0; i < 3; i++)
+		s->velocity[i] += accelspeed * wishveloc[i];
+}
+
+/*
+===================
+CL_PredWaterMove
+===================
+*/
+static void CL_PredWaterMove (predstate_t *s, usercmd_t *cmd, float frametime)
+{
+	int	   i;
+	vec3_t forward, right, up;
+	vec3_t wishvel;
+	float  speed, newspeed, wishspeed, addspeed, accelspeed;
+
+	//
+	// user intentions
+	//
+	AngleVectors (cmd->viewangles, forward, right, up);
+
+	for (i = 0; i < 3; i++)
+		wishvel[i] = forward[i] * cmd->forwardmove + right[i] * cmd->sidemove;
+
+	if (!cmd->forwardmove && !cmd->sidemove && !cmd->upmove)
+		wishvel[2] -= 60; // drift towards bottom
+	else
+		wishvel[2] += cmd->upmove;
+
+	wishspeed = VectorLength (wishvel);
+	if (wishspeed > predvars.maxspeed)
+	{
+		VectorScale (wishvel, predvars.maxspeed / wishspeed, wishvel);
+		wishspeed = predvars.maxspeed;
+	}
+	wishspeed *= 0.7;
+
+	//
+	// water friction
+	//
+	speed = VectorLength (s->velocity);
+	if (speed)
+	{
+		newspeed = speed - frametime * speed * predvars.friction;
+		if (newspeed < 0)
+			newspeed = 0;
+		VectorScale (s->velocity, newspeed / speed, s->velocity);
+	}
+	else
+		newspeed = 0;
+
+	//
+	// water acceleration
+	//
+	if (!wishspeed)
+		return;
+
+	addspeed = wishspeed - newspeed;
+	if (addspeed <= 0)
+		return;
+
+	VectorNormalize (wishvel);
+	accelspeed = predvars.accelerate * wishspeed * frametime;
+	if (accelspeed > addspeed)
+		accelspeed = addspeed;
+
+	for (i = 0; i < 3; i++)
+		s->velocity[i] += accelspeed * wishvel[i];
+}
+
+/*
+===================
+CL_PredNoclipMove
+===================
+*/
+static void CL_PredNoclipMove (predstate_t *s, usercmd_t *cmd)
+{
+	vec3_t forward, right, up;
+
+	AngleVectors (cmd->viewangles, forward, right, up);
+
+	s->velocity[0] = forward[0] * cmd->forwardmove + right[0] * cmd->sidemove;
+	s->velocity[1] = forward[1] * cmd->forwardmove + right[1] * cmd->sidemove;
+	s->velocity[2] = forward[2] * cmd->forwardmove + right[2] * cmd->sidemove;
+	s->velocity[2] += cmd->upmove * 2; // doubled to match running speed
+
+	if (VectorLength (s->velocity) > predvars.maxspeed)
+	{
+		VectorNormalize (s->velocity);
+		VectorScale (s->velocity, predvars.maxspeed, s->velocity);
+	}
+}
+
+/*
+===================
+CL_PredAirMove
+===================
+*/
+static void CL_PredAirMove (predstate_t *s, usercmd_t *cmd, float frametime)
+{
+	int	   i;
+	vec3_t angles, forward, right, up;
+	vec3_t wishvel, wishdir;
+	float  wishspeed;
+
+	// the server moves along the body angles, which only show 1/3 of the pitch
+	angles[PITCH] = -cmd->viewangles[PITCH] / 3;
+	angles[YAW] = cmd->viewangles[YAW];
+	angles[ROLL] = V_CalcRoll (angles, s->velocity) * 4;
+	AngleVectors (angles, forward, right, up);
+
+	for (i = 0; i < 3; i++)
+		wishvel[i] = forward[i] * cmd->forwardmove + right[i] * cmd->sidemove;
+
+	if (s->movetype != MOVETYPE_WALK)
+		wishvel[2] = cmd->upmove;
+	else
+		wishvel[2] = 0;
+
+	VectorCopy (wishvel, wishdir);
+	wishspeed = VectorNormalize (wishdir);
+	if (wishspeed > predvars.maxspeed)
+	{
+		VectorScale (wishvel, predvars.maxspeed / wishspeed, wishvel);
+		wishspeed = predvars.maxspeed;
+	}
+
+	if (s->movetype == MOVETYPE_NOCLIP)
+		VectorCopy (wishvel, s->velocity);
+	else if (s->onground)
+	{
+		CL_PredUserFriction (s, frametime);
+		CL_PredAccelerate (s, wishspeed, wishdir, frametime);
+	}
+	else
+		CL_PredAirAccelerate (s, wishspeed, wishvel, frametime);
+}
+
+/*
+===================
+CL_PredJump
+
+What PlayerPreThink / PlayerJump in the game code do with button2
+===================
+*/
+static void CL_PredJump (predstate_t *s, usercmd_t *cmd)
+{
+	if (!(cmd->buttons & 2))
+	{
+		s->jumpreleased = true;
+		return;
+	}
+
+	if (s->waterlevel >= 2)
+	{
+		if (s->watertype == CONTENTS_WATER)
+			s->velocity[2] = 100;
+		else if (s->watertype == CONTENTS_SLIME)
+			s->velocity[2] = 80;
+		else
+			s->velocity[2] = 50;
+		return;
+	}
+
+	if (!s->onground || !s->jumpreleased)
+		return; // don't pogo stick
+
+	s->jumpreleased = false;
+	s->onground = false;
+	s->velocity[2] += 270;
+}
+
+/*
+===================
+CL_PredRunCmd
+
+One server frame of SV_ClientThink followed by SV_Physics_Client
+===================
+*/
+static void CL_PredRunCmd (predstate_t *s, usercmd_t *cmd, float frametime)
+{
+	if (frametime <= 0)
+		return;
+
+	if (s->movetype == MOVETYPE_NOCLIP && predvars.altnoclip)
+		CL_PredNoclipMove (s, cmd);
+	else if (s->waterlevel >= 2 && s->movetype != MOVETYPE_NOCLIP)
+		CL_PredWaterMove (s, cmd, frametime);
+	else
+		CL_PredAirMove (s, cmd, frametime);
+
+	if (s->movetype != MOVETYPE_NOCLIP)
+		CL_PredJump (s, cmd);
+
+	CL_PredCheckVelocity (s);
+
+	switch (s->movetype)
+	{
+	case MOVETYPE_WALK:
+		if (!CL_PredCheckWater (s))
+			s->velocity[2] -= predvars.gravity * frametime;
+		CL_PredWalkMove (s, cmd, frametime);
+		break;
+	case MOVETYPE_FLY:
+		CL_PredFlyMove (s, frametime, NULL);
+		break;
+	case MOVETYPE_NOCLIP:
+		VectorMA (s->origin, frametime, s->velocity, s->origin);
+		break;
+	}
+}
+
+/*
+===============================================================================
+
+RECONCILIATION
+
+===============================================================================
+*/
+
+/*
+===================
+CL_PredReadVars
+
+Fails unless the server sent all of its physics settings
+===================
+*/
+static qboolean CL_PredReadVars (void)
+{
+	char value[64];
+
+	for (size_t i = 0; i < countof (pred_varkeys); i++)
+	{
+		if (!*Info_GetKey (cl.serverinfo, pred_varkeys[i].key, value, sizeof (value)))
+			return false;
+		*(float *)((byte *)&predvars + pred_varkeys[i].offset) = atof (value);
+	}
+	return true;
+}
+
+/*
+===================
+CL_PredictionActive
+===================
+*/
+static qboolean CL_PredictionActive (void)
+{
+	entity_t *ent;
+
+#ifdef _DEBUG
+	if (!cl_prediction.value && !pred_test.active)
+		return false;
+#else
+	if (!cl_prediction.value)
+		return false;
+#endif
+	if (!(cl.protocol_pext2 & PEXT2_PREDINFO) || cls.demoplayback || cls.signon != SIGNONS || !cl.worldmodel || cl.paused || cl.intermission)
+		return false;
+	if (cl.stats[STAT_HEALTH] <= 0 || cl.viewentity <= 0 || cl.viewentity >= cl.num_entities)
+		return false;
+	if (cl.movemessages - cl.ackedmovemessages > (int)MOVECMDS_MASK || cl.ackedmovemessages <= 2)
+		return false;
+
+	if (!CL_PredReadVars ())
+		return false;
+
+	// servers only send the movetype with sv_predictmovetype, don't guess it
+	ent = &cl.entities[cl.viewentity];
+	switch (ent->netstate.pmovetype)
+	{
+	case MOVETYPE_WALK:
+	case MOVETYPE_FLY:
+	case MOVETYPE_NOCLIP:
+		return ent->model != NULL;
+	default:
+		return false;
+	}
+}
+
+/*
+===================
+CL_PredictionError
+===================
+*/
+static void CL_PredictionError (float error)
+{
+	pred.error = error;
+	pred.avgerror += (error - pred.avgerror) * 0.1f;
+	pred.peakerror = q_max (pred.peakerror, error);
+	if (realtime - pred.peaktime > 1.0)
+	{
+		pred.maxerror = pred.peakerror;
+		pred.peakerror = 0;
+		pred.peaktime = realtime;
+	}
+
+#ifdef _DEBUG
+	if (pred_test.active && cl.ackedmovemessages >= pred_test.firstseq && (!pred_test.lastseq || cl.ackedmovemessages <= pred_test.lastseq))
+	{
+		pred_test.samples++;
+		pred_test.sumerror += error;
+		pred_test.maxerror = q_max (pred_test.maxerror, error);
+	}
+#endif
+}
+
+/*
+===================
+CL_PredictMove
+
+Called after the entities have been relinked. Replaces the lerped view entity origin
+with the predicted one.
+===================
+*/
+void CL_PredictMove (void)
+{
+	entity_t	*ent;
+	predstate_t	 s;
+	usercmd_t	 cmd;
+	vec3_t		 error;
+	int			 seq, slot;
+	float		 frametime, smooth, len;
+
+	if (!CL_PredictionActive ())
+	{
+		pred.lastacked = 0;
+		VectorCopy (vec3_origin, pred.offset);
+		return;
+	}
+
+	ent = &cl.entities[cl.viewentity];
+
+	//
+	// start from the state the server acknowledged
+	//
+	memset (&s, 0, sizeof (s));
+	VectorCopy (ent->netstate.origin, s.origin);
+	VectorCopy (cl.mvelocity[0], s.velocity);
+	s.movetype = ent->netstate.pmovetype;
+	s.onground = (ent->netstate.eflags & EFLAGS_ONGROUND) ? true : false;
+	CL_PredCheckWater (&s);
+
+	slot = cl.ackedmovemessages & MOVECMDS_MASK;
+	if (pred.sequences[slot] == cl.ackedmovemessages)
+	{
+		s.jumpreleased = pred.states[slot].jumpreleased;
+		if (cl.ackedmovemessages != pred.lastacked)
+		{
+			VectorSubtract (pred.states[slot].origin, s.origin, error);
+			len = VectorLength (error);
+			if (len > SNAP_DISTANCE)
+				VectorCopy (vec3_origin, pred.offset); // teleported
+			else
+				VectorAdd (pred.offset, error, pred.offset);
+			CL_PredictionError (len);
+		}
+	}
+	else
+		s.jumpreleased = !(cl.movecmds[slot].buttons & 2);
+	pred.lastacked = cl.ackedmovemessages;
+
+	//
+	// replay everything the server hasn't applied yet
+	//
+	for (seq = cl.ackedmovemessages + 1; seq < cl.movemessages; seq++)
+	{
+		slot = seq & MOVECMDS_MASK;
+		CL_PredRunCmd (&s, &cl.movecmds[slot], CLAMP (0.f, cl.movecmds[slot].seconds, MAX_FRAMETIME));
+		pred.states[slot] = s;
+		pred.sequences[slot] = seq;
+	}
+
+	//
+	// and the input that has been accumulated since the last command went out
+	//
+	CL_BaseMove (&cmd);
+	cmd.forwardmove += cl.pendingcmd.forwardmove + cl.pendingcmd.forwardmove_accumulator;
+	cmd.sidemove += cl.pendingcmd.sidemove + cl.pendingcmd.sidemove_accumulator;
+	cmd.upmove += cl.pendingcmd.upmove + cl.pendingcmd.upmove_accumulator;
+	cmd.buttons = (in_jump.state & 1) ? 2 : 0;
+	CL_PredRunCmd (&s, &cmd, CLAMP (0.f, cl.time - cl.pendingcmd.servertime, MAX_FRAMETIME));
+
+	//
+	// blend out the reconciliation error
+	//
+	frametime = CLAMP (0.f, cl.time - cl.oldtime, MAX_FRAMETIME);
+	smooth = cl_prediction_smooth.value;
+	if (smooth > 0)
+		VectorScale (pred.offset, q_max (0.f, 1.f - frametime / smooth), pred.offset);
+	else
+		VectorCopy (vec3_origin, pred.offset);
+
+	VectorAdd (s.origin, pred.offset, ent->origin);
+	VectorCopy (s.velocity, cl.velocity);
+	cl.onground = s.onground;
+
+#ifdef _DEBUG
+	if (pred_test.active && pred_test.lastseq && cl.ackedmovemessages >= pred_test.lastseq && (VectorLength (pred.offset) < 0.01f || realtime > pred_test.endtime))
+	{
+		float mean = pred_test.samples ? pred_test.sumerror / pred_test.samples : 0.f;
+		VectorSubtract (ent->origin, ent->netstate.origin, error);
+		len = VectorLength (error);
+		pred_test.active = false;
+		Con_Printf (
+			"prediction test: %i commands, %i acks, mean error %.3f, max error %.3f, final offset %.3f: %s\n", pred_test.lastseq - pred_test.firstseq + 1,
+			pred_test.samples, mean, pred_test.maxerror, len, (len < 0.125f && mean < 1.f) ? "PASS" : "FAIL");
+	}
+#endif
+}
+
+/*
+===================
+CL_PredictionStats
+===================
+*/
+void CL_PredictionStats (float *error, float *avgerror, float *maxerror)
+{
+	*error = pred.error;
+	*avgerror = pred.avgerror;
+	*maxerror = q_max (pred.maxerror, pred.peakerror);
+}
+
+/*
+===================
+CL_ClearPrediction
+===================
+*/
+void CL_ClearPrediction (void)
+{
+	memset (&pred, 0, sizeof (pred));
+#ifdef _DEBUG
+	pred_test.active = false;
+#endif
+}
+
+#ifdef _DEBUG
+/*
+===================
+CL_PredictionTest_f
+
+Drives the player through a fixed input recording and checks that the predicted
+position converges to the one the server ends up with.
+===================
+*/
+static const struct
+{
+	int	  cmds;
+	short forwardmove;
+	short sidemove;
+	float yawspeed;
+	int	  buttons;
+} pred_test_script[] = {
+	{36, 0, 0, 0, 0},	  {72, 400, 0, 0, 0}, {36, 400, 0, 90, 0},	{54, 0, 350, 0, 0},		 {8, 400, 0, 0, 2},	  {40, 400, 0, 0, 0},
+	{8, 400, 0, 0, 2},	  {40, 400, 0, -60, 0}, {54, -400, -350, -45, 0}, {36, 200, 0, 180, 2}, {72, 0, 0, 0, 0},
+};
+
+void CL_PredictionTest_f (void)
+{
+	if (cls.state != ca_connected || cls.signon != SIGNONS || cls.demoplayback)
+	{
+		Con_Printf ("test_prediction: not in a game\n");
+		return;
+	}
+	if (!(cl.protocol_pext2 & PEXT2_PREDINFO))
+	{
+		Con_Printf ("test_prediction: server does not support PEXT2_PREDINFO\n");
+		return;
+	}
+	if (!CL_PredReadVars ())
+	{
+		Con_Printf ("test_prediction: server did not send its physics settings\n");
+		return;
+	}
+	if (!cl.entities[cl.viewentity].netstate.pmovetype)
+	{
+		Con_Printf ("test_prediction: server does not send the player movetype (sv_predictmovetype)\n");
+		return;
+	}
+
+	memset (&pred_test, 0, sizeof (pred_test));
+	pred_test.active = true;
+	pred_test.remaining = pred_test_script[0].cmds;
+	pred_test.firstseq = cl.movemessages;
+	Con_Printf ("prediction test started\n");
+}
+
+/*
+===================
+CL_PredictionTestInput
+
+Replaces the player's input while the test is running
+===================
+*/
+void CL_PredictionTestInput (usercmd_t *cmd)
+{
+	if (!pred_test.active || pred_test.lastseq)
+		return;
+
+	while (pred_test.remaining == 0)
+	{
+		if (++pred_test.segment == countof (pred_test_script))
+		{
+			pred_test.lastseq = cl.movemessages - 1;
+			pred_test.endtime = realtime + 2.0;
+			return;
+		}
+		pred_test.remaining = pred_test_script[pred_test.segment].cmds;
+	}
+	--pred_test.remaining;
+
+	cl.viewangles[PITCH] = 0;
+	cl.viewangles[ROLL] = 0;
+	cl.viewangles[YAW] = anglemod (cl.viewangles[YAW] + pred_test_script[pred_test.segment].yawspeed * cmd->seconds);
+	VectorCopy (cl.viewangles, cmd->viewangles);
+	cmd->forwardmove = pred_test_script[pred_test.segment].forwardmove;
+	cmd->sidemove = pred_test_script[pred_test.segment].sidemove;
+	cmd->upmove = 0;
+	cmd->buttons = pred_test_script[pred_test.segment].buttons;
+	cmd->impulse = 0;
+}
+#endif
+
+/*
+===================
+CL_InitPrediction
+===================
+*/
+void CL_InitPrediction (void)
+{
+	Cvar_RegisterVariable (&cl_prediction);
+	Cvar_RegisterVariable (&cl_prediction_smooth);
+}
@@ -159,7 +159,7 @@ typedef struct
 								 // doesn't accidentally do something the
 								 // first frame
 	int		  ackedmovemessages; // echo of movemessages from the server.
-	usercmd_t movecmds[64];		 // ringbuffer of previous movement commands (journal for prediction)
+	usercmd_t movecmds[256];	 // ringbuffer of previous movement commands (journal for prediction)
 #define MOVECMDS_MASK (countof (cl.movecmds) - 1)
 	usercmd_t pendingcmd; // accumulated state from mice+joysticks.
 
@@ -234,8 +234,6 @@ typedef struct
 	struct qmodel_s *worldmodel; // cl_entitites[0].model
 	struct efrag_s	*free_efrags;
 	int				 num_efrags;
-	struct efrag_s **efrag_allocs;
-	int				 num_efragallocs;
 	entity_t		 viewent; // the gun model
 
 	entity_t *entities; // spike -- moved into here
@@ -427,6 +425,20 @@ void  CL_InitTEnts (void);
 void  CL_SignonReply (void);
 float CL_TraceLine (vec3_t start, vec3_t end, vec3_t impact, vec3_t normal, int *ent);
 
+//
+// cl_pred
+//
+extern cvar_t cl_prediction;
+
+void CL_InitPrediction (void);
+void CL_ClearPrediction (void);
+void CL_PredictMove (void);
+void CL_PredictionStats (float *error, float *avgerror, float *maxerror);
+#ifdef _DEBUG
+void CL_PredictionTest_f (void);
+void CL_PredictionTestInput (usercmd_t *cmd);
+#endif
+
 //
 // chase
 //
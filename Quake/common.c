@@ -690,6 +690,49 @@ void MSG_WriteEntity (sizebuf_t *sb, unsigned int entnum, unsigned int pext2)
 		MSG_WriteShort (sb, entnum);
 }
 
+qboolean msgw_unreserved;
+
+/*
+==============
+MSGW_Begin
+
+Reserves up to reserve bytes at the end of sb. The fragment is written in place when
+it is guaranteed to fit, otherwise into the spill buffer to be checked on commit.
+==============
+*/
+void MSGW_Begin (msg_writer_t *w, sizebuf_t *sb, int reserve)
+{
+	if (reserve > MSGW_MAX_RESERVE)
+		Sys_Error ("MSGW_Begin: %i is > MSGW_MAX_RESERVE", reserve);
+
+	w->sb = sb;
+	if (!msgw_unreserved && sb->cursize + reserve <= sb->maxsize)
+		w->start = sb->data + sb->cursize;
+	else
+		w->start = w->spill;
+	w->cur = w->start;
+#ifdef _DEBUG
+	w->end = w->start + reserve;
+#endif
+}
+
+/*
+==============
+MSGW_Commit
+==============
+*/
+void MSGW_Commit (msg_writer_t *w)
+{
+#ifdef _DEBUG
+	if (w->cur > w->end)
+		Sys_Error ("MSGW_Commit: wrote %i bytes, reserved %i", MSGW_Length (w), (int)(w->end - w->start));
+#endif
+	if (w->start == w->spill)
+		SZ_Write (w->sb, w->spill, MSGW_Length (w));
+	else
+		w->sb->cursize += MSGW_Length (w);
+}
+
 //
 // reading functions
 //
@@ -702,75 +745,99 @@ void MSG_BeginReading (void)
 	msg_badread = false;
 }
 
-// returns -1 and sets msg_badread if no more characters are available
-int MSG_ReadChar (void)
+void MSGR_Init (msg_reader_t *reader, const byte *data, int size)
+{
+	reader->data = data;
+	reader->cursize = size;
+	reader->readcount = 0;
+	reader->badread = false;
+}
+
+// continue reading net_message where the global cursor is
+void MSGR_FromNetMessage (msg_reader_t *reader)
+{
+	reader->data = net_message.data;
+	reader->cursize = net_message.cursize;
+	reader->readcount = msg_readcount;
+	reader->badread = msg_badread;
+}
+
+// hand the cursor back to the global readers
+void MSGR_ToNetMessage (const msg_reader_t *reader)
+{
+	msg_readcount = reader->readcount;
+	msg_badread = reader->badread;
+}
+
+// returns -1 and sets badread if no more characters are available
+int MSGR_ReadChar (msg_reader_t *reader)
 {
 	int c;
 
-	if (msg_readcount + 1 > net_message.cursize)
+	if (reader->readcount + 1 > reader->cursize)
 	{
-		msg_badread = true;
+		reader->badread = true;
 		return -1;
 	}
 
-	c = (signed char)net_message.data[msg_readcount];
-	msg_readcount++;
+	c = (signed char)reader->data[reader->readcount];
+	reader->readcount++;
 
 	return c;
 }
 
-int MSG_ReadByte (void)
+int MSGR_ReadByte (msg_reader_t *reader)
 {
 	int c;
 
-	if (msg_readcount + 1 > net_message.cursize)
+	if (reader->readcount + 1 > reader->cursize)
 	{
-		msg_badread = true;
+		reader->badread = true;
 		return -1;
 	}
 
-	c = (unsigned char)net_message.data[msg_readcount];
-	msg_readcount++;
+	c = (unsigned char)reader->data[reader->readcount];
+	reader->readcount++;
 
 	return c;
 }
 
-int MSG_ReadShort (void)
+int MSGR_ReadShort (msg_reader_t *reader)
 {
 	int c;
 
-	if (msg_readcount + 2 > net_message.cursize)
+	if (reader->readcount + 2 > reader->cursize)
 	{
-		msg_badread = true;
+		reader->badread = true;
 		return -1;
 	}
 
-	c = (short)(net_message.data[msg_readcount] + (net_message.data[msg_readcount + 1] << 8));
+	c = (short)(reader->data[reader->readcount] + (reader->data[reader->readcount + 1] << 8));
 
-	msg_readcount += 2;
+	reader->readcount += 2;
 
 	return c;
 }
 
-int MSG_ReadLong (void)
+int MSGR_ReadLong (msg_reader_t *reader)
 {
 	uint32_t c;
 
-	if (msg_readcount + 4 > net_message.cursize)
+	if (reader->readcount + 4 > reader->cursize)
 	{
-		msg_badread = true;
+		reader->badread = true;
 		return -1;
 	}
 
-	c = (uint32_t)net_message.data[msg_readcount] + ((uint32_t)(net_message.data[msg_readcount + 1]) << 8) +
-		((uint32_t)(net_message.data[msg_readcount + 2]) << 16) + ((uint32_t)(net_message.data[msg_readcount + 3]) << 24);
+	c = (uint32_t)reader->data[reader->readcount] + ((uint32_t)(reader->data[reader->readcount + 1]) << 8) +
+		((uint32_t)(reader->data[reader->readcount + 2]) << 16) + ((uint32_t)(reader->data[reader->readcount + 3]) << 24);
 
-	msg_readcount += 4;
+	reader->readcount += 4;
 
 	return c;
 }
 
-float MSG_ReadFloat (void)
+float MSGR_ReadFloat (msg_reader_t *reader)
 {
 	union
 	{
@@ -779,102 +846,159 @@ float MSG_ReadFloat (void)
 		int	  l;
 	} dat;
 
-	dat.b[0] = net_message.data[msg_readcount];
-	dat.b[1] = net_message.data[msg_readcount + 1];
-	dat.b[2] = net_message.data[msg_readcount + 2];
-	dat.b[3] = net_message.data[msg_readcount + 3];
-	msg_readcount += 4;
+	if (reader->readcount + 4 > reader->cursize)
+	{
+		reader->badread = true;
+		return -1;
+	}
+
+	dat.b[0] = reader->data[reader->readcount];
+	dat.b[1] = reader->data[reader->readcount + 1];
+	dat.b[2] = reader->data[reader->readcount + 2];
+	dat.b[3] = reader->data[reader->readcount + 3];
+	reader->readcount += 4;
 
 	dat.l = LittleLong (dat.l);
 
 	return dat.f;
 }
 
-const char *MSG_ReadString (void)
+// copies at most size - 1 characters, always terminates. returns the length
+size_t MSGR_ReadString (msg_reader_t *reader, char *string, size_t size)
 {
-	static char string[2048];
-	int			c;
-	size_t		l;
+	int	   c;
+	size_t l;
 
 	l = 0;
-	do
+	while (l < size - 1)
 	{
-		c = MSG_ReadByte ();
+		c = MSGR_ReadByte (reader);
 		if (c == -1 || c == 0)
 			break;
 		string[l] = c;
 		l++;
-	} while (l < sizeof (string) - 1);
+	}
 
 	string[l] = 0;
 
-	return string;
-}
-
-// johnfitz -- original behavior, 13.3 fixed point coords, max range +-4096
-float MSG_ReadCoord16 (void)
-{
-	return MSG_ReadShort () * (1.0 / 8);
-}
-
-// johnfitz -- 16.8 fixed point coords, max range +-32768
-float MSG_ReadCoord24 (void)
-{
-	return MSG_ReadShort () + MSG_ReadByte () * (1.0 / 255);
-}
-
-// johnfitz -- 32-bit float coords
-float MSG_ReadCoord32f (void)
-{
-	return MSG_ReadFloat ();
+	return l;
 }
 
-float MSG_ReadCoord (unsigned int flags)
+float MSGR_ReadCoord (msg_reader_t *reader, unsigned int flags)
 {
 	if (flags & PRFL_FLOATCOORD)
-		return MSG_ReadFloat ();
+		return MSGR_ReadFloat (reader);
 	else if (flags & PRFL_INT32COORD)
-		return MSG_ReadLong () * (1.0 / 16.0);
+		return MSGR_ReadLong (reader) * (1.0 / 16.0);
 	else if (flags & PRFL_24BITCOORD)
-		return MSG_ReadCoord24 ();
+		return MSGR_ReadShort (reader) + MSGR_ReadByte (reader) * (1.0 / 255); // johnfitz -- 16.8 fixed point coords, max range +-32768
 	else
-		return MSG_ReadCoord16 ();
+		return MSGR_ReadShort (reader) * (1.0 / 8); // johnfitz -- original behavior, 13.3 fixed point coords, max range +-4096
 }
 
-float MSG_ReadAngle (unsigned int flags)
+float MSGR_ReadAngle (msg_reader_t *reader, unsigned int flags)
 {
 	if (flags & PRFL_FLOATANGLE)
-		return MSG_ReadFloat ();
+		return MSGR_ReadFloat (reader);
 	else if (flags & PRFL_SHORTANGLE)
-		return MSG_ReadShort () * (360.0 / 65536);
+		return MSGR_ReadShort (reader) * (360.0 / 65536);
 	else
-		return MSG_ReadChar () * (360.0 / 256);
+		return MSGR_ReadChar (reader) * (360.0 / 256);
 }
 
 // johnfitz -- for PROTOCOL_FITZQUAKE
-float MSG_ReadAngle16 (unsigned int flags)
+float MSGR_ReadAngle16 (msg_reader_t *reader, unsigned int flags)
 {
 	if (flags & PRFL_FLOATANGLE)
-		return MSG_ReadFloat (); // make sure
+		return MSGR_ReadFloat (reader); // make sure
 	else
-		return MSG_ReadShort () * (360.0 / 65536);
+		return MSGR_ReadShort (reader) * (360.0 / 65536);
 }
-// johnfitz
 
-unsigned int MSG_ReadEntity (unsigned int pext2)
+unsigned int MSGR_ReadEntity (msg_reader_t *reader, unsigned int pext2)
 {
-	unsigned int e = (unsigned short)MSG_ReadShort ();
+	unsigned int e = (unsigned short)MSGR_ReadShort (reader);
 	if (pext2 & PEXT2_REPLACEMENTDELTAS)
 	{
 		if (e & 0x8000)
 		{
 			e = (e & 0x7fff) << 8;
-			e |= MSG_ReadByte ();
+			e |= MSGR_ReadByte (reader);
 		}
 	}
 	return e;
 }
 
+//
+// the global readers work on net_message with msg_readcount/msg_badread as the cursor
+//
+#define MSG_GLOBAL_READ(type, read)        \
+	msg_reader_t reader;                   \
+	type		 result;                   \
+	MSGR_FromNetMessage (&reader);         \
+	result = read;                         \
+	MSGR_ToNetMessage (&reader);           \
+	return result;
+
+int MSG_ReadChar (void)
+{
+	MSG_GLOBAL_READ (int, MSGR_ReadChar (&reader));
+}
+
+int MSG_ReadByte (void)
+{
+	MSG_GLOBAL_READ (int, MSGR_ReadByte (&reader));
+}
+
+int MSG_ReadShort (void)
+{
+	MSG_GLOBAL_READ (int, MSGR_ReadShort (&reader));
+}
+
+int MSG_ReadLong (void)
+{
+	MSG_GLOBAL_READ (int, MSGR_ReadLong (&reader));
+}
+
+float MSG_ReadFloat (void)
+{
+	MSG_GLOBAL_READ (float, MSGR_ReadFloat (&reader));
+}
+
+const char *MSG_ReadString (void)
+{
+	static char string[2048];
+	msg_reader_t reader;
+
+	MSGR_FromNetMessage (&reader);
+	MSGR_ReadString (&reader, string, sizeof (string));
+	MSGR_ToNetMessage (&reader);
+
+	return string;
+}
+
+float MSG_ReadCoord (unsigned int flags)
+{
+	MSG_GLOBAL_READ (float, MSGR_ReadCoord (&reader, flags));
+}
+
+float MSG_ReadAngle (unsigned int flags)
+{
+	MSG_GLOBAL_READ (float, MSGR_ReadAngle (&reader, flags));
+}
+
+// johnfitz -- for PROTOCOL_FITZQUAKE
+float MSG_ReadAngle16 (unsigned int flags)
+{
+	MSG_GLOBAL_READ (float, MSGR_ReadAngle16 (&reader, flags));
+}
+// johnfitz
+
+unsigned int MSG_ReadEntity (unsigned int pext2)
+{
+	MSG_GLOBAL_READ (unsigned int, MSGR_ReadEntity (&reader, pext2));
+}
+
 //===========================================================================
 
 void SZ_Alloc (sizebuf_t *buf, int startsize)
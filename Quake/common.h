@@ -178,6 +178,65 @@ void MSG_WriteStaticOrBaseLine (
 	sizebuf_t *buf, int idx, struct entity_state_s *state, unsigned int protocol_pext2, unsigned int protocol,
 	unsigned int protocolflags); // spike
 
+// bulk writing: reserve the worst case of a message fragment once, then store without per-field bounds checks.
+// fragments that do not fit are built in the spill buffer and go through SZ_Write on commit, so overflow
+// handling is the same as for the MSG_Write* functions. rolling back is just not committing.
+#define MSGW_MAX_RESERVE 128
+
+typedef struct msg_writer_s
+{
+	sizebuf_t *sb;
+	byte	  *cur;
+	byte	  *start;
+#ifdef _DEBUG
+	byte *end;
+#endif
+	byte spill[MSGW_MAX_RESERVE];
+} msg_writer_t;
+
+extern qboolean msgw_unreserved; // sv_msgbenchmark: build every fragment in the spill buffer
+
+void MSGW_Begin (msg_writer_t *w, sizebuf_t *sb, int reserve);
+void MSGW_Commit (msg_writer_t *w);
+
+static inline int MSGW_Length (const msg_writer_t *w)
+{
+	return (int)(w->cur - w->start);
+}
+
+static inline void MSGW_WriteByte (msg_writer_t *w, int c)
+{
+	*w->cur++ = c;
+}
+
+static inline void MSGW_WriteShort (msg_writer_t *w, int c)
+{
+	w->cur[0] = c & 0xff;
+	w->cur[1] = c >> 8;
+	w->cur += 2;
+}
+
+static inline void MSGW_WriteLong (msg_writer_t *w, int c)
+{
+	w->cur[0] = c & 0xff;
+	w->cur[1] = (c >> 8) & 0xff;
+	w->cur[2] = (c >> 16) & 0xff;
+	w->cur[3] = c >> 24;
+	w->cur += 4;
+}
+
+static inline void MSGW_WriteFloat (msg_writer_t *w, float f)
+{
+	union
+	{
+		float f;
+		int	  l;
+	} dat;
+
+	dat.f = f;
+	MSGW_WriteLong (w, dat.l);
+}
+
 extern int		msg_readcount;
 extern qboolean msg_badread; // set if a read goes beyond end of message
 
@@ -195,6 +254,29 @@ float		 MSG_ReadAngle16 (unsigned int flags); // johnfitz
 byte		*MSG_ReadData (unsigned int length);   // spike
 unsigned int MSG_ReadEntity (unsigned int pext2);  // spike
 
+// reentrant reading: the cursor and error state live in the reader instead of msg_readcount/msg_badread
+typedef struct msg_reader_s
+{
+	const byte *data;
+	int			cursize;
+	int			readcount;
+	qboolean	badread; // set if a read goes beyond end of message
+} msg_reader_t;
+
+void		 MSGR_Init (msg_reader_t *reader, const byte *data, int size);
+void		 MSGR_FromNetMessage (msg_reader_t *reader);
+void		 MSGR_ToNetMessage (const msg_reader_t *reader);
+int			 MSGR_ReadChar (msg_reader_t *reader);
+int			 MSGR_ReadByte (msg_reader_t *reader);
+int			 MSGR_ReadShort (msg_reader_t *reader);
+int			 MSGR_ReadLong (msg_reader_t *reader);
+float		 MSGR_ReadFloat (msg_reader_t *reader);
+size_t		 MSGR_ReadString (msg_reader_t *reader, char *string, size_t size);
+float		 MSGR_ReadCoord (msg_reader_t *reader, unsigned int flags);
+float		 MSGR_ReadAngle (msg_reader_t *reader, unsigned int flags);
+float		 MSGR_ReadAngle16 (msg_reader_t *reader, unsigned int flags);
+unsigned int MSGR_ReadEntity (msg_reader_t *reader, unsigned int pext2);
+
 void COM_Effectinfo_Enumerate (int (*cb) (const char *pname)); // spike -- for dp compat
 
 //============================================================================
@@ -0,0 +1,528 @@
+/*
+Copyright (C) 2023 Axel Gneiting
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#include "quakedef.h"
+
+#define MIN_KEY_VALUE_STORAGE_SIZE 16
+#define MIN_CAPACITY			   FLAT_MAP_GROUP_WIDTH
+
+// at most 7/8 of the slots are full or deleted, so every probe sequence ends at an empty slot
+#define MaxLoad(capacity) ((capacity) - ((capacity) / 8))
+
+/*
+=================
+FlatMap_KeysEqual
+=================
+*/
+static inline qboolean FlatMap_KeysEqual (flat_map_t *map, const void *const key, const void *const storage_key)
+{
+	return map->comp ? map->comp (key, storage_key) : (memcmp (key, storage_key, map->key_size) == 0);
+}
+
+/*
+=================
+FlatMap_SetCtrl
+=================
+*/
+static inline void FlatMap_SetCtrl (flat_map_t *map, const uint32_t slot, const uint8_t ctrl)
+{
+	map->ctrl[slot] = ctrl;
+	if (slot < FLAT_MAP_GROUP_WIDTH)
+		map->ctrl[map->capacity + slot] = ctrl;
+}
+
+/*
+=================
+FlatMap_FindFreeSlot
+=================
+*/
+static uint32_t FlatMap_FindFreeSlot (flat_map_t *map, const uint32_t hash)
+{
+	const uint32_t mask = map->capacity - 1;
+	for (uint32_t pos = (hash >> 7) & mask, step = FLAT_MAP_GROUP_WIDTH;; pos = (pos + step) & mask, step += FLAT_MAP_GROUP_WIDTH)
+	{
+		const uint32_t match = FlatMap_MatchFree (map->ctrl + pos);
+		if (match)
+			return (pos + FindFirstBitNonZero (match)) & mask;
+	}
+}
+
+/*
+=================
+FlatMap_FindSlot
+
+Returns the slot of a key or UINT32_MAX
+=================
+*/
+static uint32_t FlatMap_FindSlot (flat_map_t *map, const void *const key, const uint32_t hash)
+{
+	const uint32_t mask = map->capacity - 1;
+	for (uint32_t pos = (hash >> 7) & mask, step = FLAT_MAP_GROUP_WIDTH;; pos = (pos + step) & mask, step += FLAT_MAP_GROUP_WIDTH)
+	{
+		const uint8_t *group = map->ctrl + pos;
+		for (uint32_t match = FlatMap_MatchByte (group, hash & 0x7F); match; match &= match - 1)
+		{
+			const uint32_t slot = (pos + FindFirstBitNonZero (match)) & mask;
+			if (FlatMap_KeysEqual (map, key, FlatMap_GetKeyImpl (map, map->slots[slot])))
+				return slot;
+		}
+		if (FlatMap_MatchByte (group, FLAT_MAP_EMPTY))
+			return UINT32_MAX;
+	}
+}
+
+/*
+=================
+FlatMap_FindSlotForIndex
+
+Returns the slot pointing at a storage index, which must be in the map
+=================
+*/
+static uint32_t FlatMap_FindSlotForIndex (flat_map_t *map, const uint32_t index)
+{
+	const uint32_t hash = map->hasher (FlatMap_GetKeyImpl (map, index));
+	const uint32_t mask = map->capacity - 1;
+	for (uint32_t pos = (hash >> 7) & mask, step = FLAT_MAP_GROUP_WIDTH;; pos = (pos + step) & mask, step += FLAT_MAP_GROUP_WIDTH)
+	{
+		for (uint32_t match = FlatMap_MatchByte (map->ctrl + pos, hash & 0x7F); match; match &= match - 1)
+		{
+			const uint32_t slot = (pos + FindFirstBitNonZero (match)) & mask;
+			if (map->slots[slot] == index)
+				return slot;
+		}
+	}
+}
+
+/*
+=================
+FlatMap_Rehash
+
+Rebuilds the control bytes from the stored keys, which also drops all deleted slots
+=================
+*/
+static void FlatMap_Rehash (flat_map_t *map, const uint32_t new_capacity)
+{
+	map->capacity = new_capacity;
+	map->ctrl = Mem_Realloc (map->ctrl, map->capacity + FLAT_MAP_GROUP_WIDTH);
+	map->slots = Mem_Realloc (map->slots, map->capacity * sizeof (uint32_t));
+	memset (map->ctrl, FLAT_MAP_EMPTY, map->capacity + FLAT_MAP_GROUP_WIDTH);
+	for (uint32_t i = 0; i < map->num_entries; ++i)
+	{
+		const uint32_t hash = map->hasher (FlatMap_GetKeyImpl (map, i));
+		const uint32_t slot = FlatMap_FindFreeSlot (map, hash);
+		FlatMap_SetCtrl (map, slot, hash & 0x7F);
+		map->slots[slot] = i;
+	}
+	map->growth_left = MaxLoad (map->capacity) - map->num_entries;
+}
+
+/*
+=================
+FlatMap_ExpandKeyValueStorage
+=================
+*/
+static void FlatMap_ExpandKeyValueStorage (flat_map_t *map, const uint32_t new_size)
+{
+	map->keys = Mem_Realloc (map->keys, new_size * map->key_size);
+	map->values = Mem_Realloc (map->values, new_size * map->value_size);
+	map->key_value_storage_size = new_size;
+}
+
+/*
+=================
+FlatMap_CreateImpl
+=================
+*/
+flat_map_t *FlatMap_CreateImpl (
+	const uint32_t key_size, const uint32_t value_size, uint32_t (*hasher) (const void *const), qboolean (*comp) (const void *const, const void *const))
+{
+	flat_map_t *map = Mem_Alloc (sizeof (flat_map_t));
+	map->key_size = key_size;
+	map->value_size = value_size;
+	map->hasher = hasher;
+	map->comp = comp;
+	FlatMap_Rehash (map, MIN_CAPACITY);
+	return map;
+}
+
+/*
+=================
+FlatMap_Destroy
+=================
+*/
+void FlatMap_Destroy (flat_map_t *map)
+{
+	Mem_Free (map->ctrl);
+	Mem_Free (map->slots);
+	Mem_Free (map->keys);
+	Mem_Free (map->values);
+	Mem_Free (map);
+}
+
+/*
+=================
+FlatMap_Reserve
+=================
+*/
+void FlatMap_Reserve (flat_map_t *map, int capacity)
+{
+	const uint32_t new_key_value_storage_size = Q_nextPow2 (capacity);
+	if (map->key_value_storage_size < new_key_value_storage_size)
+		FlatMap_ExpandKeyValueStorage (map, new_key_value_storage_size);
+	uint32_t new_capacity = map->capacity;
+	while (MaxLoad (new_capacity) < (uint32_t)capacity)
+		new_capacity *= 2;
+	if (map->capacity < new_capacity)
+		FlatMap_Rehash (map, new_capacity);
+}
+
+/*
+=================
+FlatMap_InsertNewImpl
+
+Adds a key that is known not to be in the map
+=================
+*/
+void FlatMap_InsertNewImpl (flat_map_t *map, const uint32_t hash, const void *const key, const void *const value)
+{
+	if (map->num_entries >= map->key_value_storage_size)
+		FlatMap_ExpandKeyValueStorage (map, q_max (map->key_value_storage_size * 2, MIN_KEY_VALUE_STORAGE_SIZE));
+
+	uint32_t slot = FlatMap_FindFreeSlot (map, hash);
+	if (map->growth_left == 0 && map->ctrl[slot] == FLAT_MAP_EMPTY)
+	{
+		// grow if the map is more than half full, otherwise only get rid of the deleted slots
+		FlatMap_Rehash (map, (map->num_entries * 2 >= MaxLoad (map->capacity)) ? map->capacity * 2 : map->capacity);
+		slot = FlatMap_FindFreeSlot (map, hash);
+	}
+
+	if (map->ctrl[slot] == FLAT_MAP_EMPTY)
+		--map->growth_left;
+	FlatMap_SetCtrl (map, slot, hash & 0x7F);
+	map->slots[slot] = map->num_entries;
+	memcpy (FlatMap_GetKeyImpl (map, map->num_entries), key, map->key_size);
+	memcpy (FlatMap_GetValueImpl (map, map->num_entries), value, map->value_size);
+	++map->num_entries;
+}
+
+/*
+=================
+FlatMap_InsertImpl
+=================
+*/
+qboolean FlatMap_InsertImpl (flat_map_t *map, const uint32_t key_size, const uint32_t value_size, const void *const key, const void *const value)
+{
+	assert (map->key_size == key_size);
+	assert (map->value_size == value_size);
+
+	const uint32_t hash = map->hasher (key);
+	const uint32_t slot = map->num_entries ? FlatMap_FindSlot (map, key, hash) : UINT32_MAX;
+	if (slot != UINT32_MAX)
+	{
+		memcpy (FlatMap_GetValueImpl (map, map->slots[slot]), value, value_size);
+		return true;
+	}
+
+	FlatMap_InsertNewImpl (map, hash, key, value);
+	return false;
+}
+
+/*
+=================
+FlatMap_EraseImpl
+=================
+*/
+qboolean FlatMap_EraseImpl (flat_map_t *map, const uint32_t key_size, const void *const key)
+{
+	assert (key_size == map->key_size);
+	if (map->num_entries == 0)
+		return false;
+
+	const uint32_t slot = FlatMap_FindSlot (map, key, map->hasher (key));
+	if (slot == UINT32_MAX)
+		return false;
+
+	const uint32_t storage_index = map->slots[slot];
+	const uint32_t last_index = map->num_entries - 1;
+	FlatMap_SetCtrl (map, slot, FLAT_MAP_DELETED);
+
+	// keep the storage dense by moving the last entry into the hole
+	if (storage_index != last_index)
+	{
+		map->slots[FlatMap_FindSlotForIndex (map, last_index)] = storage_index;
+		memcpy (FlatMap_GetKeyImpl (map, storage_index), FlatMap_GetKeyImpl (map, last_index), map->key_size);
+		memcpy (FlatMap_GetValueImpl (map, storage_index), FlatMap_GetValueImpl (map, last_index), map->value_size);
+	}
+
+	--map->num_entries;
+	return true;
+}
+
+/*
+=================
+FlatMap_LookupImpl
+=================
+*/
+void *FlatMap_LookupImpl (flat_map_t *map, const uint32_t key_size, const void *const key)
+{
+	assert (map->key_size == key_size);
+
+	if (map->num_entries == 0)
+		return NULL;
+
+	const uint32_t slot = FlatMap_FindSlot (map, key, map->hasher (key));
+	return (slot != UINT32_MAX) ? FlatMap_GetValueImpl (map, map->slots[slot]) : NULL;
+}
+
+/*
+=================
+FlatMap_MemoryUsage
+=================
+*/
+size_t FlatMap_MemoryUsage (flat_map_t *map)
+{
+	return sizeof (flat_map_t) + (map->capacity + FLAT_MAP_GROUP_WIDTH) + (map->capacity * sizeof (uint32_t)) +
+		   (map->key_value_storage_size * (map->key_size + map->value_size));
+}
+
+#ifdef _DEBUG
+/*
+=================
+FlatMap_TestAssert
+=================
+*/
+#define FlatMap_TestAssert(cond, what) \
+	if (!(cond))                       \
+	{                                  \
+		Con_Printf ("%s", what);       \
+		abort ();                      \
+	}
+
+/*
+=================
+FlatMap_BasicTest
+=================
+*/
+static void FlatMap_BasicTest (const qboolean reserve)
+{
+	const int	TEST_SIZE = 1000;
+	flat_map_t *map = FlatMap_Create (int32_t, int64_t, &HashInt32, NULL);
+	if (reserve)
+		FlatMap_Reserve (map, TEST_SIZE);
+	for (int i = 0; i < TEST_SIZE; ++i)
+	{
+		int64_t value = i;
+		FlatMap_TestAssert (!FlatMap_Insert (map, &i, &value), va ("%d should not be overwritten\n", i));
+	}
+	for (int i = 0; i < TEST_SIZE; ++i)
+	{
+		FlatMap_TestAssert (*FlatMap_Lookup (int64_t, map, &i) == i, va ("Wrong lookup for %d\n", i));
+		FlatMap_TestAssert (*(int64_t *)FlatMap_LookupInt32 (map, &i) == i, va ("Wrong inline lookup for %d\n", i));
+	}
+	for (int i = 0; i < TEST_SIZE; i += 2)
+		FlatMap_Erase (map, &i);
+	for (int i = 1; i < TEST_SIZE; i += 2)
+		FlatMap_TestAssert (*FlatMap_Lookup (int64_t, map, &i) == i, va ("Wrong lookup for %d\n", i));
+	for (int i = 0; i < TEST_SIZE; i += 2)
+		FlatMap_TestAssert (FlatMap_Lookup (int64_t, map, &i) == NULL, va ("Wrong lookup for %d\n", i));
+	for (int i = 0; i < TEST_SIZE; ++i)
+		FlatMap_Erase (map, &i);
+	FlatMap_TestAssert (FlatMap_Size (map) == 0, "Map is not empty");
+	for (int i = 0; i < TEST_SIZE; ++i)
+		FlatMap_TestAssert (FlatMap_Lookup (int64_t, map, &i) == NULL, va ("Wrong lookup for %d\n", i));
+	FlatMap_Destroy (map);
+}
+
+/*
+=================
+FlatMap_StressTest
+=================
+*/
+static void FlatMap_StressTest (void)
+{
+	srand (0);
+	const int TEST_SIZE = 10000;
+	TEMP_ALLOC (int64_t, keys, TEST_SIZE);
+	flat_map_t *map = FlatMap_Create (int64_t, int32_t, &HashInt64, NULL);
+	for (int j = 0; j < 10; ++j)
+	{
+		for (int i = 0; i < TEST_SIZE; ++i)
+		{
+			keys[i] = i;
+		}
+		for (int i = TEST_SIZE - 1; i > 0; --i)
+		{
+			const int swap_index = rand () % (i + 1);
+			const int temp = keys[swap_index];
+			keys[swap_index] = keys[i];
+			keys[i] = temp;
+		}
+		for (int i = 0; i < TEST_SIZE; ++i)
+			FlatMap_InsertInt64 (map, &keys[i], &i);
+		for (int i = 0; i < TEST_SIZE; ++i)
+			FlatMap_TestAssert (*FlatMap_Lookup (int32_t, map, &keys[i]) == i, va ("Wrong lookup for %d\n", i));
+		// erase in a different order than inserted, so deleted slots pile up between the full ones
+		for (int i = 0; i < TEST_SIZE; i += 2)
+			FlatMap_Erase (map, &keys[i]);
+		for (int i = 1; i < TEST_SIZE; i += 2)
+			FlatMap_TestAssert (*FlatMap_Lookup (int32_t, map, &keys[i]) == i, va ("Wrong lookup for %d\n", i));
+		for (int i = TEST_SIZE - 1; i >= 0; --i)
+			FlatMap_Erase (map, &keys[i]);
+		FlatMap_TestAssert (FlatMap_Size (map) == 0, "Map is not empty");
+	}
+	FlatMap_Destroy (map);
+	TEMP_FREE (keys);
+}
+
+/*
+=================
+TestFlatMap
+=================
+*/
+void TestFlatMap (void)
+{
+	FlatMap_BasicTest (false);
+	FlatMap_BasicTest (true);
+	FlatMap_StressTest ();
+}
+
+/*
+=================
+BenchmarkFlatMap
+
+Insert and lookup throughput against hash_map_t for integer and string keys
+=================
+*/
+#define BENCHMARK_SIZE	 100000
+#define BENCHMARK_ROUNDS 10
+
+typedef enum
+{
+	BENCH_HASH_MAP,
+	BENCH_FLAT_MAP,
+	BENCH_FLAT_MAP_INLINE,
+	BENCH_NUM_MAPS
+} benchmap_t;
+
+static const char *bench_map_names[BENCH_NUM_MAPS] = {"hash_map", "flat_map", "flat_map inline"};
+
+static void BenchmarkFlatMap_Run (const char *what, benchmap_t which, const qboolean strings, const void *keys, const void *misses)
+{
+	const uint32_t key_size = strings ? sizeof (const char *) : sizeof (int32_t);
+	double		   insert_time = 0.0, hit_time = 0.0, miss_time = 0.0;
+	size_t		   memory = 0;
+	uint32_t	   found = 0;
+
+	for (int round = 0; round < BENCHMARK_ROUNDS; ++round)
+	{
+		hash_map_t *hash_map = NULL;
+		flat_map_t *flat_map = NULL;
+		double		time;
+
+		if (which == BENCH_HASH_MAP)
+			hash_map = HashMap_CreateImpl (key_size, sizeof (int32_t), strings ? &HashStr : &HashInt32, strings ? &HashStrCmp : NULL);
+		else
+			flat_map = FlatMap_CreateImpl (key_size, sizeof (int32_t), strings ? &HashStr : &HashInt32, strings ? &HashStrCmp : NULL);
+
+		time = Sys_DoubleTime ();
+		for (int i = 0; i < BENCHMARK_SIZE; ++i)
+		{
+			const void *key = (const byte *)keys + i * key_size;
+			if (which == BENCH_HASH_MAP)
+				HashMap_InsertImpl (hash_map, key_size, sizeof (int32_t), key, &i);
+			else if (which == BENCH_FLAT_MAP)
+				FlatMap_InsertImpl (flat_map, key_size, sizeof (int32_t), key, &i);
+			else if (strings)
+				FlatMap_InsertStr (flat_map, key, &i);
+			else
+				FlatMap_InsertInt32 (flat_map, key, &i);
+		}
+		insert_time += Sys_DoubleTime () - time;
+
+		for (int pass = 0; pass < 2; ++pass)
+		{
+			const void *lookup_keys = pass ? misses : keys;
+			time = Sys_DoubleTime ();
+			for (int i = 0; i < BENCHMARK_SIZE; ++i)
+			{
+				const void *key = (const byte *)lookup_keys + i * key_size;
+				const void *value;
+				if (which == BENCH_HASH_MAP)
+					value = HashMap_LookupImpl (hash_map, key_size, key);
+				else if (which == BENCH_FLAT_MAP)
+					value = FlatMap_LookupImpl (flat_map, key_size, key);
+				else if (strings)
+					value = FlatMap_LookupStr (flat_map, key);
+				else
+					value = FlatMap_LookupInt32 (flat_map, key);
+				found += value != NULL;
+			}
+			if (pass)
+				miss_time += Sys_DoubleTime () - time;
+			else
+				hit_time += Sys_DoubleTime () - time;
+		}
+
+		if (which == BENCH_HASH_MAP)
+		{
+			memory = HashMap_MemoryUsage (hash_map);
+			HashMap_Destroy (hash_map);
+		}
+		else
+		{
+			memory = FlatMap_MemoryUsage (flat_map);
+			FlatMap_Destroy (flat_map);
+		}
+	}
+
+	if (found != BENCHMARK_SIZE * BENCHMARK_ROUNDS)
+		Con_Printf ("%s %s: wrong number of keys found\n", what, bench_map_names[which]);
+	Con_Printf (
+		"%-7s %-16s %7.1f %7.1f %7.1f %7.1f MB\n", what, bench_map_names[which], BENCHMARK_SIZE * BENCHMARK_ROUNDS / insert_time / 1e6,
+		BENCHMARK_SIZE * BENCHMARK_ROUNDS / hit_time / 1e6, BENCHMARK_SIZE * BENCHMARK_ROUNDS / miss_time / 1e6, memory / (1024.0 * 1024.0));
+}
+
+void BenchmarkFlatMap (void)
+{
+	TEMP_ALLOC (int32_t, int_keys, BENCHMARK_SIZE * 2);
+	TEMP_ALLOC (const char *, str_keys, BENCHMARK_SIZE * 2);
+	char *strings = Mem_Alloc (BENCHMARK_SIZE * 2 * 16);
+
+	srand (0);
+	for (int i = 0; i < BENCHMARK_SIZE * 2; ++i)
+	{
+		// odd keys are inserted, even ones only looked up
+		int_keys[i] = (int32_t)((((uint32_t)rand () << 16) ^ (uint32_t)rand ()) * 2 + (i < BENCHMARK_SIZE));
+		q_snprintf (strings + i * 16, 16, "key_%d", int_keys[i]);
+		str_keys[i] = strings + i * 16;
+	}
+
+	Con_Printf ("%d keys, million ops/s\n", BENCHMARK_SIZE);
+	Con_Printf ("keys    map               insert     hit    miss  memory\n");
+	for (int which = 0; which < BENCH_NUM_MAPS; ++which)
+		BenchmarkFlatMap_Run ("int32", which, false, int_keys, int_keys + BENCHMARK_SIZE);
+	for (int which = 0; which < BENCH_NUM_MAPS; ++which)
+		BenchmarkFlatMap_Run ("string", which, true, str_keys, str_keys + BENCHMARK_SIZE);
+
+	Mem_Free (strings);
+	TEMP_FREE (str_keys);
+	TEMP_FREE (int_keys);
+}
+#endif
@@ -0,0 +1,176 @@
+/*
+Copyright (C) 2023 Axel Gneiting
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+
+#ifndef _FLAT_MAP_H_
+#define _FLAT_MAP_H_
+
+// Open addressing variant of hash_map_t with the same API. Keys and values are stored densely like in hash_map_t,
+// so GetKey/GetValue by index keep working, but the index is a table of control bytes that is probed a group of
+// 16 slots at a time. Each control byte holds 7 bits of the hash of its slot, so a key is usually only compared
+// once per lookup.
+
+#define FLAT_MAP_GROUP_WIDTH 16
+#define FLAT_MAP_EMPTY		 0x80
+#define FLAT_MAP_DELETED	 0xFE
+
+typedef struct flat_map_s
+{
+	uint32_t num_entries;
+	uint32_t key_value_storage_size;
+	uint32_t capacity;	  // slots, a power of two
+	uint32_t growth_left; // inserts into empty slots until the next rehash
+	uint32_t key_size;
+	uint32_t value_size;
+	uint32_t (*hasher) (const void *const);
+	qboolean (*comp) (const void *const, const void *const);
+	uint8_t	 *ctrl;	 // capacity + FLAT_MAP_GROUP_WIDTH bytes, the first group is mirrored at the end
+	uint32_t *slots; // index into keys/values for every full slot
+	void	 *keys;
+	void	 *values;
+} flat_map_t;
+
+flat_map_t *FlatMap_CreateImpl (
+	const uint32_t key_size, const uint32_t value_size, uint32_t (*hasher) (const void *const), qboolean (*comp) (const void *const, const void *const));
+void	 FlatMap_Destroy (flat_map_t *map);
+void	 FlatMap_Reserve (flat_map_t *map, int capacity);
+qboolean FlatMap_InsertImpl (flat_map_t *map, const uint32_t key_size, const uint32_t value_size, const void *const key, const void *const value);
+void	 FlatMap_InsertNewImpl (flat_map_t *map, const uint32_t hash, const void *const key, const void *const value);
+qboolean FlatMap_EraseImpl (flat_map_t *map, const uint32_t key_size, const void *const key);
+void	*FlatMap_LookupImpl (flat_map_t *map, const uint32_t key_size, const void *const key);
+size_t	 FlatMap_MemoryUsage (flat_map_t *map);
+
+#define FlatMap_Create(key_type, value_type, hasher, comp) FlatMap_CreateImpl (sizeof (key_type), sizeof (value_type), hasher, comp)
+#define FlatMap_Insert(map, key, value)					   FlatMap_InsertImpl (map, sizeof (*key), sizeof (*value), key, value)
+#define FlatMap_Erase(map, key)							   FlatMap_EraseImpl (map, sizeof (*key), key)
+#define FlatMap_Lookup(type, map, key)					   ((type *)FlatMap_LookupImpl (map, sizeof (*key), key))
+#define FlatMap_GetKey(type, map, index)				   ((type *)FlatMap_GetKeyImpl (map, index))
+#define FlatMap_GetValue(type, map, index)				   ((type *)FlatMap_GetValueImpl (map, index))
+
+static inline uint32_t FlatMap_Size (flat_map_t *map)
+{
+	return map->num_entries;
+}
+
+static inline void *FlatMap_GetKeyImpl (flat_map_t *map, uint32_t index)
+{
+	return (byte *)map->keys + (map->key_size * index);
+}
+
+static inline void *FlatMap_GetValueImpl (flat_map_t *map, uint32_t index)
+{
+	return (byte *)map->values + (map->value_size * index);
+}
+
+// Bit i is set for every control byte in the group that equals val
+static inline uint32_t FlatMap_MatchByte (const uint8_t *group, const uint8_t val)
+{
+#if defined(USE_SSE2)
+	return (uint32_t)_mm_movemask_epi8 (_mm_cmpeq_epi8 (_mm_loadu_si128 ((const __m128i *)group), _mm_set1_epi8 ((char)val)));
+#elif defined(USE_NEON)
+	static const uint8_t bits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+	const uint8x16_t	 eq = vandq_u8 (vceqq_u8 (vld1q_u8 (group), vdupq_n_u8 (val)), vld1q_u8 (bits));
+	return (uint32_t)vaddv_u8 (vget_low_u8 (eq)) | ((uint32_t)vaddv_u8 (vget_high_u8 (eq)) << 8);
+#else
+	uint32_t mask = 0;
+	for (int i = 0; i < FLAT_MAP_GROUP_WIDTH; ++i)
+		mask |= (uint32_t)(group[i] == val) << i;
+	return mask;
+#endif
+}
+
+// Bit i is set for every empty or deleted control byte in the group
+static inline uint32_t FlatMap_MatchFree (const uint8_t *group)
+{
+#if defined(USE_SSE2)
+	return (uint32_t)_mm_movemask_epi8 (_mm_loadu_si128 ((const __m128i *)group));
+#elif defined(USE_NEON)
+	static const uint8_t bits[16] = {1, 2, 4, 8, 16, 32, 64, 128, 1, 2, 4, 8, 16, 32, 64, 128};
+	const uint8x16_t	 unused = vandq_u8 (vcltq_s8 (vreinterpretq_s8_u8 (vld1q_u8 (group)), vdupq_n_s8 (0)), vld1q_u8 (bits));
+	return (uint32_t)vaddv_u8 (vget_low_u8 (unused)) | ((uint32_t)vaddv_u8 (vget_high_u8 (unused)) << 8);
+#else
+	uint32_t mask = 0;
+	for (int i = 0; i < FLAT_MAP_GROUP_WIDTH; ++i)
+		mask |= (uint32_t)(group[i] >> 7) << i;
+	return mask;
+#endif
+}
+
+/*
+FLAT_MAP_DEFINE_KEY generates FlatMap_Lookup<name> and FlatMap_Insert<name> for a fixed key type. The hasher and
+key comparison are inlined instead of being called through the function pointers of the map, which still need to
+be passed to FlatMap_Create for rehashing and the generic functions.
+
+Groups are probed with growing steps, with a power of two capacity this visits every group.
+*/
+#define FLAT_MAP_DEFINE_KEY(name, key_type, hasher, equals)                                                         \
+	static inline uint32_t FlatMap_Find##name (flat_map_t *map, key_type const *key, const uint32_t hash)         \
+	{                                                                                                               \
+		const uint32_t mask = map->capacity - 1;                                                                    \
+		for (uint32_t pos = (hash >> 7) & mask, step = FLAT_MAP_GROUP_WIDTH;; pos = (pos + step) & mask, step += FLAT_MAP_GROUP_WIDTH) \
+		{                                                                                                           \
+			const uint8_t *group = map->ctrl + pos;                                                                 \
+			for (uint32_t match = FlatMap_MatchByte (group, hash & 0x7F); match; match &= match - 1)                \
+			{                                                                                                       \
+				const uint32_t index = map->slots[(pos + FindFirstBitNonZero (match)) & mask];                      \
+				if (equals (key, (key_type const *)map->keys + index))                                              \
+					return index;                                                                                   \
+			}                                                                                                       \
+			if (FlatMap_MatchByte (group, FLAT_MAP_EMPTY))                                                          \
+				return UINT32_MAX;                                                                                  \
+		}                                                                                                           \
+	}                                                                                                               \
+	static inline void *FlatMap_Lookup##name (flat_map_t *map, key_type const *key)                                 \
+	{                                                                                                               \
+		if (map->num_entries == 0)                                                                                  \
+			return NULL;                                                                                            \
+		const uint32_t index = FlatMap_Find##name (map, key, hasher (key));                                         \
+		return (index != UINT32_MAX) ? FlatMap_GetValueImpl (map, index) : NULL;                                    \
+	}                                                                                                               \
+	static inline qboolean FlatMap_Insert##name (flat_map_t *map, key_type const *key, const void *const value)      \
+	{                                                                                                               \
+		const uint32_t hash = hasher (key);                                                                         \
+		const uint32_t index = map->num_entries ? FlatMap_Find##name (map, key, hash) : UINT32_MAX;                 \
+		if (index != UINT32_MAX)                                                                                    \
+		{                                                                                                           \
+			memcpy (FlatMap_GetValueImpl (map, index), value, map->value_size);                                     \
+			return true;                                                                                            \
+		}                                                                                                           \
+		FlatMap_InsertNewImpl (map, hash, key, value);                                                              \
+		return false;                                                                                               \
+	}
+
+#define FLAT_MAP_EQUALS(a, b) (*(a) == *(b))
+
+static inline qboolean FlatMap_Vec3Equals (const vec3_t *a, const vec3_t *b)
+{
+	return (*a)[0] == (*b)[0] && (*a)[1] == (*b)[1] && (*a)[2] == (*b)[2];
+}
+
+FLAT_MAP_DEFINE_KEY (Int32, int32_t, HashInt32, FLAT_MAP_EQUALS)
+FLAT_MAP_DEFINE_KEY (Int64, int64_t, HashInt64, FLAT_MAP_EQUALS)
+FLAT_MAP_DEFINE_KEY (Vec3, vec3_t, HashVec3, FlatMap_Vec3Equals)
+FLAT_MAP_DEFINE_KEY (Str, const char *, HashStr, HashStrCmp)
+
+#ifdef _DEBUG
+void TestFlatMap (void);
+void BenchmarkFlatMap (void);
+#endif
+
+#endif /* _FLAT_MAP_H_ */
@@ -111,7 +111,7 @@ gltexture_t *scrap_textures[MAX_SCRAPS]; // johnfitz
 ================
 Scrap_AllocBlock
 
-returns an index into scrap_texnums[] and the position inside it
+returns an index into scrap_texnums[] and the position inside it, or -1 if the scrap is full
 ================
 */
 int Scrap_AllocBlock (int w, int h, int *x, int *y)
@@ -151,8 +151,7 @@ int Scrap_AllocBlock (int w, int h, int *x, int *y)
 		return texnum;
 	}
 
-	Sys_Error ("Scrap_AllocBlock: full");
-	return 0;
+	return -1;
 }
 
 /*
@@ -176,6 +175,41 @@ void Scrap_Upload (void)
 	scrap_dirty = false;
 }
 
+/*
+================
+Scrap_AddPic
+
+copies a small pic into the scrap so that it can be batched with the other 2D quads
+================
+*/
+static qboolean Scrap_AddPic (int width, int height, const byte *data, glpic_t *gl)
+{
+	int x = 0, y = 0;
+	int i, j, k;
+	int texnum;
+
+	if (width >= 64 || height >= 64)
+		return false;
+	texnum = Scrap_AllocBlock (width, height, &x, &y);
+	if (texnum < 0)
+		return false;
+
+	scrap_dirty = true;
+	k = 0;
+	for (i = 0; i < height; i++)
+	{
+		for (j = 0; j < width; j++, k++)
+			scrap_texels[texnum][(y + i) * BLOCK_WIDTH + x + j] = data[k];
+	}
+	gl->gltexture = scrap_textures[texnum]; // johnfitz -- changed to an array
+	// johnfitz -- no longer go from 0.01 to 0.99
+	gl->sl = x / (float)BLOCK_WIDTH;
+	gl->sh = (x + width) / (float)BLOCK_WIDTH;
+	gl->tl = y / (float)BLOCK_WIDTH;
+	gl->th = (y + height) / (float)BLOCK_WIDTH;
+	return true;
+}
+
 /*
 ================
 Draw_PicFromWad
@@ -213,29 +247,7 @@ qpic_t *Draw_PicFromWad2 (const char *name, unsigned int texflags)
 		Sys_Error ("Draw_PicFromWad: bad size (%dx%d) for pic \"%s\"", p->width, p->height, name);
 
 	// load little ones into the scrap
-	if (p->width < 64 && p->height < 64)
-	{
-		int	  x = 0, y = 0;
-		int	  j, k;
-		int	  texnum;
-		byte *data = p->data;
-
-		texnum = Scrap_AllocBlock (p->width, p->height, &x, &y);
-		scrap_dirty = true;
-		k = 0;
-		for (i = 0; i < p->height; i++)
-		{
-			for (j = 0; j < p->width; j++, k++)
-				scrap_texels[texnum][(y + i) * BLOCK_WIDTH + x + j] = data[k];
-		}
-		gl.gltexture = scrap_textures[texnum]; // johnfitz -- changed to an array
-		// johnfitz -- no longer go from 0.01 to 0.99
-		gl.sl = x / (float)BLOCK_WIDTH;
-		gl.sh = (x + p->width) / (float)BLOCK_WIDTH;
-		gl.tl = y / (float)BLOCK_WIDTH;
-		gl.th = (y + p->height) / (float)BLOCK_WIDTH;
-	}
-	else
+	if (!Scrap_AddPic (p->width, p->height, p->data, &gl))
 	{
 		char texturename[64];														// johnfitz
 		q_snprintf (texturename, sizeof (texturename), "%s:%s", WADFILENAME, name); // johnfitz
@@ -315,12 +327,17 @@ qpic_t *Draw_TryCachePic (const char *path, unsigned int texflags)
 	pic->pic.width = dat->width;
 	pic->pic.height = dat->height;
 
-	gl.gltexture = TexMgr_LoadImage (
-		NULL, path, dat->width, dat->height, SRC_INDEXED, dat->data, path, sizeof (int) * 2, texflags | TEXPREF_NOPICMIP); // johnfitz -- TexMgr
-	gl.sl = 0;
-	gl.sh = 1;
-	gl.tl = 0;
-	gl.th = 1;
+	// small menu pics go into the scrap too, except the one that gets translated
+	if ((texflags != (TEXPREF_ALPHA | TEXPREF_PAD | TEXPREF_NOPICMIP)) || !strcmp (path, "gfx/menuplyr.lmp") ||
+		!Scrap_AddPic (dat->width, dat->height, dat->data, &gl))
+	{
+		gl.gltexture = TexMgr_LoadImage (
+			NULL, path, dat->width, dat->height, SRC_INDEXED, dat->data, path, sizeof (int) * 2, texflags | TEXPREF_NOPICMIP); // johnfitz -- TexMgr
+		gl.sl = 0;
+		gl.sh = 1;
+		gl.tl = 0;
+		gl.th = 1;
+	}
 
 	memcpy (pic->pic.data, &gl, sizeof (glpic_t));
 
@@ -449,6 +466,98 @@ void Draw_Init (void)
 //
 //==============================================================================
 
+#define MAX_BATCH_QUADS 2048
+
+typedef struct draw_batch_s
+{
+	vulkan_pipeline_t pipeline;
+	VkDescriptorSet	  descriptor_set;
+	int				  num_vertices;
+	uint32_t		  num_draws;
+	uint32_t		  num_drawn_vertices;
+	basicvertex_t	  vertices[MAX_BATCH_QUADS * 6];
+} draw_batch_t;
+
+/*
+================
+Draw_FlushBatch
+
+Submits all queued 2D quads with a single draw. Must be called before
+recording anything else into the command buffer (canvas, scissor, ...)
+================
+*/
+void Draw_FlushBatch (cb_context_t *cbx)
+{
+	draw_batch_t *batch = cbx->draw_batch;
+	if (!batch || !batch->num_vertices)
+		return;
+
+	VkBuffer	  buffer;
+	VkDeviceSize  buffer_offset;
+	byte		 *vertices = R_VertexAllocate (batch->num_vertices * sizeof (basicvertex_t), &buffer, &buffer_offset);
+	memcpy (vertices, batch->vertices, batch->num_vertices * sizeof (basicvertex_t));
+
+	vulkan_globals.vk_cmd_bind_vertex_buffers (cbx->cb, 0, 1, &buffer, &buffer_offset);
+	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, batch->pipeline);
+	if (batch->descriptor_set != VK_NULL_HANDLE)
+		vulkan_globals.vk_cmd_bind_descriptor_sets (
+			cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &batch->descriptor_set, 0, NULL);
+	vulkan_globals.vk_cmd_draw (cbx->cb, batch->num_vertices, 1, 0, 0);
+
+	batch->num_draws++;
+	batch->num_drawn_vertices += batch->num_vertices;
+	batch->num_vertices = 0;
+}
+
+/*
+================
+Draw_EndBatch
+
+Flushes the batch at the end of the 2D pass and publishes its counters for r_speeds
+================
+*/
+void Draw_EndBatch (cb_context_t *cbx)
+{
+	draw_batch_t *batch = cbx->draw_batch;
+
+	Draw_FlushBatch (cbx);
+	Atomic_StoreUInt32 (&rs_2ddrawcalls, batch ? batch->num_draws : 0);
+	Atomic_StoreUInt32 (&rs_2dvertices, batch ? batch->num_drawn_vertices : 0);
+	if (batch)
+	{
+		batch->num_draws = 0;
+		batch->num_drawn_vertices = 0;
+	}
+}
+
+/*
+================
+Draw_AllocateQuad
+
+Returns space for the 6 vertices of one quad. Consecutive quads with the same
+pipeline and texture are merged into one draw. Quads are never reordered since
+2D relies on painter's order for blending.
+================
+*/
+basicvertex_t *Draw_AllocateQuad (cb_context_t *cbx, vulkan_pipeline_t pipeline, gltexture_t *texture)
+{
+	draw_batch_t		 *batch = cbx->draw_batch;
+	const VkDescriptorSet descriptor_set = texture ? texture->descriptor_set : VK_NULL_HANDLE;
+
+	if (!batch)
+		batch = cbx->draw_batch = (draw_batch_t *)Mem_Alloc (sizeof (draw_batch_t));
+	else if (
+		(batch->num_vertices > 0) &&
+		((batch->pipeline.handle != pipeline.handle) || (batch->descriptor_set != descriptor_set) || (batch->num_vertices == MAX_BATCH_QUADS * 6)))
+		Draw_FlushBatch (cbx);
+
+	basicvertex_t *vertices = batch->vertices + batch->num_vertices;
+	batch->pipeline = pipeline;
+	batch->descriptor_set = descriptor_set;
+	batch->num_vertices += 6;
+	return vertices;
+}
+
 /*
 ================
 Draw_FillCharacterQuad
@@ -522,17 +631,8 @@ void Draw_Character (cb_context_t *cbx, int x, int y, int num)
 	if (num == 32)
 		return; // don't waste verts on spaces
 
-	VkBuffer	   buffer;
-	VkDeviceSize   buffer_offset;
-	basicvertex_t *vertices = (basicvertex_t *)R_VertexAllocate (6 * sizeof (basicvertex_t), &buffer, &buffer_offset);
-
+	basicvertex_t *vertices = Draw_AllocateQuad (cbx, vulkan_globals.basic_alphatest_pipeline[cbx->render_pass_index], char_texture);
 	Draw_FillCharacterQuad (x, y, (char)num, vertices, rotation);
-
-	vulkan_globals.vk_cmd_bind_vertex_buffers (cbx->cb, 0, 1, &buffer, &buffer_offset);
-	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_alphatest_pipeline[cbx->render_pass_index]);
-	vulkan_globals.vk_cmd_bind_descriptor_sets (
-		cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &char_texture->descriptor_set, 0, NULL);
-	vulkan_globals.vk_cmd_draw (cbx->cb, 6, 1, 0, 0);
 }
 
 /*
@@ -542,36 +642,15 @@ Draw_String
 */
 void Draw_String (cb_context_t *cbx, int x, int y, const char *str)
 {
-	int			num_verts = 0;
-	int			i;
-	const char *tmp;
-
 	if (y <= -CHARACTER_SIZE)
 		return; // totally off screen
 
-	for (tmp = str; *tmp != 0; ++tmp)
-		if (*tmp != 32)
-			num_verts += 6;
-
-	VkBuffer	   buffer;
-	VkDeviceSize   buffer_offset;
-	basicvertex_t *vertices = (basicvertex_t *)R_VertexAllocate (num_verts * sizeof (basicvertex_t), &buffer, &buffer_offset);
-
-	for (i = 0; *str != 0; ++str)
+	for (; *str != 0; ++str)
 	{
 		if (*str != 32)
-		{
-			Draw_FillCharacterQuad (x, y, *str, vertices + i * 6, 0);
-			i++;
-		}
+			Draw_FillCharacterQuad (x, y, *str, Draw_AllocateQuad (cbx, vulkan_globals.basic_alphatest_pipeline[cbx->render_pass_index], char_texture), 0);
 		x += CHARACTER_SIZE;
 	}
-
-	vulkan_globals.vk_cmd_bind_vertex_buffers (cbx->cb, 0, 1, &buffer, &buffer_offset);
-	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_alphatest_pipeline[cbx->render_pass_index]);
-	vulkan_globals.vk_cmd_bind_descriptor_sets (
-		cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &char_texture->descriptor_set, 0, NULL);
-	vulkan_globals.vk_cmd_draw (cbx->cb, num_verts, 1, 0, 0);
 }
 
 /*
@@ -585,13 +664,12 @@ void Draw_Pic (cb_context_t *cbx, int x, int y, qpic_t *pic, float alpha, qboole
 	int		i;
 
 	if (scrap_dirty)
+	{
+		Draw_FlushBatch (cbx);
 		Scrap_Upload ();
+	}
 	memcpy (&gl, pic->data, sizeof (glpic_t));
 
-	VkBuffer	   buffer;
-	VkDeviceSize   buffer_offset;
-	basicvertex_t *vertices = (basicvertex_t *)R_VertexAllocate (6 * sizeof (basicvertex_t), &buffer, &buffer_offset);
-
 	basicvertex_t corner_verts[4];
 	memset (&corner_verts, 255, sizeof (corner_verts));
 
@@ -622,21 +700,15 @@ void Draw_Pic (cb_context_t *cbx, int x, int y, qpic_t *pic, float alpha, qboole
 	for (i = 0; i < 4; ++i)
 		corner_verts[i].color[3] = alpha * 255.0f;
 
+	basicvertex_t *vertices = Draw_AllocateQuad (
+		cbx, alpha_blend ? vulkan_globals.basic_blend_pipeline[cbx->render_pass_index] : vulkan_globals.basic_alphatest_pipeline[cbx->render_pass_index],
+		gl.gltexture);
 	vertices[0] = corner_verts[0];
 	vertices[1] = corner_verts[1];
 	vertices[2] = corner_verts[2];
 	vertices[3] = corner_verts[2];
 	vertices[4] = corner_verts[3];
 	vertices[5] = corner_verts[0];
-
-	vkCmdBindVertexBuffers (cbx->cb, 0, 1, &buffer, &buffer_offset);
-	if (alpha_blend)
-		R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_blend_pipeline[cbx->render_pass_index]);
-	else
-		R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_alphatest_pipeline[cbx->render_pass_index]);
-	vkCmdBindDescriptorSets (
-		cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &gl.gltexture->descriptor_set, 0, NULL);
-	vkCmdDraw (cbx->cb, 6, 1, 0, 0);
 }
 
 void Draw_SubPic (cb_context_t *cbx, float x, float y, float w, float h, qpic_t *pic, float s1, float t1, float s2, float t2, float *rgb, float alpha)
@@ -651,15 +723,14 @@ void Draw_SubPic (cb_context_t *cbx, float x, float y, float w, float h, qpic_t
 	t2 += t1;
 
 	if (scrap_dirty)
+	{
+		Draw_FlushBatch (cbx);
 		Scrap_Upload ();
+	}
 	memcpy (&gl, pic->data, sizeof (glpic_t));
 	if (!gl.gltexture)
 		return;
 
-	VkBuffer	   buffer;
-	VkDeviceSize   buffer_offset;
-	basicvertex_t *vertices = (basicvertex_t *)R_VertexAllocate (6 * sizeof (basicvertex_t), &buffer, &buffer_offset);
-
 	basicvertex_t corner_verts[4];
 	memset (&corner_verts, 255, sizeof (corner_verts));
 
@@ -695,21 +766,15 @@ void Draw_SubPic (cb_context_t *cbx, float x, float y, float w, float h, qpic_t
 		corner_verts[i].color[3] = alpha * 255.0f;
 	}
 
+	basicvertex_t *vertices = Draw_AllocateQuad (
+		cbx, alpha_blend ? vulkan_globals.basic_blend_pipeline[cbx->render_pass_index] : vulkan_globals.basic_alphatest_pipeline[cbx->render_pass_index],
+		gl.gltexture);
 	vertices[0] = corner_verts[0];
 	vertices[1] = corner_verts[1];
 	vertices[2] = corner_verts[2];
 	vertices[3] = corner_verts[2];
 	vertices[4] = corner_verts[3];
 	vertices[5] = corner_verts[0];
-
-	vkCmdBindVertexBuffers (cbx->cb, 0, 1, &buffer, &buffer_offset);
-	if (alpha_blend)
-		R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_blend_pipeline[cbx->render_pass_index]);
-	else
-		R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_alphatest_pipeline[cbx->render_pass_index]);
-	vkCmdBindDescriptorSets (
-		cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &gl.gltexture->descriptor_set, 0, NULL);
-	vkCmdDraw (cbx->cb, 6, 1, 0, 0);
 }
 
 /*
@@ -773,10 +838,6 @@ void Draw_TileClear (cb_context_t *cbx, int x, int y, int w, int h)
 	glpic_t gl;
 	memcpy (&gl, draw_backtile->data, sizeof (glpic_t));
 
-	VkBuffer	   buffer;
-	VkDeviceSize   buffer_offset;
-	basicvertex_t *vertices = (basicvertex_t *)R_VertexAllocate (6 * sizeof (basicvertex_t), &buffer, &buffer_offset);
-
 	basicvertex_t corner_verts[4];
 	memset (&corner_verts, 255, sizeof (corner_verts));
 
@@ -804,18 +865,13 @@ void Draw_TileClear (cb_context_t *cbx, int x, int y, int w, int h)
 	corner_verts[3].texcoord[0] = x / 64.0;
 	corner_verts[3].texcoord[1] = (y + h) / 64.0;
 
+	basicvertex_t *vertices = Draw_AllocateQuad (cbx, vulkan_globals.basic_blend_pipeline[cbx->render_pass_index], gl.gltexture);
 	vertices[0] = corner_verts[0];
 	vertices[1] = corner_verts[1];
 	vertices[2] = corner_verts[2];
 	vertices[3] = corner_verts[2];
 	vertices[4] = corner_verts[3];
 	vertices[5] = corner_verts[0];
-
-	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_blend_pipeline[cbx->render_pass_index]);
-	vkCmdBindDescriptorSets (
-		cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &gl.gltexture->descriptor_set, 0, NULL);
-	vkCmdBindVertexBuffers (cbx->cb, 0, 1, &buffer, &buffer_offset);
-	vkCmdDraw (cbx->cb, 6, 1, 0, 0);
 }
 
 /*
@@ -830,10 +886,6 @@ void Draw_Fill (cb_context_t *cbx, int x, int y, int w, int h, int c, float alph
 	int	  i;
 	byte *pal = (byte *)d_8to24table; // johnfitz -- use d_8to24table instead of host_basepal
 
-	VkBuffer	   buffer;
-	VkDeviceSize   buffer_offset;
-	basicvertex_t *vertices = (basicvertex_t *)R_VertexAllocate (6 * sizeof (basicvertex_t), &buffer, &buffer_offset);
-
 	basicvertex_t corner_verts[4];
 	memset (&corner_verts, 0, sizeof (corner_verts));
 
@@ -857,16 +909,13 @@ void Draw_Fill (cb_context_t *cbx, int x, int y, int w, int h, int c, float alph
 		corner_verts[i].color[3] = alpha * 255;
 	}
 
+	basicvertex_t *vertices = Draw_AllocateQuad (cbx, vulkan_globals.basic_notex_blend_pipeline[cbx->render_pass_index], NULL);
 	vertices[0] = corner_verts[0];
 	vertices[1] = corner_verts[1];
 	vertices[2] = corner_verts[2];
 	vertices[3] = corner_verts[2];
 	vertices[4] = corner_verts[3];
 	vertices[5] = corner_verts[0];
-
-	vkCmdBindVertexBuffers (cbx->cb, 0, 1, &buffer, &buffer_offset);
-	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_notex_blend_pipeline[cbx->render_pass_index]);
-	vkCmdDraw (cbx->cb, 6, 1, 0, 0);
 }
 
 /*
@@ -880,10 +929,6 @@ void Draw_FadeScreen (cb_context_t *cbx)
 
 	GL_SetCanvas (cbx, CANVAS_DEFAULT);
 
-	VkBuffer	   buffer;
-	VkDeviceSize   buffer_offset;
-	basicvertex_t *vertices = (basicvertex_t *)R_VertexAllocate (6 * sizeof (basicvertex_t), &buffer, &buffer_offset);
-
 	basicvertex_t corner_verts[4];
 	memset (&corner_verts, 0, sizeof (corner_verts));
 
@@ -902,16 +947,13 @@ void Draw_FadeScreen (cb_context_t *cbx)
 	for (i = 0; i < 4; ++i)
 		corner_verts[i].color[3] = 128;
 
+	basicvertex_t *vertices = Draw_AllocateQuad (cbx, vulkan_globals.basic_notex_blend_pipeline[cbx->render_pass_index], NULL);
 	vertices[0] = corner_verts[0];
 	vertices[1] = corner_verts[1];
 	vertices[2] = corner_verts[2];
 	vertices[3] = corner_verts[2];
 	vertices[4] = corner_verts[3];
 	vertices[5] = corner_verts[0];
-
-	vkCmdBindVertexBuffers (cbx->cb, 0, 1, &buffer, &buffer_offset);
-	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_notex_blend_pipeline[cbx->render_pass_index]);
-	vkCmdDraw (cbx->cb, 6, 1, 0, 0);
 }
 
 /*
@@ -978,6 +1020,7 @@ void GL_SetCanvas (cb_context_t *cbx, canvastype newcanvas)
 	float		   s, u, v;
 	int			   lines;
 
+	Draw_FlushBatch (cbx);
 	cbx->current_canvas = newcanvas;
 
 	switch (newcanvas)
@@ -148,6 +148,13 @@ static uint32_t AliasMeshHash (const void *const p)
 	return HashCombine (HashInt32 (&vertindex), HashCombine (HashFloat (&mesh->st[0]), HashFloat (&mesh->st[1])));
 }
 
+static inline qboolean AliasMeshEquals (const aliasmesh_t *a, const aliasmesh_t *b)
+{
+	return (a->vertindex == b->vertindex) && (a->st[0] == b->st[0]) && (a->st[1] == b->st[1]);
+}
+
+FLAT_MAP_DEFINE_KEY (AliasMesh, aliasmesh_t, AliasMeshHash, AliasMeshEquals)
+
 void GL_MakeAliasModelDisplayLists (qmodel_t *m, aliashdr_t *paliashdr)
 {
 	Con_DPrintf2 ("meshing %s...\n", m->name);
@@ -164,8 +171,8 @@ void GL_MakeAliasModelDisplayLists (qmodel_t *m, aliashdr_t *paliashdr)
 	// there will always be this number of indexes
 	TEMP_ALLOC_ZEROED (unsigned short, indexes, maxverts_vbo);
 
-	hash_map_t *vertex_to_index_map = HashMap_Create (aliasmesh_t, unsigned short, &AliasMeshHash, NULL);
-	HashMap_Reserve (vertex_to_index_map, maxverts_vbo);
+	flat_map_t *vertex_to_index_map = FlatMap_Create (aliasmesh_t, unsigned short, &AliasMeshHash, NULL);
+	FlatMap_Reserve (vertex_to_index_map, maxverts_vbo);
 
 	ZEROED_STRUCT (aliasmesh_t, mesh);
 	for (int i = 0; i < paliashdr->numtris; i++)
@@ -190,13 +197,13 @@ void GL_MakeAliasModelDisplayLists (qmodel_t *m, aliashdr_t *paliashdr)
 			// Check if this vert already exists
 			unsigned short	index;
 			unsigned short *found_index;
-			if ((found_index = HashMap_Lookup (unsigned short, vertex_to_index_map, &mesh)))
+			if ((found_index = FlatMap_LookupAliasMesh (vertex_to_index_map, &mesh)))
 				index = *found_index;
 			else
 			{
 				// doesn't exist; emit a new vert and index
 				index = paliashdr->numverts_vbo;
-				HashMap_Insert (vertex_to_index_map, &mesh, &index);
+				FlatMap_InsertAliasMesh (vertex_to_index_map, &mesh, &index);
 				desc[paliashdr->numverts_vbo].vertindex = vertindex;
 				desc[paliashdr->numverts_vbo].st[0] = s;
 				desc[paliashdr->numverts_vbo++].st[1] = t;
@@ -206,7 +213,7 @@ void GL_MakeAliasModelDisplayLists (qmodel_t *m, aliashdr_t *paliashdr)
 		}
 	}
 
-	HashMap_Destroy (vertex_to_index_map);
+	FlatMap_Destroy (vertex_to_index_map);
 
 	// upload immediately
 	paliashdr->poseverttype = PV_QUAKE1;
@@ -266,6 +273,474 @@ void GLMesh_DeleteMeshBuffers (aliashdr_t *hdr)
 		SAFE_FREE (hdr->texels[i]);
 }
 
+/*
+=================================================================
+
+MESH OPTIMIZATION
+
+Triangles are reordered for the post-transform vertex cache with Tom
+Forsyth's linear speed algorithm, then vertices are renumbered in the
+order the triangles first use them so fetches walk the vertex buffer
+forward. The result only depends on the unoptimized mesh, so it is kept
+in <gamedir>/meshcache and reused on the next load.
+
+=================================================================
+*/
+
+cvar_t r_meshcache = {"r_meshcache", "1", CVAR_ARCHIVE};
+
+#define MESHOPT_CACHE_SIZE	 32 // LRU cache simulated by the optimizer
+#define MESHOPT_FIFO_SIZE	 16 // FIFO cache the statistics are measured with
+#define MESHOPT_MAX_VALENCE	 32 // precomputed valence scores
+#define MESHCACHE_MAGIC		 (('C' << 24) | ('M' << 16) | ('K' << 8) | 'V')
+#define MESHCACHE_VERSION	 1
+
+typedef struct
+{
+	int		 magic;
+	int		 version;
+	unsigned checksum; // of the unoptimized indexes
+	int		 numindexes;
+	int		 numverts;
+} meshcacheheader_t;
+
+typedef struct
+{
+	int misses;
+	int numtris;
+	int numverts; // referenced by at least one triangle
+} meshcachestats_t;
+
+static float meshopt_cachescore[MESHOPT_CACHE_SIZE];
+static float meshopt_valencescore[MESHOPT_MAX_VALENCE];
+
+/*
+================
+GLMesh_VertexScore
+================
+*/
+static float GLMesh_VertexScore (int cachepos, int remaining)
+{
+	float score;
+
+	if (remaining == 0)
+		return -1.0f; // nothing left to draw with this vertex
+
+	score = (cachepos >= 0) ? meshopt_cachescore[cachepos] : 0.0f;
+	// boost vertices with few triangles left so they don't get stranded
+	score += (remaining < MESHOPT_MAX_VALENCE) ? meshopt_valencescore[remaining] : 2.0f / sqrtf ((float)remaining);
+	return score;
+}
+
+/*
+================
+GLMesh_OptimizeVertexCache
+
+Reorders the triangles of one surface in place
+================
+*/
+static void GLMesh_OptimizeVertexCache (unsigned short *indexes, int numindexes, int numverts)
+{
+	const int numtris = numindexes / 3;
+	int		  cache[MESHOPT_CACHE_SIZE + 3];
+	int		  newcache[MESHOPT_CACHE_SIZE + 3];
+	int		  cachecount = 0, numemitted = 0, scanpos = 0;
+	int		  besttri = -1;
+	float	  bestscore = -1.0f;
+	int		  i, j, k;
+
+	if (!meshopt_cachescore[0])
+	{
+		for (i = 0; i < MESHOPT_CACHE_SIZE; i++)
+			meshopt_cachescore[i] = (i < 3) ? 0.75f : powf (1.0f - (float)(i - 3) / (MESHOPT_CACHE_SIZE - 3), 1.5f);
+		for (i = 1; i < MESHOPT_MAX_VALENCE; i++)
+			meshopt_valencescore[i] = 2.0f / sqrtf ((float)i);
+	}
+
+	TEMP_ALLOC_ZEROED (int, remaining, numverts);
+	TEMP_ALLOC (int, adjacencyofs, numverts + 1);
+	TEMP_ALLOC (int, adjacency, numindexes);
+	TEMP_ALLOC (int, cachepos, numverts);
+	TEMP_ALLOC (float, vertscore, numverts);
+	TEMP_ALLOC (float, triscore, numtris);
+	TEMP_ALLOC_ZEROED (byte, emitted, numtris);
+	TEMP_ALLOC (unsigned short, out, numindexes);
+
+	// triangles using each vertex
+	for (i = 0; i < numtris * 3; i++)
+		remaining[indexes[i]]++;
+	adjacencyofs[0] = 0;
+	for (i = 0; i < numverts; i++)
+	{
+		adjacencyofs[i + 1] = adjacencyofs[i] + remaining[i];
+		cachepos[i] = adjacencyofs[i];
+	}
+	for (i = 0; i < numtris * 3; i++)
+		adjacency[cachepos[indexes[i]]++] = i / 3;
+
+	for (i = 0; i < numverts; i++)
+	{
+		cachepos[i] = -1;
+		vertscore[i] = GLMesh_VertexScore (-1, remaining[i]);
+	}
+	for (i = 0; i < numtris; i++)
+	{
+		triscore[i] = vertscore[indexes[i * 3]] + vertscore[indexes[i * 3 + 1]] + vertscore[indexes[i * 3 + 2]];
+		if (triscore[i] > bestscore)
+		{
+			bestscore = triscore[i];
+			besttri = i;
+		}
+	}
+
+	while (numemitted < numtris)
+	{
+		int newcount = 0, tricount;
+
+		if (besttri < 0)
+		{
+			// nothing in the cache has triangles left, continue with the next unused one
+			while (emitted[scanpos])
+				++scanpos;
+			besttri = scanpos;
+		}
+
+		emitted[besttri] = true;
+		for (k = 0; k < 3; k++)
+		{
+			const int v = indexes[besttri * 3 + k];
+			int		 *adj = &adjacency[adjacencyofs[v]];
+
+			out[numemitted * 3 + k] = v;
+			for (j = 0; adj[j] != besttri; j++)
+				;
+			adj[j] = adj[--remaining[v]];
+
+			for (j = 0; j < newcount && newcache[j] != v; j++)
+				;
+			if (j == newcount)
+				newcache[newcount++] = v;
+		}
+		++numemitted;
+
+		// the triangle's vertices move to the front of the cache
+		tricount = newcount;
+		for (i = 0; i < cachecount; i++)
+		{
+			const int v = cache[i];
+			for (j = 0; j < tricount && newcache[j] != v; j++)
+				;
+			if (j == tricount)
+				newcache[newcount++] = v;
+		}
+
+		// rescore everything that was in the cache, including what just fell out of it
+		for (i = 0; i < newcount; i++)
+		{
+			const int v = newcache[i];
+			cachepos[v] = (i < MESHOPT_CACHE_SIZE) ? i : -1;
+			vertscore[v] = GLMesh_VertexScore (cachepos[v], remaining[v]);
+		}
+
+		besttri = -1;
+		bestscore = -1.0f;
+		for (i = 0; i < newcount; i++)
+		{
+			const int v = newcache[i];
+			for (j = adjacencyofs[v]; j < adjacencyofs[v] + remaining[v]; j++)
+			{
+				const int t = adjacency[j];
+				triscore[t] = vertscore[indexes[t * 3]] + vertscore[indexes[t * 3 + 1]] + vertscore[indexes[t * 3 + 2]];
+				if (triscore[t] > bestscore)
+				{
+					bestscore = triscore[t];
+					besttri = t;
+				}
+			}
+		}
+
+		cachecount = q_min (newcount, MESHOPT_CACHE_SIZE);
+		memcpy (cache, newcache, cachecount * sizeof (int));
+	}
+
+	memcpy (indexes, out, numtris * 3 * sizeof (unsigned short));
+
+	TEMP_FREE (out);
+	TEMP_FREE (emitted);
+	TEMP_FREE (triscore);
+	TEMP_FREE (vertscore);
+	TEMP_FREE (cachepos);
+	TEMP_FREE (adjacency);
+	TEMP_FREE (adjacencyofs);
+	TEMP_FREE (remaining);
+}
+
+/*
+================
+GLMesh_OptimizeVertexFetch
+
+Renumbers the vertices of one surface in order of first use. remap gets
+the old index of every new vertex, unused vertices go to the end.
+================
+*/
+static void GLMesh_OptimizeVertexFetch (unsigned short *indexes, int numindexes, int numverts, unsigned short *remap)
+{
+	int next = 0, i;
+
+	TEMP_ALLOC (int, oldtonew, numverts);
+	for (i = 0; i < numverts; i++)
+		oldtonew[i] = -1;
+
+	for (i = 0; i < numindexes; i++)
+	{
+		const int v = indexes[i];
+		if (oldtonew[v] < 0)
+		{
+			oldtonew[v] = next;
+			remap[next++] = v;
+		}
+		indexes[i] = oldtonew[v];
+	}
+	for (i = 0; i < numverts; i++)
+		if (oldtonew[i] < 0)
+			remap[next++] = i;
+
+	TEMP_FREE (oldtonew);
+}
+
+/*
+================
+GLMesh_AnalyzeVertexCache
+
+Counts the vertex shader invocations of one surface with a FIFO cache
+================
+*/
+static void GLMesh_AnalyzeVertexCache (const unsigned short *indexes, int numindexes, int numverts, meshcachestats_t *stats)
+{
+	int timestamp = MESHOPT_FIFO_SIZE + 1, i;
+
+	TEMP_ALLOC_ZEROED (int, cachetime, numverts);
+	for (i = 0; i < numindexes; i++)
+	{
+		const int v = indexes[i];
+		if (!cachetime[v])
+			++stats->numverts;
+		if (timestamp - cachetime[v] > MESHOPT_FIFO_SIZE)
+		{
+			cachetime[v] = timestamp++;
+			++stats->misses;
+		}
+	}
+	stats->numtris += numindexes / 3;
+	TEMP_FREE (cachetime);
+}
+
+/*
+================
+GLMesh_IndexesInRange
+
+Indexes are local to their surface and the optimizer uses them as array offsets
+================
+*/
+static qboolean GLMesh_IndexesInRange (const aliashdr_t *mainhdr, const unsigned short *indexes)
+{
+	for (const aliashdr_t *hdr = mainhdr; hdr != NULL; hdr = hdr->nextsurface)
+	{
+		for (int i = 0; i < hdr->numindexes; i++)
+			if (indexes[i] >= hdr->numverts_vbo)
+				return false;
+		indexes += hdr->numindexes;
+	}
+	return true;
+}
+
+/*
+================
+GLMesh_MeshCachePath
+================
+*/
+static void GLMesh_MeshCachePath (const qmodel_t *m, char *path, size_t size)
+{
+	q_snprintf (path, size, "%s/meshcache/%s.vmc", com_gamedir, m->name);
+}
+
+/*
+================
+GLMesh_LoadMeshCache
+
+Only replaces indexes and remap if the cache matches the mesh
+================
+*/
+static qboolean GLMesh_LoadMeshCache (const qmodel_t *m, const aliashdr_t *mainhdr, unsigned checksum, unsigned short *indexes, unsigned short *remap)
+{
+	char			  path[MAX_OSPATH];
+	meshcacheheader_t header;
+	qboolean		  valid;
+	int				  handle, length, indexofs = 0, vertofs = 0, i;
+
+	GLMesh_MeshCachePath (m, path, sizeof (path));
+	length = Sys_FileOpenRead (path, &handle);
+	if (handle == -1)
+		return false;
+
+	valid = (length >= (int)sizeof (header)) && (Sys_FileRead (handle, &header, sizeof (header)) == sizeof (header));
+	valid = valid && header.magic == MESHCACHE_MAGIC && header.version == MESHCACHE_VERSION && header.checksum == checksum;
+	for (const aliashdr_t *hdr = mainhdr; valid && hdr != NULL; hdr = hdr->nextsurface)
+	{
+		indexofs += hdr->numindexes;
+		vertofs += hdr->numverts_vbo;
+	}
+	valid = valid && header.numindexes == indexofs && header.numverts == vertofs;
+	valid = valid && length == (int)(sizeof (header) + (header.numindexes + header.numverts) * sizeof (unsigned short));
+	if (!valid)
+	{
+		Sys_FileClose (handle);
+		return false;
+	}
+
+	TEMP_ALLOC (unsigned short, cachedindexes, header.numindexes);
+	TEMP_ALLOC (unsigned short, cachedremap, header.numverts);
+	valid = Sys_FileRead (handle, cachedindexes, header.numindexes * sizeof (unsigned short)) == (int)(header.numindexes * sizeof (unsigned short));
+	valid = valid && Sys_FileRead (handle, cachedremap, header.numverts * sizeof (unsigned short)) == (int)(header.numverts * sizeof (unsigned short));
+	Sys_FileClose (handle);
+
+	// don't trust the file with anything that could index out of bounds, and the remap has to be a permutation
+	valid = valid && GLMesh_IndexesInRange (mainhdr, cachedindexes);
+	TEMP_ALLOC_ZEROED (byte, used, header.numverts);
+	vertofs = 0;
+	for (const aliashdr_t *hdr = mainhdr; valid && hdr != NULL; hdr = hdr->nextsurface)
+	{
+		for (i = 0; valid && i < hdr->numverts_vbo; i++)
+		{
+			valid = cachedremap[vertofs + i] < hdr->numverts_vbo && !used[vertofs + cachedremap[vertofs + i]];
+			if (valid)
+				used[vertofs + cachedremap[vertofs + i]] = 1;
+		}
+		vertofs += hdr->numverts_vbo;
+	}
+	TEMP_FREE (used);
+
+	if (valid)
+	{
+		memcpy (indexes, cachedindexes, header.numindexes * sizeof (unsigned short));
+		memcpy (remap, cachedremap, header.numverts * sizeof (unsigned short));
+	}
+
+	TEMP_FREE (cachedremap);
+	TEMP_FREE (cachedindexes);
+	return valid;
+}
+
+/*
+================
+GLMesh_SaveMeshCache
+================
+*/
+static void GLMesh_SaveMeshCache (const qmodel_t *m, unsigned checksum, const unsigned short *indexes, int numindexes, const unsigned short *remap, int numverts)
+{
+	char			  path[MAX_OSPATH];
+	meshcacheheader_t header;
+	int				  handle;
+
+	GLMesh_MeshCachePath (m, path, sizeof (path));
+	COM_CreatePath (path);
+	handle = Sys_FileOpenWrite (path);
+	if (handle == -1)
+		return;
+
+	header.magic = MESHCACHE_MAGIC;
+	header.version = MESHCACHE_VERSION;
+	header.checksum = checksum;
+	header.numindexes = numindexes;
+	header.numverts = numverts;
+	Sys_FileWrite (handle, &header, sizeof (header));
+	Sys_FileWrite (handle, indexes, numindexes * sizeof (unsigned short));
+	Sys_FileWrite (handle, remap, numverts * sizeof (unsigned short));
+	Sys_FileClose (handle);
+}
+
+/*
+================
+GLMesh_PermuteVertices
+================
+*/
+static void GLMesh_PermuteVertices (byte *verts, size_t size, int numverts, const unsigned short *remap)
+{
+	TEMP_ALLOC (byte, copy, size * numverts);
+	memcpy (copy, verts, size * numverts);
+	for (int i = 0; i < numverts; i++)
+		memcpy (verts + i * size, copy + remap[i] * size, size);
+	TEMP_FREE (copy);
+}
+
+/*
+================
+GLMesh_OptimizeMesh
+
+Optimizes all surfaces of a model in place, before they are uploaded.
+Indexes are local to their surface. Quake meshes reorder desc, which
+references the pose vertices, md5 meshes reorder their vertexes.
+================
+*/
+static void GLMesh_OptimizeMesh (const qmodel_t *m, const aliashdr_t *mainhdr, unsigned short *indexes, byte *vertexes, aliasmesh_t *desc)
+{
+	meshcachestats_t before, after;
+	int				 numindexes = 0, numverts = 0, indexofs, vertofs;
+	unsigned		 checksum;
+	qboolean		 cached;
+
+	if (!GLMesh_IndexesInRange (mainhdr, indexes))
+	{
+		Con_Warning ("%s has out of range vertex indexes, not optimized\n", m->name);
+		return;
+	}
+
+	for (const aliashdr_t *hdr = mainhdr; hdr != NULL; hdr = hdr->nextsurface)
+	{
+		numindexes += hdr->numindexes;
+		numverts += hdr->numverts_vbo;
+	}
+	checksum = HashCombine (Com_BlockChecksum (indexes, numindexes * sizeof (unsigned short)), numverts);
+
+	memset (&before, 0, sizeof (before));
+	memset (&after, 0, sizeof (after));
+	indexofs = 0;
+	for (const aliashdr_t *hdr = mainhdr; hdr != NULL; hdr = hdr->nextsurface)
+	{
+		GLMesh_AnalyzeVertexCache (indexes + indexofs, hdr->numindexes, hdr->numverts_vbo, &before);
+		indexofs += hdr->numindexes;
+	}
+
+	TEMP_ALLOC (unsigned short, remap, numverts);
+	cached = r_meshcache.value && GLMesh_LoadMeshCache (m, mainhdr, checksum, indexes, remap);
+	indexofs = vertofs = 0;
+	for (const aliashdr_t *hdr = mainhdr; hdr != NULL; hdr = hdr->nextsurface)
+	{
+		if (!cached)
+		{
+			GLMesh_OptimizeVertexCache (indexes + indexofs, hdr->numindexes, hdr->numverts_vbo);
+			GLMesh_OptimizeVertexFetch (indexes + indexofs, hdr->numindexes, hdr->numverts_vbo, remap + vertofs);
+		}
+		GLMesh_AnalyzeVertexCache (indexes + indexofs, hdr->numindexes, hdr->numverts_vbo, &after);
+
+		if (hdr->poseverttype == PV_QUAKE1)
+			GLMesh_PermuteVertices ((byte *)(desc + vertofs), sizeof (aliasmesh_t), hdr->numverts_vbo, remap + vertofs);
+		else
+			GLMesh_PermuteVertices (vertexes + vertofs * sizeof (md5vert_t), sizeof (md5vert_t), hdr->numverts_vbo, remap + vertofs);
+
+		indexofs += hdr->numindexes;
+		vertofs += hdr->numverts_vbo;
+	}
+	if (!cached && r_meshcache.value)
+		GLMesh_SaveMeshCache (m, checksum, indexes, numindexes, remap, numverts);
+	TEMP_FREE (remap);
+
+	if (before.numtris && before.numverts)
+		Con_DPrintf (
+			"%s: ACMR %.3f -> %.3f, ATVR %.3f -> %.3f%s\n", m->name, (float)before.misses / before.numtris, (float)after.misses / after.numtris,
+			(float)before.misses / before.numverts, (float)after.misses / after.numverts, cached ? " (cached)" : "");
+}
+
 /*
 ================
 GLMesh_UploadBuffers
@@ -314,6 +789,8 @@ void GLMesh_UploadBuffers (qmodel_t *m, aliashdr_t *mainhdr, unsigned short *ind
 	if (!totalvbosize)
 		return;
 
+	GLMesh_OptimizeMesh (m, mainhdr, indexes, vertexes, desc);
+
 	{
 		const size_t totalindexsize = numindexes * sizeof (unsigned short);
 
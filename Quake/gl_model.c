@@ -32,12 +32,17 @@ static void		 Mod_LoadBrushModel (qmodel_t *mod, const char *loadname, void *buf
 static void		 Mod_LoadAliasModel (qmodel_t *mod, void *buffer);
 static void		 Mod_LoadMD5MeshModel (qmodel_t *mod, const void *buffer);
 static qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash);
+static byte		*Mod_LoadPreloadedFile (const char *path, unsigned int *path_id, qboolean is_map);
+static void		 Mod_PreloadMaps_f (cvar_t *var);
+static void		 Mod_PreloadStats_f (void);
 
 cvar_t external_ents = {"external_ents", "1", CVAR_ARCHIVE};
 cvar_t external_vis = {"external_vis", "1", CVAR_ARCHIVE};
 cvar_t r_loadmd5models = {"r_loadmd5models", "1", CVAR_ARCHIVE};
 cvar_t r_md5models = {"r_md5models", "1", CVAR_ARCHIVE};
 cvar_t keepbmodelcache = {"keepbmodelcache", "1", CVAR_NONE};
+cvar_t sv_preloadmaps = {"sv_preloadmaps", "0", CVAR_ARCHIVE};
+cvar_t sv_preloadmaps_budget = {"sv_preloadmaps_budget", "64", CVAR_ARCHIVE}; // in MB
 
 static byte *mod_novis;
 static int	 mod_novis_capacity;
@@ -118,6 +123,10 @@ void Mod_Init (void)
 	Cvar_RegisterVariable (&r_md5models);
 	Cvar_SetCallback (&r_md5models, Mod_RefreshSkins_f);
 	Cvar_RegisterVariable (&keepbmodelcache);
+	Cvar_RegisterVariable (&sv_preloadmaps);
+	Cvar_SetCallback (&sv_preloadmaps, Mod_PreloadMaps_f);
+	Cvar_RegisterVariable (&sv_preloadmaps_budget);
+	Cmd_AddCommand ("preloadstats", Mod_PreloadStats_f);
 
 	// johnfitz -- create notexture miptex
 	r_notexture_mip = (texture_t *)Mem_Alloc (sizeof (texture_t));
@@ -326,46 +335,44 @@ Mod_FreeModelMemory
 */
 static void Mod_FreeModelMemory (qmodel_t *mod)
 {
+	// brush model lumps live in the MEM_TAG_WORLD arena, which is reset by Mod_ClearAll/Mod_ResetAll
 	if (mod->name[0] != '*')
 	{
 		if ((mod->type == mod_sprite) && (mod->extradata[0]))
 			Mod_FreeSpriteMemory ((msprite_t *)mod->extradata[0]);
-		// Last two ones are dummy textures
-		for (int i = 0; i < mod->numtextures - 2; ++i)
-			SAFE_FREE (mod->textures[i]);
 		for (int i = 0; i < mod->numsurfaces; ++i)
 			SAFE_FREE (mod->surfaces[i].polys);
-		SAFE_FREE (mod->hulls[0].clipnodes);
-		SAFE_FREE (mod->submodels);
+		mod->hulls[0].clipnodes = NULL;
+		mod->submodels = NULL;
 		mod->numsubmodels = 0;
-		SAFE_FREE (mod->planes);
+		mod->planes = NULL;
 		mod->numplanes = 0;
-		SAFE_FREE (mod->leafs);
+		mod->leafs = NULL;
 		mod->numleafs = 0;
-		SAFE_FREE (mod->vertexes);
+		mod->vertexes = NULL;
 		mod->numvertexes = 0;
-		SAFE_FREE (mod->edges);
+		mod->edges = NULL;
 		mod->numedges = 0;
-		SAFE_FREE (mod->nodes);
+		mod->nodes = NULL;
 		mod->numnodes = 0;
-		SAFE_FREE (mod->texinfo);
+		mod->texinfo = NULL;
 		mod->numtexinfo = 0;
-		SAFE_FREE (mod->surfaces);
+		mod->surfaces = NULL;
 		mod->numsurfaces = 0;
-		SAFE_FREE (mod->surfedges);
+		mod->surfedges = NULL;
 		mod->numsurfedges = 0;
-		SAFE_FREE (mod->clipnodes);
+		mod->clipnodes = NULL;
 		mod->numclipnodes = 0;
-		SAFE_FREE (mod->marksurfaces);
+		mod->marksurfaces = NULL;
 		mod->nummarksurfaces = 0;
 		SAFE_FREE (mod->soa_leafbounds);
 		SAFE_FREE (mod->surfvis);
 		SAFE_FREE (mod->soa_surfplanes);
-		SAFE_FREE (mod->textures);
+		mod->textures = NULL;
 		mod->numtextures = 0;
-		SAFE_FREE (mod->visdata);
-		SAFE_FREE (mod->lightdata);
-		SAFE_FREE (mod->entities);
+		mod->visdata = NULL;
+		mod->lightdata = NULL;
+		mod->entities = NULL;
 		for (int i = 0; i < 2; ++i)
 			SAFE_FREE (mod->extradata[i]);
 		SAFE_FREE (mod->water_surfs);
@@ -373,7 +380,7 @@ static void Mod_FreeModelMemory (qmodel_t *mod)
 		mod->water_surfs_specials = 0;
 	}
 	else
-		SAFE_FREE (mod->textures);
+		mod->textures = NULL;
 
 	if (!isDedicated)
 		TexMgr_FreeTexturesForOwner (mod);
@@ -503,6 +510,7 @@ void Mod_ClearAll (void)
 			Mod_FreeModelMemory (mod); // johnfitz
 		}
 	}
+	Mem_ArenaReset (MEM_TAG_WORLD);
 
 	InvalidateTraceLineCache ();
 }
@@ -517,6 +525,9 @@ void Mod_ResetAll (void)
 	int		  i;
 	qmodel_t *mod;
 
+	// preloaded files were resolved against the old search paths
+	Mod_PreloadCancel ();
+
 	// ericw -- free alias model VBOs
 	GLMesh_DeleteAllMeshBuffers ();
 	GL_DeleteBModelAccelerationStructures ();
@@ -529,6 +540,7 @@ void Mod_ResetAll (void)
 		memset (mod, 0, sizeof (qmodel_t));
 	}
 	mod_numknown = 0;
+	Mem_ArenaReset (MEM_TAG_WORLD);
 
 	memset (mod_loaded_map, 0, sizeof (mod_loaded_map));
 
@@ -622,7 +634,7 @@ static qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 	}
 
 	unsigned int md5_path_id = mod->path_id;
-	buf = COM_LoadFile (mod->name, &mod->path_id);
+	buf = Mod_LoadPreloadedFile (mod->name, &mod->path_id, !strcmp (mod->name, mod_loaded_map));
 	if (!buf)
 	{
 		if (crash)
@@ -680,6 +692,313 @@ qmodel_t *Mod_ForName (const char *name, qboolean crash)
 	return Mod_LoadModel (mod, crash);
 }
 
+/*
+===============================================================================
+
+					NEXT MAP PRELOADING
+
+===============================================================================
+*/
+
+#define MAX_PRELOAD_FILES  16
+#define PRELOAD_CHUNK_SIZE (1024 * 1024)
+
+typedef enum
+{
+	PRELOAD_PENDING,
+	PRELOAD_READY,
+	PRELOAD_FAILED,
+} preload_status_t;
+
+typedef struct
+{
+	char			name[MAX_QPATH];
+	FILE		   *file;
+	int				size;
+	unsigned int	path_id;
+	byte		   *data;
+	task_handle_t	task;
+	atomic_uint32_t cancel;
+	atomic_uint32_t status;
+} preload_file_t;
+
+static preload_file_t preload_files[MAX_PRELOAD_FILES];
+static int			  preload_numfiles;
+static size_t		  preload_bytes;
+
+static struct
+{
+	int	   hits;
+	int	   misses;
+	int	   stale;
+	int	   unused;
+	int	   over_budget;
+	size_t bytes_preloaded;
+	size_t bytes_used;
+} preload_stats;
+
+/*
+=================
+Mod_PreloadCheckHeader
+
+Rejects truncated or foreign files before anybody waits for them
+=================
+*/
+static qboolean Mod_PreloadCheckHeader (const preload_file_t *pf)
+{
+	if (!strcmp (COM_FileGetExtension (pf->name), "lit"))
+		return pf->size >= 8 && !memcmp (pf->data, "QLIT", 4);
+
+	if (pf->size < (int)sizeof (dheader_t))
+		return false;
+
+	const dheader_t *header = (const dheader_t *)pf->data;
+	const int		 version = LittleLong (header->version);
+	if (version != BSPVERSION && version != BSP2VERSION_2PSB && version != BSP2VERSION_BSP2 && version != BSPVERSION_QUAKE64)
+		return false;
+
+	for (int i = 0; i < HEADER_LUMPS; ++i)
+	{
+		const int fileofs = LittleLong (header->lumps[i].fileofs);
+		const int filelen = LittleLong (header->lumps[i].filelen);
+		if (fileofs < 0 || filelen < 0 || fileofs > pf->size - filelen)
+			return false;
+	}
+	return true;
+}
+
+/*
+=================
+Mod_PreloadTask
+=================
+*/
+static void Mod_PreloadTask (void *payload)
+{
+	preload_file_t *pf = *(preload_file_t **)payload;
+	int				ofs = 0;
+
+	// read in chunks so a cancel doesn't have to wait for the whole file
+	while (ofs < pf->size && !Atomic_LoadUInt32 (&pf->cancel))
+	{
+		const int chunk = q_min (pf->size - ofs, PRELOAD_CHUNK_SIZE);
+		if (fread (pf->data + ofs, 1, chunk, pf->file) != (size_t)chunk)
+			break;
+		ofs += chunk;
+	}
+	fclose (pf->file);
+	pf->file = NULL;
+
+	Atomic_StoreUInt32 (&pf->status, ((ofs == pf->size) && Mod_PreloadCheckHeader (pf)) ? PRELOAD_READY : PRELOAD_FAILED);
+}
+
+/*
+=================
+Mod_PreloadCancel
+
+Stops all preloads in flight and drops everything that wasn't used
+=================
+*/
+void Mod_PreloadCancel (void)
+{
+	for (int i = 0; i < preload_numfiles; ++i)
+		Atomic_StoreUInt32 (&preload_files[i].cancel, true);
+
+	for (int i = 0; i < preload_numfiles; ++i)
+	{
+		preload_file_t *pf = &preload_files[i];
+		Task_Join (pf->task, SDL_MUTEX_MAXWAIT);
+		if (pf->data)
+		{
+			++preload_stats.unused;
+			SAFE_FREE (pf->data);
+		}
+	}
+
+	preload_numfiles = 0;
+	preload_bytes = 0;
+}
+
+/*
+=================
+Mod_PreloadFile
+
+The file is located on the calling thread, only the read happens on a worker
+=================
+*/
+static qboolean Mod_PreloadFile (const char *name)
+{
+	FILE		*f;
+	unsigned int path_id;
+	int			 size;
+
+	for (int i = 0; i < preload_numfiles; ++i)
+		if (!strcmp (preload_files[i].name, name))
+			return true;
+
+	if (preload_numfiles == MAX_PRELOAD_FILES)
+		return false;
+
+	size = COM_FOpenFile (name, &f, &path_id);
+	if (!f)
+		return false;
+
+	if (size <= 0 || preload_bytes + size > (size_t)(q_max (sv_preloadmaps_budget.value, 0.0f) * 1024.0f * 1024.0f))
+	{
+		if (size > 0)
+			++preload_stats.over_budget;
+		fclose (f);
+		return false;
+	}
+
+	preload_file_t *pf = &preload_files[preload_numfiles++];
+	memset (pf, 0, sizeof (*pf));
+	q_strlcpy (pf->name, name, sizeof (pf->name));
+	pf->file = f;
+	pf->size = size;
+	pf->path_id = path_id;
+	pf->data = (byte *)Mem_AllocNonZero (size + 1);
+	pf->data[size] = 0;
+	Atomic_StoreUInt32 (&pf->status, PRELOAD_PENDING);
+	preload_bytes += size;
+	preload_stats.bytes_preloaded += size;
+
+	pf->task = Task_AllocateAssignFuncAndSubmit (Mod_PreloadTask, &pf, sizeof (pf));
+	return true;
+}
+
+/*
+=================
+Mod_PreloadMaps
+
+Starts reading the maps the trigger_changelevels of the current map lead to
+=================
+*/
+void Mod_PreloadMaps (const char *entities, const char *current_map)
+{
+	char		classname[64], key[64], map[MAX_QPATH];
+	const char *data = entities;
+
+	Mod_PreloadCancel ();
+
+	if (!sv_preloadmaps.value || !data)
+		return;
+
+	while ((data = COM_Parse (data)) && com_token[0] == '{')
+	{
+		classname[0] = map[0] = 0;
+		while (1)
+		{
+			data = COM_Parse (data);
+			if (!data)
+				return; // error
+			if (com_token[0] == '}')
+				break;
+			q_strlcpy (key, com_token, sizeof (key));
+			data = COM_Parse (data);
+			if (!data)
+				return; // error
+			if (!strcmp (key, "classname"))
+				q_strlcpy (classname, com_token, sizeof (classname));
+			else if (!strcmp (key, "map"))
+				q_strlcpy (map, com_token, sizeof (map));
+		}
+
+		if (!map[0] || strcmp (classname, "trigger_changelevel") || !strcmp (map, current_map))
+			continue;
+
+		if (Mod_PreloadFile (va ("maps/%s.bsp", map)) && !isDedicated)
+			Mod_PreloadFile (va ("maps/%s.lit", map));
+	}
+
+	if (preload_numfiles)
+		Con_DPrintf ("Preloading %d files (%d KB)\n", preload_numfiles, (int)(preload_bytes / 1024));
+}
+
+/*
+=================
+Mod_LoadPreloadedFile
+
+COM_LoadFile, but hands out the preloaded copy if the file hasn't changed
+=================
+*/
+static byte *Mod_LoadPreloadedFile (const char *path, unsigned int *path_id, qboolean is_map)
+{
+	for (int i = 0; i < preload_numfiles; ++i)
+	{
+		preload_file_t *pf = &preload_files[i];
+		if (!pf->data || strcmp (pf->name, path))
+			continue;
+
+		Task_Join (pf->task, SDL_MUTEX_MAXWAIT);
+		byte *data = pf->data;
+		pf->data = NULL;
+		preload_bytes -= pf->size;
+
+		// make sure the search paths still resolve to the same file with the same size.
+		// COM_FileExists doesn't report the size of loose files, so open it to get the real one
+		unsigned int current_path_id = 0;
+		int			 current_size = -1;
+		if (Atomic_LoadUInt32 (&pf->status) == PRELOAD_READY)
+		{
+			FILE *f;
+			current_size = COM_FOpenFile (path, &f, &current_path_id);
+			if (f)
+				fclose (f);
+			else
+				current_size = -1;
+		}
+		if ((current_size == pf->size) && (current_path_id == pf->path_id))
+		{
+			++preload_stats.hits;
+			preload_stats.bytes_used += pf->size;
+			if (path_id)
+				*path_id = pf->path_id;
+			return data;
+		}
+
+		++preload_stats.stale;
+		Mem_Free (data);
+		break;
+	}
+
+	if (is_map && sv_preloadmaps.value)
+		++preload_stats.misses;
+	return COM_LoadFile (path, path_id);
+}
+
+/*
+=================
+Mod_PreloadMaps_f
+=================
+*/
+static void Mod_PreloadMaps_f (cvar_t *var)
+{
+	if (!var->value)
+		Mod_PreloadCancel ();
+}
+
+/*
+=================
+Mod_PreloadStats_f
+=================
+*/
+static void Mod_PreloadStats_f (void)
+{
+	static const char *status_names[] = {"loading", "ready", "failed"};
+
+	Con_Printf ("next map preloading is %s\n", sv_preloadmaps.value ? "on" : "off");
+	for (int i = 0; i < preload_numfiles; ++i)
+	{
+		preload_file_t *pf = &preload_files[i];
+		Con_Printf ("  %-32s %7d KB %s\n", pf->name, pf->size / 1024, pf->data ? status_names[Atomic_LoadUInt32 (&pf->status)] : "used");
+	}
+	Con_Printf ("%d KB of %.0f MB budget resident\n", (int)(preload_bytes / 1024), q_max (sv_preloadmaps_budget.value, 0.0f));
+	Con_Printf (
+		"%d hits, %d misses, %d stale, %d unused, %d over budget\n", preload_stats.hits, preload_stats.misses, preload_stats.stale, preload_stats.unused,
+		preload_stats.over_budget);
+	Con_Printf ("%d KB preloaded, %d KB used\n", (int)(preload_stats.bytes_preloaded / 1024), (int)(preload_stats.bytes_used / 1024));
+}
+
 /*
 ===============================================================================
 
@@ -874,7 +1193,7 @@ static void Mod_LoadTextures (qmodel_t *mod, byte *mod_base, lump_t *l)
 	// johnfitz
 
 	mod->numtextures = nummiptex + 2; // johnfitz -- need 2 dummy texture chains for missing textures
-	mod->textures = (texture_t **)Mem_Alloc (mod->numtextures * sizeof (*mod->textures));
+	mod->textures = (texture_t **)Mem_ArenaAlloc (MEM_TAG_WORLD, mod->numtextures * sizeof (*mod->textures));
 
 	for (i = 0; i < nummiptex; i++)
 	{
@@ -894,7 +1213,7 @@ static void Mod_LoadTextures (qmodel_t *mod, byte *mod_base, lump_t *l)
 		}
 
 		pixels = mt.width * mt.height / 64 * 85;
-		tx = (texture_t *)Mem_Alloc (sizeof (texture_t) + pixels);
+		tx = (texture_t *)Mem_ArenaAlloc (MEM_TAG_WORLD, sizeof (texture_t) + pixels);
 		mod->textures[i] = tx;
 
 		memcpy (tx->name, mt.name, sizeof (tx->name));
@@ -1061,11 +1380,14 @@ static void Mod_LoadLighting (qmodel_t *mod, byte *mod_base, lump_t *l)
 	unsigned int path_id;
 
 	mod->lightdata = NULL;
+	if (isDedicated)
+		return; // lighting is only ever sampled by the renderer
+
 	// LordHavoc: check for a .lit file
 	q_strlcpy (litfilename, mod->name, sizeof (litfilename));
 	COM_StripExtension (litfilename, litfilename, sizeof (litfilename));
 	q_strlcat (litfilename, ".lit", sizeof (litfilename));
-	data = (byte *)COM_LoadFile (litfilename, &path_id);
+	data = Mod_LoadPreloadedFile (litfilename, &path_id, false);
 	if (data)
 	{
 		// use lit file only from the same gamedir as the map
@@ -1082,7 +1404,7 @@ static void Mod_LoadLighting (qmodel_t *mod, byte *mod_base, lump_t *l)
 				if (8 + l->filelen * 3 == com_filesize)
 				{
 					Con_DPrintf2 ("%s loaded\n", litfilename);
-					mod->lightdata = (byte *)Mem_AllocNonZero (l->filelen * 3);
+					mod->lightdata = (byte *)Mem_ArenaAllocNonZero (MEM_TAG_WORLD, l->filelen * 3);
 					memcpy (mod->lightdata, data + 8, l->filelen * 3);
 					Mem_Free (data);
 					return;
@@ -1111,7 +1433,7 @@ static void Mod_LoadLighting (qmodel_t *mod, byte *mod_base, lump_t *l)
 		// RGB lightmap samples are packed in 16bits.
 		// RRRRR GGGGG BBBBBB
 
-		mod->lightdata = (byte *)Mem_Alloc ((l->filelen / 2) * 3);
+		mod->lightdata = (byte *)Mem_ArenaAlloc (MEM_TAG_WORLD, (l->filelen / 2) * 3);
 		in = mod_base + l->fileofs;
 		out = mod->lightdata;
 
@@ -1127,7 +1449,7 @@ static void Mod_LoadLighting (qmodel_t *mod, byte *mod_base, lump_t *l)
 		return;
 	}
 
-	mod->lightdata = (byte *)Mem_Alloc (l->filelen * 3);
+	mod->lightdata = (byte *)Mem_ArenaAlloc (MEM_TAG_WORLD, l->filelen * 3);
 	in = mod->lightdata + l->filelen * 2; // place the file at the end, so it will not be overwritten until the very last write
 	out = mod->lightdata;
 	memcpy (in, mod_base + l->fileofs, l->filelen);
@@ -1153,7 +1475,7 @@ static void Mod_LoadVisibility (qmodel_t *mod, byte *mod_base, lump_t *l)
 		mod->visdata = NULL;
 		return;
 	}
-	mod->visdata = (byte *)Mem_Alloc (l->filelen);
+	mod->visdata = (byte *)Mem_ArenaAlloc (MEM_TAG_WORLD, l->filelen);
 	memcpy (mod->visdata, mod_base + l->fileofs, l->filelen);
 }
 
@@ -1205,7 +1527,8 @@ static void Mod_LoadEntities (qmodel_t *mod, byte *mod_base, lump_t *l)
 		}
 		else
 		{
-			mod->entities = ents;
+			mod->entities = Mem_ArenaStrdup (MEM_TAG_WORLD, ents);
+			Mem_Free (ents);
 			Con_DPrintf ("Loaded external entity file %s\n", entfilename);
 			return;
 		}
@@ -1214,11 +1537,11 @@ static void Mod_LoadEntities (qmodel_t *mod, byte *mod_base, lump_t *l)
 _load_embedded:
 	if (!l->filelen)
 	{
-		Mem_Free (mod->entities);
 		mod->entities = NULL;
+		Mem_Free (ents);
 		return;
 	}
-	mod->entities = (char *)Mem_Alloc (l->filelen);
+	mod->entities = (char *)Mem_ArenaAlloc (MEM_TAG_WORLD, l->filelen);
 	memcpy (mod->entities, mod_base + l->fileofs, l->filelen);
 	Mem_Free (ents);
 }
@@ -1238,7 +1561,7 @@ static void Mod_LoadVertexes (qmodel_t *mod, byte *mod_base, lump_t *l)
 	if (l->filelen % sizeof (dvertex_t))
 		Sys_Error ("MOD_LoadBmodel: funny lump size in %s", mod->name);
 	count = l->filelen / sizeof (dvertex_t);
-	out = (mvertex_t *)Mem_Alloc (count * sizeof (*out));
+	out = (mvertex_t *)Mem_ArenaAlloc (MEM_TAG_WORLD, count * sizeof (*out));
 
 	mod->vertexes = out;
 	mod->numvertexes = count;
@@ -1269,7 +1592,7 @@ static void Mod_LoadEdges (qmodel_t *mod, byte *mod_base, lump_t *l, int bsp2)
 			Sys_Error ("MOD_LoadBmodel: funny lump size in %s", mod->name);
 
 		count = l->filelen / sizeof (dledge_t);
-		out = (medge_t *)Mem_Alloc ((count + 1) * sizeof (*out));
+		out = (medge_t *)Mem_ArenaAlloc (MEM_TAG_WORLD, (count + 1) * sizeof (*out));
 
 		mod->edges = out;
 		mod->numedges = count;
@@ -1288,7 +1611,7 @@ static void Mod_LoadEdges (qmodel_t *mod, byte *mod_base, lump_t *l, int bsp2)
 			Sys_Error ("MOD_LoadBmodel: funny lump size in %s", mod->name);
 
 		count = l->filelen / sizeof (dsedge_t);
-		out = (medge_t *)Mem_Alloc ((count + 1) * sizeof (*out));
+		out = (medge_t *)Mem_ArenaAlloc (MEM_TAG_WORLD, (count + 1) * sizeof (*out));
 
 		mod->edges = out;
 		mod->numedges = count;
@@ -1317,7 +1640,7 @@ static void Mod_LoadTexinfo (qmodel_t *mod, byte *mod_base, lump_t *l)
 	if (l->filelen % sizeof (texinfo_t))
 		Sys_Error ("MOD_LoadBmodel: funny lump size in %s", mod->name);
 	count = l->filelen / sizeof (texinfo_t);
-	out = (mtexinfo_t *)Mem_Alloc (count * sizeof (*out));
+	out = (mtexinfo_t *)Mem_ArenaAlloc (MEM_TAG_WORLD, count * sizeof (*out));
 
 	mod->texinfo = out;
 	mod->numtexinfo = count;
@@ -1518,7 +1841,7 @@ static void Mod_LoadFaces (qmodel_t *mod, byte *mod_base, lump_t *l, qboolean bs
 			Sys_Error ("MOD_LoadBmodel: funny lump size in %s", mod->name);
 		count = l->filelen / sizeof (dsface_t);
 	}
-	out = (msurface_t *)Mem_AllocNonZero (count * sizeof (*out));
+	out = (msurface_t *)Mem_ArenaAllocNonZero (MEM_TAG_WORLD, count * sizeof (*out));
 
 	// johnfitz -- warn mappers about exceeding old limits
 	if (count > 32767 && !bsp2)
@@ -1680,7 +2003,7 @@ static void Mod_LoadNodes_S (qmodel_t *mod, byte *mod_base, lump_t *l)
 	if (l->filelen % sizeof (dsnode_t))
 		Sys_Error ("MOD_LoadBmodel: funny lump size in %s", mod->name);
 	count = l->filelen / sizeof (dsnode_t);
-	out = (mnode_t *)Mem_Alloc (count * sizeof (*out));
+	out = (mnode_t *)Mem_ArenaAlloc (MEM_TAG_WORLD, count * sizeof (*out));
 
 	// johnfitz -- warn mappers about exceeding old limits
 	if (count > 32767)
@@ -1737,7 +2060,7 @@ static void Mod_LoadNodes_L1 (qmodel_t *mod, byte *mod_base, lump_t *l)
 		Sys_Error ("Mod_LoadNodes: funny lump size in %s", mod->name);
 
 	count = l->filelen / sizeof (dl1node_t);
-	out = (mnode_t *)Mem_Alloc (count * sizeof (*out));
+	out = (mnode_t *)Mem_ArenaAlloc (MEM_TAG_WORLD, count * sizeof (*out));
 
 	mod->nodes = out;
 	mod->numnodes = count;
@@ -1789,7 +2112,7 @@ static void Mod_LoadNodes_L2 (qmodel_t *mod, byte *mod_base, lump_t *l)
 		Sys_Error ("Mod_LoadNodes: funny lump size in %s", mod->name);
 
 	count = l->filelen / sizeof (dl2node_t);
-	out = (mnode_t *)Mem_Alloc (count * sizeof (*out));
+	out = (mnode_t *)Mem_ArenaAlloc (MEM_TAG_WORLD, count * sizeof (*out));
 
 	mod->nodes = out;
 	mod->numnodes = count;
@@ -1848,7 +2171,7 @@ static void Mod_ProcessLeafs_S (qmodel_t *mod, byte *in, int filelen)
 	if (filelen % sizeof (dsleaf_t))
 		Sys_Error ("Mod_ProcessLeafs: funny lump size in %s", mod->name);
 	count = filelen / sizeof (dsleaf_t);
-	out = (mleaf_t *)Mem_Alloc (count * sizeof (*out));
+	out = (mleaf_t *)Mem_ArenaAlloc (MEM_TAG_WORLD, count * sizeof (*out));
 
 	// johnfitz
 	if (count > 32767)
@@ -1897,7 +2220,7 @@ static void Mod_ProcessLeafs_L1 (qmodel_t *mod, byte *in, int filelen)
 
 	count = filelen / sizeof (dl1leaf_t);
 
-	out = (mleaf_t *)Mem_Alloc (count * sizeof (*out));
+	out = (mleaf_t *)Mem_ArenaAlloc (MEM_TAG_WORLD, count * sizeof (*out));
 
 	mod->leafs = out;
 	mod->numleafs = count;
@@ -1940,7 +2263,7 @@ static void Mod_ProcessLeafs_L2 (qmodel_t *mod, byte *in, int filelen)
 
 	count = filelen / sizeof (dl2leaf_t);
 
-	out = (mleaf_t *)Mem_Alloc (count * sizeof (*out));
+	out = (mleaf_t *)Mem_ArenaAlloc (MEM_TAG_WORLD, count * sizeof (*out));
 
 	mod->leafs = out;
 	mod->numleafs = count;
@@ -2128,7 +2451,7 @@ static void Mod_LoadClipnodes (qmodel_t *mod, byte *mod_base, lump_t *l, qboolea
 
 		count = l->filelen / sizeof (dsclipnode_t);
 	}
-	out = (mclipnode_t *)Mem_Alloc (count * sizeof (*out));
+	out = (mclipnode_t *)Mem_ArenaAlloc (MEM_TAG_WORLD, count * sizeof (*out));
 
 	// johnfitz -- warn about exceeding old limits
 	if (count > 32767 && !bsp2)
@@ -2220,7 +2543,7 @@ static void Mod_MakeHull0 (qmodel_t *mod)
 
 	in = mod->nodes;
 	count = mod->numnodes;
-	out = (mclipnode_t *)Mem_Alloc (count * sizeof (*out));
+	out = (mclipnode_t *)Mem_ArenaAlloc (MEM_TAG_WORLD, count * sizeof (*out));
 
 	hull->clipnodes = out;
 	hull->firstclipnode = 0;
@@ -2258,7 +2581,7 @@ static void Mod_LoadMarksurfaces (qmodel_t *mod, byte *mod_base, lump_t *l, int
 			Host_Error ("Mod_LoadMarksurfaces: funny lump size in %s", mod->name);
 
 		count = l->filelen / sizeof (unsigned int);
-		out = (int *)Mem_Alloc (count * sizeof (*out));
+		out = (int *)Mem_ArenaAlloc (MEM_TAG_WORLD, count * sizeof (*out));
 
 		mod->marksurfaces = out;
 		mod->nummarksurfaces = count;
@@ -2279,7 +2602,7 @@ static void Mod_LoadMarksurfaces (qmodel_t *mod, byte *mod_base, lump_t *l, int
 			Host_Error ("Mod_LoadMarksurfaces: funny lump size in %s", mod->name);
 
 		count = l->filelen / sizeof (short);
-		out = (int *)Mem_Alloc (count * sizeof (*out));
+		out = (int *)Mem_ArenaAlloc (MEM_TAG_WORLD, count * sizeof (*out));
 
 		mod->marksurfaces = out;
 		mod->nummarksurfaces = count;
@@ -2314,7 +2637,7 @@ static void Mod_LoadSurfedges (qmodel_t *mod, byte *mod_base, lump_t *l)
 	if (l->filelen % sizeof (int))
 		Sys_Error ("MOD_LoadBmodel: funny lump size in %s", mod->name);
 	count = l->filelen / sizeof (int);
-	out = (int *)Mem_Alloc (count * sizeof (int));
+	out = (int *)Mem_ArenaAlloc (MEM_TAG_WORLD, count * sizeof (int));
 
 	mod->surfedges = out;
 	mod->numsurfedges = count;
@@ -2342,7 +2665,7 @@ static void Mod_LoadPlanes (qmodel_t *mod, byte *mod_base, lump_t *l)
 	if (l->filelen % sizeof (dplane_t))
 		Sys_Error ("MOD_LoadBmodel: funny lump size in %s", mod->name);
 	count = l->filelen / sizeof (dplane_t);
-	out = (mplane_t *)Mem_Alloc (count * 2 * sizeof (*out));
+	out = (mplane_t *)Mem_ArenaAlloc (MEM_TAG_WORLD, count * 2 * sizeof (*out));
 
 	mod->planes = out;
 	mod->numplanes = count;
@@ -2396,7 +2719,7 @@ static void Mod_LoadSubmodels (qmodel_t *mod, byte *mod_base, lump_t *l)
 	if (l->filelen % sizeof (dmodel_t))
 		Sys_Error ("MOD_LoadBmodel: funny lump size in %s", mod->name);
 	count = l->filelen / sizeof (dmodel_t);
-	out = (dmodel_t *)Mem_Alloc (count * sizeof (*out));
+	out = (dmodel_t *)Mem_ArenaAlloc (MEM_TAG_WORLD, count * sizeof (*out));
 
 	mod->submodels = out;
 	mod->numsubmodels = count;
@@ -2557,7 +2880,7 @@ static byte *Mod_LoadVisibilityExternal (FILE *f)
 	if (filelen <= 0)
 		return NULL;
 	Con_DPrintf ("...%d bytes visibility data\n", filelen);
-	visdata = (byte *)Mem_Alloc (filelen);
+	visdata = (byte *)Mem_ArenaAlloc (MEM_TAG_WORLD, filelen);
 	if (fread (visdata, filelen, 1, f) != 1)
 		return NULL;
 	return visdata;
@@ -2576,9 +2899,9 @@ static void Mod_LoadLeafsExternal (qmodel_t *mod, FILE *f)
 		return;
 	Con_DPrintf ("...%d bytes leaf data\n", filelen);
 	in = Mem_Alloc (filelen);
-	if (fread (in, filelen, 1, f) != 1)
-		return;
-	Mod_ProcessLeafs_S (mod, (byte *)in, filelen);
+	if (fread (in, filelen, 1, f) == 1)
+		Mod_ProcessLeafs_S (mod, (byte *)in, filelen);
+	Mem_Free (in);
 }
 
 /*
@@ -2609,7 +2932,7 @@ static void Mod_CalcSpecialsAndTextures (qmodel_t *model)
 			++total;
 
 	texture_t **orig_textures = model->textures;
-	model->textures = (texture_t **)Mem_AllocNonZero (total * sizeof (*model->textures));
+	model->textures = (texture_t **)Mem_ArenaAllocNonZero (MEM_TAG_WORLD, total * sizeof (*model->textures));
 	model->numtextures = total;
 
 	for (int i = 0; placed < total; i++)
@@ -3919,8 +4242,8 @@ MD5_ComputeNormals
 */
 static void MD5_ComputeNormals (md5vert_t *vert, size_t numverts, unsigned short *indexes, size_t numindexes)
 {
-	hash_map_t *pos_to_normal_map = HashMap_Create (vec3_t, vec3_t, &HashVec3, NULL);
-	HashMap_Reserve (pos_to_normal_map, numverts);
+	flat_map_t *pos_to_normal_map = FlatMap_Create (vec3_t, vec3_t, &HashVec3, NULL);
+	FlatMap_Reserve (pos_to_normal_map, numverts);
 
 	for (size_t v = 0; v < numverts; v++)
 		vert[v].norm[0] = vert[v].norm[1] = vert[v].norm[2] = 0;
@@ -3944,28 +4267,28 @@ static void MD5_ComputeNormals (md5vert_t *vert, size_t numverts, unsigned short
 		vec3_t *found_normal;
 		for (int i = 0; i < 3; ++i)
 		{
-			if ((found_normal = HashMap_Lookup (vec3_t, pos_to_normal_map, &verts[i]->xyz)))
+			if ((found_normal = FlatMap_LookupVec3 (pos_to_normal_map, &verts[i]->xyz)))
 				VectorAdd (norm, *found_normal, *found_normal);
 			else
-				HashMap_Insert (pos_to_normal_map, &verts[i]->xyz, &norm);
+				FlatMap_InsertVec3 (pos_to_normal_map, &verts[i]->xyz, &norm);
 		}
 	}
 
-	const uint32_t map_size = HashMap_Size (pos_to_normal_map);
+	const uint32_t map_size = FlatMap_Size (pos_to_normal_map);
 	for (uint32_t i = 0; i < map_size; ++i)
 	{
-		vec3_t *norm = HashMap_GetValue (vec3_t, pos_to_normal_map, i);
+		vec3_t *norm = FlatMap_GetValue (vec3_t, pos_to_normal_map, i);
 		VectorNormalize (*norm);
 	}
 
 	for (size_t v = 0; v < numverts; v++)
 	{
-		vec3_t *norm = HashMap_Lookup (vec3_t, pos_to_normal_map, &vert[v].xyz);
+		vec3_t *norm = FlatMap_LookupVec3 (pos_to_normal_map, &vert[v].xyz);
 		if (norm)
 			VectorCopy (*norm, vert[v].norm);
 	}
 
-	HashMap_Destroy (pos_to_normal_map);
+	FlatMap_Destroy (pos_to_normal_map);
 }
 
 /*
@@ -4408,7 +4731,7 @@ static void Mod_LoadMD5MeshModel (qmodel_t *mod, const void *buffer)
 			for (j = 0; j < 3; j++)
 			{
 				size_t t = MD5UINT ();
-				if (t > (size_t)surf->numverts)
+				if (t >= (size_t)surf->numverts)
 					Sys_Error ("vertex index out of bounds");
 				poutindexes[index_offset + idx + j] = t;
 			}
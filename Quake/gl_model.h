@@ -185,6 +185,7 @@ typedef struct msurface_s
 	uint32_t styles_bitmap;				 // bitmap of styles used (16..64 OR-folded into bits 16..31)
 	int		 cached_light[MAXLIGHTMAPS]; // values currently used in lightmap
 	qboolean cached_dlight;				 // true if dynamic light in cache
+	int		 lightmapframe;				 // r_framecount when the lightmap was last queued for a rebuild
 	byte	*samples;					 // [numstyles*surfsize]
 } msurface_t;
 
@@ -566,6 +567,8 @@ void	  Mod_ResetAll (void); // for gamedir changes (Host_Game_f)
 void	  Mod_UnPrimeAll (void);
 void	  Mod_ClearBModelCaches (const char *newmap);
 qmodel_t *Mod_ForName (const char *name, qboolean crash);
+void	  Mod_PreloadMaps (const char *entities, const char *current_map);
+void	  Mod_PreloadCancel (void);
 void	 *Mod_Extradata_CheckSkin (qmodel_t *mod, int skinnum);
 void	 *Mod_Extradata (qmodel_t *mod);
 void	  Mod_TouchModel (const char *name);
@@ -71,11 +71,7 @@ static efrag_t *R_GetEfrag (void)
 	{
 		int i;
 
-		cl.free_efrags = (efrag_t *)Mem_Alloc (EXTRA_EFRAGS * sizeof (efrag_t));
-
-		// Track allocations so we don't leak
-		cl.efrag_allocs = (efrag_t **)Mem_Realloc (cl.efrag_allocs, sizeof (efrag_t **) * (cl.num_efragallocs + 1));
-		cl.efrag_allocs[cl.num_efragallocs++] = cl.free_efrags;
+		cl.free_efrags = (efrag_t *)Mem_ArenaAlloc (MEM_TAG_CLIENT, EXTRA_EFRAGS * sizeof (efrag_t));
 
 		for (i = 0; i < EXTRA_EFRAGS - 1; i++)
 			cl.free_efrags[i].leafnext = &cl.free_efrags[i + 1];
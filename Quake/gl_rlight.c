@@ -28,6 +28,7 @@ int r_dlightframecount;
 extern cvar_t r_flatlightstyles; // johnfitz
 extern cvar_t r_lerplightstyles;
 extern cvar_t r_gpulightmapupdate;
+extern cvar_t r_lightgrid;
 
 /*
 ==================
@@ -334,6 +335,292 @@ loc0:
 	}
 }
 
+/*
+=============================================================================
+
+LIGHT GRID
+
+Sparse grid of light samples baked from the world lightmaps at map load. Every cell
+stores the lightmap color per lightstyle, so animated styles still work, and lookups
+blend the 8 surrounding cells. Cells are grouped into bricks that are only allocated
+where the world has non-solid leafs.
+
+=============================================================================
+*/
+
+#define LIGHTGRID_BRICK		 4 // cells per brick side
+#define LIGHTGRID_BRICKCELLS (LIGHTGRID_BRICK * LIGHTGRID_BRICK * LIGHTGRID_BRICK)
+#define LIGHTGRID_MAXBRICKS	 (1 << 20)
+#define LIGHTGRID_MAXCELLS	 (1 << 20)
+
+#define LIGHTCELL_VALID 1
+
+typedef struct
+{
+	byte flags;
+	byte styles[MAXLIGHTMAPS];
+	byte rgb[MAXLIGHTMAPS][3];
+} lightcell_t;
+
+static struct
+{
+	qmodel_t	*model;
+	float		 cellsize;
+	vec3_t		 origin;
+	int			 size[3]; // in bricks
+	int			*brickindex; // -1 = not allocated
+	int			*brickpos;	 // brick -> index in brickindex
+	int			 numbricks;
+	lightcell_t *cells;
+} lightgrid;
+
+/*
+=============
+R_LightGridMarkBricks
+
+Flags the bricks overlapping non-solid leafs, returns their count
+=============
+*/
+static int R_LightGridMarkBricks (qmodel_t *model)
+{
+	const float bricksize = lightgrid.cellsize * LIGHTGRID_BRICK;
+	int			numbricks = 0;
+	int			i, j, x, y, z;
+	int			mins[3], maxs[3];
+
+	memset (lightgrid.brickindex, 0, sizeof (int) * lightgrid.size[0] * lightgrid.size[1] * lightgrid.size[2]);
+	for (i = 1; i <= model->numleafs; i++)
+	{
+		mleaf_t *leaf = &model->leafs[i];
+		if (leaf->contents == CONTENTS_SOLID || leaf->contents == CONTENTS_SKY)
+			continue;
+		for (j = 0; j < 3; j++)
+		{
+			mins[j] = CLAMP (0, (int)floorf ((leaf->minmaxs[j] - lightgrid.origin[j]) / bricksize), lightgrid.size[j] - 1);
+			maxs[j] = CLAMP (0, (int)floorf ((leaf->minmaxs[3 + j] - lightgrid.origin[j]) / bricksize), lightgrid.size[j] - 1);
+		}
+		for (z = mins[2]; z <= maxs[2]; z++)
+			for (y = mins[1]; y <= maxs[1]; y++)
+				for (x = mins[0]; x <= maxs[0]; x++)
+				{
+					int *brick = &lightgrid.brickindex[(z * lightgrid.size[1] + y) * lightgrid.size[0] + x];
+					if (!*brick)
+					{
+						*brick = 1;
+						++numbricks;
+					}
+				}
+	}
+	return numbricks;
+}
+
+/*
+=============
+R_LightGridBakeCell
+=============
+*/
+static void R_LightGridBakeCell (qmodel_t *model, vec3_t p, lightcell_t *cell)
+{
+	lightcache_t cache;
+	vec3_t		 end;
+	float		 maxdist = 8192.f;
+	msurface_t	*surf;
+	byte		*lightmap;
+	int			 maps, line3, dsfrac, dtfrac, j;
+
+	memset (cell->styles, 255, sizeof (cell->styles));
+	if (Mod_PointInLeaf (p, model)->contents == CONTENTS_SOLID)
+		return;
+	cell->flags = LIGHTCELL_VALID;
+
+	VectorCopy (p, end);
+	end[2] -= maxdist;
+	cache.surfidx = 0;
+	RecursiveLightPoint (&cache, model->nodes, p, p, end, &maxdist);
+	if (cache.surfidx <= 0)
+		return; // black
+
+	// same filtering as InterpolateLightmap, one style at a time
+	surf = model->surfaces + cache.surfidx - 1;
+	dsfrac = cache.ds & 15;
+	dtfrac = cache.dt & 15;
+	line3 = ((surf->extents[0] >> 4) + 1) * 3;
+	lightmap = surf->samples + ((cache.dt >> 4) * ((surf->extents[0] >> 4) + 1) + (cache.ds >> 4)) * 3;
+	for (maps = 0; maps < MAXLIGHTMAPS && surf->styles[maps] != 255; maps++)
+	{
+		cell->styles[maps] = surf->styles[maps];
+		for (j = 0; j < 3; j++)
+		{
+			int c00 = lightmap[j], c01 = lightmap[3 + j], c10 = lightmap[line3 + j], c11 = lightmap[line3 + 3 + j];
+			int c0 = (((c01 - c00) * dsfrac) >> 4) + c00;
+			int c1 = (((c11 - c10) * dsfrac) >> 4) + c10;
+			cell->rgb[maps][j] = CLAMP (0, (((c1 - c0) * dtfrac) >> 4) + c0, 255);
+		}
+		lightmap += ((surf->extents[0] >> 4) + 1) * ((surf->extents[1] >> 4) + 1) * 3;
+	}
+}
+
+/*
+=============
+R_LightGridBakeTask
+=============
+*/
+static void R_LightGridBakeTask (int brick, void *unused)
+{
+	const int	 index = lightgrid.brickpos[brick];
+	const int	 bx = index % lightgrid.size[0];
+	const int	 by = (index / lightgrid.size[0]) % lightgrid.size[1];
+	const int	 bz = index / (lightgrid.size[0] * lightgrid.size[1]);
+	lightcell_t *cell = lightgrid.cells + brick * LIGHTGRID_BRICKCELLS;
+	int			 x, y, z;
+	vec3_t		 p;
+
+	for (z = 0; z < LIGHTGRID_BRICK; z++)
+		for (y = 0; y < LIGHTGRID_BRICK; y++)
+			for (x = 0; x < LIGHTGRID_BRICK; x++, cell++)
+			{
+				p[0] = lightgrid.origin[0] + (bx * LIGHTGRID_BRICK + x) * lightgrid.cellsize;
+				p[1] = lightgrid.origin[1] + (by * LIGHTGRID_BRICK + y) * lightgrid.cellsize;
+				p[2] = lightgrid.origin[2] + (bz * LIGHTGRID_BRICK + z) * lightgrid.cellsize;
+				R_LightGridBakeCell (cl.worldmodel, p, cell);
+			}
+}
+
+/*
+=============
+R_BuildLightGrid
+
+Called at map load after the lightmaps are set up
+=============
+*/
+void R_BuildLightGrid (void)
+{
+	qmodel_t *model = cl.worldmodel;
+	double	  start = Sys_DoubleTime ();
+	int		  i, numbricks, totalbricks;
+
+	Mem_Free (lightgrid.brickindex);
+	Mem_Free (lightgrid.brickpos);
+	Mem_Free (lightgrid.cells);
+	memset (&lightgrid, 0, sizeof (lightgrid));
+
+	if (!model || !model->lightdata)
+		return;
+
+	// start at 32 units and double the spacing until the grid is small enough
+	for (lightgrid.cellsize = 32.f;; lightgrid.cellsize *= 2.f)
+	{
+		const float bricksize = lightgrid.cellsize * LIGHTGRID_BRICK;
+		totalbricks = 1;
+		for (i = 0; i < 3; i++)
+		{
+			lightgrid.origin[i] = floorf (model->mins[i] / lightgrid.cellsize) * lightgrid.cellsize;
+			lightgrid.size[i] = (int)ceilf ((model->maxs[i] - lightgrid.origin[i]) / bricksize) + 1;
+			totalbricks *= lightgrid.size[i];
+		}
+		if (totalbricks > LIGHTGRID_MAXBRICKS)
+			continue;
+		lightgrid.brickindex = Mem_Realloc (lightgrid.brickindex, sizeof (int) * totalbricks);
+		numbricks = R_LightGridMarkBricks (model);
+		if (numbricks * LIGHTGRID_BRICKCELLS <= LIGHTGRID_MAXCELLS)
+			break;
+	}
+
+	lightgrid.brickpos = Mem_Alloc (sizeof (int) * numbricks);
+	lightgrid.cells = Mem_Alloc (sizeof (lightcell_t) * LIGHTGRID_BRICKCELLS * numbricks);
+	lightgrid.numbricks = 0;
+	for (i = 0; i < totalbricks; i++)
+	{
+		if (lightgrid.brickindex[i])
+		{
+			lightgrid.brickpos[lightgrid.numbricks] = i;
+			lightgrid.brickindex[i] = lightgrid.numbricks++;
+		}
+		else
+			lightgrid.brickindex[i] = -1;
+	}
+
+	if (numbricks)
+	{
+		task_handle_t task = Task_AllocateAssignIndexedFuncAndSubmit (R_LightGridBakeTask, numbricks, NULL, 0);
+		Task_Join (task, SDL_MUTEX_MAXWAIT);
+	}
+	lightgrid.model = model;
+
+	Con_DPrintf (
+		"Light grid: %d bricks, %d cells of %g units, %.1f ms\n", numbricks, numbricks * LIGHTGRID_BRICKCELLS, lightgrid.cellsize,
+		(Sys_DoubleTime () - start) * 1000.0);
+}
+
+/*
+=============
+R_LightGridCell
+=============
+*/
+static inline const lightcell_t *R_LightGridCell (int x, int y, int z)
+{
+	int brick;
+
+	if (x < 0 || y < 0 || z < 0)
+		return NULL;
+	if (x >= lightgrid.size[0] * LIGHTGRID_BRICK || y >= lightgrid.size[1] * LIGHTGRID_BRICK || z >= lightgrid.size[2] * LIGHTGRID_BRICK)
+		return NULL;
+	brick = lightgrid.brickindex[((z / LIGHTGRID_BRICK) * lightgrid.size[1] + (y / LIGHTGRID_BRICK)) * lightgrid.size[0] + (x / LIGHTGRID_BRICK)];
+	if (brick < 0)
+		return NULL;
+	return lightgrid.cells + brick * LIGHTGRID_BRICKCELLS +
+		   ((z % LIGHTGRID_BRICK) * LIGHTGRID_BRICK + (y % LIGHTGRID_BRICK)) * LIGHTGRID_BRICK + (x % LIGHTGRID_BRICK);
+}
+
+/*
+=============
+R_LightGridPoint
+
+Trilinear blend of the valid cells around p. Returns false if there aren't any.
+=============
+*/
+static qboolean R_LightGridPoint (vec3_t p, vec3_t color)
+{
+	int	   i, j, corner, base[3];
+	float  frac[3], weight, totalweight = 0.f;
+	vec3_t cellcolor;
+
+	for (i = 0; i < 3; i++)
+	{
+		float f = (p[i] - lightgrid.origin[i]) / lightgrid.cellsize;
+		base[i] = (int)floorf (f);
+		frac[i] = f - base[i];
+	}
+
+	VectorCopy (vec3_origin, color);
+	for (corner = 0; corner < 8; corner++)
+	{
+		const lightcell_t *cell = R_LightGridCell (base[0] + (corner & 1), base[1] + ((corner >> 1) & 1), base[2] + (corner >> 2));
+		if (!cell || !(cell->flags & LIGHTCELL_VALID))
+			continue;
+
+		weight = ((corner & 1) ? frac[0] : 1.f - frac[0]) * ((corner & 2) ? frac[1] : 1.f - frac[1]) * ((corner & 4) ? frac[2] : 1.f - frac[2]);
+		if (weight <= 0.f)
+			continue;
+
+		VectorCopy (vec3_origin, cellcolor);
+		for (i = 0; i < MAXLIGHTMAPS && cell->styles[i] != 255; i++)
+		{
+			const int scale = d_lightstylevalue[cell->styles[i]];
+			for (j = 0; j < 3; j++)
+				cellcolor[j] += cell->rgb[i][j] * scale;
+		}
+		VectorMA (color, weight, cellcolor, color);
+		totalweight += weight;
+	}
+
+	if (totalweight < 0.001f)
+		return false;
+
+	VectorScale (color, 1.f / (256.f * totalweight), color);
+	return true;
+}
+
 /*
 =============
 R_LightPoint -- johnfitz -- replaced entire function for lit support via lordhavoc
@@ -341,8 +628,9 @@ R_LightPoint -- johnfitz -- replaced entire function for lit support via lordhav
 */
 int R_LightPoint (vec3_t p, float ofs, lightcache_t *cache, vec3_t *lightcolor)
 {
-	vec3_t start, end;
-	float  maxdist = 8192.f; // johnfitz -- was 2048
+	vec3_t		 start, end;
+	float		 maxdist = 8192.f; // johnfitz -- was 2048
+	const double time0 = r_speeds.value ? Sys_DoubleTime () : 0.0;
 
 	if (!cl.worldmodel->lightdata)
 	{
@@ -353,6 +641,16 @@ int R_LightPoint (vec3_t p, float ofs, lightcache_t *cache, vec3_t *lightcolor)
 	start[0] = p[0];
 	start[1] = p[1];
 	start[2] = p[2] + ofs;
+
+	Atomic_IncrementUInt32 (&rs_lightpoints);
+	if (r_lightgrid.value && lightgrid.model == cl.worldmodel && R_LightGridPoint (start, *lightcolor))
+	{
+		Atomic_IncrementUInt32 (&rs_lightgridpoints);
+		if (r_speeds.value)
+			Atomic_AddUInt64 (&rs_lightgridtime, (uint64_t)((Sys_DoubleTime () - time0) * 1e9));
+		return (((*lightcolor)[0] + (*lightcolor)[1] + (*lightcolor)[2]) * (1.0f / 3.0f));
+	}
+
 	end[0] = start[0];
 	end[1] = start[1];
 	end[2] = start[2] - maxdist;
@@ -371,5 +669,8 @@ int R_LightPoint (vec3_t p, float ofs, lightcache_t *cache, vec3_t *lightcolor)
 	if (cache && cache->surfidx > 0)
 		InterpolateLightmap (*lightcolor, cl.worldmodel->surfaces + cache->surfidx - 1, cache->ds, cache->dt);
 
+	// includes the grid lookup that fell through
+	if (r_speeds.value)
+		Atomic_AddUInt64 (&rs_lighttracetime, (uint64_t)((Sys_DoubleTime () - time0) * 1e9));
 	return (((*lightcolor)[0] + (*lightcolor)[1] + (*lightcolor)[2]) * (1.0f / 3.0f));
 }
@@ -36,6 +36,10 @@ int		 render_scale;
 // johnfitz -- rendering statistics
 atomic_uint32_t rs_brushpolys, rs_aliaspolys, rs_skypolys, rs_particles, rs_fogpolys;
 atomic_uint32_t rs_dynamiclightmaps, rs_brushpasses, rs_aliaspasses;
+atomic_uint32_t rs_lightpoints, rs_lightgridpoints;
+atomic_uint64_t rs_lightgridtime, rs_lighttracetime;
+atomic_uint32_t rs_occluders, rs_occludedleafs, rs_occludedsurfaces, rs_occludedentities;
+atomic_uint32_t rs_2ddrawcalls, rs_2dvertices;
 
 //
 // view origin
@@ -79,6 +83,9 @@ cvar_t r_clearcolor = {"r_clearcolor", "2", CVAR_ARCHIVE};
 cvar_t r_fastclear = {"r_fastclear", "1", CVAR_ARCHIVE};
 cvar_t r_flatlightstyles = {"r_flatlightstyles", "0", CVAR_NONE};
 cvar_t r_lerplightstyles = {"r_lerplightstyles", "1", CVAR_ARCHIVE}; // 0=off; 1=skip abrupt transitions; 2=always lerp
+cvar_t r_lightgrid = {"r_lightgrid", "1", CVAR_ARCHIVE}; // light alias models from the baked light grid instead of tracing
+cvar_t r_occlusion = {"r_occlusion", "1", CVAR_ARCHIVE}; // cull leafs, surfaces and entities behind large world faces
+cvar_t r_occlusion_occluders = {"r_occlusion_occluders", "64", CVAR_ARCHIVE};
 cvar_t gl_fullbrights = {"gl_fullbrights", "1", CVAR_ARCHIVE};
 cvar_t gl_farclip = {"gl_farclip", "16384", CVAR_ARCHIVE};
 cvar_t r_oldskyleaf = {"r_oldskyleaf", "0", CVAR_NONE};
@@ -186,7 +193,16 @@ qboolean R_CullModelForEntity (entity_t *e)
 		VectorAdd (e->origin, maxbounds, maxs);
 	}
 
-	return R_CullBox (mins, maxs);
+	if (R_CullBox (mins, maxs))
+		return true;
+
+	// the view model is drawn on top of the world
+	if (e != &cl.viewent && R_OcclusionCullBox (mins, maxs))
+	{
+		Atomic_IncrementUInt32 (&rs_occludedentities);
+		return true;
+	}
+	return false;
 }
 
 /*
@@ -1031,11 +1047,20 @@ static void R_PrintStats (double time1)
 			(int)cl.entities[cl.viewentity].origin[2], (int)cl.viewangles[PITCH], (int)cl.viewangles[YAW], (int)cl.viewangles[ROLL]);
 	else if (r_speeds.value == 2)
 		Con_Printf (
-			"%6.3f ms  %4u/%4u wpoly %4u/%4u epoly %5.3g lmap %4u skypoly\n", (time2 - time1) * 1000.0, rs_brushpolys, rs_brushpasses, rs_aliaspolys,
-			rs_aliaspasses, lms, rs_skypolys);
+			"%6.3f ms  %4u/%4u wpoly %4u/%4u epoly %5.3g lmap %4u skypoly %4u/%4u lpoint\n", (time2 - time1) * 1000.0, rs_brushpolys, rs_brushpasses,
+			rs_aliaspolys, rs_aliaspasses, lms, rs_skypolys, rs_lightgridpoints, rs_lightpoints);
 	else if (r_speeds.value)
 		Con_Printf ("%3i ms  %4i wpoly %4i epoly %5.3g lmap\n", (int)((time2 - time1) * 1000), rs_brushpolys, rs_aliaspolys, lms);
 	// johnfitz
+	if (!r_pos.value && r_speeds.value == 2 && r_occlusion.value)
+		Con_Printf (
+			"%4u occluders, occluded %4u leafs %5u wpoly %4u ents\n", rs_occluders, rs_occludedleafs, rs_occludedsurfaces, rs_occludedentities);
+	if (!r_pos.value && r_speeds.value == 2)
+		Con_Printf ("%4u 2d draws %5u 2d verts\n", rs_2ddrawcalls, rs_2dvertices);
+	if (!r_pos.value && r_speeds.value == 2)
+		Con_Printf ( // cpu time summed over all threads
+			"lpoint %4u grid %6.3f ms, %4u traced %6.3f ms\n", Atomic_LoadUInt32 (&rs_lightgridpoints), Atomic_LoadUInt64 (&rs_lightgridtime) / 1e6,
+			Atomic_LoadUInt32 (&rs_lightpoints) - Atomic_LoadUInt32 (&rs_lightgridpoints), Atomic_LoadUInt64 (&rs_lighttracetime) / 1e6);
 }
 
 /*
@@ -1071,6 +1096,14 @@ void R_RenderView (qboolean use_tasks, task_handle_t begin_rendering_task, task_
 		Atomic_StoreUInt32 (&rs_dynamiclightmaps, 0u);
 		Atomic_StoreUInt32 (&rs_aliaspasses, 0u);
 		Atomic_StoreUInt32 (&rs_brushpasses, 0u);
+		Atomic_StoreUInt32 (&rs_lightpoints, 0u);
+		Atomic_StoreUInt32 (&rs_lightgridpoints, 0u);
+		Atomic_StoreUInt64 (&rs_lightgridtime, 0u);
+		Atomic_StoreUInt64 (&rs_lighttracetime, 0u);
+		Atomic_StoreUInt32 (&rs_occluders, 0u);
+		Atomic_StoreUInt32 (&rs_occludedleafs, 0u);
+		Atomic_StoreUInt32 (&rs_occludedsurfaces, 0u);
+		Atomic_StoreUInt32 (&rs_occludedentities, 0u);
 		stats_ready = true;
 	}
 	else
@@ -1081,10 +1114,16 @@ void R_RenderView (qboolean use_tasks, task_handle_t begin_rendering_task, task_
 		task_handle_t before_mark = Task_AllocateAndAssignFunc (R_SetupViewBeforeMark, NULL, 0);
 		Task_AddDependency (setup_frame_task, before_mark);
 
+		// marking and entity culling test against the occluders
+		task_handle_t setup_occlusion = Task_AllocateAndAssignFunc (R_SetupOcclusion, NULL, 0);
+		Task_AddDependency (before_mark, setup_occlusion);
+		task_handle_t rasterize_occluders = Task_AllocateAndAssignIndexedFunc (R_RasterizeOccludersTask, NUM_OCCLUSION_BINS, NULL, 0);
+		Task_AddDependency (setup_occlusion, rasterize_occluders);
+
 		task_handle_t store_efrags = INVALID_TASK_HANDLE;
 		task_handle_t cull_surfaces = INVALID_TASK_HANDLE;
 		task_handle_t chain_surfaces = INVALID_TASK_HANDLE;
-		R_MarkSurfaces (use_tasks, before_mark, &store_efrags, &cull_surfaces, &chain_surfaces);
+		R_MarkSurfaces (use_tasks, rasterize_occluders, &store_efrags, &cull_surfaces, &chain_surfaces);
 
 		task_handle_t update_warp_textures = Task_AllocateAndAssignFunc ((task_func_t)R_UpdateWarpTextures, NULL, 0);
 		Task_AddDependency (cull_surfaces, update_warp_textures);
@@ -1136,10 +1175,24 @@ void R_RenderView (qboolean use_tasks, task_handle_t begin_rendering_task, task_
 		Task_AddDependency (begin_rendering_task, build_tlas_task);
 		Task_AddDependency (build_tlas_task, draw_done_task);
 
-		task_handle_t update_lightmaps_task = Task_AllocateAndAssignFunc (R_UpdateLightmapsAndIndirect, NULL, 0);
-		Task_AddDependency (cull_surfaces, update_lightmaps_task);
-		Task_AddDependency (draw_entities_task, update_lightmaps_task);
-		Task_AddDependency (draw_alpha_entities_task, update_lightmaps_task);
+		// the CPU lightmap path rebuilds the lightmaps queued while marking and drawing in parallel, then uploads them
+		task_handle_t update_lightmaps_task;
+		task_handle_t prepare_lightmaps_task = INVALID_TASK_HANDLE;
+		task_handle_t build_lightmaps_task = INVALID_TASK_HANDLE;
+		if (r_gpulightmapupdate.value)
+			update_lightmaps_task = Task_AllocateAndAssignFunc (R_UpdateLightmapsAndIndirect, NULL, 0);
+		else
+		{
+			prepare_lightmaps_task = Task_AllocateAndAssignFunc (R_PrepareDynamicLightmaps, NULL, 0);
+			build_lightmaps_task = Task_AllocateAndAssignIndexedFunc (R_BuildDynamicLightmapsTask, NUM_LIGHTMAP_BUILD_TASKS, NULL, 0);
+			update_lightmaps_task = Task_AllocateAndAssignFunc (R_UploadLightmaps, NULL, 0);
+			Task_AddDependency (prepare_lightmaps_task, build_lightmaps_task);
+			Task_AddDependency (build_lightmaps_task, update_lightmaps_task);
+		}
+		task_handle_t first_lightmaps_task = r_gpulightmapupdate.value ? update_lightmaps_task : prepare_lightmaps_task;
+		Task_AddDependency (cull_surfaces, first_lightmaps_task);
+		Task_AddDependency (draw_entities_task, first_lightmaps_task);
+		Task_AddDependency (draw_alpha_entities_task, first_lightmaps_task);
 		Task_AddDependency (update_lightmaps_task, draw_done_task);
 
 		if (r_showtris.value)
@@ -1147,6 +1200,7 @@ void R_RenderView (qboolean use_tasks, task_handle_t begin_rendering_task, task_
 			if (!indirect)
 				Task_AddDependency (chain_surfaces, draw_view_model_task);
 
+			Task_AddDependency (rasterize_occluders, draw_view_model_task);		 // entity culling for showtris
 			Task_AddDependency (draw_entities_task, draw_view_model_task);		 // not dependent, but mutually exclusive
 			Task_AddDependency (draw_alpha_entities_task, draw_view_model_task); // not dependent, but mutually exclusive
 
@@ -1155,10 +1209,15 @@ void R_RenderView (qboolean use_tasks, task_handle_t begin_rendering_task, task_
 #endif
 		}
 
-		task_handle_t tasks[] = {before_mark,		  store_efrags,	   update_warp_textures, draw_world_task,	 sort_transparents,
-								 draw_sky_task,		  draw_water_task, draw_view_model_task, draw_entities_task, draw_alpha_entities_task,
-								 draw_particles_task, build_tlas_task, update_lightmaps_task};
+		task_handle_t tasks[] = {before_mark,			setup_occlusion,			rasterize_occluders,	store_efrags,		update_warp_textures,
+								 draw_world_task,		sort_transparents,			draw_sky_task,			draw_water_task,	draw_view_model_task,
+								 draw_entities_task,	draw_alpha_entities_task,	draw_particles_task,	build_tlas_task,	update_lightmaps_task};
 		Tasks_Submit ((sizeof (tasks) / sizeof (task_handle_t)), tasks);
+		if (!r_gpulightmapupdate.value)
+		{
+			Task_Submit (prepare_lightmaps_task);
+			Task_Submit (build_lightmaps_task);
+		}
 		if (cull_surfaces != chain_surfaces)
 		{
 			Task_Submit (cull_surfaces);
@@ -1168,6 +1227,7 @@ void R_RenderView (qboolean use_tasks, task_handle_t begin_rendering_task, task_
 	else
 	{
 		R_SetupViewBeforeMark (NULL);
+		R_RasterizeOccluders ();
 		R_MarkSurfaces (use_tasks, INVALID_TASK_HANDLE, NULL, NULL, NULL); // johnfitz -- create texture chains from PVS
 		R_UpdateWarpTextures (NULL);
 		R_DrawWorldTask (0, NULL);
@@ -1183,6 +1243,8 @@ void R_RenderView (qboolean use_tasks, task_handle_t begin_rendering_task, task_
 			R_BuildTopLevelAccelerationStructure (NULL);
 			R_UpdateLightmapsAndIndirect (NULL);
 		}
+		else
+			R_BuildDynamicLightmaps ();
 		R_PrintStats (time1);
 	}
 }
@@ -35,6 +35,9 @@ extern cvar_t r_clearcolor;
 extern cvar_t r_fastclear;
 extern cvar_t r_flatlightstyles;
 extern cvar_t r_lerplightstyles;
+extern cvar_t r_lightgrid;
+extern cvar_t r_occlusion;
+extern cvar_t r_occlusion_occluders;
 extern cvar_t gl_fullbrights;
 extern cvar_t gl_farclip;
 extern cvar_t r_waterquality;
@@ -59,6 +62,7 @@ extern cvar_t r_indirect;
 extern cvar_t r_tasks;
 extern cvar_t r_parallelmark;
 extern cvar_t r_usesops;
+extern cvar_t r_meshcache;
 
 #if defined(USE_SIMD)
 extern cvar_t r_simd;
@@ -3574,6 +3578,7 @@ void R_Init (void)
 	Cmd_AddCommand ("timerefresh", R_TimeRefresh_f);
 	Cmd_AddCommand ("pointfile", R_ReadPointFile_f);
 	Cmd_AddCommand ("vkmemstats", R_VulkanMemStats_f);
+	Cmd_AddCommand ("r_occlusiontest", R_OcclusionRasterTest_f);
 
 	Cvar_RegisterVariable (&r_fullbright);
 	Cvar_RegisterVariable (&r_lightmap);
@@ -3605,6 +3610,9 @@ void R_Init (void)
 	Cvar_RegisterVariable (&r_waterwarpcompute);
 	Cvar_RegisterVariable (&r_flatlightstyles);
 	Cvar_RegisterVariable (&r_lerplightstyles);
+	Cvar_RegisterVariable (&r_lightgrid);
+	Cvar_RegisterVariable (&r_occlusion);
+	Cvar_RegisterVariable (&r_occlusion_occluders);
 	Cvar_RegisterVariable (&r_oldskyleaf);
 	Cvar_RegisterVariable (&r_drawworld);
 	Cvar_RegisterVariable (&r_showtris);
@@ -3642,6 +3650,7 @@ void R_Init (void)
 	Cvar_RegisterVariable (&r_tasks);
 	Cvar_RegisterVariable (&r_parallelmark);
 	Cvar_RegisterVariable (&r_usesops);
+	Cvar_RegisterVariable (&r_meshcache);
 
 	R_InitParticles ();
 	SetClearColor (); // johnfitz
@@ -3906,6 +3915,9 @@ void R_NewMap (void)
 	Sky_NewMap ();		  // johnfitz -- skybox in worldspawn
 	Fog_NewMap ();		  // johnfitz -- global fog in worldspawn
 	R_ParseWorldspawn (); // ericw -- wateralpha, lavaalpha, telealpha, slimealpha in worldspawn
+	R_BuildLightGrid ();
+	R_BuildOccluders ();
+	TexMgr_NewMap ();
 
 	GL_UpdateDescriptorSets ();
 }
@@ -88,6 +88,7 @@ cvar_t scr_conwidth = {"scr_conwidth", "0", CVAR_ARCHIVE};
 cvar_t scr_conscale = {"scr_conscale", "1", CVAR_ARCHIVE};
 cvar_t scr_crosshairscale = {"scr_crosshairscale", "1", CVAR_ARCHIVE};
 cvar_t scr_showfps = {"scr_showfps", "0", CVAR_ARCHIVE};
+cvar_t scr_showprediction = {"scr_showprediction", "0", CVAR_NONE};
 cvar_t scr_clock = {"scr_clock", "0", CVAR_NONE};
 cvar_t scr_autoclock = {"scr_autoclock", "1", CVAR_ARCHIVE};
 cvar_t scr_usekfont = {"scr_usekfont", "0", CVAR_NONE}; // 2021 re-release
@@ -549,6 +550,7 @@ void SCR_Init (void)
 	Cvar_RegisterVariable (&scr_conscale);
 	Cvar_RegisterVariable (&scr_crosshairscale);
 	Cvar_RegisterVariable (&scr_showfps);
+	Cvar_RegisterVariable (&scr_showprediction);
 	Cvar_RegisterVariable (&scr_clock);
 	Cvar_RegisterVariable (&scr_autoclock);
 	// johnfitz
@@ -651,6 +653,35 @@ void SCR_DrawFPS (cb_context_t *cbx)
 	}
 }
 
+/*
+==============
+SCR_DrawPrediction
+
+last / average / max distance between the predicted and the acknowledged player origin
+==============
+*/
+void SCR_DrawPrediction (cb_context_t *cbx)
+{
+	char  st[40];
+	float error, avgerror, maxerror;
+	int	  x, y;
+
+	if (!scr_showprediction.value || scr_viewsize.value >= 130)
+		return;
+
+	CL_PredictionStats (&error, &avgerror, &maxerror);
+	if (cl_prediction.value)
+		q_snprintf (st, sizeof (st), "pred %.2f/%.2f/%.2f", error, avgerror, maxerror);
+	else
+		q_snprintf (st, sizeof (st), "pred off");
+	x = 320 - (strlen (st) << 3);
+	y = 200 - 8;
+	if (scr_showfps.value)
+		y -= 8;
+	GL_SetCanvas (cbx, CANVAS_BOTTOMRIGHT);
+	Draw_String (cbx, x, y, st);
+}
+
 /*
 ==============
 SCR_DrawClock -- johnfitz
@@ -684,6 +715,8 @@ void SCR_DrawClock (cb_context_t *cbx)
 
 	if (scr_showfps.value)
 		y -= 8; // make room for fps counter
+	if (scr_showprediction.value)
+		y -= 8;
 
 	if (scr_clock.value >= 2)
 	{
@@ -1158,6 +1191,7 @@ static void SCR_DrawGUI (void *unused)
 		Sbar_Draw (cbx);
 		SCR_DrawDevStats (cbx); // johnfitz
 		SCR_DrawFPS (cbx);		// johnfitz
+		SCR_DrawPrediction (cbx);
 		SCR_DrawClock (cbx);	// johnfitz
 		SCR_DrawConsole (cbx);
 		M_Draw (cbx);
@@ -1166,6 +1200,7 @@ static void SCR_DrawGUI (void *unused)
 	if (use_mutex)
 		SDL_UnlockMutex (draw_qcvm_mutex);
 
+	Draw_EndBatch (cbx);
 	R_EndDebugUtilsLabel (cbx);
 }
 
@@ -75,6 +75,26 @@ unsigned int d_8to24table_pants[256];
 static glheap_t	 *texmgr_heap;
 static SDL_mutex *texmgr_mutex;
 
+// Lookup and sharing
+typedef struct
+{
+	qmodel_t *owner;
+	char	  name[64];
+} texture_name_key_t;
+
+static hash_map_t  *texture_name_map;	 // texture_name_key_t -> most recently loaded gltexture_t
+static hash_map_t  *texture_content_map; // gltexture_key_t -> a gltexture_t using that image
+static gltexture_t *retired_gltextures;
+static int			num_retired_gltextures;
+
+static struct
+{
+	int	   loads;
+	int	   hits;
+	int	   reused_retired;
+	size_t bytes_saved;
+} texture_share_stats;
+
 static byte bluenoise_data[4096] = {
 	0x27, 0x62, 0x08, 0x4C, 0xDE, 0xBA, 0x05, 0xEF, 0x2A, 0xA1, 0xF7, 0x4A, 0x5F, 0x29, 0xE8, 0x34, 0xA9, 0xCB, 0x40, 0x60, 0xD5, 0x87, 0x70, 0xD0, 0x61, 0x8A,
 	0xDF, 0xB2, 0xD8, 0xFA, 0x07, 0x74, 0x31, 0x56, 0x1A, 0x4B, 0xAA, 0x36, 0xD4, 0x16, 0x95, 0x2F, 0x68, 0x8E, 0x77, 0x25, 0x49, 0xE3, 0x12, 0x6C, 0x9F, 0xD7,
@@ -300,7 +320,9 @@ static void TexMgr_Imagelist_f (void)
 {
 	float		 mb;
 	float		 texels = 0;
-	gltexture_t *glt;
+	float		 shared_texels = 0;
+	int			 num_shared = 0;
+	gltexture_t *glt, *other;
 
 	for (glt = active_gltextures; glt; glt = glt->next)
 	{
@@ -314,11 +336,24 @@ static void TexMgr_Imagelist_f (void)
 			texels *= 6.0f;
 		}
 		else
-			Con_SafePrintf ("   %4i x%4i %s\n", glt->width, glt->height, glt->name);
+			Con_SafePrintf ("   %4i x%4i %s%s\n", glt->width, glt->height, glt->name, (glt->next_shared != glt) ? " (shared)" : "");
+
+		// every texture of a shared image but the one with the lowest address is a duplicate
+		for (other = glt->next_shared; other != glt; other = other->next_shared)
+			if (other < glt)
+				break;
+		if (other != glt)
+		{
+			++num_shared;
+			shared_texels += (glt->flags & TEXPREF_MIPMAP) ? glt->width * glt->height * 4.0f / 3.0f : glt->width * glt->height;
+		}
 	}
 
+	texels -= shared_texels;
 	mb = (texels * 4) / 0x100000;
 	Con_Printf ("%i textures %i pixels %1.1f megabytes\n", numgltextures, (int)texels, mb);
+	Con_Printf (
+		"%i textures share an image, %1.1f megabytes saved, %i retired images\n", num_shared, (shared_texels * 4) / 0x100000, num_retired_gltextures);
 }
 
 /*
@@ -329,6 +364,43 @@ static void TexMgr_Imagelist_f (void)
 ================================================================================
 */
 
+static void GL_DeleteTexture (gltexture_t *texture);
+
+/*
+================
+TexMgr_NameKey
+================
+*/
+static void TexMgr_NameKey (texture_name_key_t *key, qmodel_t *owner, const char *name)
+{
+	memset (key, 0, sizeof (texture_name_key_t));
+	key->owner = owner;
+	q_strlcpy (key->name, name, sizeof (key->name));
+}
+
+/*
+================
+TexMgr_HashNameKey
+================
+*/
+static uint32_t TexMgr_HashNameKey (const void *const key)
+{
+	const texture_name_key_t *name_key = (const texture_name_key_t *)key;
+	const char				 *name = name_key->name;
+	return HashCombine (HashPtr (&name_key->owner), HashStr (&name));
+}
+
+/*
+================
+TexMgr_HashContentKey
+================
+*/
+static uint32_t TexMgr_HashContentKey (const void *const key)
+{
+	const gltexture_key_t *content_key = (const gltexture_key_t *)key;
+	return HashCombine (HashInt64 (&content_key->hash), HashInt32 (&content_key->flags));
+}
+
 /*
 ================
 TexMgr_FindTexture
@@ -336,21 +408,131 @@ TexMgr_FindTexture
 */
 gltexture_t *TexMgr_FindTexture (qmodel_t *owner, const char *name)
 {
+	texture_name_key_t key;
+	gltexture_t		 **found;
+	gltexture_t		  *glt = NULL;
+
+	if (!name)
+		return NULL;
+
+	TexMgr_NameKey (&key, owner, name);
 	SDL_LockMutex (texmgr_mutex);
-	gltexture_t *glt = NULL;
+	found = HashMap_Lookup (gltexture_t *, texture_name_map, &key);
+	if (found)
+		glt = *found;
+	SDL_UnlockMutex (texmgr_mutex);
+	return glt;
+}
 
-	if (name)
+/*
+================
+TexMgr_LinkName -- makes glt the texture TexMgr_FindTexture returns for its owner and name
+================
+*/
+static void TexMgr_LinkName (gltexture_t *glt)
+{
+	texture_name_key_t key;
+	gltexture_t		 **found;
+
+	TexMgr_NameKey (&key, glt->owner, glt->name);
+	SDL_LockMutex (texmgr_mutex);
+	found = HashMap_Lookup (gltexture_t *, texture_name_map, &key);
+	glt->next_same_name = found ? *found : NULL;
+	HashMap_Insert (texture_name_map, &key, &glt);
+	SDL_UnlockMutex (texmgr_mutex);
+}
+
+/*
+================
+TexMgr_UnlinkName -- returns false if glt isn't a loaded texture
+================
+*/
+static qboolean TexMgr_UnlinkName (gltexture_t *glt)
+{
+	texture_name_key_t key;
+	gltexture_t		 **found;
+	gltexture_t		  *other;
+
+	TexMgr_NameKey (&key, glt->owner, glt->name);
+	found = HashMap_Lookup (gltexture_t *, texture_name_map, &key);
+	if (!found)
+		return false;
+
+	if (*found == glt)
 	{
-		for (glt = active_gltextures; glt; glt = glt->next)
+		if (glt->next_same_name)
+			*found = glt->next_same_name;
+		else
+			HashMap_Erase (texture_name_map, &key);
+		glt->next_same_name = NULL;
+		return true;
+	}
+
+	for (other = *found; other->next_same_name; other = other->next_same_name)
+	{
+		if (other->next_same_name == glt)
 		{
-			if (glt->owner == owner && !strcmp (glt->name, name))
-				goto unlock_mutex;
+			other->next_same_name = glt->next_same_name;
+			glt->next_same_name = NULL;
+			return true;
 		}
 	}
+	return false;
+}
 
-unlock_mutex:
+/*
+================
+TexMgr_DetachImage -- stops glt from sharing its image, returns true if other textures still use it
+================
+*/
+static qboolean TexMgr_DetachImage (gltexture_t *glt)
+{
+	gltexture_t **shared = NULL;
+	gltexture_t	 *prev;
+
+	if (glt->content_key.hash)
+		shared = HashMap_Lookup (gltexture_t *, texture_content_map, &glt->content_key);
+
+	if (glt->next_shared == glt)
+	{
+		if (shared && *shared == glt)
+			HashMap_Erase (texture_content_map, &glt->content_key);
+		glt->content_key.hash = 0;
+		return false;
+	}
+
+	for (prev = glt->next_shared; prev->next_shared != glt; prev = prev->next_shared)
+		;
+	prev->next_shared = glt->next_shared;
+	if (shared && *shared == glt)
+		*shared = glt->next_shared;
+	glt->next_shared = glt;
+	glt->content_key.hash = 0;
+	return true;
+}
+
+/*
+================
+TexMgr_FreeRetired -- deletes the images that weren't loaded again since their last texture was freed
+================
+*/
+static void TexMgr_FreeRetired (void)
+{
+	SDL_LockMutex (texmgr_mutex);
+	gltexture_t *glt, *next;
+
+	for (glt = retired_gltextures; glt; glt = next)
+	{
+		next = glt->next;
+		glt->retired = false;
+		glt->next = free_gltextures;
+		free_gltextures = glt;
+
+		GL_DeleteTexture (glt);
+	}
+	retired_gltextures = NULL;
+	num_retired_gltextures = 0;
 	SDL_UnlockMutex (texmgr_mutex);
-	return glt;
 }
 
 /*
@@ -363,18 +545,28 @@ gltexture_t *TexMgr_NewTexture (void)
 	SDL_LockMutex (texmgr_mutex);
 	gltexture_t *glt;
 
+	if (!free_gltextures)
+		TexMgr_FreeRetired ();
+	if (!free_gltextures)
+		Sys_Error ("TexMgr_NewTexture: more than %d textures", MAX_GLTEXTURES);
+
 	glt = free_gltextures;
 	free_gltextures = glt->next;
 	glt->next = active_gltextures;
+	glt->prev = NULL;
+	if (active_gltextures)
+		active_gltextures->prev = glt;
 	active_gltextures = glt;
 
+	glt->next_same_name = NULL;
+	glt->next_shared = glt;
+	memset (&glt->content_key, 0, sizeof (glt->content_key));
+
 	numgltextures++;
 	SDL_UnlockMutex (texmgr_mutex);
 	return glt;
 }
 
-static void GL_DeleteTexture (gltexture_t *texture);
-
 /*
 ================
 TexMgr_FreeTexture
@@ -383,7 +575,7 @@ TexMgr_FreeTexture
 void TexMgr_FreeTexture (gltexture_t *kill)
 {
 	SDL_LockMutex (texmgr_mutex);
-	gltexture_t *glt;
+	gltexture_t **shared;
 
 	if (kill == NULL)
 	{
@@ -391,32 +583,39 @@ void TexMgr_FreeTexture (gltexture_t *kill)
 		goto unlock_mutex;
 	}
 
-	if (active_gltextures == kill)
+	if (kill->retired || !TexMgr_UnlinkName (kill))
 	{
+		Con_Printf ("TexMgr_FreeTexture: not found\n");
+		goto unlock_mutex;
+	}
+
+	if (kill->prev)
+		kill->prev->next = kill->next;
+	else
 		active_gltextures = kill->next;
-		kill->next = free_gltextures;
-		free_gltextures = kill;
+	if (kill->next)
+		kill->next->prev = kill->prev;
+	numgltextures--;
 
-		GL_DeleteTexture (kill);
-		numgltextures--;
+	// keep the last user of a shareable image around in case the next map loads it again
+	shared = kill->content_key.hash ? HashMap_Lookup (gltexture_t *, texture_content_map, &kill->content_key) : NULL;
+	if (shared && *shared == kill && kill->next_shared == kill && kill->image_view != VK_NULL_HANDLE)
+	{
+		kill->retired = true;
+		kill->prev = NULL;
+		kill->next = retired_gltextures;
+		if (retired_gltextures)
+			retired_gltextures->prev = kill;
+		retired_gltextures = kill;
+		num_retired_gltextures++;
 		goto unlock_mutex;
 	}
 
-	for (glt = active_gltextures; glt; glt = glt->next)
-	{
-		if (glt->next == kill)
-		{
-			glt->next = kill->next;
-			kill->next = free_gltextures;
-			free_gltextures = kill;
+	kill->next = free_gltextures;
+	free_gltextures = kill;
 
-			GL_DeleteTexture (kill);
-			numgltextures--;
-			goto unlock_mutex;
-		}
-	}
+	GL_DeleteTexture (kill);
 
-	Con_Printf ("TexMgr_FreeTexture: not found\n");
 unlock_mutex:
 	SDL_UnlockMutex (texmgr_mutex);
 }
@@ -471,6 +670,7 @@ void TexMgr_DeleteTextureObjects (void)
 	SDL_LockMutex (texmgr_mutex);
 	gltexture_t *glt;
 
+	TexMgr_FreeRetired ();
 	for (glt = active_gltextures; glt; glt = glt->next)
 		GL_DeleteTexture (glt);
 	SDL_UnlockMutex (texmgr_mutex);
@@ -609,9 +809,38 @@ TexMgr_NewGame
 void TexMgr_NewGame (void)
 {
 	TexMgr_FreeTextures (0, TEXPREF_PERSIST); // deletes all textures where TEXPREF_PERSIST is unset
+	TexMgr_FreeRetired ();
+
+	// the palette can change, so nothing loaded so far may be shared with new textures
+	SDL_LockMutex (texmgr_mutex);
+	HashMap_Destroy (texture_content_map);
+	texture_content_map = HashMap_Create (gltexture_key_t, gltexture_t *, &TexMgr_HashContentKey, NULL);
+	SDL_UnlockMutex (texmgr_mutex);
+
 	TexMgr_LoadPalette ();
 }
 
+/*
+================
+TexMgr_NewMap -- frees the images of the previous map the new one didn't load again and reports how many were shared
+================
+*/
+void TexMgr_NewMap (void)
+{
+	const int num_freed = num_retired_gltextures;
+
+	TexMgr_FreeRetired ();
+
+	SDL_LockMutex (texmgr_mutex);
+	if (texture_share_stats.loads)
+		Con_DPrintf (
+			"Texture sharing: %d of %d images reused (%.0f%%, %d from the last map), %.1f MB saved, %d unused images freed\n", texture_share_stats.hits,
+			texture_share_stats.loads, 100.0 * texture_share_stats.hits / texture_share_stats.loads, texture_share_stats.reused_retired,
+			texture_share_stats.bytes_saved / (double)0x100000, num_freed);
+	memset (&texture_share_stats, 0, sizeof (texture_share_stats));
+	SDL_UnlockMutex (texmgr_mutex);
+}
+
 /*
 ================
 TexMgr_Init
@@ -637,6 +866,8 @@ void TexMgr_Init (void)
 		free_gltextures[i].next = &free_gltextures[i + 1];
 	free_gltextures[i].next = NULL;
 	numgltextures = 0;
+	texture_name_map = HashMap_Create (texture_name_key_t, gltexture_t *, &TexMgr_HashNameKey, NULL);
+	texture_content_map = HashMap_Create (gltexture_key_t, gltexture_t *, &TexMgr_HashContentKey, NULL);
 
 	// palette
 	TexMgr_LoadPalette ();
@@ -848,6 +1079,53 @@ static int TexMgr_DeriveStagingSize (int width, int height)
 	return size;
 }
 
+/*
+================
+TexMgr_ImageSize
+================
+*/
+static size_t TexMgr_ImageSize (gltexture_t *glt)
+{
+	if (glt->flags & TEXPREF_MIPMAP)
+		return TexMgr_DeriveStagingSize (glt->width, glt->height);
+	return (size_t)glt->width * glt->height * 4;
+}
+
+/*
+================
+TexMgr_HashData -- MurmurHash64A, never returns 0
+================
+*/
+static uint64_t TexMgr_HashData (const byte *data, size_t size)
+{
+	const uint64_t m = 0xc6a4a7935bd1e995ull;
+	uint64_t	   h = 0x8445d61a4e774912ull ^ (size * m);
+	uint64_t	   k;
+	size_t		   i;
+
+	for (i = 0; i + 8 <= size; i += 8)
+	{
+		memcpy (&k, data + i, sizeof (k));
+		k *= m;
+		k ^= k >> 47;
+		k *= m;
+		h ^= k;
+		h *= m;
+	}
+	if (i < size)
+	{
+		for (k = 0; i < size; i++)
+			k = (k << 8) | data[i];
+		h ^= k;
+		h *= m;
+	}
+
+	h ^= h >> 47;
+	h *= m;
+	h ^= h >> 47;
+	return h ? h : 1;
+}
+
 /*
 ================
 TexMgr_PreMultiply32
@@ -1266,6 +1544,146 @@ static void TexMgr_LoadLightmap (gltexture_t *glt, byte *data)
 	TexMgr_LoadImage32 (glt, (unsigned *)data);
 }
 
+/*
+================
+TexMgr_ContentKey -- returns false for images that can't be shared
+================
+*/
+static qboolean TexMgr_ContentKey (gltexture_t *glt, byte *data, gltexture_key_t *key)
+{
+	extern cvar_t gl_fullbrights;
+	size_t		  size;
+
+	if (!data || (glt->flags & (TEXPREF_OVERWRITE | TEXPREF_WARPIMAGE | TEXPREF_ISLIGHTMAP)))
+		return false;
+
+	if (glt->source_format == SRC_INDEXED)
+		size = (size_t)glt->width * glt->height;
+	else if (glt->source_format == SRC_RGBA)
+		size = (size_t)glt->width * glt->height * 4;
+	else
+		return false;
+
+	memset (key, 0, sizeof (gltexture_key_t));
+	key->hash = TexMgr_HashData (data, size);
+	key->width = glt->width;
+	key->height = glt->height;
+	key->format = glt->source_format;
+	key->flags = glt->flags & ~TEXPREF_PERSIST;
+	if (!(glt->flags & TEXPREF_NOPICMIP))
+	{
+		key->picmip = q_max ((int)gl_picmip.value, 0);
+		key->max_size = (int)gl_max_size.value;
+	}
+	key->nobright = (glt->flags & TEXPREF_NOBRIGHT) && gl_fullbrights.value;
+	return true;
+}
+
+/*
+================
+TexMgr_ShareImage -- makes glt use the image of shared, which has the same content key
+================
+*/
+static void TexMgr_ShareImage (gltexture_t *glt, gltexture_t *shared)
+{
+	glt->width = shared->width;
+	glt->height = shared->height;
+	glt->flags = (glt->flags & ~TEXPREF_ALPHA) | (shared->flags & TEXPREF_ALPHA);
+	glt->content_key = shared->content_key;
+	glt->image = shared->image;
+	glt->image_view = shared->image_view;
+	glt->target_image_view = shared->target_image_view;
+	glt->allocation = shared->allocation;
+	glt->descriptor_set = shared->descriptor_set;
+	glt->frame_buffer = shared->frame_buffer;
+	glt->storage_descriptor_set = shared->storage_descriptor_set;
+	glt->next_shared = shared->next_shared;
+	shared->next_shared = glt;
+
+	if (!shared->retired)
+		return;
+
+	// glt takes over the image of a texture freed with the last map
+	if (shared->prev)
+		shared->prev->next = shared->next;
+	else
+		retired_gltextures = shared->next;
+	if (shared->next)
+		shared->next->prev = shared->prev;
+	num_retired_gltextures--;
+
+	TexMgr_DetachImage (shared);
+	shared->frame_buffer = VK_NULL_HANDLE;
+	shared->target_image_view = VK_NULL_HANDLE;
+	shared->image_view = VK_NULL_HANDLE;
+	shared->image = VK_NULL_HANDLE;
+	shared->allocation = NULL;
+	shared->retired = false;
+	shared->next = free_gltextures;
+	free_gltextures = shared;
+
+	// filter modes may have changed while it was retired
+	TexMgr_SetFilterModes (glt);
+	++texture_share_stats.reused_retired;
+}
+
+/*
+================
+TexMgr_UploadImage -- uses the image of a loaded texture with the same content if there is one, uploads data otherwise
+================
+*/
+static void TexMgr_UploadImage (gltexture_t *glt, byte *data, qboolean shareable)
+{
+	ZEROED_STRUCT (gltexture_key_t, key);
+	gltexture_t **found;
+	gltexture_t	 *shared;
+
+	if (shareable && TexMgr_ContentKey (glt, data, &key))
+	{
+		SDL_LockMutex (texmgr_mutex);
+		++texture_share_stats.loads;
+		found = HashMap_Lookup (gltexture_t *, texture_content_map, &key);
+		if (found && *found != glt)
+		{
+			shared = *found;
+			GL_DeleteTexture (glt);
+			TexMgr_ShareImage (glt, shared);
+			++texture_share_stats.hits;
+			texture_share_stats.bytes_saved += TexMgr_ImageSize (glt);
+			SDL_UnlockMutex (texmgr_mutex);
+			return;
+		}
+		SDL_UnlockMutex (texmgr_mutex);
+	}
+
+	switch (glt->source_format)
+	{
+	case SRC_INDEXED:
+		TexMgr_LoadImage8 (glt, data);
+		break;
+	case SRC_LIGHTMAP:
+		TexMgr_LoadLightmap (glt, data);
+		break;
+	case SRC_RGBA:
+	case SRC_SURF_INDICES:
+	case SRC_RGBA_CUBEMAP:
+		TexMgr_LoadImage32 (glt, (unsigned *)data);
+		break;
+	}
+
+	if (key.hash)
+	{
+		SDL_LockMutex (texmgr_mutex);
+		// if another thread loaded the same image in the meantime this one just stays unshared
+		if (!HashMap_Lookup (gltexture_t *, texture_content_map, &key))
+		{
+			glt->content_key = key;
+			HashMap_Insert (texture_content_map, &key, &glt);
+		}
+		SDL_UnlockMutex (texmgr_mutex);
+	}
+}
+
 /*
 ================
 TexMgr_LoadImage -- the one entry point for loading all textures
@@ -1277,6 +1695,7 @@ gltexture_t *TexMgr_LoadImage (
 {
 	unsigned short crc = 0;
 	gltexture_t	  *glt;
+	qboolean	   is_new = false;
 
 	if (isDedicated)
 		return NULL;
@@ -1303,7 +1722,10 @@ gltexture_t *TexMgr_LoadImage (
 			return glt;
 	}
 	else
+	{
 		glt = TexMgr_NewTexture ();
+		is_new = true;
+	}
 
 	// copy data
 	glt->owner = owner;
@@ -1319,22 +1741,11 @@ gltexture_t *TexMgr_LoadImage (
 	glt->source_width = width;
 	glt->source_height = height;
 	glt->source_crc = crc;
+	if (is_new)
+		TexMgr_LinkName (glt);
 
 	// upload it
-	switch (glt->source_format)
-	{
-	case SRC_INDEXED:
-		TexMgr_LoadImage8 (glt, data);
-		break;
-	case SRC_LIGHTMAP:
-		TexMgr_LoadLightmap (glt, data);
-		break;
-	case SRC_RGBA:
-	case SRC_SURF_INDICES:
-	case SRC_RGBA_CUBEMAP:
-		TexMgr_LoadImage32 (glt, (unsigned *)data);
-		break;
-	}
+	TexMgr_UploadImage (glt, data, true);
 
 	return glt;
 }
@@ -1457,22 +1868,9 @@ void TexMgr_ReloadImage (gltexture_t *glt, int shirt, int pants)
 		data = translated;
 	}
 	//
-	// upload it
+	// upload it, colormapped images are never shared
 	//
-	switch (glt->source_format)
-	{
-	case SRC_INDEXED:
-		TexMgr_LoadImage8 (glt, data);
-		break;
-	case SRC_LIGHTMAP:
-		TexMgr_LoadLightmap (glt, data);
-		break;
-	case SRC_RGBA:
-	case SRC_SURF_INDICES:
-	case SRC_RGBA_CUBEMAP:
-		TexMgr_LoadImage32 (glt, (unsigned *)data);
-		break;
-	}
+	TexMgr_UploadImage (glt, data, !translated);
 
 	Mem_Free (translated);
 	Mem_Free (allocated);
@@ -1565,7 +1963,11 @@ static void GL_DeleteTexture (gltexture_t *texture)
 	if (texture->image_view == VK_NULL_HANDLE)
 		goto mutex_unlock;
 
-	if (in_update_screen)
+	if (TexMgr_DetachImage (texture))
+	{
+		// other textures still use the image
+	}
+	else if (in_update_screen)
 	{
 		garbage_index = num_garbage_textures[current_garbage_index]++;
 		garbage = &texture_garbage[garbage_index][current_garbage_index];
@@ -55,10 +55,28 @@ enum srcformat
 
 typedef struct glheapallocation_s glheapallocation_t;
 
+// identifies an image by its source data and everything that changes how it gets uploaded
+typedef struct gltexture_key_s
+{
+	uint64_t	 hash; // hash of the source data, 0 if the image can't be shared
+	unsigned int width;
+	unsigned int height;
+	unsigned int format;
+	unsigned int flags;
+	int			 picmip;
+	int			 max_size;
+	int			 nobright; // gl_fullbrights state for TEXPREF_NOBRIGHT images
+} gltexture_key_t;
+
 typedef struct gltexture_s
 {
 	// managed by texture manager
 	struct gltexture_s *next;
+	struct gltexture_s *prev;
+	struct gltexture_s *next_same_name; // older texture with the same owner and name
+	struct gltexture_s *next_shared;	// circular list of the textures using this image
+	gltexture_key_t		content_key;
+	qboolean			retired; // no longer referenced, image kept until the next map has loaded
 	qmodel_t		   *owner;
 	// managed by image loading
 	char				name[64];
@@ -106,6 +124,7 @@ void		 TexMgr_FreeTexture (gltexture_t *kill);
 void		 TexMgr_FreeTextures (unsigned int flags, unsigned int mask);
 void		 TexMgr_FreeTexturesForOwner (qmodel_t *owner);
 void		 TexMgr_NewGame (void);
+void		 TexMgr_NewMap (void);
 void		 TexMgr_Init (void);
 void		 TexMgr_DeleteTextureObjects (void);
 void		 TexMgr_CollectGarbage (void);
@@ -87,7 +87,6 @@ typedef struct particle_s
 	vec3_t			   org;
 	float			   color;
 	// drivers never touch the following fields
-	struct particle_s *next;
 	vec3_t			   vel;
 	float			   ramp;
 	float			   die;
@@ -98,6 +97,7 @@ typedef struct particle_s
 #ifdef PSET_SCRIPT
 void PScript_InitParticles (void);
 void PScript_Shutdown (void);
+void PScript_SimulateParticles (void);
 void PScript_DrawParticles (cb_context_t *cbx);
 void PScript_DrawParticles_ShowTris (cb_context_t *cbx);
 struct trailstate_s;
@@ -220,14 +220,15 @@ static const int SECONDARY_CB_MULTIPLICITY[SCBX_NUM] = {
 
 typedef struct cb_context_s
 {
-	VkCommandBuffer	  cb;
-	canvastype		  current_canvas;
-	VkRenderPass	  render_pass;
-	int				  render_pass_index;
-	int				  subpass;
-	vulkan_pipeline_t current_pipeline;
-	uint32_t		  vbo_indices[MAX_BATCH_SIZE];
-	unsigned int	  num_vbo_indices;
+	VkCommandBuffer		 cb;
+	canvastype			 current_canvas;
+	VkRenderPass		 render_pass;
+	int					 render_pass_index;
+	int					 subpass;
+	vulkan_pipeline_t	 current_pipeline;
+	uint32_t			 vbo_indices[MAX_BATCH_SIZE];
+	unsigned int		 num_vbo_indices;
+	struct draw_batch_s *draw_batch; // queued 2D quads, see Draw_AllocateQuad
 } cb_context_t;
 
 typedef struct
@@ -392,6 +393,7 @@ extern vec3_t vup;
 extern vec3_t vpn;
 extern vec3_t vright;
 extern vec3_t r_origin;
+extern float  r_fovx, r_fovy;
 
 //
 // screen size info
@@ -426,6 +428,10 @@ extern cvar_t gl_nocolors;
 // johnfitz -- rendering statistics
 extern atomic_uint32_t rs_brushpolys, rs_aliaspolys, rs_skypolys, rs_particles, rs_fogpolys;
 extern atomic_uint32_t rs_dynamiclightmaps, rs_brushpasses, rs_aliaspasses;
+extern atomic_uint32_t rs_lightpoints, rs_lightgridpoints;
+extern atomic_uint64_t rs_lightgridtime, rs_lighttracetime; // ns spent in R_LightPoint, summed over all threads
+extern atomic_uint32_t rs_occluders, rs_occludedleafs, rs_occludedsurfaces, rs_occludedentities;
+extern atomic_uint32_t rs_2ddrawcalls, rs_2dvertices;
 
 extern atomic_uint64_t total_device_vulkan_allocation_size;
 extern atomic_uint64_t total_host_vulkan_allocation_size;
@@ -462,6 +468,8 @@ typedef struct
 	byte  color[4];
 } basicvertex_t;
 
+basicvertex_t *Draw_AllocateQuad (cb_context_t *cbx, vulkan_pipeline_t pipeline, gltexture_t *texture);
+
 // johnfitz -- moved here from r_brush.c
 extern int gl_lightmap_format;
 
@@ -474,6 +482,9 @@ extern int gl_lightmap_format;
 #define LM_CULL_BLOCK_W 128
 #define LM_CULL_BLOCK_H 256
 
+#define NUM_LIGHTMAP_BUILD_TASKS 64 // slices of the CPU dynamic lightmap rebuilds
+#define NUM_OCCLUSION_BINS		 32 // screen bins of the occlusion depth buffer, rasterized in parallel
+
 typedef struct lm_compute_workgroup_bounds_s
 {
 	float mins[3];
@@ -584,12 +595,31 @@ void GL_PrepareSIMDAndParallelData (void);
 void GLMesh_UploadBuffers (qmodel_t *m, aliashdr_t *hdr, unsigned short *indexes, byte *vertexes, aliasmesh_t *desc, jointpose_t *joints);
 void GLMesh_DeleteAllMeshBuffers (void);
 
-int R_LightPoint (vec3_t p, float ofs, lightcache_t *cache, vec3_t *lightcolor);
+int	 R_LightPoint (vec3_t p, float ofs, lightcache_t *cache, vec3_t *lightcolor);
+void R_BuildLightGrid (void);
+
+void	 R_BuildOccluders (void);
+void	 R_SetupOcclusion (void *unused);
+void	 R_RasterizeOccludersTask (int index, void *unused);
+void	 R_RasterizeOccluders (void);
+qboolean R_OcclusionCullBox (vec3_t mins, vec3_t maxs);
+qboolean R_OcclusionCullSurface (int surfnum);
+void	 R_OcclusionRasterTest_f (void);
+#ifdef _DEBUG
+void R_OcclusionTest_f (void);
+#endif
 
 void GL_SubdivideSurface (msurface_t *fa);
 void R_BuildLightMap (msurface_t *surf, byte *dest, int stride);
 void R_RenderDynamicLightmaps (msurface_t *fa);
-void R_UploadLightmaps (void);
+void R_PrepareDynamicLightmaps (void *unused);
+void R_BuildDynamicLightmapsTask (int index, void *unused);
+void R_BuildDynamicLightmaps (void);
+#ifdef _DEBUG
+void R_LightmapBenchmark_f (void);
+void R_LightmapPackerTest_f (void);
+#endif
+void R_UploadLightmaps (void *unused);
 
 void R_DrawWorld_ShowTris (cb_context_t *cbx);
 void R_DrawBrushModel_ShowTris (cb_context_t *cbx, entity_t *e);
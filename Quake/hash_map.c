@@ -109,6 +109,17 @@ hash_map_t *HashMap_CreateImpl (
 	return map;
 }
 
+/*
+=================
+HashMap_MemoryUsage
+=================
+*/
+size_t HashMap_MemoryUsage (hash_map_t *map)
+{
+	return sizeof (hash_map_t) + (map->hash_size * sizeof (uint32_t)) +
+		   (map->key_value_storage_size * (sizeof (uint32_t) + map->key_size + map->value_size));
+}
+
 /*
 =================
 HashMap_Destroy
@@ -382,5 +393,7 @@ void TestHashMap_f (void)
 	HashMap_BasicTest (false);
 	HashMap_BasicTest (true);
 	HashMap_StressTest ();
+	TestFlatMap ();
+	BenchmarkFlatMap ();
 }
 #endif
\ No newline at end of file
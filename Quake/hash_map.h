@@ -30,6 +30,7 @@ void	*HashMap_LookupImpl (hash_map_t *map, const uint32_t key_size, const void *
 uint32_t HashMap_Size (hash_map_t *map);
 void	*HashMap_GetKeyImpl (hash_map_t *map, uint32_t index);
 void	*HashMap_GetValueImpl (hash_map_t *map, uint32_t index);
+size_t	 HashMap_MemoryUsage (hash_map_t *map);
 
 #define HashMap_Create(key_type, value_type, hasher, comp) HashMap_CreateImpl (sizeof (key_type), sizeof (value_type), hasher, comp)
 #define HashMap_Insert(map, key, value)					   HashMap_InsertImpl (map, sizeof (*key), sizeof (*value), key, value)
@@ -95,6 +95,8 @@ cvar_t campaign = {"campaign", "0", CVAR_NONE};	  // for the 2021 rerelease
 cvar_t horde = {"horde", "0", CVAR_NONE};		  // for the 2021 rerelease
 cvar_t sv_cheats = {"sv_cheats", "0", CVAR_NONE}; // for the 2021 rerelease
 
+static void Host_ServerStats_f (void);
+
 devstats_t		dev_stats, dev_peakstats;
 overflowtimes_t dev_overflows; // this stores the last time overflow messages were displayed, not the last time overflows occured
 
@@ -286,6 +288,7 @@ Host_InitLocal
 void Host_InitLocal (void)
 {
 	Cmd_AddCommand ("version", Host_Version_f);
+	Cmd_AddCommand ("memstats", Mem_Stats_f);
 
 	Host_InitCommands ();
 
@@ -303,6 +306,7 @@ void Host_InitLocal (void)
 
 	Cvar_RegisterVariable (&sys_ticrate);
 	Cvar_RegisterVariable (&serverprofile);
+	Cmd_AddCommand_ClientCommand ("serverstats", Host_ServerStats_f);
 
 	Cvar_RegisterVariable (&fraglimit);
 	Cvar_RegisterVariable (&timelimit);
@@ -618,9 +622,8 @@ void Host_ClearMemory (char *newmap)
 	cls.signon = 0;
 	PR_ClearProgs (&sv.qcvm);
 	Mem_Free (sv.static_entities); // spike -- this is dynamic too, now
-	for (int i = 1; i < MAX_PARTICLETYPES; ++i)
-		Mem_Free (sv.particle_precache[i]);
 	memset (&sv, 0, sizeof (sv));
+	Mem_ArenaReset (MEM_TAG_SERVER);
 
 	CL_FreeState ();
 }
@@ -654,8 +657,9 @@ qboolean Host_FilterTime (float time)
 
 		// Check if we still have more than 2ms till next frame and if so wait for "1ms"
 		// E.g. Windows is not a real time OS and the sleeps can vary in length even with timeBeginPeriod(1)
+		// Dedicated servers already wait for their tick deadline in Host_DedicatedFrame
 		min_frame_time = 1.0f / maxfps;
-		if ((min_frame_time - delta_since_last_frame) > (2.0f / 1000.0f))
+		if (!isDedicated && ((min_frame_time - delta_since_last_frame) > (2.0f / 1000.0f)))
 			SDL_Delay (1);
 
 		if (!cls.timedemo && (delta_since_last_frame < min_frame_time))
@@ -716,9 +720,6 @@ void Host_ServerFrame (void)
 	// run the world state
 	pr_global_struct->frametime = host_frametime;
 
-	// set the time and clear the general datagram
-	SV_ClearDatagram ();
-
 	// check for new clients
 	SV_CheckForNewClients ();
 
@@ -748,6 +749,10 @@ void Host_ServerFrame (void)
 
 	// send all messages to the clients
 	SV_SendClientMessages ();
+
+	// clear the general datagram after sending so that anything written
+	// while reading client packets between frames goes out with this one
+	SV_ClearDatagram ();
 }
 
 static void CL_LoadCSProgs (void)
@@ -867,6 +872,7 @@ void _Host_Frame (double time)
 	Cbuf_Execute ();
 
 	NET_Poll ();
+	LoadBots_Frame ();
 
 	if (cl.sendprespawn)
 	{
@@ -925,6 +931,9 @@ void _Host_Frame (double time)
 	if (host_speeds.value)
 		time1 = Sys_DoubleTime ();
 
+#ifdef PSET_SCRIPT
+	PScript_SimulateParticles (); // on the main thread so it can use worker tasks
+#endif
 	SCR_UpdateScreen (true);
 
 	CL_RunParticles (); // johnfitz -- seperated from rendering
@@ -992,6 +1001,145 @@ void Host_Frame (double time)
 	Con_Printf ("serverprofile: %2i clients %2i msec\n", c, m);
 }
 
+/*
+==================
+Host_ReadClientMessages
+
+Returns false if nothing consumed the pending packets
+==================
+*/
+static qboolean Host_ReadClientMessages (void)
+{
+	if (!sv.active)
+		return false;
+
+	if (setjmp (host_abortserver))
+		return true; // something bad happened, or the server disconnected
+
+	PR_SwitchQCVM (&sv.qcvm);
+	SV_ReadClientMessages ();
+	PR_SwitchQCVM (NULL);
+	return true;
+}
+
+static struct
+{
+	int	   ticks;
+	int	   wakeups;
+	double start_time;
+	double busy_time;
+	double late_sum;
+	double late_max;
+	double jitter_sum;
+	double jitter_max;
+	double frame_sum;
+	double frame_max;
+} tickstats;
+
+/*
+==================
+Host_DedicatedFrame
+
+Blocks on the server sockets until the next tick is due, reading client
+packets as soon as they arrive, then runs the tick
+==================
+*/
+void Host_DedicatedFrame (void)
+{
+	static double last_tick = -1.0;
+	static double next_tick;
+	double		  now = Sys_DoubleTime ();
+
+	if (last_tick < 0.0)
+		last_tick = next_tick = tickstats.start_time = now;
+
+	next_tick += sys_ticrate.value;
+	if (now > (next_tick + sys_ticrate.value))
+		next_tick = now; // fell behind by more than a tick, don't try to catch up
+
+	while (now < next_tick)
+	{
+		if (NET_Sleep (next_tick - now))
+		{
+			const double read_start = Sys_DoubleTime ();
+			++tickstats.wakeups;
+			if (!Host_ReadClientMessages ())
+			{
+				// nobody is going to read the packets, don't spin on them
+				SDL_Delay ((Uint32)ceil ((next_tick - read_start) * 1000.0));
+				now = Sys_DoubleTime ();
+				break;
+			}
+			tickstats.busy_time += Sys_DoubleTime () - read_start;
+		}
+		now = Sys_DoubleTime ();
+	}
+
+	const double late = now - next_tick;
+	const double jitter = fabs ((now - last_tick) - sys_ticrate.value);
+	++tickstats.ticks;
+	tickstats.late_sum += late;
+	tickstats.late_max = q_max (tickstats.late_max, late);
+	tickstats.jitter_sum += jitter;
+	tickstats.jitter_max = q_max (tickstats.jitter_max, jitter);
+
+	Host_Frame (now - last_tick);
+	const double frame_time = Sys_DoubleTime () - now;
+	tickstats.busy_time += frame_time;
+	tickstats.frame_sum += frame_time;
+	tickstats.frame_max = q_max (tickstats.frame_max, frame_time);
+	last_tick = now;
+}
+
+/*
+==================
+Host_ServerStats_f
+
+Clients may ask for these too, the load generator bots do,
+but only the server console can reset them
+==================
+*/
+static void Host_ServerStats_f (void)
+{
+	void (*print_fn) (const char *fmt, ...) FUNCP_PRINTF (1, 2);
+
+	if (cmd_source == src_client)
+		print_fn = SV_ClientPrintf;
+	else
+		print_fn = Con_Printf;
+
+	if (Cmd_Argc () > 1 && !strcmp (Cmd_Argv (1), "reset"))
+	{
+		if (cmd_source != src_command)
+		{
+			print_fn ("serverstats: reset is only allowed from the server console\n");
+			return;
+		}
+		memset (&tickstats, 0, sizeof (tickstats));
+		tickstats.start_time = Sys_DoubleTime ();
+		return;
+	}
+
+	if (!isDedicated)
+	{
+		print_fn ("serverstats: only available on dedicated servers\n");
+		return;
+	}
+
+	if (!tickstats.ticks)
+	{
+		print_fn ("serverstats: no ticks yet\n");
+		return;
+	}
+
+	const double elapsed = Sys_DoubleTime () - tickstats.start_time;
+	print_fn ("%d ticks in %.1f s at %.1f ms per tick\n", tickstats.ticks, elapsed, sys_ticrate.value * 1000.0);
+	print_fn ("busy %.1f%%, %d packet wakeups\n", 100.0 * tickstats.busy_time / q_max (elapsed, 0.001), tickstats.wakeups);
+	print_fn ("frame time:    avg %.3f ms, max %.3f ms\n", 1000.0 * tickstats.frame_sum / tickstats.ticks, 1000.0 * tickstats.frame_max);
+	print_fn ("tick lateness: avg %.3f ms, max %.3f ms\n", 1000.0 * tickstats.late_sum / tickstats.ticks, 1000.0 * tickstats.late_max);
+	print_fn ("tick jitter:   avg %.3f ms, max %.3f ms\n", 1000.0 * tickstats.jitter_sum / tickstats.ticks, 1000.0 * tickstats.jitter_max);
+}
+
 /*
 ====================
 Tests_Init
@@ -1003,6 +1151,10 @@ static void Tests_Init ()
 	Cmd_AddCommand ("test_hash_map", TestHashMap_f);
 	Cmd_AddCommand ("test_gl_heap", GL_HeapTest_f);
 	Cmd_AddCommand ("test_tasks", TestTasks_f);
+	Cmd_AddCommand ("test_prediction", CL_PredictionTest_f);
+	Cmd_AddCommand ("test_lightmaps", R_LightmapBenchmark_f);
+	Cmd_AddCommand ("test_lightmap_packer", R_LightmapPackerTest_f);
+	Cmd_AddCommand ("test_occlusion", R_OcclusionTest_f);
 #endif
 }
 
@@ -1035,6 +1187,7 @@ void Host_Init (void)
 	Mod_Init ();
 	NET_Init ();
 	SV_Init ();
+	LoadBots_Init ();
 
 	Con_Printf ("Exe: " __TIME__ " " __DATE__ "\n");
 
@@ -1086,7 +1239,7 @@ void Host_Init (void)
 		Cbuf_AddText ("exec autoexec.cfg\n");
 		Cbuf_AddText ("stuffcmds");
 		Cbuf_Execute ();
-		if (!sv.active)
+		if (!sv.active && !LoadBots_Active ())
 			Cbuf_AddText ("map start\n");
 	}
 }
@@ -1116,6 +1269,7 @@ void Host_Shutdown (void)
 
 	Host_WriteConfiguration ();
 
+	LoadBots_Shutdown ();
 	NET_Shutdown ();
 
 	if (cls.state != ca_dedicated)
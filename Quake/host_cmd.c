@@ -1483,7 +1483,7 @@ static void Host_Loadgame_f (void)
 					ext = COM_Parse (ext);
 					if (idx >= 1 && idx < MAX_MODELS)
 					{
-						sv.model_precache[idx] = (const char *)q_strdup (com_token);
+						sv.model_precache[idx] = Mem_ArenaStrdup (MEM_TAG_SERVER, com_token);
 						sv.models[idx] = Mod_ForName (sv.model_precache[idx], idx == 1);
 						// if (idx == 1)
 						//	sv.worldmodel = sv.models[idx];
@@ -1496,7 +1496,7 @@ static void Host_Loadgame_f (void)
 					idx = atoi (com_token);
 					ext = COM_Parse (ext);
 					if (idx >= 1 && idx < MAX_MODELS)
-						sv.sound_precache[idx] = (const char *)q_strdup (com_token);
+						sv.sound_precache[idx] = Mem_ArenaStrdup (MEM_TAG_SERVER, com_token);
 				}
 				else if (!strcmp (com_token, "sv.particle_precache"))
 				{
@@ -1505,10 +1505,7 @@ static void Host_Loadgame_f (void)
 					idx = atoi (com_token);
 					ext = COM_Parse (ext);
 					if (idx >= 1 && idx < MAX_PARTICLETYPES)
-					{
-						Mem_Free (sv.particle_precache[idx]);
-						sv.particle_precache[idx] = (const char *)q_strdup (com_token);
-					}
+						sv.particle_precache[idx] = Mem_ArenaStrdup (MEM_TAG_SERVER, com_token);
 				}
 				else if (!strcmp (com_token, "sv.serverflags") || !strcmp (com_token, "svs.serverflags"))
 				{
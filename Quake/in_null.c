@@ -0,0 +1,74 @@
+/*
+ * in_null.c -- input stubs for the dedicated server build
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "quakedef.h"
+
+char	  key_lines[CMDLINES][MAXCMDLINE];
+int		  key_linepos;
+int		  key_insert;
+double	  key_blinktime;
+int		  edit_line;
+int		  history_line;
+keydest_t key_dest;
+qboolean  keydown[MAX_KEYS];
+qboolean  chat_team;
+
+void IN_Init (void) {}
+
+void IN_Shutdown (void) {}
+
+void IN_Activate () {}
+
+void IN_Deactivate (qboolean free_cursor) {}
+
+void IN_Commands (void) {}
+
+void IN_SendKeyEvents (void) {}
+
+void IN_UpdateInputMode (void) {}
+
+void Key_Init (void) {}
+
+void Key_UpdateForDest (void) {}
+
+void Key_WriteBindings (FILE *f) {}
+
+void Key_BeginInputGrab (void) {}
+
+void Key_EndInputGrab (void) {}
+
+void Key_GetGrabbedInput (int *lastkey, int *lastchar)
+{
+	if (lastkey)
+		*lastkey = 0;
+	if (lastchar)
+		*lastchar = 0;
+}
+
+const char *Key_GetChatBuffer (void)
+{
+	return "";
+}
+
+int Key_GetChatMsgLen (void)
+{
+	return 0;
+}
+
+void History_Shutdown (void) {}
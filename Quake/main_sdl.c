@@ -65,7 +65,11 @@ int main (int argc, char *argv[])
 
 	COM_InitArgv (parms.argc, parms.argv);
 
+#ifdef SERVERONLY
+	isDedicated = true;
+#else
 	isDedicated = (COM_CheckParm ("-dedicated") != 0);
+#endif
 
 	Sys_InitSDL ();
 
@@ -90,20 +94,7 @@ int main (int argc, char *argv[])
 	if (isDedicated)
 	{
 		while (1)
-		{
-			newtime = Sys_DoubleTime ();
-			time = newtime - oldtime;
-
-			while (time < sys_ticrate.value)
-			{
-				SDL_Delay (1);
-				newtime = Sys_DoubleTime ();
-				time = newtime - oldtime;
-			}
-
-			Host_Frame (time);
-			oldtime = newtime;
-		}
+			Host_DedicatedFrame ();
 	}
 	else
 		while (1)
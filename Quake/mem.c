@@ -50,6 +50,8 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 size_t THREAD_LOCAL thread_stack_alloc_size = 0;
 size_t				max_thread_stack_alloc_size = 0;
 
+static SDL_mutex *arena_mutex;
+
 /*
 ====================
 Mem_Init
@@ -57,6 +59,7 @@ Mem_Init
 */
 void Mem_Init ()
 {
+	arena_mutex = SDL_CreateMutex ();
 #ifdef _WIN32
 	max_thread_stack_alloc_size = MAX_STACK_ALLOC_SIZE;
 #else /* unix: */
@@ -134,3 +137,186 @@ void Mem_Free (const void *ptr)
 	free ((void *)ptr);
 #endif
 }
+
+/*
+==============================================================================
+
+MEMORY ARENAS
+
+Each tag owns a list of pages that allocations are bumped from. Resetting a tag
+rewinds its pages instead of freeing them, so the next level reuses the same
+memory. Allocations too large to share a page get a page of their own, which
+is released on reset.
+
+==============================================================================
+*/
+
+#define ARENA_PAGE_SIZE		 (4 * 1024 * 1024)
+#define ARENA_MAX_SHARED	 (ARENA_PAGE_SIZE / 4)
+#define ARENA_ALIGNMENT		 16
+#define ARENA_ALIGN(size)	 (((size) + (ARENA_ALIGNMENT - 1)) & ~(size_t)(ARENA_ALIGNMENT - 1))
+#define ARENA_PAGE_HEADER	 ARENA_ALIGN (sizeof (arena_page_t))
+
+typedef struct arena_page_s
+{
+	struct arena_page_s *next;
+	size_t				 size;
+	size_t				 used;
+} arena_page_t;
+
+typedef struct
+{
+	const char	 *name;
+	arena_page_t *pages;	  // first page is the one being allocated from
+	arena_page_t *free_pages; // standard sized pages kept over a reset
+	arena_page_t *large;	  // dedicated pages for large allocations
+	size_t		  used;
+	size_t		  reserved;
+	size_t		  high_water;
+	size_t		  num_allocs;
+	size_t		  num_resets;
+} mem_arena_t;
+
+static mem_arena_t arenas[NUM_MEM_TAGS] = {{"world"}, {"server"}, {"client"}};
+
+/*
+====================
+Mem_ArenaNewPage
+====================
+*/
+static arena_page_t *Mem_ArenaNewPage (mem_arena_t *arena, const size_t size)
+{
+	arena_page_t *page = (arena_page_t *)Mem_AllocNonZero (ARENA_PAGE_HEADER + size);
+	if (!page)
+		Sys_Error ("Mem_ArenaNewPage: failed to allocate %" SDL_PRIu64 " bytes for %s", (uint64_t)size, arena->name);
+	page->size = size;
+	page->used = 0;
+	arena->reserved += size;
+	return page;
+}
+
+/*
+====================
+Mem_ArenaAllocNonZero
+====================
+*/
+void *Mem_ArenaAllocNonZero (const memtag_t tag, const size_t size)
+{
+	mem_arena_t	 *arena = &arenas[tag];
+	const size_t  aligned_size = ARENA_ALIGN (q_max (size, (size_t)1));
+	arena_page_t *page;
+	byte		 *ptr;
+
+	SDL_LockMutex (arena_mutex);
+	if (aligned_size > ARENA_MAX_SHARED)
+	{
+		page = Mem_ArenaNewPage (arena, aligned_size);
+		page->next = arena->large;
+		arena->large = page;
+	}
+	else if (!arena->pages || (arena->pages->used + aligned_size) > arena->pages->size)
+	{
+		if (arena->free_pages)
+		{
+			page = arena->free_pages;
+			arena->free_pages = page->next;
+		}
+		else
+			page = Mem_ArenaNewPage (arena, ARENA_PAGE_SIZE);
+		page->next = arena->pages;
+		arena->pages = page;
+	}
+	else
+		page = arena->pages;
+
+	ptr = (byte *)page + ARENA_PAGE_HEADER + page->used;
+	page->used += aligned_size;
+	arena->used += aligned_size;
+	arena->high_water = q_max (arena->high_water, arena->used);
+	++arena->num_allocs;
+	SDL_UnlockMutex (arena_mutex);
+
+	return ptr;
+}
+
+/*
+====================
+Mem_ArenaAlloc
+====================
+*/
+void *Mem_ArenaAlloc (const memtag_t tag, const size_t size)
+{
+	void *ptr = Mem_ArenaAllocNonZero (tag, size);
+	memset (ptr, 0, size);
+	return ptr;
+}
+
+/*
+====================
+Mem_ArenaStrdup
+====================
+*/
+char *Mem_ArenaStrdup (const memtag_t tag, const char *str)
+{
+	const size_t len = strlen (str) + 1;
+	char		*newstr = (char *)Mem_ArenaAllocNonZero (tag, len);
+	memcpy (newstr, str, len);
+	return newstr;
+}
+
+/*
+====================
+Mem_ArenaReset
+====================
+*/
+void Mem_ArenaReset (const memtag_t tag)
+{
+	mem_arena_t *arena = &arenas[tag];
+
+	SDL_LockMutex (arena_mutex);
+	while (arena->pages)
+	{
+		arena_page_t *page = arena->pages;
+		arena->pages = page->next;
+		page->used = 0;
+		page->next = arena->free_pages;
+		arena->free_pages = page;
+	}
+	while (arena->large)
+	{
+		arena_page_t *page = arena->large;
+		arena->large = page->next;
+		arena->reserved -= page->size;
+		Mem_Free (page);
+	}
+	if (arena->used)
+		++arena->num_resets;
+	arena->used = 0;
+	SDL_UnlockMutex (arena_mutex);
+}
+
+/*
+====================
+Mem_Stats_f
+====================
+*/
+void Mem_Stats_f (void)
+{
+	Con_Printf ("arena       used   reserved high water    allocs resets\n");
+	SDL_LockMutex (arena_mutex);
+	for (int i = 0; i < NUM_MEM_TAGS; ++i)
+	{
+		const mem_arena_t *arena = &arenas[i];
+		Con_Printf (
+			"%-7s %7.1f MB %7.1f MB %7.1f MB %9" SDL_PRIu64 " %6" SDL_PRIu64 "\n", arena->name, arena->used / (1024.0 * 1024.0),
+			arena->reserved / (1024.0 * 1024.0), arena->high_water / (1024.0 * 1024.0), (uint64_t)arena->num_allocs, (uint64_t)arena->num_resets);
+	}
+	SDL_UnlockMutex (arena_mutex);
+#if defined(USE_MI_MALLOC)
+	size_t current_rss, peak_rss, current_commit, peak_commit;
+	mi_process_info (NULL, NULL, NULL, &current_rss, &peak_rss, &current_commit, &peak_commit, NULL);
+	Con_Printf (
+		"process rss %.1f MB (peak %.1f MB), committed %.1f MB (peak %.1f MB)\n", current_rss / (1024.0 * 1024.0), peak_rss / (1024.0 * 1024.0),
+		current_commit / (1024.0 * 1024.0), peak_commit / (1024.0 * 1024.0));
+#endif
+}
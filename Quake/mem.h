@@ -32,6 +32,22 @@ void *Mem_AllocNonZero (const size_t size);
 void *Mem_Realloc (void *ptr, const size_t size);
 void  Mem_Free (const void *ptr);
 
+// Map lifetime data is bump allocated from per tag arenas and released all at once with Mem_ArenaReset.
+// Memory returned by Mem_ArenaAlloc is zeroed and must never be passed to Mem_Free/Mem_Realloc.
+typedef enum
+{
+	MEM_TAG_WORLD,	// brush models, reset by Mod_ClearAll
+	MEM_TAG_SERVER, // server level, reset by Host_ClearMemory
+	MEM_TAG_CLIENT, // client level, reset by CL_FreeState
+	NUM_MEM_TAGS
+} memtag_t;
+
+void *Mem_ArenaAlloc (const memtag_t tag, const size_t size);
+void *Mem_ArenaAllocNonZero (const memtag_t tag, const size_t size);
+char *Mem_ArenaStrdup (const memtag_t tag, const char *str);
+void  Mem_ArenaReset (const memtag_t tag);
+void  Mem_Stats_f (void);
+
 #define SAFE_FREE(ptr)  \
 	do                  \
 	{                   \
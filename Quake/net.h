@@ -56,6 +56,9 @@ struct qsocket_s *NET_CheckNewConnections (void);
 struct qsocket_s *NET_Connect (const char *host);
 // called by client to connect to a host.  Returns -1 if not able to
 
+struct qsocket_s *NET_ConnectDirect (const char *host);
+// like NET_Connect, but skips the server list lookup
+
 double		NET_QSocketGetTime (const struct qsocket_s *sock);
 const char *NET_QSocketGetTrueAddressString (const struct qsocket_s *sock);
 const char *NET_QSocketGetMaskedAddressString (const struct qsocket_s *sock);
@@ -102,6 +105,16 @@ void NET_Close (struct qsocket_s *sock);
 
 void NET_Poll (void);
 
+// Blocks until a packet arrives on a listening socket or timeout seconds
+// have passed. Returns true if there is something to read.
+qboolean NET_Sleep (double timeout);
+
+// Load generator bots, see net_loadbot.c
+void	 LoadBots_Init (void);
+void	 LoadBots_Frame (void);
+void	 LoadBots_Shutdown (void);
+qboolean LoadBots_Active (void);
+
 // Server list related globals:
 extern qboolean slistInProgress;
 extern qboolean slist_silent;
@@ -0,0 +1,1006 @@
+/*
+ * net_loadbot.c -- headless load generator clients
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/*
+Each bot is a full network client without any client state: it goes through
+the signon, parses (and throws away) everything the server sends and sends
+clc_move at loadbot_rate. Bots never advertise protocol extensions, so the
+server talks plain 15/666/999 to them.
+
+Run them from a separate process, e.g.
+	vkquake-dedicated -port 26001 +sys_ticrate 0.01 +loadbots 16 192.168.0.10
+*/
+
+#include "quakedef.h"
+
+#define MAX_LOADBOTS	   255
+#define MAX_SCRIPT_STEPS   256
+#define SERVERSTATS_WINDOW 2.0
+
+typedef struct
+{
+	float duration;
+	float forwardmove, sidemove, upmove;
+	float yawspeed;
+	float pitch;
+	int	  buttons;
+	int	  impulse;
+} loadbot_step_t;
+
+typedef enum
+{
+	LB_CONNECTED,
+	LB_ACTIVE,
+	LB_DROPPED,
+} loadbot_state_t;
+
+typedef struct
+{
+	struct qsocket_s *sock;
+	loadbot_state_t state;
+	int				signon;
+	int				protocol;
+	unsigned int	protocolflags;
+	float			servertime;
+
+	sizebuf_t message;
+	byte	  message_buf[1024];
+
+	// movement
+	unsigned int   seed;
+	double		   next_move;
+	double		   step_end;
+	int			   step;
+	loadbot_step_t move;
+	float		   yaw;
+
+	// stats since the last reset
+	int	   snapshots;
+	double last_snapshot;
+	double interval_sum;
+	double interval_max;
+	int	   bytes_in;
+	int	   bytes_out;
+} loadbot_t;
+
+static cvar_t loadbot_rate = {"loadbot_rate", "72", CVAR_NONE};
+static cvar_t loadbot_script = {"loadbot_script", "", CVAR_NONE};
+
+static loadbot_t *loadbots;
+static int		  num_loadbots;
+static double	  stats_start;
+static double	  serverstats_until;
+
+static loadbot_step_t script_steps[MAX_SCRIPT_STEPS];
+static int			  num_script_steps;
+
+/*
+====================
+LoadBot_Random
+====================
+*/
+static unsigned int LoadBot_Random (loadbot_t *bot)
+{
+	bot->seed = bot->seed * 1103515245u + 12345u;
+	return (bot->seed >> 16) & 0x7fff;
+}
+
+/*
+====================
+LoadBot_LoadScript
+
+One step per line: duration forward side up yawspeed [pitch] [buttons] [impulse]
+====================
+*/
+static void LoadBot_LoadScript (const char *name)
+{
+	char *data, *line, *next;
+
+	num_script_steps = 0;
+	if (!*name)
+		return;
+
+	data = (char *)COM_LoadFile (name, NULL);
+	if (!data)
+	{
+		Con_Printf ("loadbots: couldn't load script %s, using random moves\n", name);
+		return;
+	}
+
+	for (line = data; line && *line && num_script_steps < MAX_SCRIPT_STEPS; line = next)
+	{
+		loadbot_step_t *step = &script_steps[num_script_steps];
+
+		next = strchr (line, '\n');
+		if (next)
+			*next++ = 0;
+		if (line[0] == '/' && line[1] == '/')
+			continue;
+
+		memset (step, 0, sizeof (*step));
+		if (sscanf (
+				line, "%f %f %f %f %f %f %i %i", &step->duration, &step->forwardmove, &step->sidemove, &step->upmove, &step->yawspeed, &step->pitch,
+				&step->buttons, &step->impulse) >= 5 &&
+			step->duration > 0.0f)
+			++num_script_steps;
+	}
+	Mem_Free (data);
+
+	Con_Printf ("loadbots: %d script steps from %s\n", num_script_steps, name);
+}
+
+/*
+====================
+LoadBot_NextStep
+====================
+*/
+static void LoadBot_NextStep (loadbot_t *bot, double now)
+{
+	if (num_script_steps)
+	{
+		bot->move = script_steps[bot->step++ % num_script_steps];
+		bot->step_end = now + bot->move.duration;
+		return;
+	}
+
+	// wander around: run in some direction while turning, and every now and then jump or shoot
+	memset (&bot->move, 0, sizeof (bot->move));
+	bot->move.forwardmove = (LoadBot_Random (bot) % 3) * 200.0f;
+	bot->move.sidemove = ((int)(LoadBot_Random (bot) % 3) - 1) * 350.0f;
+	bot->move.yawspeed = (float)((int)(LoadBot_Random (bot) % 361) - 180);
+	if (LoadBot_Random (bot) % 10 == 0)
+		bot->move.buttons |= 2;
+	if (LoadBot_Random (bot) % 5 == 0)
+		bot->move.buttons |= 1;
+	bot->step_end = now + 0.5 + (LoadBot_Random (bot) % 1500) / 1000.0;
+}
+
+/*
+====================
+LoadBot_Drop
+====================
+*/
+static void LoadBot_Drop (loadbot_t *bot, const char *reason)
+{
+	if (bot->state == LB_DROPPED)
+		return;
+
+	Con_Printf ("loadbot %d: %s\n", (int)(bot - loadbots), reason);
+	bot->state = LB_DROPPED;
+	if (bot->sock)
+	{
+		NET_Close (bot->sock);
+		bot->sock = NULL;
+	}
+}
+
+/*
+====================
+LoadBot_StringCmd
+====================
+*/
+static void LoadBot_StringCmd (loadbot_t *bot, const char *cmd)
+{
+	MSG_WriteByte (&bot->message, clc_stringcmd);
+	MSG_WriteString (&bot->message, cmd);
+}
+
+/*
+====================
+LoadBot_SignonReply
+====================
+*/
+static void LoadBot_SignonReply (loadbot_t *bot)
+{
+	switch (bot->signon)
+	{
+	case 1:
+		LoadBot_StringCmd (bot, va ("name \"loadbot%d\"\n", (int)(bot - loadbots)));
+		LoadBot_StringCmd (bot, "prespawn");
+		break;
+
+	case 2:
+		LoadBot_StringCmd (bot, va ("color %d %d\n", (int)(bot - loadbots) % 14, (int)(bot - loadbots) % 14));
+		LoadBot_StringCmd (bot, "spawn ");
+		break;
+
+	case 3:
+		LoadBot_StringCmd (bot, "begin");
+		break;
+
+	case 4:
+		bot->state = LB_ACTIVE;
+		break;
+	}
+}
+
+/*
+====================
+LoadBot_StuffText
+
+Only reacts to what a real client needs to stay connected
+====================
+*/
+static void LoadBot_StuffText (loadbot_t *bot, const char *text)
+{
+	char line[1024];
+
+	while (*text)
+	{
+		size_t len = strcspn (text, "\n;");
+
+		q_strlcpy (line, text, q_min (len + 1, sizeof (line)));
+		text += len;
+		if (*text)
+			++text;
+
+		if (!strcmp (line, "reconnect"))
+			bot->signon = 0;
+		else if (!strcmp (line, "cmd pext"))
+			LoadBot_StringCmd (bot, "pext"); // no extensions
+		else if (!strncmp (line, "cmd ", 4))
+			LoadBot_StringCmd (bot, line + 4);
+	}
+}
+
+/*
+====================
+LoadBot_ParseBaseline
+====================
+*/
+static void LoadBot_ParseBaseline (loadbot_t *bot, int version)
+{
+	int i;
+	int bits = (version == 2) ? MSG_ReadByte () : 0;
+
+	if (bits & B_LARGEMODEL)
+		MSG_ReadShort ();
+	else
+		MSG_ReadByte ();
+	if (bits & B_LARGEFRAME)
+		MSG_ReadShort ();
+	else
+		MSG_ReadByte ();
+	MSG_ReadByte (); // colormap
+	MSG_ReadByte (); // skin
+	for (i = 0; i < 3; i++)
+	{
+		MSG_ReadCoord (bot->protocolflags);
+		MSG_ReadAngle (bot->protocolflags);
+	}
+	if (bits & B_ALPHA)
+		MSG_ReadByte ();
+	if (bits & B_SCALE)
+		MSG_ReadByte ();
+}
+
+/*
+====================
+LoadBot_ParseUpdate
+====================
+*/
+static void LoadBot_ParseUpdate (loadbot_t *bot, int bits)
+{
+	if (bot->signon == SIGNONS - 1)
+	{ // first update is the final signon stage
+		bot->signon = SIGNONS;
+		LoadBot_SignonReply (bot);
+	}
+
+	if (bits & U_MOREBITS)
+		bits |= MSG_ReadByte () << 8;
+	if (bot->protocol == PROTOCOL_FITZQUAKE || bot->protocol == PROTOCOL_RMQ)
+	{
+		if (bits & U_EXTEND1)
+			bits |= MSG_ReadByte () << 16;
+		if (bits & U_EXTEND2)
+			bits |= MSG_ReadByte () << 24;
+	}
+
+	if (bits & U_LONGENTITY)
+		MSG_ReadShort ();
+	else
+		MSG_ReadByte ();
+	if (bits & U_MODEL)
+		MSG_ReadByte ();
+	if (bits & U_FRAME)
+		MSG_ReadByte ();
+	if (bits & U_COLORMAP)
+		MSG_ReadByte ();
+	if (bits & U_SKIN)
+		MSG_ReadByte ();
+	if (bits & U_EFFECTS)
+		MSG_ReadByte ();
+	if (bits & U_ORIGIN1)
+		MSG_ReadCoord (bot->protocolflags);
+	if (bits & U_ANGLE1)
+		MSG_ReadAngle (bot->protocolflags);
+	if (bits & U_ORIGIN2)
+		MSG_ReadCoord (bot->protocolflags);
+	if (bits & U_ANGLE2)
+		MSG_ReadAngle (bot->protocolflags);
+	if (bits & U_ORIGIN3)
+		MSG_ReadCoord (bot->protocolflags);
+	if (bits & U_ANGLE3)
+		MSG_ReadAngle (bot->protocolflags);
+
+	if (bot->protocol == PROTOCOL_FITZQUAKE || bot->protocol == PROTOCOL_RMQ)
+	{
+		if (bits & U_ALPHA)
+			MSG_ReadByte ();
+		if (bits & U_SCALE)
+			MSG_ReadByte ();
+		if (bits & U_FRAME2)
+			MSG_ReadByte ();
+		if (bits & U_MODEL2)
+			MSG_ReadByte ();
+		if (bits & U_LERPFINISH)
+			MSG_ReadByte ();
+	}
+	else if (bits & U_TRANS)
+	{ // nehahra
+		if (MSG_ReadFloat () == 2)
+		{
+			MSG_ReadFloat ();
+			MSG_ReadFloat ();
+		}
+		else
+			MSG_ReadFloat ();
+	}
+}
+
+/*
+====================
+LoadBot_ParseClientdata
+====================
+*/
+static void LoadBot_ParseClientdata (void)
+{
+	int i;
+	int bits = (unsigned short)MSG_ReadShort ();
+
+	if (bits & SU_EXTEND1)
+		bits |= MSG_ReadByte () << 16;
+	if (bits & SU_EXTEND2)
+		bits |= MSG_ReadByte () << 24;
+
+	if (bits & SU_VIEWHEIGHT)
+		MSG_ReadChar ();
+	if (bits & SU_IDEALPITCH)
+		MSG_ReadChar ();
+	for (i = 0; i < 3; i++)
+	{
+		if (bits & (SU_PUNCH1 << i))
+			MSG_ReadChar ();
+		if (bits & (SU_VELOCITY1 << i))
+			MSG_ReadChar ();
+	}
+	MSG_ReadLong (); // items
+	if (bits & SU_WEAPONFRAME)
+		MSG_ReadByte ();
+	if (bits & SU_ARMOR)
+		MSG_ReadByte ();
+	if (bits & SU_WEAPON)
+		MSG_ReadByte ();
+	MSG_ReadShort (); // health
+	MSG_ReadByte ();  // ammo
+	for (i = 0; i < 4; i++)
+		MSG_ReadByte ();
+	MSG_ReadByte (); // active weapon
+	if (bits & SU_WEAPON2)
+		MSG_ReadByte ();
+	if (bits & SU_ARMOR2)
+		MSG_ReadByte ();
+	if (bits & SU_AMMO2)
+		MSG_ReadByte ();
+	if (bits & SU_SHELLS2)
+		MSG_ReadByte ();
+	if (bits & SU_NAILS2)
+		MSG_ReadByte ();
+	if (bits & SU_ROCKETS2)
+		MSG_ReadByte ();
+	if (bits & SU_CELLS2)
+		MSG_ReadByte ();
+	if (bits & SU_WEAPONFRAME2)
+		MSG_ReadByte ();
+	if (bits & SU_WEAPONALPHA)
+		MSG_ReadByte ();
+}
+
+/*
+====================
+LoadBot_ParseSound
+====================
+*/
+static void LoadBot_ParseSound (loadbot_t *bot)
+{
+	int field_mask = MSG_ReadByte ();
+
+	if (field_mask & SND_FTE_MOREFLAGS)
+		field_mask |= MSG_ReadByte () << 8;
+	if (field_mask & SND_VOLUME)
+		MSG_ReadByte ();
+	if (field_mask & SND_ATTENUATION)
+		MSG_ReadByte ();
+	if (field_mask & SND_LARGEENTITY)
+	{
+		MSG_ReadShort ();
+		MSG_ReadByte ();
+	}
+	else
+		MSG_ReadShort ();
+	if (field_mask & SND_LARGESOUND)
+		MSG_ReadShort ();
+	else
+		MSG_ReadByte ();
+	MSG_ReadCoord (bot->protocolflags);
+	MSG_ReadCoord (bot->protocolflags);
+	MSG_ReadCoord (bot->protocolflags);
+}
+
+/*
+====================
+LoadBot_ReadCoords
+====================
+*/
+static void LoadBot_ReadCoords (loadbot_t *bot, int count)
+{
+	while (count-- > 0)
+		MSG_ReadCoord (bot->protocolflags);
+}
+
+/*
+====================
+LoadBot_ParseTEnt
+====================
+*/
+static qboolean LoadBot_ParseTEnt (loadbot_t *bot)
+{
+	switch (MSG_ReadByte ())
+	{
+	case TE_WIZSPIKE:
+	case TE_KNIGHTSPIKE:
+	case TE_SPIKE:
+	case TE_SUPERSPIKE:
+	case TE_GUNSHOT:
+	case TE_EXPLOSION:
+	case TE_TAREXPLOSION:
+	case TE_LAVASPLASH:
+	case TE_TELEPORT:
+		LoadBot_ReadCoords (bot, 3);
+		return true;
+	case TE_LIGHTNING1:
+	case TE_LIGHTNING2:
+	case TE_LIGHTNING3:
+	case TE_BEAM:
+		MSG_ReadShort ();
+		LoadBot_ReadCoords (bot, 6);
+		return true;
+	case TE_EXPLOSION2:
+		LoadBot_ReadCoords (bot, 3);
+		MSG_ReadByte ();
+		MSG_ReadByte ();
+		return true;
+	case TEDP_PARTICLERAIN:
+	case TEDP_PARTICLESNOW:
+		LoadBot_ReadCoords (bot, 9);
+		MSG_ReadShort ();
+		MSG_ReadByte ();
+		return true;
+	}
+	return false;
+}
+
+/*
+====================
+LoadBot_ParseServerInfo
+====================
+*/
+static qboolean LoadBot_ParseServerInfo (loadbot_t *bot)
+{
+	const char *str;
+	int			i;
+
+	bot->protocol = MSG_ReadLong ();
+	if (bot->protocol != PROTOCOL_NETQUAKE && bot->protocol != PROTOCOL_FITZQUAKE && bot->protocol != PROTOCOL_RMQ)
+		return false;
+	bot->protocolflags = (bot->protocol == PROTOCOL_RMQ) ? (unsigned int)MSG_ReadLong () : 0;
+
+	MSG_ReadByte ();   // maxclients
+	MSG_ReadByte ();   // gametype
+	MSG_ReadString (); // levelname
+	for (i = 0; i < 2; i++)
+	{ // model and sound precaches
+		do
+			str = MSG_ReadString ();
+		while (*str && !msg_badread);
+	}
+	bot->signon = 0;
+	return true;
+}
+
+/*
+====================
+LoadBot_ParseMessage
+
+Walks the whole message in net_message the same way CL_ParseServerMessage does
+====================
+*/
+static void LoadBot_ParseMessage (loadbot_t *bot)
+{
+	const char *str;
+	int			cmd, i;
+	qboolean	echo = (bot == loadbots) && (realtime < serverstats_until);
+
+	MSG_BeginReading ();
+	while (bot->state != LB_DROPPED)
+	{
+		if (msg_badread)
+		{
+			LoadBot_Drop (bot, "bad server message");
+			return;
+		}
+
+		cmd = MSG_ReadByte ();
+		if (cmd == -1)
+			return;
+
+		if (cmd & U_SIGNAL)
+		{
+			LoadBot_ParseUpdate (bot, cmd & 127);
+			continue;
+		}
+
+		switch (cmd)
+		{
+		default:
+			LoadBot_Drop (bot, va ("unhandled server message %d", cmd));
+			return;
+
+		case svc_nop:
+		case svc_killedmonster:
+		case svc_foundsecret:
+		case svc_intermission:
+		case svc_sellscreen:
+		case svc_bf:
+			break;
+
+		case svc_time:
+			bot->servertime = MSG_ReadFloat ();
+			if (bot->last_snapshot > 0.0)
+			{
+				const double interval = Sys_DoubleTime () - bot->last_snapshot;
+				bot->interval_sum += interval;
+				bot->interval_max = q_max (bot->interval_max, interval);
+			}
+			bot->last_snapshot = Sys_DoubleTime ();
+			++bot->snapshots;
+			break;
+
+		case svc_clientdata:
+			LoadBot_ParseClientdata ();
+			break;
+
+		case svc_version:
+			bot->protocol = MSG_ReadLong ();
+			break;
+
+		case svc_disconnect:
+			LoadBot_Drop (bot, "server disconnected");
+			return;
+
+		case svc_print:
+			str = MSG_ReadString ();
+			if (echo)
+				Con_Printf ("%s", str);
+			break;
+
+		case svc_centerprint:
+		case svc_finale:
+		case svc_cutscene:
+		case svc_skybox:
+		case svc_achievement:
+			MSG_ReadString ();
+			break;
+
+		case svc_stufftext:
+			LoadBot_StuffText (bot, MSG_ReadString ());
+			break;
+
+		case svc_damage:
+			MSG_ReadByte ();
+			MSG_ReadByte ();
+			LoadBot_ReadCoords (bot, 3);
+			break;
+
+		case svc_serverinfo:
+			if (!LoadBot_ParseServerInfo (bot))
+			{
+				LoadBot_Drop (bot, "unsupported server protocol");
+				return;
+			}
+			break;
+
+		case svc_setangle:
+			MSG_ReadAngle (bot->protocolflags);
+			bot->yaw = MSG_ReadAngle (bot->protocolflags);
+			MSG_ReadAngle (bot->protocolflags);
+			break;
+
+		case svc_setview:
+		case svc_stopsound:
+			MSG_ReadShort ();
+			break;
+
+		case svc_lightstyle:
+		case svc_updatename:
+			MSG_ReadByte ();
+			MSG_ReadString ();
+			break;
+
+		case svc_sound:
+			LoadBot_ParseSound (bot);
+			break;
+
+		case svc_updatefrags:
+			MSG_ReadByte ();
+			MSG_ReadShort ();
+			break;
+
+		case svc_updatecolors:
+		case svc_cdtrack:
+			MSG_ReadByte ();
+			MSG_ReadByte ();
+			break;
+
+		case svc_particle:
+			LoadBot_ReadCoords (bot, 3);
+			for (i = 0; i < 5; i++)
+				MSG_ReadByte (); // dir, count, color
+			break;
+
+		case svc_spawnbaseline:
+			MSG_ReadShort ();
+			LoadBot_ParseBaseline (bot, 1);
+			break;
+
+		case svc_spawnbaseline2:
+			MSG_ReadShort ();
+			LoadBot_ParseBaseline (bot, 2);
+			break;
+
+		case svc_spawnstatic:
+			LoadBot_ParseBaseline (bot, 1);
+			break;
+
+		case svc_spawnstatic2:
+			LoadBot_ParseBaseline (bot, 2);
+			break;
+
+		case svc_temp_entity:
+			if (!LoadBot_ParseTEnt (bot))
+			{
+				LoadBot_Drop (bot, "unhandled temp entity");
+				return;
+			}
+			break;
+
+		case svc_setpause:
+			MSG_ReadByte ();
+			break;
+
+		case svc_signonnum:
+			bot->signon = MSG_ReadByte ();
+			LoadBot_SignonReply (bot);
+			break;
+
+		case svc_updatestat:
+			MSG_ReadByte ();
+			MSG_ReadLong ();
+			break;
+
+		case svc_spawnstaticsound:
+			LoadBot_ReadCoords (bot, 3);
+			MSG_ReadByte ();
+			MSG_ReadByte ();
+			MSG_ReadByte ();
+			break;
+
+		case svc_spawnstaticsound2:
+			LoadBot_ReadCoords (bot, 3);
+			MSG_ReadShort ();
+			MSG_ReadByte ();
+			MSG_ReadByte ();
+			break;
+
+		case svc_fog:
+			for (i = 0; i < 4; i++)
+				MSG_ReadByte ();
+			MSG_ReadShort ();
+			break;
+
+		case svc_localsound:
+			if (MSG_ReadByte () & SND_LARGESOUND)
+				MSG_ReadShort ();
+			else
+				MSG_ReadByte ();
+			break;
+		}
+	}
+}
+
+/*
+====================
+LoadBot_SendMove
+====================
+*/
+static void LoadBot_SendMove (loadbot_t *bot, double now, double frametime)
+{
+	sizebuf_t buf;
+	byte	  data[64];
+	int		  i;
+
+	if (now >= bot->step_end)
+		LoadBot_NextStep (bot, now);
+	bot->yaw = anglemod (bot->yaw + bot->move.yawspeed * frametime);
+
+	buf.maxsize = sizeof (data);
+	buf.cursize = 0;
+	buf.data = data;
+	buf.allowoverflow = false;
+	buf.overflowed = false;
+
+	MSG_WriteByte (&buf, clc_move);
+	MSG_WriteFloat (&buf, bot->servertime);
+	for (i = 0; i < 3; i++)
+	{
+		const float angle = (i == YAW) ? bot->yaw : (i == PITCH) ? bot->move.pitch : 0.0f;
+		if (bot->protocol == PROTOCOL_NETQUAKE && !NET_QSocketGetProQuakeAngleHack (bot->sock))
+			MSG_WriteAngle (&buf, angle, bot->protocolflags);
+		else
+			MSG_WriteAngle16 (&buf, angle, bot->protocolflags);
+	}
+	MSG_WriteShort (&buf, bot->move.forwardmove);
+	MSG_WriteShort (&buf, bot->move.sidemove);
+	MSG_WriteShort (&buf, bot->move.upmove);
+	MSG_WriteByte (&buf, bot->move.buttons);
+	MSG_WriteByte (&buf, bot->move.impulse);
+	bot->move.impulse = 0;
+
+	if (NET_SendUnreliableMessage (bot->sock, &buf) == -1)
+		LoadBot_Drop (bot, "lost server connection");
+	else
+		bot->bytes_out += buf.cursize;
+}
+
+/*
+====================
+LoadBot_Disconnect
+====================
+*/
+static void LoadBot_Disconnect (loadbot_t *bot)
+{
+	if (bot->sock)
+	{
+		SZ_Clear (&bot->message);
+		MSG_WriteByte (&bot->message, clc_disconnect);
+		NET_SendUnreliableMessage (bot->sock, &bot->message);
+		NET_Close (bot->sock);
+		bot->sock = NULL;
+	}
+	bot->state = LB_DROPPED;
+}
+
+/*
+====================
+LoadBots_Shutdown
+====================
+*/
+void LoadBots_Shutdown (void)
+{
+	int i;
+
+	for (i = 0; i < num_loadbots; i++)
+		LoadBot_Disconnect (&loadbots[i]);
+	SAFE_FREE (loadbots);
+	num_loadbots = 0;
+}
+
+/*
+====================
+LoadBots_Active
+====================
+*/
+qboolean LoadBots_Active (void)
+{
+	return num_loadbots > 0;
+}
+
+/*
+====================
+LoadBots_Frame
+====================
+*/
+void LoadBots_Frame (void)
+{
+	const double now = Sys_DoubleTime ();
+	const double interval = 1.0 / CLAMP (1.0, loadbot_rate.value, 1000.0);
+	int			 i, ret;
+
+	for (i = 0; i < num_loadbots; i++)
+	{
+		loadbot_t *bot = &loadbots[i];
+
+		while (bot->state != LB_DROPPED && (ret = NET_GetMessage (bot->sock)) != 0)
+		{
+			if (ret == -1)
+			{
+				LoadBot_Drop (bot, "lost server connection");
+				break;
+			}
+			bot->bytes_in += net_message.cursize;
+			LoadBot_ParseMessage (bot);
+		}
+
+		if (bot->state == LB_DROPPED)
+			continue;
+
+		if (bot->message.cursize && NET_CanSendMessage (bot->sock))
+		{
+			if (NET_SendMessage (bot->sock, &bot->message) == -1)
+			{
+				LoadBot_Drop (bot, "lost server connection");
+				continue;
+			}
+			bot->bytes_out += bot->message.cursize;
+			SZ_Clear (&bot->message);
+		}
+
+		if (bot->state == LB_ACTIVE && bot->signon == SIGNONS && now >= bot->next_move)
+		{
+			LoadBot_SendMove (bot, now, interval);
+			bot->next_move = q_max (bot->next_move + interval, now - interval);
+		}
+	}
+}
+
+/*
+====================
+LoadBots_f
+====================
+*/
+static void LoadBots_f (void)
+{
+	const char *host;
+	int			i, count;
+
+	if (Cmd_Argc () < 2)
+	{
+		Con_Printf ("usage: loadbots <count> [host]\n");
+		Con_Printf ("       loadbots 0 disconnects all bots\n");
+		return;
+	}
+
+	LoadBots_Shutdown ();
+	count = CLAMP (0, atoi (Cmd_Argv (1)), MAX_LOADBOTS);
+	if (!count)
+		return;
+
+	if (sv.active)
+	{
+		Con_Printf ("loadbots: can't connect bots from the process running the server\n");
+		return;
+	}
+
+	host = (Cmd_Argc () > 2) ? Cmd_Argv (2) : "localhost";
+	LoadBot_LoadScript (loadbot_script.string);
+
+	loadbots = (loadbot_t *)Mem_Alloc (count * sizeof (loadbot_t));
+	for (i = 0; i < count; i++)
+	{
+		loadbot_t *bot = &loadbots[i];
+
+		bot->sock = NET_ConnectDirect (host);
+		if (!bot->sock)
+		{
+			Con_Printf ("loadbots: connection %d to %s failed\n", i, host);
+			break;
+		}
+
+		bot->state = LB_CONNECTED;
+		bot->message.data = bot->message_buf;
+		bot->message.maxsize = sizeof (bot->message_buf);
+		bot->seed = 0x9e3779b9u * (i + 1);
+		bot->step = i; // don't move in lockstep
+		MSG_WriteByte (&bot->message, clc_nop); // NAT fix, see CL_EstablishConnection
+		++num_loadbots;
+	}
+
+	stats_start = Sys_DoubleTime ();
+	Con_Printf ("loadbots: %d bots connected to %s\n", num_loadbots, host);
+}
+
+/*
+====================
+LoadBotStats_f
+====================
+*/
+static void LoadBotStats_f (void)
+{
+	const double elapsed = q_max (Sys_DoubleTime () - stats_start, 0.001);
+	static const char *const state_names[] = {"signon", "active", "dropped"};
+	int						 i, active = 0;
+	double					 total_in = 0.0, total_out = 0.0;
+
+	if (Cmd_Argc () > 1 && !strcmp (Cmd_Argv (1), "reset"))
+	{
+		for (i = 0; i < num_loadbots; i++)
+		{
+			loadbot_t *bot = &loadbots[i];
+			bot->snapshots = bot->bytes_in = bot->bytes_out = 0;
+			bot->interval_sum = bot->interval_max = bot->last_snapshot = 0.0;
+		}
+		stats_start = Sys_DoubleTime ();
+		// remote clients may only read the server's tick statistics
+		Con_Printf ("loadbotstats: use \"serverstats reset\" on the server console to reset its tick statistics\n");
+		return;
+	}
+
+	if (!num_loadbots)
+	{
+		Con_Printf ("loadbotstats: no bots\n");
+		return;
+	}
+
+	Con_Printf ("bot  state    snaps  avg ms  max ms   in B/s  out B/s\n");
+	for (i = 0; i < num_loadbots; i++)
+	{
+		loadbot_t *bot = &loadbots[i];
+		const int  intervals = q_max (bot->snapshots - 1, 1);
+
+		Con_Printf (
+			"%3d  %-7s %6d %7.2f %7.2f %8.0f %8.0f\n", i, state_names[bot->state], bot->snapshots, 1000.0 * bot->interval_sum / intervals,
+			1000.0 * bot->interval_max, bot->bytes_in / elapsed, bot->bytes_out / elapsed);
+		total_in += bot->bytes_in;
+		total_out += bot->bytes_out;
+		if (bot->state == LB_ACTIVE)
+			++active;
+	}
+	Con_Printf ("%d of %d bots active, %.0f B/s in, %.0f B/s out over %.1f s\n", active, num_loadbots, total_in / elapsed, total_out / elapsed, elapsed);
+
+	// the server answers with svc_print, echoed when it arrives
+	if (loadbots[0].state == LB_ACTIVE)
+	{
+		LoadBot_StringCmd (&loadbots[0], "serverstats");
+		serverstats_until = realtime + SERVERSTATS_WINDOW;
+	}
+}
+
+/*
+====================
+LoadBots_Init
+====================
+*/
+void LoadBots_Init (void)
+{
+	Cvar_RegisterVariable (&loadbot_rate);
+	Cvar_RegisterVariable (&loadbot_script);
+	Cmd_AddCommand ("loadbots", LoadBots_f);
+	Cmd_AddCommand ("loadbotstats", LoadBotStats_f);
+}
@@ -503,6 +503,31 @@ JustDoIt:
 	return NULL;
 }
 
+/*
+===================
+NET_ConnectDirect
+
+Connects straight to an address without querying the server list first
+===================
+*/
+qsocket_t *NET_ConnectDirect (const char *host)
+{
+	qsocket_t *ret;
+
+	SetNetTime ();
+
+	for (net_driverlevel = 0; net_driverlevel < net_numdrivers; net_driverlevel++)
+	{
+		if (net_drivers[net_driverlevel].initialized == false)
+			continue;
+		ret = dfunc.Connect (host);
+		if (ret)
+			return ret;
+	}
+
+	return NULL;
+}
+
 /*
 ===================
 NET_CheckNewConnections
@@ -927,6 +952,46 @@ void NET_Poll (void)
 	}
 }
 
+/*
+===================
+NET_Sleep
+===================
+*/
+qboolean NET_Sleep (double timeout)
+{
+	fd_set		   set;
+	struct timeval tv;
+	sys_socket_t   maxsock = 0;
+	int			   numsocks = 0;
+
+	FD_ZERO (&set);
+	for (int i = 0; i < net_numlandrivers; ++i)
+	{
+		const sys_socket_t sock = net_landrivers[i].listeningSock;
+		if (!net_landrivers[i].initialized || sock == INVALID_SOCKET)
+			continue;
+#if !defined(PLATFORM_WINDOWS)
+		if (sock >= FD_SETSIZE)
+			continue;
+#endif
+		FD_SET (sock, &set);
+		maxsock = q_max (maxsock, sock);
+		++numsocks;
+	}
+
+	timeout = q_max (timeout, 0.0);
+	if (!numsocks)
+	{
+		SDL_Delay ((Uint32)(timeout * 1000.0));
+		return false;
+	}
+
+	// select has microsecond resolution, poll only milliseconds
+	tv.tv_sec = (long)timeout;
+	tv.tv_usec = (long)((timeout - tv.tv_sec) * 1000000.0);
+	return selectsocket ((int)maxsock + 1, &set, NULL, NULL, &tv) > 0;
+}
+
 void SchedulePollProcedure (PollProcedure *proc, double timeOffset)
 {
 	PollProcedure *pp, *prev;
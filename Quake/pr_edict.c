@@ -214,7 +214,7 @@ ED_FindField
 */
 ddef_t *ED_FindField (const char *name)
 {
-	ddef_t **def_ptr = HashMap_Lookup (ddef_t *, qcvm->fielddefs_map, &name);
+	ddef_t **def_ptr = FlatMap_LookupStr (qcvm->fielddefs_map, &name);
 	if (def_ptr)
 		return *def_ptr;
 	return NULL;
@@ -237,7 +237,7 @@ ED_FindGlobal
 */
 ddef_t *ED_FindGlobal (const char *name)
 {
-	ddef_t **def_ptr = HashMap_Lookup (ddef_t *, qcvm->globaldefs_map, &name);
+	ddef_t **def_ptr = FlatMap_LookupStr (qcvm->globaldefs_map, &name);
 	if (def_ptr)
 		return *def_ptr;
 	return NULL;
@@ -250,7 +250,7 @@ ED_FindFunction
 */
 dfunction_t *ED_FindFunction (const char *fn_name)
 {
-	dfunction_t **func_ptr = HashMap_Lookup (dfunction_t *, qcvm->function_map, &fn_name);
+	dfunction_t **func_ptr = FlatMap_LookupStr (qcvm->function_map, &fn_name);
 	if (func_ptr)
 		return *func_ptr;
 	return NULL;
@@ -1122,13 +1122,14 @@ void PR_ClearProgs (qcvm_t *vm)
 		Mem_Free ((void *)qcvm->knownstrings);
 		Mem_Free (qcvm->knownstringsowned);
 	}
-	Mem_Free (qcvm->edicts); // ericw -- sv.edicts switched to use malloc()
+	if (vm != &sv.qcvm) // server edicts are in the level arena
+		Mem_Free (qcvm->edicts);
 	if (qcvm->fielddefs != (ddef_t *)((byte *)qcvm->progs + qcvm->progs->ofs_fielddefs))
 		Mem_Free (qcvm->fielddefs);
 	Mem_Free (qcvm->progs); // spike -- pr_progs switched to use malloc (so menuqc doesn't end up stuck on the early hunk nor wiped on every map change)
-	HashMap_Destroy (qcvm->function_map);
-	HashMap_Destroy (qcvm->fielddefs_map);
-	HashMap_Destroy (qcvm->globaldefs_map);
+	FlatMap_Destroy (qcvm->function_map);
+	FlatMap_Destroy (qcvm->fielddefs_map);
+	FlatMap_Destroy (qcvm->globaldefs_map);
 	memset (qcvm, 0, sizeof (*qcvm));
 
 	qcvm = NULL;
@@ -1201,7 +1202,7 @@ static void PR_MergeEngineFieldDefs (void)
 				qcvm->fielddefs[qcvm->progs->numfielddefs].type = extrafields[j].type;
 				qcvm->fielddefs[qcvm->progs->numfielddefs].s_name = ED_NewString (extrafields[j].fname);
 				const ddef_t *def_ptr = &qcvm->fielddefs[qcvm->progs->numfielddefs];
-				HashMap_Insert (qcvm->fielddefs_map, &extrafields[j].fname, &def_ptr);
+				FlatMap_InsertStr (qcvm->fielddefs_map, &extrafields[j].fname, &def_ptr);
 				qcvm->progs->numfielddefs++;
 
 				if (extrafields[j].type == ev_vector)
@@ -1213,7 +1214,7 @@ static void PR_MergeEngineFieldDefs (void)
 						const char *fielddef_name = va ("%s_%c", extrafields[j].fname, 'x' + a);
 						qcvm->fielddefs[qcvm->progs->numfielddefs].s_name = ED_NewString (fielddef_name);
 						const ddef_t *def_ptr_v = &qcvm->fielddefs[qcvm->progs->numfielddefs];
-						HashMap_Insert (qcvm->fielddefs_map, &fielddef_name, &def_ptr_v);
+						FlatMap_InsertStr (qcvm->fielddefs_map, &fielddef_name, &def_ptr_v);
 						qcvm->progs->numfielddefs++;
 					}
 				}
@@ -1398,13 +1399,13 @@ qboolean PR_LoadProgs (const char *filename, qboolean fatal, unsigned int needcr
 	}
 	// Just to be sure: Reverse insert because there can be duplicates and we want
 	// to match linear search with hash lookup (find first)
-	qcvm->function_map = HashMap_Create (const char *, dfunction_t *, &HashStr, &HashStrCmp);
-	HashMap_Reserve (qcvm->function_map, qcvm->progs->numfunctions);
+	qcvm->function_map = FlatMap_Create (const char *, dfunction_t *, &HashStr, &HashStrCmp);
+	FlatMap_Reserve (qcvm->function_map, qcvm->progs->numfunctions);
 	for (i = qcvm->progs->numfunctions - 1; i >= 0; --i)
 	{
 		const char		  *func_name = PR_GetString (qcvm->functions[i].s_name);
 		const dfunction_t *func_ptr = &qcvm->functions[i];
-		HashMap_Insert (qcvm->function_map, &func_name, &func_ptr);
+		FlatMap_InsertStr (qcvm->function_map, &func_name, &func_ptr);
 	}
 
 	for (i = 0; i < qcvm->progs->numglobaldefs; i++)
@@ -1413,13 +1414,13 @@ qboolean PR_LoadProgs (const char *filename, qboolean fatal, unsigned int needcr
 		qcvm->globaldefs[i].ofs = LittleShort (qcvm->globaldefs[i].ofs);
 		qcvm->globaldefs[i].s_name = LittleLong (qcvm->globaldefs[i].s_name);
 	}
-	qcvm->globaldefs_map = HashMap_Create (const char *, ddef_t *, &HashStr, &HashStrCmp);
-	HashMap_Reserve (qcvm->globaldefs_map, qcvm->progs->numglobaldefs);
+	qcvm->globaldefs_map = FlatMap_Create (const char *, ddef_t *, &HashStr, &HashStrCmp);
+	FlatMap_Reserve (qcvm->globaldefs_map, qcvm->progs->numglobaldefs);
 	for (i = qcvm->progs->numglobaldefs - 1; i >= 0; --i)
 	{
 		const char	 *globaldef_name = PR_GetString (qcvm->globaldefs[i].s_name);
 		const ddef_t *def_ptr = &qcvm->globaldefs[i];
-		HashMap_Insert (qcvm->globaldefs_map, &globaldef_name, &def_ptr);
+		FlatMap_InsertStr (qcvm->globaldefs_map, &globaldef_name, &def_ptr);
 	}
 
 	for (i = 0; i < qcvm->progs->numfielddefs; i++)
@@ -1430,13 +1431,13 @@ qboolean PR_LoadProgs (const char *filename, qboolean fatal, unsigned int needcr
 		qcvm->fielddefs[i].ofs = LittleShort (qcvm->fielddefs[i].ofs);
 		qcvm->fielddefs[i].s_name = LittleLong (qcvm->fielddefs[i].s_name);
 	}
-	qcvm->fielddefs_map = HashMap_Create (const char *, ddef_t *, &HashStr, &HashStrCmp);
-	HashMap_Reserve (qcvm->fielddefs_map, qcvm->progs->numfielddefs + 11); // up to 7 scalar + 1 vector engine autofields
+	qcvm->fielddefs_map = FlatMap_Create (const char *, ddef_t *, &HashStr, &HashStrCmp);
+	FlatMap_Reserve (qcvm->fielddefs_map, qcvm->progs->numfielddefs + 11); // up to 7 scalar + 1 vector engine autofields
 	for (i = qcvm->progs->numfielddefs - 1; i >= 0; --i)
 	{
 		const char	 *fielddef_name = PR_GetString (qcvm->fielddefs[i].s_name);
 		const ddef_t *def_ptr = &qcvm->fielddefs[i];
-		HashMap_Insert (qcvm->fielddefs_map, &fielddef_name, &def_ptr);
+		FlatMap_InsertStr (qcvm->fielddefs_map, &fielddef_name, &def_ptr);
 		const size_t len = strlen (fielddef_name);
 		if (len > 1 && fielddef_name[len - 2] == '_')
 			qcvm->fielddefs[i].type |= DEF_SAVEGLOBAL;
@@ -34,12 +34,14 @@ extern void PF_sv_CheckPlayerEXFlags (void);
 extern void PF_sv_walkpathtogoal (void);
 extern void PF_sv_localsound (void);
 
+#ifndef SERVERONLY
 static float PR_GetVMScale (void)
 {
 	// sigh, this is horrible (divides glwidth)
 	float s = CLAMP (1.0, scr_sbarscale.value, (float)glwidth / 320.0);
 	return s;
 }
+#endif
 
 // there's a few different aproaches to tempstrings...
 // the lame way is to just have a single one (vanilla).
@@ -4061,7 +4063,7 @@ MSG_WriteString (&sv.multicast, s);
 SV_Multicast (MULTICAST_ALL_R, NULL, 0, PEXT2_REPLACEMENTDELTAS); // FIXME
 			}
 
-			sv.particle_precache[i] = q_strdup (s); // weirdness to avoid issues with tempstrings
+			sv.particle_precache[i] = Mem_ArenaStrdup (MEM_TAG_SERVER, s); // weirdness to avoid issues with tempstrings
 			return i;
 		}
 	}
@@ -4112,7 +4114,7 @@ MSG_WriteString (&sv.multicast, s);
 SV_Multicast (MULTICAST_ALL_R, NULL, 0, PEXT2_REPLACEMENTDELTAS);
 			}
 
-			sv.particle_precache[i] = q_strdup (s); // weirdness to avoid issues with tempstrings
+			sv.particle_precache[i] = Mem_ArenaStrdup (MEM_TAG_SERVER, s); // weirdness to avoid issues with tempstrings
 			G_FLOAT (OFS_RETURN) = i;
 			return;
 		}
@@ -4209,7 +4211,7 @@ int PF_CL_ForceParticlePrecache (const char *s)
 	{
 		if (!cl.local_particle_precache[i].name)
 		{
-			cl.local_particle_precache[i].name = q_strdup (s); // weirdness to avoid issues with tempstrings
+			cl.local_particle_precache[i].name = Mem_ArenaStrdup (MEM_TAG_CLIENT, s); // weirdness to avoid issues with tempstrings
 			cl.local_particle_precache[i].index = PScript_FindParticleType (cl.local_particle_precache[i].name);
 			return -i;
 		}
@@ -4421,10 +4423,6 @@ static void			DrawQC_CharacterQuad (cb_context_t *cbx, float x, float y, int num
 	qboolean alpha_blend = alpha < 1.0f;
 	size = 0.0624; // avoid rounding errors...
 
-	VkBuffer	   buffer;
-	VkDeviceSize   buffer_offset;
-	basicvertex_t *vertices = (basicvertex_t *)R_VertexAllocate (6 * sizeof (basicvertex_t), &buffer, &buffer_offset);
-
 	basicvertex_t corner_verts[4];
 	memset (&corner_verts, 255, sizeof (corner_verts));
 
@@ -4460,21 +4458,15 @@ static void			DrawQC_CharacterQuad (cb_context_t *cbx, float x, float y, int num
 		corner_verts[i].color[3] = alpha * 255.0f;
 	}
 
+	basicvertex_t *vertices = Draw_AllocateQuad (
+		cbx, alpha_blend ? vulkan_globals.basic_blend_pipeline[cbx->render_pass_index] : vulkan_globals.basic_alphatest_pipeline[cbx->render_pass_index],
+		char_texture);
 	vertices[0] = corner_verts[0];
 	vertices[1] = corner_verts[1];
 	vertices[2] = corner_verts[2];
 	vertices[3] = corner_verts[2];
 	vertices[4] = corner_verts[3];
 	vertices[5] = corner_verts[0];
-
-	vulkan_globals.vk_cmd_bind_vertex_buffers (cbx->cb, 0, 1, &buffer, &buffer_offset);
-	if (alpha_blend)
-		R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_blend_pipeline[cbx->render_pass_index]);
-	else
-		R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_alphatest_pipeline[cbx->render_pass_index]);
-	vulkan_globals.vk_cmd_bind_descriptor_sets (
-		cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &char_texture->descriptor_set, 0, NULL);
-	vulkan_globals.vk_cmd_draw (cbx->cb, 6, 1, 0, 0);
 }
 static void PF_cl_drawcharacter (void)
 {
@@ -4561,6 +4553,7 @@ static void PF_cl_stringwidth (void)
 
 static void PF_cl_drawsetclip (void)
 {
+#ifndef SERVERONLY
 	float s = PR_GetVMScale ();
 
 	float x = G_FLOAT (OFS_PARM0) * s;
@@ -4573,16 +4566,21 @@ static void PF_cl_drawsetclip (void)
 	render_area.offset.y = y;
 	render_area.extent.width = w;
 	render_area.extent.height = h;
+	Draw_FlushBatch (vulkan_globals.secondary_cb_contexts[SCBX_GUI]);
 	vkCmdSetScissor (vulkan_globals.secondary_cb_contexts[SCBX_GUI][0].cb, 0, 1, &render_area);
+#endif
 }
 static void PF_cl_drawresetclip (void)
 {
+#ifndef SERVERONLY
 	VkRect2D render_area;
 	render_area.offset.x = 0;
 	render_area.offset.y = 0;
 	render_area.extent.width = vid.width;
 	render_area.extent.height = vid.height;
+	Draw_FlushBatch (vulkan_globals.secondary_cb_contexts[SCBX_GUI]);
 	vkCmdSetScissor (vulkan_globals.secondary_cb_contexts[SCBX_GUI][0].cb, 0, 1, &render_area);
+#endif
 }
 
 static void PF_cl_precachepic (void)
@@ -4648,10 +4646,6 @@ static void PF_cl_drawfill (void)
 	float *rgb = G_VECTOR (OFS_PARM2);
 	float  alpha = G_FLOAT (OFS_PARM3);
 
-	VkBuffer	   buffer;
-	VkDeviceSize   buffer_offset;
-	basicvertex_t *vertices = (basicvertex_t *)R_VertexAllocate (6 * sizeof (basicvertex_t), &buffer, &buffer_offset);
-
 	basicvertex_t corner_verts[4];
 	memset (&corner_verts, 255, sizeof (corner_verts));
 
@@ -4679,19 +4673,14 @@ static void PF_cl_drawfill (void)
 		corner_verts[i].color[3] = alpha * 255.0f;
 	}
 
+	cb_context_t  *cbx = vulkan_globals.secondary_cb_contexts[SCBX_GUI];
+	basicvertex_t *vertices = Draw_AllocateQuad (cbx, vulkan_globals.basic_notex_blend_pipeline[cbx->render_pass_index], NULL);
 	vertices[0] = corner_verts[0];
 	vertices[1] = corner_verts[1];
 	vertices[2] = corner_verts[2];
 	vertices[3] = corner_verts[2];
 	vertices[4] = corner_verts[3];
 	vertices[5] = corner_verts[0];
-
-	cb_context_t *cbx = vulkan_globals.secondary_cb_contexts[SCBX_GUI];
-	vulkan_globals.vk_cmd_bind_vertex_buffers (cbx->cb, 0, 1, &buffer, &buffer_offset);
-	R_BindPipeline (cbx, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_notex_blend_pipeline[cbx->render_pass_index]);
-	vulkan_globals.vk_cmd_bind_descriptor_sets (
-		cbx->cb, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan_globals.basic_pipeline_layout.handle, 0, 1, &char_texture->descriptor_set, 0, NULL);
-	vulkan_globals.vk_cmd_draw (cbx->cb, 6, 1, 0, 0);
 }
 
 void PF_cl_playerkey_internal (int player, const char *key, qboolean retfloat)
@@ -428,4 +428,49 @@ typedef struct
 	int weapon;
 } usercmd_t;
 
+// msg_writer_t versions of the MSG_Write* encodings that depend on the protocol flags
+static inline void MSGW_WriteCoord (msg_writer_t *w, float f, unsigned int flags)
+{
+	if (flags & PRFL_FLOATCOORD)
+		MSGW_WriteFloat (w, f);
+	else if (flags & PRFL_INT32COORD)
+		MSGW_WriteLong (w, Q_rint (f * 16));
+	else if (flags & PRFL_24BITCOORD)
+	{
+		MSGW_WriteShort (w, f);
+		MSGW_WriteByte (w, (int)(f * 255) % 255);
+	}
+	else
+		MSGW_WriteShort (w, Q_rint (f * 8));
+}
+
+static inline void MSGW_WriteAngle (msg_writer_t *w, float f, unsigned int flags)
+{
+	if (flags & PRFL_FLOATANGLE)
+		MSGW_WriteFloat (w, f);
+	else if (flags & PRFL_SHORTANGLE)
+		MSGW_WriteShort (w, Q_rint (f * 65536.0 / 360.0) & 65535);
+	else
+		MSGW_WriteByte (w, Q_rint (f * 256.0 / 360.0) & 255);
+}
+
+static inline void MSGW_WriteAngle16 (msg_writer_t *w, float f, unsigned int flags)
+{
+	if (flags & PRFL_FLOATANGLE)
+		MSGW_WriteFloat (w, f);
+	else
+		MSGW_WriteShort (w, Q_rint (f * 65536.0 / 360.0) & 65535);
+}
+
+static inline void MSGW_WriteEntity (msg_writer_t *w, unsigned int entnum, unsigned int pext2)
+{
+	if (entnum > 0x7fff && (pext2 & PEXT2_REPLACEMENTDELTAS))
+	{
+		MSGW_WriteShort (w, 0x8000 | (entnum >> 8));
+		MSGW_WriteByte (w, entnum & 0xff);
+	}
+	else
+		MSGW_WriteShort (w, entnum);
+}
+
 #endif /* _QUAKE_PROTOCOL_H */
@@ -45,8 +45,9 @@ typedef struct
 
 typedef struct sfx_s
 {
-	char		name[MAX_QPATH];
-	sfxcache_t *cache;
+	char			  name[MAX_QPATH];
+	sfxcache_t		 *cache;
+	struct sfxload_s *load; /* background load in flight (or failed), see snd_mem.c */
 } sfx_t;
 
 typedef struct
@@ -75,6 +76,10 @@ typedef struct
 	vec3_t origin;	   /* origin of sound effect			*/
 	vec_t  dist_mult;  /* distance multiplier (attenuation/clipK)	*/
 	int	   master_vol; /* 0-255 master volume				*/
+	int	   loading;	   /* started before its sfx was loaded, end holds the start time */
+	float  gain[2];	   /* left/right gain the mixer is at			*/
+	float  target[2];  /* gain it is ramping towards			*/
+	int	   ramp;	   /* samples left in the ramp			*/
 } channel_t;
 
 #define WAV_FORMAT_PCM 1
@@ -89,6 +94,17 @@ typedef struct
 	int dataofs; /* chunk starts this many bytes from file start	*/
 } wavinfo_t;
 
+typedef struct
+{
+	int	   queued;		/* loads handed to a worker			*/
+	int	   sync_loads;	/* cache misses loaded on the calling thread	*/
+	int	   stalls;		/* S_LoadSound had to wait for a worker		*/
+	double stall_time;
+	double stall_max;
+	int	   late_starts; /* sounds that started playing after their data arrived */
+	int	   late_max;	/* in sample pairs				*/
+} sfxloadstats_t;
+
 void S_Init (void);
 void S_Startup (void);
 void S_Shutdown (void);
@@ -182,9 +198,27 @@ extern cvar_t bgmvolume;
 
 void		S_LocalSound (const char *name);
 sfxcache_t *S_LoadSound (sfx_t *s);
+void		S_QueueSound (sfx_t *s);
+void		S_WakeMixer (void);
+sfxcache_t *S_PeekSound (sfx_t *s, qboolean *loading);
+void		S_UnloadSound (sfx_t *s);
 
-wavinfo_t GetWavinfo (const char *name, byte *wav, int wavlength);
+// snd_resample.c
+#define RESAMPLE_MAX_TAPS 128
+typedef struct resampler_s resampler_t;
 
-void SND_InitScaletable (void);
+void			   S_InitResample (void);
+const resampler_t *S_GetResampler (int inrate, int outrate, int quality);
+int				   S_ResamplerTaps (const resampler_t *r);
+int				   S_ResampleLength (const resampler_t *r, int inframes);
+int				   S_Resample (const resampler_t *r, const float *in, int inframes, int *pos, int *phase, float *out, int maxout);
+void			   S_MakeBlackmanWindowKernel (float *kernel, int M, float f_c);
+
+extern cvar_t snd_resample;
+
+extern sfxloadstats_t snd_loadstats;
+extern SDL_mutex	 *snd_mutex;
+
+wavinfo_t GetWavinfo (const char *name, byte *wav, int wavlength);
 
 #endif /* __QUAKE_SOUND__ */
@@ -380,6 +380,7 @@ static inline int FindLastBitNonZero64 (const uint64_t mask)
 #include "tasks.h"
 #include "atomics.h"
 #include "hash_map.h"
+#include "flat_map.h"
 
 //=============================================================================
 
@@ -426,6 +427,7 @@ void			   Host_Callback_Notify (cvar_t *var); /* callback function for CVAR_NOTI
 FUNC_NORETURN void Host_Error (const char *error, ...) FUNC_PRINTF (1, 2);
 FUNC_NORETURN void Host_EndGame (const char *message, ...) FUNC_PRINTF (1, 2);
 void			   Host_Frame (double time);
+void			   Host_DedicatedFrame (void);
 void			   Host_Quit_f (void);
 void			   Host_ClientCommands (const char *fmt, ...) FUNC_PRINTF (1, 2);
 void			   Host_ShutdownServer (qboolean crash);
@@ -29,25 +29,45 @@ extern cvar_t gl_fullbrights, r_drawflat, r_gpulightmapupdate, r_rtshadows;
 
 int gl_lightmap_format;
 
-#define SHELF_HEIGHT 256
-#define SHELVES		 (LMBLOCK_HEIGHT / SHELF_HEIGHT)
+#define LM_OPEN_PAGES 2 // the packer only places blocks in the last pages, older ones are considered full
 
-#define LM_BIN_E 8
-#define LM_BINS	 49
+typedef struct
+{
+	unsigned short x, y, w;
+} lm_skyline_node_t;
+
+// skyline packer: each open page keeps the top edge of the allocated area as a list of horizontal segments
+typedef struct
+{
+	int				  num_pages;
+	int				  used_texels;
+	int				  num_nodes[LM_OPEN_PAGES];
+	lm_skyline_node_t nodes[LM_OPEN_PAGES][LMBLOCK_WIDTH + 1]; // +1 while inserting
+} lm_packer_t;
 
 struct lightmap_s *lightmaps;
 int				   lightmap_count;
-int				   last_lightmap_allocated;
-int				   used_columns[MAX_SANITY_LIGHTMAPS][SHELVES];
-int				   lightmap_idx[LM_BINS];
-int				   shelf_idx[LM_BINS];
-int				   columns[LM_BINS];
-int				   rows[LM_BINS];
+static lm_packer_t lm_packer;
 
 /* Lightmap extents are usually <= 18 with the default qbsp -subdivide of 240. The check in CalcSurfaceExtents ()
    limits them to 126 x 126 on load. The lightmap packer and the blocklights array can handle up to 256 x 256. */
 
-unsigned blocklights[256 * 256 * 3 + 1]; // johnfitz -- was 18*18, added lit support (*3) and loosened surface extents maximum
+#define BLOCKLIGHTS_SIZE (256 * 256 * 3 + 1) // johnfitz -- was 18*18, added lit support (*3) and loosened surface extents maximum
+
+static THREAD_LOCAL unsigned *blocklights; // one per thread, lightmaps are rebuilt on the task workers
+
+// surfaces whose lightmaps need to be rebuilt this frame, filled by R_RenderDynamicLightmaps
+typedef struct
+{
+	msurface_t **surfs;
+	int			 numsurfs;
+	int			 maxsurfs;
+} lightmap_queue_t;
+
+static lightmap_queue_t lightmap_queues[TASKS_MAX_WORKERS];
+static msurface_t	  **lightmap_rebuilds;
+static int				num_lightmap_rebuilds;
+static int				max_lightmap_rebuilds;
 
 qboolean indirect = true;
 qboolean indirect_ready = false;
@@ -152,30 +172,140 @@ static int current_compute_buffer_index;
 
 /*
 ================
-SizeToBin
+LM_SkylineFits
+
+returns the lowest y at which a w * h block fits with its left edge on the start of node i, or -1
+================
+*/
+static int LM_SkylineFits (const lm_skyline_node_t *nodes, int num_nodes, int i, int w, int h)
+{
+	int y = 0;
+	int width_left = w;
+
+	if (nodes[i].x + w > LMBLOCK_WIDTH)
+		return -1;
+	for (; width_left > 0; i++)
+	{
+		assert (i < num_nodes);
+		y = q_max (y, nodes[i].y);
+		if (y + h > LMBLOCK_HEIGHT)
+			return -1;
+		width_left -= nodes[i].w;
+	}
+	return y;
+}
+
+/*
+================
+LM_SkylineAlloc
+
+bottom-left placement: picks the position that keeps the block's top edge lowest, ties go to the narrowest segment
+================
+*/
+static qboolean LM_SkylineAlloc (lm_packer_t *packer, int page, int w, int h, int *x, int *y)
+{
+	lm_skyline_node_t *nodes = packer->nodes[page % LM_OPEN_PAGES];
+	int				  *num_nodes = &packer->num_nodes[page % LM_OPEN_PAGES];
+	int				   best = -1;
+	int				   best_top = INT_MAX;
+	int				   best_width = INT_MAX;
+	int				   i;
+
+	for (i = 0; i < *num_nodes; i++)
+	{
+		const int node_y = LM_SkylineFits (nodes, *num_nodes, i, w, h);
+		if (node_y < 0)
+			continue;
+		if ((node_y + h < best_top) || ((node_y + h == best_top) && (nodes[i].w < best_width)))
+		{
+			best = i;
+			best_top = node_y + h;
+			best_width = nodes[i].w;
+		}
+	}
+	if (best < 0)
+		return false;
+
+	*x = nodes[best].x;
+	*y = best_top - h;
+
+	// insert the top edge of the new block and cut it out of the segments it covers
+	memmove (&nodes[best + 1], &nodes[best], (*num_nodes - best) * sizeof (lm_skyline_node_t));
+	++*num_nodes;
+	nodes[best].x = *x;
+	nodes[best].y = best_top;
+	nodes[best].w = w;
+	for (i = best + 1; i < *num_nodes;)
+	{
+		const int overlap = nodes[i - 1].x + nodes[i - 1].w - nodes[i].x;
+		if (overlap <= 0)
+			break;
+		if (overlap < nodes[i].w)
+		{
+			nodes[i].x += overlap;
+			nodes[i].w -= overlap;
+			break;
+		}
+		memmove (&nodes[i], &nodes[i + 1], (*num_nodes - i - 1) * sizeof (lm_skyline_node_t));
+		--*num_nodes;
+	}
+
+	// merge neighbours at the same height
+	for (i = q_max (best - 1, 0); i < q_min (best + 1, *num_nodes - 1);)
+	{
+		if (nodes[i].y != nodes[i + 1].y)
+		{
+			i++;
+			continue;
+		}
+		nodes[i].w += nodes[i + 1].w;
+		memmove (&nodes[i + 1], &nodes[i + 2], (*num_nodes - i - 2) * sizeof (lm_skyline_node_t));
+		--*num_nodes;
+	}
+
+	packer->used_texels += w * h;
+	return true;
+}
+
+/*
+================
+LM_PackerAlloc
+
+returns the page for a w * h block and its position inside it. Placement only depends on the order and sizes of the blocks.
+A return value of packer->num_pages - 1 after num_pages grew means a new page was started.
 ================
 */
-static int SizeToBin (int size)
+static int LM_PackerAlloc (lm_packer_t *packer, int w, int h, int *x, int *y)
 {
-	size -= 1;
-	if (size < LM_BIN_E * 2 + 1)
-		return size;
-	int bc = Q_log2 (size / LM_BIN_E);
-	return (size >> bc) + LM_BIN_E * bc + 1;
+	int page;
+
+	for (page = q_max (packer->num_pages - LM_OPEN_PAGES, 0); page < packer->num_pages; page++)
+		if (LM_SkylineAlloc (packer, page, w, h, x, y))
+			return page;
+
+	if (packer->num_pages == MAX_SANITY_LIGHTMAPS)
+		Sys_Error ("AllocBlock: full");
+	page = packer->num_pages++;
+	packer->num_nodes[page % LM_OPEN_PAGES] = 1;
+	packer->nodes[page % LM_OPEN_PAGES][0].x = 0;
+	packer->nodes[page % LM_OPEN_PAGES][0].y = 0;
+	packer->nodes[page % LM_OPEN_PAGES][0].w = LMBLOCK_WIDTH;
+	if (!LM_SkylineAlloc (packer, page, w, h, x, y))
+		Sys_Error ("AllocBlock: %dx%d block too large", w, h);
+	return page;
 }
 
 /*
 ================
-BinToSize
+LM_PrintPackerStats
 ================
 */
-static int BinToSize (int bin)
+static void LM_PrintPackerStats (const char *prefix, const lm_packer_t *packer)
 {
-	if (bin < LM_BIN_E * 2 + 1)
-		return bin + 1;
-	bin -= 1;
-	int bc = bin / LM_BIN_E - 1;
-	return (bin % LM_BIN_E + LM_BIN_E + 1) << bc;
+	const int total_texels = packer->num_pages * LMBLOCK_WIDTH * LMBLOCK_HEIGHT; // at most MAX_SANITY_LIGHTMAPS pages
+	Con_Printf (
+		"%s%d lightmap pages, %.1f%% occupancy, %d texels wasted\n", prefix, packer->num_pages, total_texels ? 100.0 * packer->used_texels / total_texels : 0.0,
+		total_texels - packer->used_texels);
 }
 
 /*
@@ -789,15 +919,13 @@ void R_DrawIndirectBrushes_ShowTris (cb_context_t *cbx)
 /*
 ================
 R_RenderDynamicLightmaps
-called during rendering
+called during rendering, queues the surface for R_PrepareDynamicLightmaps if its lightmap changed
 ================
 */
 void R_RenderDynamicLightmaps (msurface_t *fa)
 {
-	byte	 *base;
-	int		  maps;
-	glRect_t *theRect;
-	int		  smax, tmax;
+	int				  maps;
+	lightmap_queue_t *queue;
 
 	if (fa->flags & SURF_DRAWTILED) // johnfitz -- not a lightmapped surface
 		return;
@@ -813,8 +941,52 @@ void R_RenderDynamicLightmaps (msurface_t *fa)
 	dynamic:
 		if (r_dynamic.value)
 		{
+			queue = &lightmap_queues[Tasks_GetWorkerIndex ()];
+			if (queue->numsurfs == queue->maxsurfs)
+			{
+				queue->maxsurfs = q_max (256, queue->maxsurfs * 2);
+				queue->surfs = Mem_Realloc (queue->surfs, sizeof (msurface_t *) * queue->maxsurfs);
+			}
+			queue->surfs[queue->numsurfs++] = fa;
+		}
+	}
+}
+
+/*
+================
+R_PrepareDynamicLightmaps
+
+Collects the surfaces queued by R_RenderDynamicLightmaps on all workers and
+updates the changed rectangles of their lightmaps. The rebuilds themselves are
+done in parallel by R_BuildDynamicLightmapsTask.
+================
+*/
+void R_PrepareDynamicLightmaps (void *unused)
+{
+	int		   i, j, smax, tmax;
+	glRect_t  *theRect;
+	msurface_t *fa;
+
+	num_lightmap_rebuilds = 0;
+	for (i = 0; i < TASKS_MAX_WORKERS; i++)
+	{
+		lightmap_queue_t *queue = &lightmap_queues[i];
+		for (j = 0; j < queue->numsurfs; j++)
+		{
+			fa = queue->surfs[j];
+			if (fa->lightmapframe == r_framecount)
+				continue; // already queued, e.g. by a brush model that is drawn in several passes
+			fa->lightmapframe = r_framecount;
+
+			if (num_lightmap_rebuilds == max_lightmap_rebuilds)
+			{
+				max_lightmap_rebuilds = q_max (1024, max_lightmap_rebuilds * 2);
+				lightmap_rebuilds = Mem_Realloc (lightmap_rebuilds, sizeof (msurface_t *) * max_lightmap_rebuilds);
+			}
+			lightmap_rebuilds[num_lightmap_rebuilds++] = fa;
+
 			struct lightmap_s *lm = &lightmaps[fa->lightmaptexturenum];
-			lm->modified[Tasks_GetWorkerIndex ()] = true;
+			lm->modified[0] = true;
 			theRect = &lm->rectchange;
 			if (fa->light_t < theRect->t)
 			{
@@ -834,82 +1006,311 @@ void R_RenderDynamicLightmaps (msurface_t *fa)
 				theRect->w = (fa->light_s - theRect->l) + smax;
 			if ((theRect->h + theRect->t) < (fa->light_t + tmax))
 				theRect->h = (fa->light_t - theRect->t) + tmax;
-			base = lm->data;
-			base += fa->light_t * LMBLOCK_WIDTH * LIGHTMAP_BYTES + fa->light_s * LIGHTMAP_BYTES;
-			R_BuildLightMap (fa, base, LMBLOCK_WIDTH * LIGHTMAP_BYTES);
 		}
+		queue->numsurfs = 0;
 	}
 }
 
 /*
-========================
-AllocBlock -- returns a texture number and the position inside it
-========================
+================
+R_BuildDynamicLightmapsTask
+================
 */
-static int AllocBlock (int w, int h, int *x, int *y)
+void R_BuildDynamicLightmapsTask (int index, void *unused)
 {
-	int i, j, k, l;
-	int texnum;
+	const int first = (int)((int64_t)num_lightmap_rebuilds * index / NUM_LIGHTMAP_BUILD_TASKS);
+	const int last = (int)((int64_t)num_lightmap_rebuilds * (index + 1) / NUM_LIGHTMAP_BUILD_TASKS);
+	int		  i;
+
+	for (i = first; i < last; i++)
+	{
+		msurface_t *fa = lightmap_rebuilds[i];
+		byte	   *base = lightmaps[fa->lightmaptexturenum].data;
+		base += fa->light_t * LMBLOCK_WIDTH * LIGHTMAP_BYTES + fa->light_s * LIGHTMAP_BYTES;
+		R_BuildLightMap (fa, base, LMBLOCK_WIDTH * LIGHTMAP_BYTES);
+	}
+}
+
+#ifdef _DEBUG
+static THREAD_LOCAL byte *benchmark_dest;
+
+/*
+================
+R_LightmapBenchmarkTask
+================
+*/
+static void R_LightmapBenchmarkTask (int index, void *unused)
+{
+	const int first = (int)((int64_t)num_lightmap_rebuilds * index / NUM_LIGHTMAP_BUILD_TASKS);
+	const int last = (int)((int64_t)num_lightmap_rebuilds * (index + 1) / NUM_LIGHTMAP_BUILD_TASKS);
+	int		  i;
 
-	for (texnum = last_lightmap_allocated; texnum < MAX_SANITY_LIGHTMAPS; texnum++)
+	if (!benchmark_dest)
+		benchmark_dest = Mem_Alloc (256 * 256 * LIGHTMAP_BYTES);
+	for (i = first; i < last; i++)
 	{
-		if (texnum == lightmap_count)
+		msurface_t *fa = lightmap_rebuilds[i];
+		R_BuildLightMap (fa, benchmark_dest, ((fa->extents[0] >> 4) + 1) * LIGHTMAP_BYTES);
+	}
+}
+
+/*
+================
+R_LightmapBenchmarkQueue
+================
+*/
+static void R_LightmapBenchmarkQueue (msurface_t *surf)
+{
+	if (num_lightmap_rebuilds == max_lightmap_rebuilds)
+	{
+		max_lightmap_rebuilds = q_max (1024, max_lightmap_rebuilds * 2);
+		lightmap_rebuilds = Mem_Realloc (lightmap_rebuilds, sizeof (msurface_t *) * max_lightmap_rebuilds);
+	}
+	lightmap_rebuilds[num_lightmap_rebuilds++] = surf;
+}
+
+/*
+================
+R_LightmapBenchmarkWorld
+
+Puts the lights in front of random world surfaces and queues the surfaces they hit
+================
+*/
+static void R_LightmapBenchmarkWorld (qmodel_t *model, int numlights)
+{
+	int i;
+
+	for (i = 0; i < numlights; i++)
+	{
+		msurface_t *surf = &model->surfaces[rand () % model->numsurfaces];
+		int			edge = model->surfedges[surf->firstedge];
+		mvertex_t  *v = &model->vertexes[model->edges[abs (edge)].v[edge < 0 ? 1 : 0]];
+		VectorMA (v->position, (surf->flags & SURF_PLANEBACK) ? -32.f : 32.f, surf->plane->normal, cl_dlights[i].origin);
+		cl_dlights[i].radius = 200 + (rand () & 255);
+		cl_dlights[i].die = cl.time + 1.0;
+		cl_dlights[i].color[0] = cl_dlights[i].color[1] = cl_dlights[i].color[2] = 1.f;
+	}
+	R_PushDlights ();
+
+	for (i = 0; i < model->numsurfaces; i++)
+	{
+		msurface_t *surf = &model->surfaces[i];
+		if (surf->dlightframe == r_framecount && !(surf->flags & SURF_DRAWTILED))
+			R_LightmapBenchmarkQueue (surf);
+	}
+}
+
+/*
+================
+R_LightmapBenchmarkSynthetic
+
+Scatters numsurfs floor surfaces of 2x2 to 17x17 luxels with one lightmap style
+over a 2048x2048 area, with the lights above them, and queues every surface that
+is within reach of a light. Returns the allocation for the caller to free.
+================
+*/
+static void *R_LightmapBenchmarkSynthetic (int numlights, int numsurfs)
+{
+	const int	 maxsamples = 17 * 17 * 3;
+	byte		*block = Mem_Alloc (numsurfs * (sizeof (msurface_t) + sizeof (mplane_t)) + sizeof (mtexinfo_t) + maxsamples);
+	msurface_t	*surfs = (msurface_t *)block;
+	mtexinfo_t	*texinfo = (mtexinfo_t *)(surfs + numsurfs);
+	mplane_t	*planes = (mplane_t *)(texinfo + 1);
+	byte		*samples = (byte *)(planes + numsurfs);
+	int			 i, lnum;
+
+	texinfo->vecs[0][0] = 1.f;
+	texinfo->vecs[1][1] = 1.f;
+	for (i = 0; i < maxsamples; i++)
+		samples[i] = rand () & 255;
+
+	for (i = 0; i < numlights; i++)
+	{
+		cl_dlights[i].origin[0] = (rand () & 2047) - 1024;
+		cl_dlights[i].origin[1] = (rand () & 2047) - 1024;
+		cl_dlights[i].origin[2] = 64 + (rand () & 255);
+		cl_dlights[i].radius = 200 + (rand () & 255);
+		cl_dlights[i].die = cl.time + 1.0;
+		cl_dlights[i].color[0] = cl_dlights[i].color[1] = cl_dlights[i].color[2] = 1.f;
+	}
+
+	for (i = 0; i < numsurfs; i++)
+	{
+		msurface_t *surf = &surfs[i];
+		float		mins[2], maxs[2];
+		qboolean	lit = false;
+
+		planes[i].normal[2] = 1.f;
+		planes[i].dist = rand () & 255;
+		planes[i].type = PLANE_Z;
+		surf->plane = &planes[i];
+		surf->texinfo = texinfo;
+		surf->texturemins[0] = ((rand () & 2047) - 1024) & ~15;
+		surf->texturemins[1] = ((rand () & 2047) - 1024) & ~15;
+		surf->extents[0] = 16 + (rand () % 16) * 16;
+		surf->extents[1] = 16 + (rand () % 16) * 16;
+		surf->samples = samples;
+		surf->styles[0] = 0;
+		memset (&surf->styles[1], 255, MAXLIGHTMAPS - 1);
+
+		for (lnum = 0; lnum < numlights; lnum++)
 		{
-			lightmap_count++;
-			lightmaps = (struct lightmap_s *)Mem_Realloc (lightmaps, sizeof (*lightmaps) * lightmap_count);
-			memset (&lightmaps[texnum], 0, sizeof (lightmaps[texnum]));
-			lightmaps[texnum].data = (byte *)Mem_Alloc (LIGHTMAP_BYTES * LMBLOCK_WIDTH * LMBLOCK_HEIGHT);
-			for (i = 0; i < MAXLIGHTMAPS * 3 / 4; ++i)
-				lightmaps[texnum].lightstyle_data[i] = (byte *)Mem_Alloc (LIGHTMAP_BYTES * LMBLOCK_WIDTH * LMBLOCK_HEIGHT);
-			lightmaps[texnum].surface_indices = (uint32_t *)Mem_Alloc (sizeof (uint32_t) * LMBLOCK_WIDTH * LMBLOCK_HEIGHT);
-			memset (lightmaps[texnum].surface_indices, 0xFF, 4 * LMBLOCK_WIDTH * LMBLOCK_HEIGHT);
-			lightmaps[texnum].workgroup_bounds = (lm_compute_workgroup_bounds_t *)Mem_Alloc (WORKGROUP_BOUNDS_BUFFER_SIZE);
-			for (i = 0; i < (LMBLOCK_WIDTH / 8) * (LMBLOCK_HEIGHT / 8); ++i)
+			const float *org = cl_dlights[lnum].origin;
+			const float	 rad = cl_dlights[lnum].radius - fabsf (org[2] - planes[i].dist);
+			int			 j;
+
+			if (rad <= 0)
+				continue;
+			for (j = 0; j < 2; j++)
 			{
-				for (j = 0; j < 3; ++j)
-				{
-					lightmaps[texnum].workgroup_bounds[i].mins[j] = FLT_MAX;
-					lightmaps[texnum].workgroup_bounds[i].maxs[j] = -FLT_MAX;
-				}
+				mins[j] = surf->texturemins[j] - rad;
+				maxs[j] = surf->texturemins[j] + surf->extents[j] + rad;
 			}
-			for (l = 0; l < LMBLOCK_HEIGHT / LM_CULL_BLOCK_H; l++)
-				for (k = 0; k < LMBLOCK_WIDTH / LM_CULL_BLOCK_W; k++)
-					for (j = 0; j < 3; ++j)
-					{
-						lightmaps[texnum].global_bounds[l][k].mins[j] = FLT_MAX;
-						lightmaps[texnum].global_bounds[l][k].maxs[j] = -FLT_MAX;
-					}
-			memset (lightmaps[texnum].cached_light, -1, sizeof (lightmaps[texnum].cached_light));
-			memset (used_columns[texnum], 0, sizeof (used_columns[texnum]));
-			last_lightmap_allocated = texnum;
+			if (org[0] < mins[0] || org[0] > maxs[0] || org[1] < mins[1] || org[1] > maxs[1])
+				continue;
+			surf->dlightbits[lnum >> 5] |= 1U << (lnum & 31);
+			lit = true;
+		}
+		if (lit)
+		{
+			surf->dlightframe = r_framecount;
+			R_LightmapBenchmarkQueue (surf);
+		}
+	}
+
+	return block;
+}
+
+/*
+================
+R_LightmapBenchmark_f
+
+test_lightmaps [numlights] [numsurfaces]
+
+Rebuilds the world lightmaps hit by random dlights into scratch memory, serially
+without and with SIMD and then on the task workers. Doesn't touch the GPU. With
+numsurfaces, or without a lit map, it uses synthetic surfaces (4000 by default)
+instead of the world.
+================
+*/
+void R_LightmapBenchmark_f (void)
+{
+	const int		numlights = (Cmd_Argc () > 1) ? CLAMP (1, atoi (Cmd_Argv (1)), MAX_DLIGHTS) : 32;
+	const int		iterations = 20;
+	static dlight_t saved_dlights[MAX_DLIGHTS];
+	static qmodel_t synthetic_model;
+	const qboolean	saved_use_simd = use_simd;
+	qmodel_t	   *saved_worldmodel = cl.worldmodel;
+	qboolean		synthetic = (Cmd_Argc () > 2) || !cl.worldmodel || !cl.worldmodel->lightdata || !cl.worldmodel->numsurfaces;
+	void		   *synthetic_block = NULL;
+	double			times[3];
+	int				i, pass, iteration;
+
+	memcpy (saved_dlights, cl_dlights, sizeof (cl_dlights));
+	memset (cl_dlights, 0, sizeof (cl_dlights));
+	srand (0);
+	num_lightmap_rebuilds = 0;
+	if (synthetic)
+	{
+		synthetic_block = R_LightmapBenchmarkSynthetic (numlights, (Cmd_Argc () > 2) ? CLAMP (1, atoi (Cmd_Argv (2)), 1 << 20) : 4000);
+		// R_BuildLightMap only reads the world's lightdata to tell lit from fullbright maps
+		if (!cl.worldmodel || !cl.worldmodel->lightdata)
+		{
+			synthetic_model.lightdata = (byte *)synthetic_block;
+			cl.worldmodel = &synthetic_model;
 		}
+	}
+	else
+		R_LightmapBenchmarkWorld (cl.worldmodel, numlights);
 
-		i = SizeToBin (w);
-		if (columns[i] < 0 || rows[i] + h - shelf_idx[i] * SHELF_HEIGHT > SHELF_HEIGHT) // need another shelf
+	for (pass = 0; pass < 3; pass++)
+	{
+		double start = Sys_DoubleTime ();
+		use_simd = (pass > 0) && saved_use_simd;
+		for (iteration = 0; iteration < iterations; iteration++)
 		{
-			while (used_columns[lightmap_idx[i]][shelf_idx[i]] + BinToSize (i) > LMBLOCK_WIDTH)
+			if (pass < 2)
 			{
-				if (++shelf_idx[i] < SHELVES)
-					continue;
-				shelf_idx[i] = 0;
-				if (++lightmap_idx[i] == lightmap_count)
-					break;
+				for (i = 0; i < NUM_LIGHTMAP_BUILD_TASKS; i++)
+					R_LightmapBenchmarkTask (i, NULL);
 			}
-			if (lightmap_idx[i] == lightmap_count) // need another lightmap
-				continue;
+			else
+			{
+				task_handle_t task = Task_AllocateAssignIndexedFuncAndSubmit (R_LightmapBenchmarkTask, NUM_LIGHTMAP_BUILD_TASKS, NULL, 0);
+				Task_Join (task, SDL_MUTEX_MAXWAIT);
+			}
+		}
+		times[pass] = (Sys_DoubleTime () - start) * 1000.0 / iterations;
+	}
+	use_simd = saved_use_simd;
+	memcpy (cl_dlights, saved_dlights, sizeof (cl_dlights));
+	cl.worldmodel = saved_worldmodel;
+
+	Con_Printf (
+		"%d dlights, %d %ssurfaces: %.3f ms serial, %.3f ms serial SIMD, %.3f ms on %d workers\n", numlights, num_lightmap_rebuilds,
+		synthetic ? "synthetic " : "", times[0], times[1], times[2], Tasks_NumWorkers ());
+	num_lightmap_rebuilds = 0;
+	Mem_Free (synthetic_block);
+}
+#endif
+
+/*
+================
+R_BuildDynamicLightmaps
+
+Rebuilds and uploads the queued lightmaps without using tasks
+================
+*/
+void R_BuildDynamicLightmaps (void)
+{
+	int i;
+
+	R_PrepareDynamicLightmaps (NULL);
+	for (i = 0; i < NUM_LIGHTMAP_BUILD_TASKS; i++)
+		R_BuildDynamicLightmapsTask (i, NULL);
+	R_UploadLightmaps (NULL);
+}
 
-			columns[i] = used_columns[lightmap_idx[i]][shelf_idx[i]];
-			used_columns[lightmap_idx[i]][shelf_idx[i]] += BinToSize (i);
-			rows[i] = shelf_idx[i] * SHELF_HEIGHT;
+/*
+========================
+AllocBlock -- returns a texture number and the position inside it
+========================
+*/
+static int AllocBlock (int w, int h, int *x, int *y)
+{
+	int i, j, k, l;
+	int texnum = LM_PackerAlloc (&lm_packer, w, h, x, y);
+
+	if (texnum == lightmap_count)
+	{
+		lightmap_count++;
+		lightmaps = (struct lightmap_s *)Mem_Realloc (lightmaps, sizeof (*lightmaps) * lightmap_count);
+		memset (&lightmaps[texnum], 0, sizeof (lightmaps[texnum]));
+		lightmaps[texnum].data = (byte *)Mem_Alloc (LIGHTMAP_BYTES * LMBLOCK_WIDTH * LMBLOCK_HEIGHT);
+		for (i = 0; i < MAXLIGHTMAPS * 3 / 4; ++i)
+			lightmaps[texnum].lightstyle_data[i] = (byte *)Mem_Alloc (LIGHTMAP_BYTES * LMBLOCK_WIDTH * LMBLOCK_HEIGHT);
+		lightmaps[texnum].surface_indices = (uint32_t *)Mem_Alloc (sizeof (uint32_t) * LMBLOCK_WIDTH * LMBLOCK_HEIGHT);
+		memset (lightmaps[texnum].surface_indices, 0xFF, 4 * LMBLOCK_WIDTH * LMBLOCK_HEIGHT);
+		lightmaps[texnum].workgroup_bounds = (lm_compute_workgroup_bounds_t *)Mem_Alloc (WORKGROUP_BOUNDS_BUFFER_SIZE);
+		for (i = 0; i < (LMBLOCK_WIDTH / 8) * (LMBLOCK_HEIGHT / 8); ++i)
+		{
+			for (j = 0; j < 3; ++j)
+			{
+				lightmaps[texnum].workgroup_bounds[i].mins[j] = FLT_MAX;
+				lightmaps[texnum].workgroup_bounds[i].maxs[j] = -FLT_MAX;
+			}
 		}
-		*x = columns[i];
-		*y = rows[i];
-		rows[i] += h;
-		return lightmap_idx[i];
+		for (l = 0; l < LMBLOCK_HEIGHT / LM_CULL_BLOCK_H; l++)
+			for (k = 0; k < LMBLOCK_WIDTH / LM_CULL_BLOCK_W; k++)
+				for (j = 0; j < 3; ++j)
+				{
+					lightmaps[texnum].global_bounds[l][k].mins[j] = FLT_MAX;
+					lightmaps[texnum].global_bounds[l][k].maxs[j] = -FLT_MAX;
+				}
+		memset (lightmaps[texnum].cached_light, -1, sizeof (lightmaps[texnum].cached_light));
 	}
 
-	Sys_Error ("AllocBlock: full");
-	return 0; // johnfitz -- shut up compiler
+	return texnum;
 }
 
 mvertex_t *r_pcurrentvertbase;
@@ -1433,7 +1834,9 @@ static void R_UploadVisibility (byte *data, uint32_t size)
 ===============
 GL_SortSurfaces
 
-Sorts surfs by number of used lightstyles and 3D position, then allocates lm blocks in that order and sets image bounds
+Sorts surfs by number of used lightstyles, lightmap height and 3D position, then allocates lm blocks in that order and sets image bounds.
+Sorting by height lets the skyline packer fill rows evenly, the position keeps neighbouring surfaces close in the
+lightmap for the dlight culling blocks.
 ===============
 */
 typedef struct
@@ -1451,14 +1854,20 @@ static int prepare_3d_interleave (int x) // bin x..xabcdefghij --> 0000a00b00c00
 	return x;
 }
 
-static void GL_SortSurfaces (void)
+/*
+===============
+LM_SortSurfaces
+
+surfs needs room for 2 * num_surfaces entries, returns the number of sorted surfaces at the start of surfs
+===============
+*/
+static int LM_SortSurfaces (surf_sort *surfs, qboolean by_height)
 {
 	int			i;
 	unsigned	j;
 	msurface_t *surf;
-	TEMP_ALLOC (surf_sort, surfs, num_surfaces * 2);
-	int used_surfs = 0;
-	int sort_bins[4][256];
+	int			used_surfs = 0;
+	int			sort_bins[4][256];
 	memset (sort_bins, 0, sizeof (sort_bins));
 	float scale_x = 500.0f / q_max (1.0f, q_max (fabsf (cl.worldmodel->mins[0]), fabsf (cl.worldmodel->maxs[0])));
 	float scale_y = 500.0f / q_max (1.0f, q_max (fabsf (cl.worldmodel->mins[1]), fabsf (cl.worldmodel->maxs[1])));
@@ -1491,16 +1900,18 @@ static void GL_SortSurfaces (void)
 					vec = m->vertexes[r_pedge->v[1]].position;
 				}
 
-				int x = prepare_3d_interleave (((int)(vec[0] * scale_x)) + (1 << 9));
-				int y = prepare_3d_interleave (((int)(vec[1] * scale_y)) + (1 << 9));
-				int z = prepare_3d_interleave (((int)(vec[2] * scale_z)) + (1 << 9));
+				// 7 bits per axis, the 8 bits above hold the lightmap height
+				int x = prepare_3d_interleave ((((int)(vec[0] * scale_x)) + (1 << 9)) >> 3);
+				int y = prepare_3d_interleave ((((int)(vec[1] * scale_y)) + (1 << 9)) >> 3);
+				int z = prepare_3d_interleave ((((int)(vec[2] * scale_z)) + (1 << 9)) >> 3);
+				unsigned height = by_height ? 255 - q_min (surf->extents[1] >> 4, 255) : 0; // tallest first
 
 				unsigned last_lightstyle;
 				for (last_lightstyle = 0; last_lightstyle < 3; last_lightstyle++) // saturate at 3, not 4
 					if (surf->styles[last_lightstyle] == 0xFF)
 						break;
 				surfs[used_surfs].surf = surf;
-				unsigned sortkey = (3 - last_lightstyle) << 30 | z | y << 1 | x << 2;
+				unsigned sortkey = (3 - last_lightstyle) << 30 | height << 21 | z | y << 1 | x << 2;
 				surfs[used_surfs++].sortkey = sortkey;
 				sort_bins[3][(sortkey >> 24) % 256] += 1;
 				sort_bins[2][(sortkey >> 16) % 256] += 1;
@@ -1522,6 +1933,18 @@ static void GL_SortSurfaces (void)
 			to[sort_bins[pass][key]] = from[i];
 		}
 	}
+	return used_surfs;
+}
+
+static void GL_SortSurfaces (void)
+{
+	int			i;
+	unsigned	j;
+	msurface_t *surf;
+	TEMP_ALLOC (surf_sort, surfs, num_surfaces * 2);
+	const int used_surfs = LM_SortSurfaces (surfs, true);
+
+	memset (&lm_packer, 0, sizeof (lm_packer));
 	for (i = 0; i < used_surfs; ++i)
 	{
 		surf = surfs[i].surf;
@@ -1535,8 +1958,85 @@ static void GL_SortSurfaces (void)
 		}
 	}
 	TEMP_FREE (surfs);
+	if (developer.value)
+		LM_PrintPackerStats ("", &lm_packer);
 }
 
+#ifdef _DEBUG
+/*
+===============
+R_LightmapPackerTest_f
+
+Repacks the current map's lightmaps on the CPU, checks that no blocks overlap, that the result matches the
+allocation made at load time and compares against the order without the height sort.
+===============
+*/
+void R_LightmapPackerTest_f (void)
+{
+	static lm_packer_t packer;
+	byte			  *used;
+	int				   i, pass;
+	int				   errors = 0;
+
+	if (!cl.worldmodel || !lightmap_count)
+	{
+		Con_Printf ("test_lightmap_packer: no map loaded\n");
+		return;
+	}
+
+	TEMP_ALLOC (surf_sort, surfs, num_surfaces * 2);
+	used = (byte *)Mem_Alloc (LMBLOCK_WIDTH * LMBLOCK_HEIGHT);
+	for (pass = 0; pass < 2; pass++)
+	{
+		const qboolean by_height = pass == 0;
+		const int	   used_surfs = LM_SortSurfaces (surfs, by_height);
+		const double   start = Sys_DoubleTime ();
+		TEMP_ALLOC (int, placements, used_surfs * 3);
+
+		memset (&packer, 0, sizeof (packer));
+		for (i = 0; i < used_surfs; ++i)
+		{
+			msurface_t *surf = surfs[i].surf;
+			placements[i * 3] = LM_PackerAlloc (&packer, (surf->extents[0] >> 4) + 1, (surf->extents[1] >> 4) + 1, &placements[i * 3 + 1], &placements[i * 3 + 2]);
+		}
+		const double time = Sys_DoubleTime () - start;
+
+		for (int page = 0; page < packer.num_pages; page++)
+		{
+			memset (used, 0, LMBLOCK_WIDTH * LMBLOCK_HEIGHT);
+			for (i = 0; i < used_surfs; ++i)
+			{
+				msurface_t *surf = surfs[i].surf;
+				const int	w = (surf->extents[0] >> 4) + 1;
+				const int	h = (surf->extents[1] >> 4) + 1;
+				const int	x = placements[i * 3 + 1];
+				const int	y = placements[i * 3 + 2];
+				if (placements[i * 3] != page)
+					continue;
+				if (by_height && ((surf->lightmaptexturenum != page) || (surf->light_s != x) || (surf->light_t != y)))
+					++errors;
+				if ((x < 0) || (y < 0) || (x + w > LMBLOCK_WIDTH) || (y + h > LMBLOCK_HEIGHT))
+				{
+					++errors;
+					continue;
+				}
+				for (int t = y; t < y + h; t++)
+					for (int s = x; s < x + w; s++)
+						errors += used[t * LMBLOCK_WIDTH + s]++ ? 1 : 0;
+			}
+		}
+
+		LM_PrintPackerStats (by_height ? "height sorted: " : "position only: ", &packer);
+		Con_Printf ("  %d blocks packed in %.2f ms\n", used_surfs, time * 1000.0);
+		TEMP_FREE (placements);
+	}
+	Mem_Free (used);
+	TEMP_FREE (surfs);
+
+	Con_Printf ("test_lightmap_packer: %s (%d errors)\n", errors ? "FAILED" : "passed", errors);
+}
+#endif
+
 /*
 ==================
 GL_BuildLightmaps -- called at level load time
@@ -1567,12 +2067,8 @@ void GL_BuildLightmaps (void)
 
 	Mem_Free (lightmaps);
 	lightmaps = NULL;
-	last_lightmap_allocated = 0;
 	lightmap_count = 0;
 	num_surfaces = 0;
-	memset (columns, -1, sizeof (columns));
-	memset (lightmap_idx, 0, sizeof (lightmap_idx));
-	memset (shelf_idx, 0, sizeof (shelf_idx));
 	used_indirect_draws = 0;
 	indirect_ready = true;
 	indirect_bmodel_start = INT_MAX;
@@ -2532,13 +3028,13 @@ void GL_PrepareSIMDAndParallelData (void)
 R_AddDynamicLights
 ===============
 */
-void R_AddDynamicLights (msurface_t *surf)
+void R_AddDynamicLights (msurface_t *surf, unsigned *blocklights)
 {
 	int			lnum;
 	int			sd, td;
 	float		dist, rad, minlight;
 	vec3_t		impact, local;
-	int			s, t;
+	int			s, t, smin, smaxlit;
 	int			i;
 	int			smax, tmax;
 	mtexinfo_t *tex;
@@ -2576,17 +3072,98 @@ void R_AddDynamicLights (msurface_t *surf)
 		local[1] -= surf->texturemins[1];
 
 		// johnfitz -- lit support via lordhavoc
-		bl = blocklights;
 		cred = cl_dlights[lnum].color[0] * 256.0f;
 		cgreen = cl_dlights[lnum].color[1] * 256.0f;
 		cblue = cl_dlights[lnum].color[2] * 256.0f;
 		// johnfitz
+
+		// dist is at least sd, so only the columns with sd < minlight can be lit (one texel of slack for the truncation)
+		smin = q_max (0, (int)floorf ((local[0] - minlight) / 16.f) - 1);
+		smaxlit = q_min (smax, (int)ceilf ((local[0] + minlight) / 16.f) + 2);
+		if (smin >= smaxlit)
+			continue;
+
 		for (t = 0; t < tmax; t++)
 		{
 			td = local[1] - t * 16;
 			if (td < 0)
 				td = -td;
-			for (s = 0; s < smax; s++)
+			if (td >= minlight)
+				continue; // and dist is at least td
+			bl = blocklights + (t * smax + smin) * 3;
+			s = smin;
+
+#if defined(USE_SIMD)
+			if (use_simd)
+			{
+#if defined(USE_SSE2)
+				const __m128 vlocal = _mm_set1_ps (local[0]);
+				const __m128 vminlight = _mm_set1_ps (minlight);
+				const __m128 vrad = _mm_set1_ps (rad);
+				const __m128i vtd = _mm_set1_epi32 (td);
+				__m128		  vs = _mm_setr_ps (s * 16, s * 16 + 16, s * 16 + 32, s * 16 + 48);
+				for (; s + 4 <= smaxlit; s += 4, bl += 12)
+				{
+					// sd = abs ((int)(local[0] - s * 16)), dist = max (sd, td) + (min (sd, td) >> 1)
+					__m128i vsd = _mm_cvttps_epi32 (_mm_sub_ps (vlocal, vs));
+					__m128i sign = _mm_srai_epi32 (vsd, 31);
+					vsd = _mm_sub_epi32 (_mm_xor_si128 (vsd, sign), sign);
+					__m128i greater = _mm_cmpgt_epi32 (vsd, vtd);
+					__m128i vmax = _mm_or_si128 (_mm_and_si128 (greater, vsd), _mm_andnot_si128 (greater, vtd));
+					__m128i vmin = _mm_or_si128 (_mm_andnot_si128 (greater, vsd), _mm_and_si128 (greater, vtd));
+					__m128	vdist = _mm_cvtepi32_ps (_mm_add_epi32 (vmax, _mm_srai_epi32 (vmin, 1)));
+					__m128	lit = _mm_cmplt_ps (vdist, vminlight);
+					vs = _mm_add_ps (vs, _mm_set1_ps (64.f));
+					if (!_mm_movemask_ps (lit))
+						continue;
+
+					__m128 vbrightness = _mm_and_ps (_mm_sub_ps (vrad, vdist), lit);
+					int	   r[4], g[4], b[4];
+					_mm_storeu_si128 ((__m128i *)r, _mm_cvttps_epi32 (_mm_mul_ps (vbrightness, _mm_set1_ps (cred))));
+					_mm_storeu_si128 ((__m128i *)g, _mm_cvttps_epi32 (_mm_mul_ps (vbrightness, _mm_set1_ps (cgreen))));
+					_mm_storeu_si128 ((__m128i *)b, _mm_cvttps_epi32 (_mm_mul_ps (vbrightness, _mm_set1_ps (cblue))));
+					for (i = 0; i < 4; i++)
+					{
+						bl[i * 3 + 0] += r[i];
+						bl[i * 3 + 1] += g[i];
+						bl[i * 3 + 2] += b[i];
+					}
+				}
+#elif defined(USE_NEON)
+				const float32x4_t vlocal = vdupq_n_f32 (local[0]);
+				const float32x4_t vminlight = vdupq_n_f32 (minlight);
+				const float32x4_t vrad = vdupq_n_f32 (rad);
+				const int32x4_t	  vtd = vdupq_n_s32 (td);
+				const float		  s16[4] = {s * 16, s * 16 + 16, s * 16 + 32, s * 16 + 48};
+				float32x4_t		  vs = vld1q_f32 (s16);
+				for (; s + 4 <= smaxlit; s += 4, bl += 12)
+				{
+					int32x4_t	vsd = vabsq_s32 (vcvtq_s32_f32 (vsubq_f32 (vlocal, vs)));
+					int32x4_t	vmax = vmaxq_s32 (vsd, vtd);
+					int32x4_t	vmin = vminq_s32 (vsd, vtd);
+					float32x4_t vdist = vcvtq_f32_s32 (vaddq_s32 (vmax, vshrq_n_s32 (vmin, 1)));
+					uint32x4_t	lit = vcltq_f32 (vdist, vminlight);
+					vs = vaddq_f32 (vs, vdupq_n_f32 (64.f));
+					if (vmaxvq_u32 (lit) == 0)
+						continue;
+
+					float32x4_t vbrightness = vreinterpretq_f32_u32 (vandq_u32 (vreinterpretq_u32_f32 (vsubq_f32 (vrad, vdist)), lit));
+					int32_t		r[4], g[4], b[4];
+					vst1q_s32 (r, vcvtq_s32_f32 (vmulq_n_f32 (vbrightness, cred)));
+					vst1q_s32 (g, vcvtq_s32_f32 (vmulq_n_f32 (vbrightness, cgreen)));
+					vst1q_s32 (b, vcvtq_s32_f32 (vmulq_n_f32 (vbrightness, cblue)));
+					for (i = 0; i < 4; i++)
+					{
+						bl[i * 3 + 0] += r[i];
+						bl[i * 3 + 1] += g[i];
+						bl[i * 3 + 2] += b[i];
+					}
+				}
+#endif
+			}
+#endif
+
+			for (; s < smaxlit; s++)
 			{
 				sd = local[0] - s * 16;
 				if (sd < 0)
@@ -2618,7 +3195,7 @@ Scales 'lightmap' contents (RGB8) by 'scale' and accumulates
 the result in the 'blocklights' array (RGB32)
 ===============
 */
-void R_AccumulateLightmap (byte *lightmap, unsigned scale, int texels)
+void R_AccumulateLightmap (unsigned *blocklights, byte *lightmap, unsigned scale, int texels)
 {
 	unsigned *bl = blocklights;
 	int		  size = texels * 3;
@@ -2689,7 +3266,7 @@ from RGB32 (with 8 fractional bits) to RGBA8, saturates and
 stores the result in 'dest'
 ===============
 */
-void R_StoreLightmap (byte *dest, int width, int height, int stride)
+void R_StoreLightmap (unsigned *blocklights, byte *dest, int width, int height, int stride)
 {
 	unsigned *src = blocklights;
 
@@ -2769,6 +3346,9 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 	unsigned scale;
 	int		 maps;
 
+	if (!blocklights)
+		blocklights = Mem_Alloc (BLOCKLIGHTS_SIZE * sizeof (unsigned));
+
 	surf->cached_dlight = (surf->dlightframe == r_framecount);
 
 	smax = (surf->extents[0] >> 4) + 1;
@@ -2789,7 +3369,7 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 				scale = d_lightstylevalue[surf->styles[maps]];
 				surf->cached_light[maps] = scale; // 8.8 fraction
 				// johnfitz -- lit support via lordhavoc
-				R_AccumulateLightmap (lightmap, scale, size);
+				R_AccumulateLightmap (blocklights, lightmap, scale, size);
 				lightmap += size * 3;
 				// johnfitz
 			}
@@ -2797,7 +3377,7 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 
 		// add all the dynamic lights
 		if (surf->dlightframe == r_framecount)
-			R_AddDynamicLights (surf);
+			R_AddDynamicLights (surf, blocklights);
 	}
 	else
 	{
@@ -2805,7 +3385,7 @@ void R_BuildLightMap (msurface_t *surf, byte *dest, int stride)
 		memset (&blocklights[0], 255, size * 3 * sizeof (unsigned int)); // johnfitz -- lit support via lordhavoc
 	}
 
-	R_StoreLightmap (dest, smax, tmax, stride);
+	R_StoreLightmap (blocklights, dest, smax, tmax, stride);
 }
 
 /*
@@ -3207,7 +3787,7 @@ void R_UpdateLightmapsAndIndirect (void *unused)
 	current_compute_buffer_index = (current_compute_buffer_index + 1) % 2;
 }
 
-void R_UploadLightmaps (void)
+void R_UploadLightmaps (void *unused)
 {
 	int lmap;
 	int num_uploads = 0;
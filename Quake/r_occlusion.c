@@ -0,0 +1,912 @@
+/*
+Copyright (C) 1996-2001 Id Software, Inc.
+Copyright (C) 2002-2009 John Fitzgibbons and others
+Copyright (C) 2010-2014 QuakeSpasm developers
+Copyright (C) 2016 Axel Gneiting
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+*/
+// r_occlusion.c -- coarse software depth buffer for occlusion culling
+
+#include "quakedef.h"
+
+extern cvar_t r_occlusion;
+extern cvar_t r_occlusion_occluders;
+
+/*
+=============================================================================
+
+OCCLUSION CULLING
+
+Each frame the largest front facing world faces in view are rasterized into a
+small depth buffer, one task per screen bin. Leafs, world surfaces and entities
+whose bounds are behind the occluders in every pixel they cover are skipped.
+Occluders only write the pixels they cover completely, with the farthest depth
+inside each pixel, so the test never culls anything that is visible.
+
+=============================================================================
+*/
+
+#define OCC_WIDTH		   256
+#define OCC_MAX_HEIGHT	   256
+#define OCC_BLOCK_SIZE	   8 // pixels per side of the blocks that keep the farthest depth
+#define OCC_BLOCKS_X	   (OCC_WIDTH / OCC_BLOCK_SIZE)
+#define OCC_BIN_WIDTH	   64
+#define OCC_BIN_HEIGHT	   32
+#define OCC_BINS_X		   (OCC_WIDTH / OCC_BIN_WIDTH)
+#define OCC_MAX_OCCLUDERS  256
+#define OCC_MAX_TRIS	   4096
+#define OCC_MAX_EDGES	   32
+#define OCC_MAX_POLY_VERTS (OCC_MAX_EDGES + 8)
+#define OCC_MIN_AREA	   (64.f * 64.f)
+#define OCC_NEAR		   1.f
+#define OCC_GUARD_BAND	   4.f	   // occluders are clipped to a frustum this many times wider than the view
+#define OCC_DEPTH_BIAS	   1.001f // pulls tested boxes slightly closer so faces never occlude themselves
+
+COMPILE_TIME_ASSERT (occlusion_bins, NUM_OCCLUSION_BINS == OCC_BINS_X * (OCC_MAX_HEIGHT / OCC_BIN_HEIGHT));
+
+typedef struct
+{
+	int	  surface;
+	float score;
+} occluder_t;
+
+typedef struct
+{
+	float edge_a[3], edge_b[3], edge_c[3]; // inside if a * x + b * y + c >= 0 for all edges
+	float depth_a, depth_b, depth_c;	   // farthest 1/z inside the pixel
+	int	  minx, miny, maxx, maxy;		   // pixel bounds, max is exclusive
+} occluder_tri_t;
+
+static struct
+{
+	// set up at map load
+	qmodel_t   *model;
+	occluder_t *candidates; // world surfaces that are large and opaque enough to occlude, scored by area
+	int			numcandidates;
+	float	   *surfbounds; // mins and maxs of every surface
+
+	// set up every frame
+	qboolean	   active;
+	int			   height;
+	vec3_t		   origin, forward, right, up;
+	float		   tanx, tany;
+	float		   scalex, scaley; // pixels per unit of x/z and y/z
+	int			   numoccluders;
+	int			   numtris;
+	occluder_tri_t tris[OCC_MAX_TRIS];
+	float		   depth[OCC_WIDTH * OCC_MAX_HEIGHT]; // 1/z of the nearest occluder covering the pixel, 0 if none
+	float		   blockmin[OCC_BLOCKS_X * (OCC_MAX_HEIGHT / OCC_BLOCK_SIZE)];
+} occlusion;
+
+/*
+=============
+R_SurfaceVertex
+=============
+*/
+static inline float *R_SurfaceVertex (qmodel_t *model, msurface_t *surf, int i)
+{
+	const int edge = model->surfedges[surf->firstedge + i];
+	return model->vertexes[(edge >= 0) ? model->edges[edge].v[0] : model->edges[-edge].v[1]].position;
+}
+
+/*
+=============
+R_BuildOccluders
+
+Called at map load to pick the occluder candidates and compute the surface bounds
+=============
+*/
+void R_BuildOccluders (void)
+{
+	qmodel_t *model = cl.worldmodel;
+	int		  i, j, k;
+
+	Mem_Free (occlusion.candidates);
+	Mem_Free (occlusion.surfbounds);
+	occlusion.candidates = NULL;
+	occlusion.surfbounds = NULL;
+	occlusion.numcandidates = 0;
+	occlusion.model = NULL;
+	occlusion.active = false;
+
+	if (!model || !model->numsurfaces)
+		return;
+
+	occlusion.surfbounds = Mem_Alloc (sizeof (float) * 6 * model->numsurfaces);
+	for (i = 0; i < model->numsurfaces; i++)
+	{
+		msurface_t *surf = &model->surfaces[i];
+		float	   *bounds = occlusion.surfbounds + i * 6;
+		bounds[0] = bounds[1] = bounds[2] = FLT_MAX;
+		bounds[3] = bounds[4] = bounds[5] = -FLT_MAX;
+		for (j = 0; j < surf->numedges; j++)
+		{
+			const float *v = R_SurfaceVertex (model, surf, j);
+			for (k = 0; k < 3; k++)
+			{
+				bounds[k] = q_min (bounds[k], v[k]);
+				bounds[3 + k] = q_max (bounds[3 + k], v[k]);
+			}
+		}
+	}
+
+	// only faces of the world itself, brush entities move
+	occlusion.candidates = Mem_Alloc (sizeof (occluder_t) * model->nummodelsurfaces);
+	for (i = model->firstmodelsurface; i < model->firstmodelsurface + model->nummodelsurfaces; i++)
+	{
+		msurface_t *surf = &model->surfaces[i];
+		vec3_t		area, a, b, c;
+		if (surf->flags & (SURF_DRAWSKY | SURF_DRAWTURB | SURF_DRAWTILED | SURF_DRAWFENCE))
+			continue;
+		if (surf->numedges < 3 || surf->numedges > OCC_MAX_EDGES)
+			continue;
+		area[0] = area[1] = area[2] = 0.f;
+		for (j = 1; j < surf->numedges - 1; j++)
+		{
+			VectorSubtract (R_SurfaceVertex (model, surf, j), R_SurfaceVertex (model, surf, 0), a);
+			VectorSubtract (R_SurfaceVertex (model, surf, j + 1), R_SurfaceVertex (model, surf, 0), b);
+			CrossProduct (a, b, c);
+			VectorAdd (area, c, area);
+		}
+		if (0.5f * VectorLength (area) >= OCC_MIN_AREA)
+		{
+			occlusion.candidates[occlusion.numcandidates].surface = i;
+			occlusion.candidates[occlusion.numcandidates++].score = 0.5f * VectorLength (area);
+		}
+	}
+	occlusion.model = model;
+
+	Con_DPrintf ("Occlusion: %d occluder candidates\n", occlusion.numcandidates);
+}
+
+/*
+=============
+R_PushOccluder
+
+Keeps the best occluders in a min-heap on their score
+=============
+*/
+static void R_PushOccluder (occluder_t *heap, int *count, int max, int surface, float score)
+{
+	int i, child;
+
+	if (*count < max)
+	{
+		for (i = (*count)++; i > 0 && heap[(i - 1) / 2].score > score; i = (i - 1) / 2)
+			heap[i] = heap[(i - 1) / 2];
+	}
+	else if (score > heap[0].score)
+	{
+		for (i = 0; (child = i * 2 + 1) < max; i = child)
+		{
+			if (child + 1 < max && heap[child + 1].score < heap[child].score)
+				++child;
+			if (heap[child].score >= score)
+				break;
+			heap[i] = heap[child];
+		}
+	}
+	else
+		return;
+	heap[i].surface = surface;
+	heap[i].score = score;
+}
+
+/*
+=============
+R_ClipOccluder
+
+Clips a view space polygon to the positive side of the plane
+=============
+*/
+static int R_ClipOccluder (const float plane[4], vec3_t *in, int numin, vec3_t *out)
+{
+	int i, numout = 0;
+
+	for (i = 0; i < numin; i++)
+	{
+		const float *a = in[i];
+		const float *b = in[(i + 1) % numin];
+		const float	 da = DotProduct (plane, a) + plane[3];
+		const float	 db = DotProduct (plane, b) + plane[3];
+		if (da >= 0.f)
+		{
+			VectorCopy (a, out[numout]);
+			numout++;
+		}
+		if ((da >= 0.f) != (db >= 0.f))
+		{
+			const float t = da / (da - db);
+			out[numout][0] = a[0] + t * (b[0] - a[0]);
+			out[numout][1] = a[1] + t * (b[1] - a[1]);
+			out[numout][2] = a[2] + t * (b[2] - a[2]);
+			numout++;
+		}
+	}
+	return numout;
+}
+
+/*
+=============
+R_SetupOccluderTriangle
+
+Edges in the outline bitmask are on the polygon's outline, the others are shared
+with the neighbouring triangle of the fan
+=============
+*/
+static void R_SetupOccluderTriangle (const float *v0, const float *v1, const float *v2, int outline)
+{
+	const float	   area = (v1[0] - v0[0]) * (v2[1] - v0[1]) - (v2[0] - v0[0]) * (v1[1] - v0[1]);
+	const float	  *v[3] = {v0, v1, v2};
+	occluder_tri_t *tri;
+	int			   i;
+
+	if (fabsf (area) < 0.01f || occlusion.numtris == OCC_MAX_TRIS)
+		return;
+
+	tri = &occlusion.tris[occlusion.numtris];
+	tri->minx = q_max (0, (int)floorf (q_min (v0[0], q_min (v1[0], v2[0]))));
+	tri->miny = q_max (0, (int)floorf (q_min (v0[1], q_min (v1[1], v2[1]))));
+	tri->maxx = q_min (OCC_WIDTH, (int)ceilf (q_max (v0[0], q_max (v1[0], v2[0]))));
+	tri->maxy = q_min (occlusion.height, (int)ceilf (q_max (v0[1], q_max (v1[1], v2[1]))));
+	if (tri->minx >= tri->maxx || tri->miny >= tri->maxy)
+		return;
+
+	// edge functions are positive inside and offset to test the pixel center, outline
+	// edges are pulled in so that only pixels completely inside the polygon pass
+	for (i = 0; i < 3; i++)
+	{
+		const float *a = v[i];
+		const float *b = v[(i + 1) % 3];
+		const float	 sign = (area > 0.f) ? 1.f : -1.f;
+		const float	 ea = (a[1] - b[1]) * sign;
+		const float	 eb = (b[0] - a[0]) * sign;
+		const float	 ec = (a[0] * b[1] - b[0] * a[1]) * sign;
+		tri->edge_a[i] = ea;
+		tri->edge_b[i] = eb;
+		tri->edge_c[i] = ec + 0.5f * (ea + eb);
+		if (outline & (1 << i))
+			tri->edge_c[i] -= 0.5f * (fabsf (ea) + fabsf (eb));
+	}
+
+	// 1/z is linear in screen space, take the smallest value inside the pixel
+	const float dzdx = ((v1[2] - v0[2]) * (v2[1] - v0[1]) - (v2[2] - v0[2]) * (v1[1] - v0[1])) / area;
+	const float dzdy = ((v2[2] - v0[2]) * (v1[0] - v0[0]) - (v1[2] - v0[2]) * (v2[0] - v0[0])) / area;
+	tri->depth_a = dzdx;
+	tri->depth_b = dzdy;
+	tri->depth_c = v0[2] - dzdx * v0[0] - dzdy * v0[1] + 0.5f * (dzdx + dzdy) - 0.5f * (fabsf (dzdx) + fabsf (dzdy));
+
+	++occlusion.numtris;
+}
+
+/*
+=============
+R_OccluderToView
+=============
+*/
+static inline void R_OccluderToView (const float *in, float *out)
+{
+	vec3_t v;
+	VectorSubtract (in, occlusion.origin, v);
+	out[0] = DotProduct (v, occlusion.right);
+	out[1] = DotProduct (v, occlusion.up);
+	out[2] = DotProduct (v, occlusion.forward);
+}
+
+/*
+=============
+R_ProjectOccluder
+
+Clips and projects a view space polygon in poly[0] into triangles
+=============
+*/
+static void R_ProjectOccluder (vec3_t poly[2][OCC_MAX_POLY_VERTS], int numverts)
+{
+	int			i;
+	const float gx = OCC_GUARD_BAND * occlusion.tanx;
+	const float gy = OCC_GUARD_BAND * occlusion.tany;
+	const float planes[5][4] = {{0.f, 0.f, 1.f, -OCC_NEAR}, {1.f, 0.f, gx, 0.f}, {-1.f, 0.f, gx, 0.f}, {0.f, 1.f, gy, 0.f}, {0.f, -1.f, gy, 0.f}};
+
+	for (i = 0; i < 5 && numverts >= 3; i++)
+		numverts = R_ClipOccluder (planes[i], poly[i & 1], numverts, poly[(i + 1) & 1]);
+	if (numverts < 3)
+		return;
+
+	// poly[1] now has the clipped polygon, project it to pixels and 1/z
+	for (i = 0; i < numverts; i++)
+	{
+		float *v = poly[1][i];
+		v[2] = 1.f / v[2];
+		v[0] = OCC_WIDTH * 0.5f + v[0] * v[2] * occlusion.scalex;
+		v[1] = occlusion.height * 0.5f - v[1] * v[2] * occlusion.scaley;
+	}
+	for (i = 1; i < numverts - 1; i++)
+		R_SetupOccluderTriangle (poly[1][0], poly[1][i], poly[1][i + 1], 2 | ((i == 1) ? 1 : 0) | ((i == numverts - 2) ? 4 : 0));
+}
+
+/*
+=============
+R_SetupOccluder
+
+Transforms, clips and projects the surface into triangles
+=============
+*/
+static void R_SetupOccluder (msurface_t *surf)
+{
+	vec3_t poly[2][OCC_MAX_POLY_VERTS];
+	int	   i;
+
+	for (i = 0; i < surf->numedges; i++)
+		R_OccluderToView (R_SurfaceVertex (occlusion.model, surf, i), poly[0][i]);
+	R_ProjectOccluder (poly, surf->numedges);
+}
+
+/*
+=============
+R_SetupOcclusionFrustum
+=============
+*/
+static void R_SetupOcclusionFrustum (const vec3_t origin, const vec3_t forward, const vec3_t right, const vec3_t up, float fovx, float fovy)
+{
+	VectorCopy (origin, occlusion.origin);
+	VectorCopy (forward, occlusion.forward);
+	VectorCopy (right, occlusion.right);
+	VectorCopy (up, occlusion.up);
+	occlusion.tanx = tanf (DEG2RAD (fovx) * 0.5f);
+	occlusion.tany = tanf (DEG2RAD (fovy) * 0.5f);
+	occlusion.height = CLAMP (OCC_BLOCK_SIZE, (int)(OCC_WIDTH * occlusion.tany / occlusion.tanx + OCC_BLOCK_SIZE - 1) & ~(OCC_BLOCK_SIZE - 1), OCC_MAX_HEIGHT);
+	occlusion.scalex = OCC_WIDTH * 0.5f / occlusion.tanx;
+	occlusion.scaley = occlusion.height * 0.5f / occlusion.tany;
+}
+
+/*
+=============
+R_SetupOcclusionView
+
+Picks the occluders for the current view and sets up their triangles
+=============
+*/
+static void R_SetupOcclusionView (void)
+{
+	occluder_t heap[OCC_MAX_OCCLUDERS];
+	const int  maxoccluders = CLAMP (0, (int)r_occlusion_occluders.value, OCC_MAX_OCCLUDERS);
+	int		   i, j, count = 0;
+
+	occlusion.active = false;
+	occlusion.numtris = 0;
+	occlusion.numoccluders = 0;
+
+	R_SetupOcclusionFrustum (r_origin, vpn, vright, vup, r_fovx, r_fovy);
+
+	// score front facing candidates in the frustum by area over squared distance to their bounds
+	for (i = 0; i < occlusion.numcandidates && maxoccluders > 0; i++)
+	{
+		msurface_t *surf = &occlusion.model->surfaces[occlusion.candidates[i].surface];
+		float	   *bounds = occlusion.surfbounds + occlusion.candidates[i].surface * 6;
+		float		dot = DotProduct (occlusion.origin, surf->plane->normal) - surf->plane->dist;
+		float		dist = 0.f;
+		if ((surf->flags & SURF_PLANEBACK) ? (dot > -0.01f) : (dot < 0.01f))
+			continue;
+		if (R_CullBox (bounds, bounds + 3))
+			continue;
+		for (j = 0; j < 3; j++)
+		{
+			const float d = q_max (0.f, q_max (bounds[j] - occlusion.origin[j], occlusion.origin[j] - bounds[3 + j]));
+			dist += d * d;
+		}
+		R_PushOccluder (heap, &count, maxoccluders, occlusion.candidates[i].surface, occlusion.candidates[i].score / (dist + 1.f));
+	}
+
+	for (i = 0; i < count; i++)
+		R_SetupOccluder (&occlusion.model->surfaces[heap[i].surface]);
+	occlusion.numoccluders = count;
+	occlusion.active = occlusion.numtris > 0;
+}
+
+/*
+=============
+R_SetupOcclusion
+=============
+*/
+void R_SetupOcclusion (void *unused)
+{
+	occlusion.active = false;
+
+	// waterwarp moves pixels around after rendering
+	if (!r_occlusion.value || !r_drawworld_cheatsafe || render_warp || occlusion.model != cl.worldmodel || !occlusion.numcandidates)
+		return;
+
+	R_SetupOcclusionView ();
+	Atomic_StoreUInt32 (&rs_occluders, occlusion.numoccluders);
+}
+
+/*
+=============
+R_RasterizeOccluder
+=============
+*/
+static void R_RasterizeOccluder (const occluder_tri_t *tri, int x0, int y0, int x1, int y1)
+{
+	int x, y;
+
+	for (y = y0; y < y1; y++)
+	{
+		float	   *row = occlusion.depth + y * OCC_WIDTH;
+		const float e0 = tri->edge_b[0] * y + tri->edge_c[0];
+		const float e1 = tri->edge_b[1] * y + tri->edge_c[1];
+		const float e2 = tri->edge_b[2] * y + tri->edge_c[2];
+		const float z = tri->depth_b * y + tri->depth_c;
+		x = x0;
+#if defined(USE_SIMD)
+		if (use_simd)
+		{
+#if defined(USE_SSE2)
+			const __m128 a0 = _mm_set1_ps (tri->edge_a[0]), a1 = _mm_set1_ps (tri->edge_a[1]), a2 = _mm_set1_ps (tri->edge_a[2]);
+			const __m128 ve0 = _mm_set1_ps (e0), ve1 = _mm_set1_ps (e1), ve2 = _mm_set1_ps (e2);
+			const __m128 za = _mm_set1_ps (tri->depth_a), vz = _mm_set1_ps (z);
+			const __m128 zero = _mm_setzero_ps ();
+			__m128		 fx = _mm_setr_ps (x, x + 1, x + 2, x + 3);
+			for (; x < x1; x += 4, fx = _mm_add_ps (fx, _mm_set1_ps (4.f)))
+			{
+				__m128 inside = _mm_cmpge_ps (_mm_add_ps (_mm_mul_ps (a0, fx), ve0), zero);
+				inside = _mm_and_ps (inside, _mm_cmpge_ps (_mm_add_ps (_mm_mul_ps (a1, fx), ve1), zero));
+				inside = _mm_and_ps (inside, _mm_cmpge_ps (_mm_add_ps (_mm_mul_ps (a2, fx), ve2), zero));
+				if (!_mm_movemask_ps (inside))
+					continue;
+				const __m128 depth = _mm_and_ps (_mm_add_ps (_mm_mul_ps (za, fx), vz), inside);
+				_mm_storeu_ps (row + x, _mm_max_ps (_mm_loadu_ps (row + x), depth));
+			}
+#elif defined(USE_NEON)
+			const float32x4_t ve0 = vdupq_n_f32 (e0), ve1 = vdupq_n_f32 (e1), ve2 = vdupq_n_f32 (e2), vz = vdupq_n_f32 (z);
+			const float32x4_t zero = vdupq_n_f32 (0.f);
+			const float		  startx[4] = {x, x + 1, x + 2, x + 3};
+			float32x4_t		  fx = vld1q_f32 (startx);
+			for (; x < x1; x += 4, fx = vaddq_f32 (fx, vdupq_n_f32 (4.f)))
+			{
+				uint32x4_t inside = vcgeq_f32 (vmlaq_n_f32 (ve0, fx, tri->edge_a[0]), zero);
+				inside = vandq_u32 (inside, vcgeq_f32 (vmlaq_n_f32 (ve1, fx, tri->edge_a[1]), zero));
+				inside = vandq_u32 (inside, vcgeq_f32 (vmlaq_n_f32 (ve2, fx, tri->edge_a[2]), zero));
+				if (vmaxvq_u32 (inside) == 0)
+					continue;
+				const float32x4_t depth = vreinterpretq_f32_u32 (vandq_u32 (vreinterpretq_u32_f32 (vmlaq_n_f32 (vz, fx, tri->depth_a)), inside));
+				vst1q_f32 (row + x, vmaxq_f32 (vld1q_f32 (row + x), depth));
+			}
+#endif
+		}
+#endif
+		for (; x < x1; x++)
+		{
+			if (tri->edge_a[0] * x + e0 >= 0.f && tri->edge_a[1] * x + e1 >= 0.f && tri->edge_a[2] * x + e2 >= 0.f)
+				row[x] = q_max (row[x], tri->depth_a * x + z);
+		}
+	}
+}
+
+/*
+=============
+R_RasterizeOccludersTask
+
+Fills one bin of the depth buffer
+=============
+*/
+void R_RasterizeOccludersTask (int index, void *unused)
+{
+	const int x0 = (index % OCC_BINS_X) * OCC_BIN_WIDTH;
+	const int y0 = (index / OCC_BINS_X) * OCC_BIN_HEIGHT;
+	int		  i, x, y, bx, by;
+
+	if (!occlusion.active || y0 >= occlusion.height)
+		return;
+
+	const int x1 = x0 + OCC_BIN_WIDTH;
+	const int y1 = q_min (y0 + OCC_BIN_HEIGHT, occlusion.height);
+	for (y = y0; y < y1; y++)
+		memset (occlusion.depth + y * OCC_WIDTH + x0, 0, sizeof (float) * OCC_BIN_WIDTH);
+
+	for (i = 0; i < occlusion.numtris; i++)
+	{
+		const occluder_tri_t *tri = &occlusion.tris[i];
+		const int			  tx0 = q_max (tri->minx, x0) & ~3;
+		const int			  tx1 = q_min (tri->maxx, x1);
+		const int			  ty0 = q_max (tri->miny, y0);
+		const int			  ty1 = q_min (tri->maxy, y1);
+		if (tx0 < tx1 && ty0 < ty1)
+			R_RasterizeOccluder (tri, tx0, ty0, tx1, ty1);
+	}
+
+	for (by = y0 / OCC_BLOCK_SIZE; by < y1 / OCC_BLOCK_SIZE; by++)
+	{
+		for (bx = x0 / OCC_BLOCK_SIZE; bx < x1 / OCC_BLOCK_SIZE; bx++)
+		{
+			float blockmin = FLT_MAX;
+			for (y = by * OCC_BLOCK_SIZE; y < (by + 1) * OCC_BLOCK_SIZE; y++)
+				for (x = bx * OCC_BLOCK_SIZE; x < (bx + 1) * OCC_BLOCK_SIZE; x++)
+					blockmin = q_min (blockmin, occlusion.depth[y * OCC_WIDTH + x]);
+			occlusion.blockmin[by * OCC_BLOCKS_X + bx] = blockmin;
+		}
+	}
+}
+
+/*
+=============
+R_RasterizeOccluders
+
+Serial version of R_SetupOcclusion and R_RasterizeOccludersTask
+=============
+*/
+void R_RasterizeOccluders (void)
+{
+	R_SetupOcclusion (NULL);
+	for (int i = 0; i < NUM_OCCLUSION_BINS; i++)
+		R_RasterizeOccludersTask (i, NULL);
+}
+
+/*
+=============
+R_OcclusionCullBox
+
+Returns true if the box is completely behind the occluders
+=============
+*/
+qboolean R_OcclusionCullBox (vec3_t mins, vec3_t maxs)
+{
+	vec3_t center, extents;
+	float  minx = FLT_MAX, miny = FLT_MAX, maxx = -FLT_MAX, maxy = -FLT_MAX;
+	int	   i, x, y, bx, by;
+
+	if (!occlusion.active)
+		return false;
+
+	for (i = 0; i < 3; i++)
+	{
+		center[i] = (mins[i] + maxs[i]) * 0.5f - occlusion.origin[i];
+		extents[i] = (maxs[i] - mins[i]) * 0.5f;
+	}
+	const float nearz = DotProduct (center, occlusion.forward) - fabsf (occlusion.forward[0]) * extents[0] - fabsf (occlusion.forward[1]) * extents[1] -
+						fabsf (occlusion.forward[2]) * extents[2];
+	if (nearz < OCC_NEAR)
+		return false;
+	const float boxdepth = OCC_DEPTH_BIAS / nearz;
+
+	for (i = 0; i < 8; i++)
+	{
+		vec3_t corner;
+		corner[0] = ((i & 1) ? maxs[0] : mins[0]) - occlusion.origin[0];
+		corner[1] = ((i & 2) ? maxs[1] : mins[1]) - occlusion.origin[1];
+		corner[2] = ((i & 4) ? maxs[2] : mins[2]) - occlusion.origin[2];
+		const float invz = 1.f / DotProduct (corner, occlusion.forward);
+		const float sx = DotProduct (corner, occlusion.right) * invz;
+		const float sy = DotProduct (corner, occlusion.up) * invz;
+		minx = q_min (minx, sx);
+		maxx = q_max (maxx, sx);
+		miny = q_min (miny, sy);
+		maxy = q_max (maxy, sy);
+	}
+	const int x0 = q_max (0, (int)floorf (OCC_WIDTH * 0.5f + minx * occlusion.scalex));
+	const int x1 = q_min (OCC_WIDTH, (int)ceilf (OCC_WIDTH * 0.5f + maxx * occlusion.scalex));
+	const int y0 = q_max (0, (int)floorf (occlusion.height * 0.5f - maxy * occlusion.scaley));
+	const int y1 = q_min (occlusion.height, (int)ceilf (occlusion.height * 0.5f - miny * occlusion.scaley));
+	if (x0 >= x1 || y0 >= y1)
+		return false;
+
+	for (by = y0 / OCC_BLOCK_SIZE; by <= (y1 - 1) / OCC_BLOCK_SIZE; by++)
+	{
+		for (bx = x0 / OCC_BLOCK_SIZE; bx <= (x1 - 1) / OCC_BLOCK_SIZE; bx++)
+		{
+			if (occlusion.blockmin[by * OCC_BLOCKS_X + bx] > boxdepth)
+				continue;
+
+			// partially covered block, check the pixels in groups of four
+			const int px0 = q_max (x0, bx * OCC_BLOCK_SIZE) & ~3;
+			const int px1 = q_min (x1, (bx + 1) * OCC_BLOCK_SIZE);
+			const int py1 = q_min (y1, (by + 1) * OCC_BLOCK_SIZE);
+			for (y = q_max (y0, by * OCC_BLOCK_SIZE); y < py1; y++)
+			{
+				const float *row = occlusion.depth + y * OCC_WIDTH;
+				for (x = px0; x < px1; x += 4)
+				{
+#if defined(USE_SIMD)
+					if (use_simd)
+					{
+#if defined(USE_SSE2)
+						if (_mm_movemask_ps (_mm_cmple_ps (_mm_loadu_ps (row + x), _mm_set1_ps (boxdepth))))
+							return false;
+#elif defined(USE_NEON)
+						if (vmaxvq_u32 (vcleq_f32 (vld1q_f32 (row + x), vdupq_n_f32 (boxdepth))))
+							return false;
+#endif
+						continue;
+					}
+#endif
+					if (row[x] <= boxdepth || row[x + 1] <= boxdepth || row[x + 2] <= boxdepth || row[x + 3] <= boxdepth)
+						return false;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+/*
+=============
+R_OcclusionCullSurface
+=============
+*/
+qboolean R_OcclusionCullSurface (int surfnum)
+{
+	float *bounds;
+
+	if (!occlusion.active)
+		return false;
+	bounds = occlusion.surfbounds + surfnum * 6;
+	return R_OcclusionCullBox (bounds, bounds + 3);
+}
+
+/*
+=============
+R_OcclusionRasterTest_f
+
+Checks the rasterizer and the box test against two walls from random views, without a map or
+the renderer: the SIMD and scalar paths must give the same depth buffer and results, and no box
+may be culled while one of its sample points can be seen past the walls
+=============
+*/
+void R_OcclusionRasterTest_f (void)
+{
+	// axis aligned walls facing the view: x, then y and z ranges
+	static const float walls[2][5] = {
+		{256.f, -200.f, 40.f, -120.f, 100.f},
+		{400.f, 0.f, 300.f, -150.f, 60.f},
+	};
+	const int		numviews = (Cmd_Argc () > 1) ? q_max (1, atoi (Cmd_Argv (1))) : 300;
+	const int		numboxes = 300;
+	const qboolean	saved_simd = use_simd;
+	float		   *scalardepth = Mem_Alloc (sizeof (occlusion.depth));
+	unsigned int	seed = 1;
+	int				numtris = 0, numculled = 0, numwrong = 0, numdiffer = 0;
+	int				view, i, j, k;
+
+// same LCG as the load bots, every run tests the same views and boxes
+#define OCCLUSION_RAND(lo, hi) ((lo) + ((hi) - (lo)) * (float)((seed = seed * 1103515245u + 12345u) >> 16 & 0x7fff) / 0x7fff)
+
+	for (view = 0; view < numviews; view++)
+	{
+		vec3_t origin, angles, forward, right, up;
+
+		origin[0] = OCCLUSION_RAND (-64.f, 64.f);
+		origin[1] = OCCLUSION_RAND (-128.f, 128.f);
+		origin[2] = OCCLUSION_RAND (-32.f, 32.f);
+		angles[PITCH] = OCCLUSION_RAND (-15.f, 15.f);
+		angles[YAW] = OCCLUSION_RAND (-40.f, 40.f);
+		angles[ROLL] = 0.f;
+		AngleVectors (angles, forward, right, up);
+
+		R_SetupOcclusionFrustum (origin, forward, right, up, 90.f, 73.74f);
+		occlusion.numtris = 0;
+		for (i = 0; i < 2; i++)
+		{
+			vec3_t		 poly[2][OCC_MAX_POLY_VERTS];
+			const vec3_t quad[4] = {
+				{walls[i][0], walls[i][1], walls[i][3]},
+				{walls[i][0], walls[i][2], walls[i][3]},
+				{walls[i][0], walls[i][2], walls[i][4]},
+				{walls[i][0], walls[i][1], walls[i][4]},
+			};
+			for (j = 0; j < 4; j++)
+				R_OccluderToView (quad[j], poly[0][j]);
+			R_ProjectOccluder (poly, 4);
+		}
+		occlusion.active = occlusion.numtris > 0;
+		numtris += occlusion.numtris;
+
+		use_simd = false;
+		for (i = 0; i < NUM_OCCLUSION_BINS; i++)
+			R_RasterizeOccludersTask (i, NULL);
+		memcpy (scalardepth, occlusion.depth, sizeof (float) * OCC_WIDTH * occlusion.height);
+		use_simd = saved_simd;
+		for (i = 0; i < NUM_OCCLUSION_BINS; i++)
+			R_RasterizeOccludersTask (i, NULL);
+		if (memcmp (scalardepth, occlusion.depth, sizeof (float) * OCC_WIDTH * occlusion.height))
+			++numdiffer;
+
+		for (i = 0; i < numboxes; i++)
+		{
+			vec3_t	 center, mins, maxs;
+			float	 size = OCCLUSION_RAND (4.f, 32.f);
+			qboolean culled;
+
+			center[0] = OCCLUSION_RAND (260.f, 900.f);
+			center[1] = OCCLUSION_RAND (-400.f, 400.f);
+			center[2] = OCCLUSION_RAND (-200.f, 200.f);
+			for (j = 0; j < 3; j++)
+			{
+				mins[j] = center[j] - size;
+				maxs[j] = center[j] + size;
+			}
+
+			culled = R_OcclusionCullBox (mins, maxs);
+			use_simd = false;
+			if (R_OcclusionCullBox (mins, maxs) != culled)
+				++numdiffer;
+			use_simd = saved_simd;
+			if (!culled)
+				continue;
+			++numculled;
+
+			// a 3x3x3 grid of points on the box, each must be outside the view or behind one of the walls
+			for (j = 0; j < 27; j++)
+			{
+				vec3_t	 point, v;
+				qboolean hidden;
+				point[0] = mins[0] + (maxs[0] - mins[0]) * 0.5f * (j % 3);
+				point[1] = mins[1] + (maxs[1] - mins[1]) * 0.5f * ((j / 3) % 3);
+				point[2] = mins[2] + (maxs[2] - mins[2]) * 0.5f * (j / 9);
+				R_OccluderToView (point, v);
+				hidden = v[2] < OCC_NEAR || fabsf (v[0]) > v[2] * occlusion.tanx || fabsf (v[1]) > v[2] * occlusion.tany;
+				for (k = 0; k < 2 && !hidden; k++)
+				{
+					const float t = (walls[k][0] - origin[0]) / (point[0] - origin[0]);
+					const float y = origin[1] + t * (point[1] - origin[1]);
+					const float z = origin[2] + t * (point[2] - origin[2]);
+					hidden = (t > 0.f && t < 1.f && y >= walls[k][1] && y <= walls[k][2] && z >= walls[k][3] && z <= walls[k][4]);
+				}
+				if (!hidden)
+				{
+					if (numwrong++ < 8)
+						Con_Printf ("r_occlusiontest: view %d culled a box with a visible point at %.1f %.1f %.1f\n", view, point[0], point[1], point[2]);
+					break;
+				}
+			}
+		}
+	}
+#undef OCCLUSION_RAND
+
+	use_simd = saved_simd;
+	occlusion.active = false;
+	Mem_Free (scalardepth);
+
+	Con_Printf (
+		"%d views, %d triangles: %d of %d boxes culled, %d with a visible point, %d simd/scalar differences: %s\n", numviews, numtris, numculled,
+		numviews * numboxes, numwrong, numdiffer, (!numwrong && !numdiffer) ? "PASS" : "FAIL");
+}
+
+#ifdef _DEBUG
+/*
+=============
+R_OcclusionTest_f
+
+Compares the leafs, world surfaces and entities visible from the last rendered view
+with and without occlusion culling. Rays are traced through the depth buffer pixels
+to check that no leaf where they hit the world was culled.
+=============
+*/
+void R_OcclusionTest_f (void)
+{
+	qmodel_t *model = cl.worldmodel;
+	byte	 *vis;
+	byte	 *leafculled;
+	uint32_t *surfvisited;
+	int		  i, j, pass;
+	int		  numleafs[2] = {0, 0}, numsurfs[2] = {0, 0}, numents[2] = {0, 0};
+	int		  numrays = 0, numhit = 0, numwrong = 0;
+	double	  start, rastertime, testtime;
+
+	if (!model || !r_viewleaf || model != occlusion.model)
+	{
+		Con_Printf ("test_occlusion: no map loaded\n");
+		return;
+	}
+
+	start = Sys_DoubleTime ();
+	R_SetupOcclusionView ();
+	for (i = 0; i < NUM_OCCLUSION_BINS; i++)
+		R_RasterizeOccludersTask (i, NULL);
+	rastertime = Sys_DoubleTime () - start;
+	if (!occlusion.active)
+	{
+		Con_Printf ("test_occlusion: no occluders in view\n");
+		return;
+	}
+
+	if (r_viewleaf->contents == CONTENTS_SOLID || r_viewleaf->contents == CONTENTS_SKY)
+		vis = Mod_NoVisPVS (model);
+	else
+		vis = Mod_LeafPVS (r_viewleaf, model);
+	leafculled = Mem_Alloc (model->numleafs);
+	surfvisited = Mem_Alloc (sizeof (uint32_t) * ((model->numsurfaces + 31) / 32));
+
+	start = Sys_DoubleTime ();
+	for (pass = 0; pass < 2; pass++)
+	{
+		occlusion.active = (pass == 1);
+		memset (surfvisited, 0, sizeof (uint32_t) * ((model->numsurfaces + 31) / 32));
+		for (i = 0; i < model->numleafs; i++)
+		{
+			mleaf_t *leaf = &model->leafs[1 + i];
+			if (!(vis[i / 8] & (1 << (i % 8))) || R_CullBox (leaf->minmaxs, leaf->minmaxs + 3))
+				continue;
+			if (R_OcclusionCullBox (leaf->minmaxs, leaf->minmaxs + 3))
+			{
+				leafculled[i] = true;
+				continue;
+			}
+			++numleafs[pass];
+			for (j = 0; j < leaf->nummarksurfaces; j++)
+			{
+				const int	surfnum = leaf->firstmarksurface[j];
+				msurface_t *surf = &model->surfaces[surfnum];
+				const float dot = DotProduct (occlusion.origin, surf->plane->normal) - surf->plane->dist;
+				if (surfvisited[surfnum / 32] & (1u << (surfnum % 32)))
+					continue;
+				surfvisited[surfnum / 32] |= 1u << (surfnum % 32);
+				if ((surf->flags & SURF_PLANEBACK) ? (dot > -0.01f) : (dot < 0.01f))
+					continue;
+				if (!R_OcclusionCullSurface (surfnum))
+					++numsurfs[pass];
+			}
+		}
+		for (i = 0; i < cl_numvisedicts; i++)
+		{
+			entity_t *e = cl_visedicts[i];
+			vec3_t	  mins, maxs;
+			VectorAdd (e->origin, e->model->rmins, mins);
+			VectorAdd (e->origin, e->model->rmaxs, maxs);
+			if (!R_CullBox (mins, maxs) && !R_OcclusionCullBox (mins, maxs))
+				++numents[pass];
+		}
+	}
+	testtime = (Sys_DoubleTime () - start) / 2.0;
+
+	// the point just in front of where a ray hits the world is visible
+	for (i = 0; i < occlusion.height; i += 2)
+	{
+		for (j = 0; j < OCC_WIDTH; j += 2)
+		{
+			vec3_t dir, end, impact;
+			VectorScale (occlusion.forward, 1.f, dir);
+			VectorMA (dir, (j + 0.5f - OCC_WIDTH * 0.5f) / occlusion.scalex, occlusion.right, dir);
+			VectorMA (dir, (occlusion.height * 0.5f - i - 0.5f) / occlusion.scaley, occlusion.up, dir);
+			VectorNormalize (dir);
+			VectorMA (occlusion.origin, 16384.f, dir, end);
+			TraceLine (occlusion.origin, end, impact);
+			++numrays;
+			if (VectorCompare (impact, end))
+				continue;
+			++numhit;
+			VectorMA (impact, -1.f, dir, impact);
+			const int leafnum = Mod_PointInLeaf (impact, model) - model->leafs - 1;
+			if (leafnum >= 0 && leafculled[leafnum])
+			{
+				if (numwrong++ < 8)
+					Con_Printf ("test_occlusion: ray hit leaf %d at %.1f %.1f %.1f behind the occluders\n", leafnum, impact[0], impact[1], impact[2]);
+			}
+		}
+	}
+
+	Con_Printf (
+		"%d occluders, %d triangles, %.3f ms to rasterize, %.3f ms to test\n", occlusion.numoccluders, occlusion.numtris, rastertime * 1000.0,
+		testtime * 1000.0);
+	Con_Printf (
+		"visible without/with occlusion: %d/%d leafs, %d/%d surfaces, %d/%d entities\n", numleafs[0], numleafs[1], numsurfs[0], numsurfs[1], numents[0],
+		numents[1]);
+	Con_Printf ("%d of %d rays hit the world, %d hit culled leafs\n", numhit, numrays, numwrong);
+
+	Mem_Free (surfvisited);
+	Mem_Free (leafculled);
+	occlusion.active = false;
+}
+#endif
@@ -35,7 +35,35 @@ int ramp1[8] = {0x6f, 0x6d, 0x6b, 0x69, 0x67, 0x65, 0x63, 0x61};
 int ramp2[8] = {0x6f, 0x6e, 0x6d, 0x6c, 0x6b, 0x6a, 0x68, 0x66};
 int ramp3[8] = {0x6d, 0x6b, 6, 5, 4, 3};
 
-particle_t *active_particles, *free_particles, *particles;
+/*
+Live particles are kept as structure-of-arrays pools, one per ptype_t, so
+CL_RunParticles runs one branch free kernel per type. New particles are
+staged as particle_t until the next CL_RunParticles, which keeps the R_*
+spawn functions unchanged and lets them set the type last.
+*/
+#define PARTICLE_POOL_FLOATS  9		// org[3], vel[3], ramp, die, color
+#define PARTICLE_TASK_CHUNK	  2048	// particles per task index
+#define PARTICLE_TASK_MINIMUM 8192	// smaller pools aren't worth the task overhead
+#define NUM_PARTICLE_TYPES	  (pt_blob2 + 1)
+
+typedef struct
+{
+	int	   count;
+	int	   capacity; // multiple of 4, so every array stays 16 byte aligned
+	float *block;
+	float *org[3];
+	float *vel[3];
+	float *ramp;
+	float *die;
+	float *color;
+} particlepool_t;
+
+static particlepool_t particle_pools[NUM_PARTICLE_TYPES];
+static int			  num_active_particles;
+static particle_t	 *staged_particles; // [r_numparticles]
+static int			  num_staged_particles;
+
+static void R_ParticleBenchmark_f (void);
 
 vec3_t r_pright, r_pup, r_ppn;
 
@@ -242,7 +270,7 @@ void R_InitParticles (void)
 		r_numparticles = MAX_PARTICLES;
 	}
 
-	particles = (particle_t *)Mem_Alloc (r_numparticles * sizeof (particle_t));
+	staged_particles = (particle_t *)Mem_Alloc (r_numparticles * sizeof (particle_t));
 
 	Cvar_RegisterVariable (&r_particles); // johnfitz
 	Cvar_SetCallback (&r_particles, R_SetParticleTexture_f);
@@ -250,6 +278,94 @@ void R_InitParticles (void)
 
 	R_InitParticleTextures (); // johnfitz
 	R_InitParticleIndexBuffer ();
+
+	Cmd_AddCommand ("r_particlebenchmark", R_ParticleBenchmark_f);
+}
+
+/*
+===============
+R_NewParticle
+
+Returns a zeroed particle for the spawn functions to fill in, or NULL if
+r_numparticles are already in use
+===============
+*/
+static particle_t *R_NewParticle (void)
+{
+	particle_t *p;
+
+	if (num_active_particles + num_staged_particles >= r_numparticles)
+		return NULL;
+	p = &staged_particles[num_staged_particles++];
+	memset (p, 0, sizeof (*p));
+	return p;
+}
+
+/*
+===============
+R_GrowParticlePool
+===============
+*/
+static void R_GrowParticlePool (particlepool_t *pool, int needed)
+{
+	int	   capacity = q_max (pool->capacity * 2, 256);
+	float *block;
+	int	   i;
+
+	while (capacity < needed)
+		capacity *= 2;
+	capacity = q_min (capacity, (r_numparticles + 3) & ~3);
+
+	block = (float *)Mem_AllocNonZero (capacity * PARTICLE_POOL_FLOATS * sizeof (float));
+	for (i = 0; i < PARTICLE_POOL_FLOATS; i++)
+	{
+		if (pool->block)
+			memcpy (block + i * capacity, pool->block + i * pool->capacity, pool->count * sizeof (float));
+	}
+	Mem_Free (pool->block);
+
+	pool->block = block;
+	pool->capacity = capacity;
+	for (i = 0; i < 3; i++)
+	{
+		pool->org[i] = block + i * capacity;
+		pool->vel[i] = block + (3 + i) * capacity;
+	}
+	pool->ramp = block + 6 * capacity;
+	pool->die = block + 7 * capacity;
+	pool->color = block + 8 * capacity;
+}
+
+/*
+===============
+R_FlushStagedParticles
+===============
+*/
+static void R_FlushStagedParticles (void)
+{
+	int i, j;
+
+	for (i = 0; i < num_staged_particles; i++)
+	{
+		const particle_t *p = &staged_particles[i];
+		particlepool_t	 *pool = &particle_pools[p->type];
+		const int		  n = pool->count;
+
+		if (n == pool->capacity)
+			R_GrowParticlePool (pool, n + 1);
+		for (j = 0; j < 3; j++)
+		{
+			pool->org[j][n] = p->org[j];
+			pool->vel[j][n] = p->vel[j];
+		}
+		pool->ramp[n] = p->ramp;
+		pool->die[n] = p->die;
+		pool->color[n] = p->color;
+		pool->count = n + 1;
+	}
+
+	num_active_particles += num_staged_particles;
+	num_staged_particles = 0;
 }
 
 /*
@@ -305,12 +421,8 @@ void R_EntityParticles (entity_t *ent)
 		forward[1] = cp * sy;
 		forward[2] = -sp;
 
-		if (!free_particles)
+		if (!(p = R_NewParticle ()))
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 
 		p->die = cl.time + 0.01;
 		p->color = 0x6f;
@@ -331,12 +443,10 @@ void R_ClearParticles (void)
 {
 	int i;
 
-	free_particles = &particles[0];
-	active_particles = NULL;
-
-	for (i = 0; i < r_numparticles; i++)
-		particles[i].next = &particles[i + 1];
-	particles[r_numparticles - 1].next = NULL;
+	for (i = 0; i < NUM_PARTICLE_TYPES; i++)
+		particle_pools[i].count = 0;
+	num_active_particles = 0;
+	num_staged_particles = 0;
 }
 
 /*
@@ -375,15 +485,11 @@ void R_ReadPointFile_f (void)
 			break;
 		c++;
 
-		if (!free_particles)
+		if (!(p = R_NewParticle ()))
 		{
 			Con_Printf ("Not enough free particles\n");
 			break;
 		}
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 
 		p->die = 99999;
 		p->color = (-c) & 15;
@@ -435,12 +541,8 @@ void R_ParticleExplosion (vec3_t org)
 
 	for (i = 0; i < 1024; i++)
 	{
-		if (!free_particles)
+		if (!(p = R_NewParticle ()))
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 
 		p->die = cl.time + 5;
 		p->color = ramp1[0];
@@ -479,12 +581,8 @@ void R_ParticleExplosion2 (vec3_t org, int colorStart, int colorLength)
 
 	for (i = 0; i < 512; i++)
 	{
-		if (!free_particles)
+		if (!(p = R_NewParticle ()))
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 
 		p->die = cl.time + 0.3;
 		p->color = colorStart + (colorMod % colorLength);
@@ -511,12 +609,8 @@ void R_BlobExplosion (vec3_t org)
 
 	for (i = 0; i < 1024; i++)
 	{
-		if (!free_particles)
+		if (!(p = R_NewParticle ()))
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 
 		p->die = cl.time + 1 + (rand () & 8) * 0.05;
 
@@ -555,12 +649,8 @@ void R_RunParticleEffect (vec3_t org, vec3_t dir, int color, int count)
 
 	for (i = 0; i < count; i++)
 	{
-		if (!free_particles)
+		if (!(p = R_NewParticle ()))
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 
 		if (count == 1024)
 		{ // rocket explosion
@@ -616,12 +706,8 @@ void R_LavaSplash (vec3_t org)
 		for (j = -16; j < 16; j++)
 			for (k = 0; k < 1; k++)
 			{
-				if (!free_particles)
+				if (!(p = R_NewParticle ()))
 					return;
-				p = free_particles;
-				free_particles = p->next;
-				p->next = active_particles;
-				active_particles = p;
 
 				p->die = cl.time + 2 + (rand () & 31) * 0.02;
 				p->color = 224 + (rand () & 7);
@@ -657,12 +743,8 @@ void R_TeleportSplash (vec3_t org)
 		for (j = -16; j < 16; j += 4)
 			for (k = -24; k < 32; k += 4)
 			{
-				if (!free_particles)
+				if (!(p = R_NewParticle ()))
 					return;
-				p = free_particles;
-				free_particles = p->next;
-				p->next = active_particles;
-				active_particles = p;
 
 				p->die = cl.time + 0.2 + (rand () & 7) * 0.02;
 				p->color = 7 + (rand () & 7);
@@ -712,12 +794,8 @@ void R_RocketTrail (vec3_t start, vec3_t end, int type)
 	{
 		len -= dec;
 
-		if (!free_particles)
+		if (!(p = R_NewParticle ()))
 			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 
 		VectorCopy (vec3_origin, p->vel);
 		p->die = cl.time + 2;
@@ -792,6 +870,126 @@ void R_RocketTrail (vec3_t start, vec3_t end, int type)
 	}
 }
 
+typedef struct
+{
+	particlepool_t *pool;
+	float			frametime;
+	float			velscale[3]; // v += v * velscale
+	float			gravity;	 // added to vel[2] afterwards
+	const int	   *ramptable;	 // NULL if the type doesn't ramp
+	float			rampstep;
+	float			rampmax;
+} particlejob_t;
+
+/*
+===============
+R_MoveParticles
+===============
+*/
+static void R_MoveParticles (const particlejob_t *job, int start, int end)
+{
+	particlepool_t *pool = job->pool;
+	const float		frametime = job->frametime;
+	int				i = start, j;
+
+#if defined(USE_SIMD)
+	if (use_simd)
+	{
+#if defined(USE_SSE2)
+		const __m128 vtime = _mm_set1_ps (frametime);
+		const __m128 vgrav = _mm_set1_ps (job->gravity);
+		for (; i + 4 <= end; i += 4)
+		{
+			for (j = 0; j < 3; j++)
+			{
+				const __m128 vscale = _mm_set1_ps (job->velscale[j]);
+				__m128		 vel = _mm_load_ps (pool->vel[j] + i);
+				_mm_store_ps (pool->org[j] + i, _mm_add_ps (_mm_load_ps (pool->org[j] + i), _mm_mul_ps (vel, vtime)));
+				vel = _mm_add_ps (vel, _mm_mul_ps (vel, vscale));
+				if (j == 2)
+					vel = _mm_add_ps (vel, vgrav);
+				_mm_store_ps (pool->vel[j] + i, vel);
+			}
+		}
+#elif defined(USE_NEON)
+		const float32x4_t vgrav = vdupq_n_f32 (job->gravity);
+		for (; i + 4 <= end; i += 4)
+		{
+			for (j = 0; j < 3; j++)
+			{
+				float32x4_t vel = vld1q_f32 (pool->vel[j] + i);
+				vst1q_f32 (pool->org[j] + i, vaddq_f32 (vld1q_f32 (pool->org[j] + i), vmulq_n_f32 (vel, frametime)));
+				vel = vaddq_f32 (vel, vmulq_n_f32 (vel, job->velscale[j]));
+				if (j == 2)
+					vel = vaddq_f32 (vel, vgrav);
+				vst1q_f32 (pool->vel[j] + i, vel);
+			}
+		}
+#endif
+	}
+#endif
+
+	for (; i < end; i++)
+	{
+		for (j = 0; j < 3; j++)
+		{
+			pool->org[j][i] += pool->vel[j][i] * frametime;
+			pool->vel[j][i] += pool->vel[j][i] * job->velscale[j];
+		}
+		pool->vel[2][i] += job->gravity;
+	}
+
+	if (job->ramptable)
+	{
+		for (i = start; i < end; i++)
+		{
+			pool->ramp[i] += job->rampstep;
+			if (pool->ramp[i] >= job->rampmax)
+				pool->die[i] = -1;
+			else
+				pool->color[i] = job->ramptable[(int)pool->ramp[i]];
+		}
+	}
+}
+
+/*
+===============
+R_MoveParticlesTask
+===============
+*/
+static void R_MoveParticlesTask (int index, void *payload)
+{
+	const particlejob_t *job = (const particlejob_t *)payload;
+	const int			 start = index * PARTICLE_TASK_CHUNK;
+
+	R_MoveParticles (job, start, q_min (start + PARTICLE_TASK_CHUNK, job->pool->count));
+}
+
+/*
+===============
+R_KillParticles
+
+Swap-removes everything that died before time
+===============
+*/
+static void R_KillParticles (particlepool_t *pool, double time)
+{
+	int i, j, last;
+
+	for (i = 0; i < pool->count;)
+	{
+		if (pool->die[i] >= time)
+		{
+			++i;
+			continue;
+		}
+		last = --pool->count;
+		for (j = 0; j < PARTICLE_POOL_FLOATS; j++)
+			pool->block[j * pool->capacity + i] = pool->block[j * pool->capacity + last];
+		--num_active_particles;
+	}
+}
+
 /*
 ===============
 CL_RunParticles -- johnfitz -- all the particle behavior, separated from R_DrawParticles
@@ -799,8 +997,9 @@ CL_RunParticles -- johnfitz -- all the particle behavior, separated from R_DrawP
 */
 void CL_RunParticles (void)
 {
-	particle_t	 *p, *kill;
-	int			  i;
+	particlejob_t jobs[NUM_PARTICLE_TYPES];
+	task_handle_t tasks[NUM_PARTICLE_TYPES];
+	int			  i, num_tasks = 0;
 	float		  time1, time2, time3, dvel, frametime, grav;
 	extern cvar_t sv_gravity;
 
@@ -811,91 +1010,210 @@ void CL_RunParticles (void)
 	grav = frametime * sv_gravity.value * 0.05;
 	dvel = 4 * frametime;
 
-	for (;;)
+	R_FlushStagedParticles ();
+
+	memset (jobs, 0, sizeof (jobs));
+	for (i = 0; i < NUM_PARTICLE_TYPES; i++)
 	{
-		kill = active_particles;
-		if (kill && kill->die < cl.time)
-		{
-			active_particles = kill->next;
-			kill->next = free_particles;
-			free_particles = kill;
-			continue;
-		}
-		break;
+		jobs[i].pool = &particle_pools[i];
+		jobs[i].frametime = frametime;
+		jobs[i].gravity = -grav;
 	}
+	jobs[pt_static].gravity = 0;
+
+	jobs[pt_fire].gravity = grav;
+	jobs[pt_fire].ramptable = ramp3;
+	jobs[pt_fire].rampstep = time1;
+	jobs[pt_fire].rampmax = 6;
+
+	jobs[pt_explode].velscale[0] = jobs[pt_explode].velscale[1] = jobs[pt_explode].velscale[2] = dvel;
+	jobs[pt_explode].ramptable = ramp1;
+	jobs[pt_explode].rampstep = time2;
+	jobs[pt_explode].rampmax = 8;
+
+	jobs[pt_explode2].velscale[0] = jobs[pt_explode2].velscale[1] = jobs[pt_explode2].velscale[2] = -frametime;
+	jobs[pt_explode2].ramptable = ramp2;
+	jobs[pt_explode2].rampstep = time3;
+	jobs[pt_explode2].rampmax = 8;
+
+	jobs[pt_blob].velscale[0] = jobs[pt_blob].velscale[1] = jobs[pt_blob].velscale[2] = dvel;
 
-	for (p = active_particles; p; p = p->next)
+	jobs[pt_blob2].velscale[0] = jobs[pt_blob2].velscale[1] = -dvel;
+
+	for (i = 0; i < NUM_PARTICLE_TYPES; i++)
 	{
-		for (;;)
+		particlepool_t *pool = &particle_pools[i];
+
+		R_KillParticles (pool, cl.time);
+		if (pool->count >= PARTICLE_TASK_MINIMUM)
+			tasks[num_tasks++] = Task_AllocateAssignIndexedFuncAndSubmit (
+				R_MoveParticlesTask, (pool->count + PARTICLE_TASK_CHUNK - 1) / PARTICLE_TASK_CHUNK, &jobs[i], sizeof (particlejob_t));
+		else
+			R_MoveParticles (&jobs[i], 0, pool->count);
+	}
+
+	for (i = 0; i < num_tasks; i++)
+		Task_Join (tasks[i], SDL_MUTEX_MAXWAIT);
+}
+
+/*
+===============
+R_ParticleBenchmark_f
+
+Simulates a fixed mix of explosions and trails without drawing anything.
+The particles that were alive before are put back afterwards.
+===============
+*/
+static void R_ParticleBenchmark_f (void)
+{
+	const int		frames = (Cmd_Argc () > 1) ? q_max (1, atoi (Cmd_Argv (1))) : 2000;
+	const double	saved_time = cl.time, saved_oldtime = cl.oldtime;
+	particlepool_t	saved_pools[NUM_PARTICLE_TYPES];
+	const int		saved_active = num_active_particles, saved_staged = num_staged_particles;
+	particle_t	   *saved_staged_particles = NULL;
+	double			elapsed = 0.0;
+	int64_t			updates = 0;
+	int				frame, i, peak = 0;
+	vec3_t			org, end;
+
+	if (!staged_particles)
+		return;
+
+	// run on empty pools of our own
+	memcpy (saved_pools, particle_pools, sizeof (particle_pools));
+	memset (particle_pools, 0, sizeof (particle_pools));
+	if (saved_staged)
+	{
+		saved_staged_particles = (particle_t *)Mem_AllocNonZero (saved_staged * sizeof (particle_t));
+		memcpy (saved_staged_particles, staged_particles, saved_staged * sizeof (particle_t));
+	}
+	R_ClearParticles ();
+	srand (0);
+	for (frame = 0; frame < frames; frame++)
+	{
+		cl.oldtime = cl.time;
+		cl.time += 1.0 / 72.0;
+
+		if (frame % 8 == 0)
+		{
+			org[0] = (rand () % 2048) - 1024;
+			org[1] = (rand () % 2048) - 1024;
+			org[2] = rand () % 512;
+			if (frame % 24 == 0)
+				R_BlobExplosion (org);
+			else
+				R_ParticleExplosion (org);
+		}
+		for (i = 0; i < 8; i++)
 		{
-			kill = p->next;
-			if (kill && kill->die < cl.time)
+			for (int j = 0; j < 3; j++)
 			{
-				p->next = kill->next;
-				kill->next = free_particles;
-				free_particles = kill;
-				continue;
+				org[j] = (rand () % 2048) - 1024;
+				end[j] = org[j] + (rand () % 256) - 128;
 			}
-			break;
+			R_RocketTrail (org, end, i % 7);
 		}
 
-		p->org[0] += p->vel[0] * frametime;
-		p->org[1] += p->vel[1] * frametime;
-		p->org[2] += p->vel[2] * frametime;
-
-		switch (p->type)
-		{
-		case pt_static:
-			break;
-		case pt_fire:
-			p->ramp += time1;
-			if (p->ramp >= 6)
-				p->die = -1;
-			else
-				p->color = ramp3[(int)p->ramp];
-			p->vel[2] += grav;
-			break;
+		const double start = Sys_DoubleTime ();
+		CL_RunParticles ();
+		elapsed += Sys_DoubleTime () - start;
+		updates += num_active_particles;
+		peak = q_max (peak, num_active_particles);
+	}
+	cl.time = saved_time;
+	cl.oldtime = saved_oldtime;
+
+	for (i = 0; i < NUM_PARTICLE_TYPES; i++)
+		Mem_Free (particle_pools[i].block);
+	memcpy (particle_pools, saved_pools, sizeof (particle_pools));
+	num_active_particles = saved_active;
+	num_staged_particles = saved_staged;
+	if (saved_staged_particles)
+	{
+		memcpy (staged_particles, saved_staged_particles, saved_staged * sizeof (particle_t));
+		Mem_Free (saved_staged_particles);
+	}
 
-		case pt_explode:
-			p->ramp += time2;
-			if (p->ramp >= 8)
-				p->die = -1;
-			else
-				p->color = ramp1[(int)p->ramp];
-			for (i = 0; i < 3; i++)
-				p->vel[i] += p->vel[i] * dvel;
-			p->vel[2] -= grav;
-			break;
+	Con_Printf (
+		"%d frames, %d particles peak: %.1f ms, %.2f M particles/s (%s)\n", frames, peak, elapsed * 1000.0, updates / elapsed / 1e6,
+		use_simd ? "simd" : "scalar");
+}
 
-		case pt_explode2:
-			p->ramp += time3;
-			if (p->ramp >= 8)
-				p->die = -1;
-			else
-				p->color = ramp2[(int)p->ramp];
-			for (i = 0; i < 3; i++)
-				p->vel[i] -= p->vel[i] * frametime;
-			p->vel[2] -= grav;
-			break;
+/*
+===============
+R_EmitParticle
 
-		case pt_blob:
-			for (i = 0; i < 3; i++)
-				p->vel[i] += p->vel[i] * dvel;
-			p->vel[2] -= grav;
-			break;
+Writes the 3 or 4 vertices of one particle, returns the next vertex index
+===============
+*/
+static inline int R_EmitParticle (
+	basicvertex_t *vertices, int current_vertex, vec3_t org, float color, vec3_t up, vec3_t right, vec3_t up_right, float texcoord_scale)
+{
+	float  scale;
+	vec3_t p_up, p_right, p_up_right;
 
-		case pt_blob2:
-			for (i = 0; i < 2; i++)
-				p->vel[i] -= p->vel[i] * dvel;
-			p->vel[2] -= grav;
-			break;
+	// hack a scale up to keep particles from disapearing
+	scale = (org[0] - r_origin[0]) * vpn[0] + (org[1] - r_origin[1]) * vpn[1] + (org[2] - r_origin[2]) * vpn[2];
+	if (scale < 20)
+		scale = 1 + 0.08; // johnfitz -- added .08 to be consistent
+	else
+		scale = 1 + scale * 0.004;
+
+	scale *= texturescalefactor; // johnfitz -- compensate for apparent size of different particle textures
+
+	byte *c = (byte *)&d_8to24table[(int)color];
+
+	vertices[current_vertex].position[0] = org[0];
+	vertices[current_vertex].position[1] = org[1];
+	vertices[current_vertex].position[2] = org[2];
+	vertices[current_vertex].texcoord[0] = 0.0f;
+	vertices[current_vertex].texcoord[1] = 0.0f;
+	vertices[current_vertex].color[0] = c[0];
+	vertices[current_vertex].color[1] = c[1];
+	vertices[current_vertex].color[2] = c[2];
+	vertices[current_vertex].color[3] = 255;
+	current_vertex++;
+
+	VectorMA (org, scale, up, p_up);
+	vertices[current_vertex].position[0] = p_up[0];
+	vertices[current_vertex].position[1] = p_up[1];
+	vertices[current_vertex].position[2] = p_up[2];
+	vertices[current_vertex].texcoord[0] = texcoord_scale;
+	vertices[current_vertex].texcoord[1] = 0.0f;
+	vertices[current_vertex].color[0] = c[0];
+	vertices[current_vertex].color[1] = c[1];
+	vertices[current_vertex].color[2] = c[2];
+	vertices[current_vertex].color[3] = 255;
+	current_vertex++;
 
-		case pt_grav:
-		case pt_slowgrav:
-			p->vel[2] -= grav;
-			break;
-		}
+	if (r_quadparticles.value)
+	{
+		VectorMA (org, scale, up_right, p_up_right);
+		vertices[current_vertex].position[0] = p_up_right[0];
+		vertices[current_vertex].position[1] = p_up_right[1];
+		vertices[current_vertex].position[2] = p_up_right[2];
+		vertices[current_vertex].texcoord[0] = texcoord_scale;
+		vertices[current_vertex].texcoord[1] = texcoord_scale;
+		vertices[current_vertex].color[0] = c[0];
+		vertices[current_vertex].color[1] = c[1];
+		vertices[current_vertex].color[2] = c[2];
+		vertices[current_vertex].color[3] = 255;
+		current_vertex++;
 	}
+
+	VectorMA (org, scale, right, p_right);
+	vertices[current_vertex].position[0] = p_right[0];
+	vertices[current_vertex].position[1] = p_right[1];
+	vertices[current_vertex].position[2] = p_right[2];
+	vertices[current_vertex].texcoord[0] = 0.0f;
+	vertices[current_vertex].texcoord[1] = texcoord_scale;
+	vertices[current_vertex].color[0] = c[0];
+	vertices[current_vertex].color[1] = c[1];
+	vertices[current_vertex].color[2] = c[2];
+	vertices[current_vertex].color[3] = 255;
+	current_vertex++;
+
+	return current_vertex;
 }
 
 /*
@@ -905,15 +1223,15 @@ R_DrawParticlesFaces
 */
 static void R_DrawParticlesFaces (cb_context_t *cbx)
 {
-	particle_t	 *p;
-	float		  scale, texcoord_scale;
-	vec3_t		  up, right, up_right, p_up, p_right, p_up_right;
+	float		  texcoord_scale;
+	vec3_t		  up, right, up_right;
 	extern cvar_t r_particles; // johnfitz
 
 	if (!r_particles.value)
 		return;
 
-	if (!active_particles)
+	const int num_particles = num_active_particles + num_staged_particles;
+	if (!num_particles)
 		return;
 
 	if (r_quadparticles.value)
@@ -932,9 +1250,6 @@ static void R_DrawParticlesFaces (cb_context_t *cbx)
 	for (int i = 0; i < 3; ++i)
 		up_right[i] = up[i] + right[i];
 
-	int num_particles = 0;
-	for (p = active_particles; p; p = p->next)
-		num_particles += 1;
 	Atomic_AddUInt32 (&rs_particles, num_particles);
 
 	VkBuffer	   vertex_buffer;
@@ -946,68 +1261,29 @@ static void R_DrawParticlesFaces (cb_context_t *cbx)
 		vertices = (basicvertex_t *)R_VertexAllocate (num_particles * 3 * sizeof (basicvertex_t), &vertex_buffer, &vertex_buffer_offset);
 
 	int current_vertex = 0;
-	for (p = active_particles; p; p = p->next)
+	for (int t = 0; t <= NUM_PARTICLE_TYPES; t++)
 	{
-		// hack a scale up to keep particles from disapearing
-		scale = (p->org[0] - r_origin[0]) * vpn[0] + (p->org[1] - r_origin[1]) * vpn[1] + (p->org[2] - r_origin[2]) * vpn[2];
-		if (scale < 20)
-			scale = 1 + 0.08; // johnfitz -- added .08 to be consistent
-		else
-			scale = 1 + scale * 0.004;
-
-		scale *= texturescalefactor; // johnfitz -- compensate for apparent size of different particle textures
-
-		byte *c = (byte *)&d_8to24table[(int)p->color];
-
-		vertices[current_vertex].position[0] = p->org[0];
-		vertices[current_vertex].position[1] = p->org[1];
-		vertices[current_vertex].position[2] = p->org[2];
-		vertices[current_vertex].texcoord[0] = 0.0f;
-		vertices[current_vertex].texcoord[1] = 0.0f;
-		vertices[current_vertex].color[0] = c[0];
-		vertices[current_vertex].color[1] = c[1];
-		vertices[current_vertex].color[2] = c[2];
-		vertices[current_vertex].color[3] = 255;
-		current_vertex++;
-
-		VectorMA (p->org, scale, up, p_up);
-		vertices[current_vertex].position[0] = p_up[0];
-		vertices[current_vertex].position[1] = p_up[1];
-		vertices[current_vertex].position[2] = p_up[2];
-		vertices[current_vertex].texcoord[0] = texcoord_scale;
-		vertices[current_vertex].texcoord[1] = 0.0f;
-		vertices[current_vertex].color[0] = c[0];
-		vertices[current_vertex].color[1] = c[1];
-		vertices[current_vertex].color[2] = c[2];
-		vertices[current_vertex].color[3] = 255;
-		current_vertex++;
-
-		if (r_quadparticles.value)
+		// the pools, then whatever was spawned since the last CL_RunParticles
+		const particlepool_t *pool = (t < NUM_PARTICLE_TYPES) ? &particle_pools[t] : NULL;
+		const int			  count = pool ? pool->count : num_staged_particles;
+		for (int i = 0; i < count; i++)
 		{
-			VectorMA (p->org, scale, up_right, p_up_right);
-			vertices[current_vertex].position[0] = p_up_right[0];
-			vertices[current_vertex].position[1] = p_up_right[1];
-			vertices[current_vertex].position[2] = p_up_right[2];
-			vertices[current_vertex].texcoord[0] = texcoord_scale;
-			vertices[current_vertex].texcoord[1] = texcoord_scale;
-			vertices[current_vertex].color[0] = c[0];
-			vertices[current_vertex].color[1] = c[1];
-			vertices[current_vertex].color[2] = c[2];
-			vertices[current_vertex].color[3] = 255;
-			current_vertex++;
+			vec3_t org;
+			float  color;
+			if (pool)
+			{
+				org[0] = pool->org[0][i];
+				org[1] = pool->org[1][i];
+				org[2] = pool->org[2][i];
+				color = pool->color[i];
+			}
+			else
+			{
+				VectorCopy (staged_particles[i].org, org);
+				color = staged_particles[i].color;
+			}
+			current_vertex = R_EmitParticle (vertices, current_vertex, org, color, up, right, up_right, texcoord_scale);
 		}
-
-		VectorMA (p->org, scale, right, p_right);
-		vertices[current_vertex].position[0] = p_right[0];
-		vertices[current_vertex].position[1] = p_right[1];
-		vertices[current_vertex].position[2] = p_right[2];
-		vertices[current_vertex].texcoord[0] = 0.0f;
-		vertices[current_vertex].texcoord[1] = texcoord_scale;
-		vertices[current_vertex].color[0] = c[0];
-		vertices[current_vertex].color[1] = c[1];
-		vertices[current_vertex].color[2] = c[2];
-		vertices[current_vertex].color[3] = 255;
-		current_vertex++;
 	}
 
 	vulkan_globals.vk_cmd_bind_vertex_buffers (cbx->cb, 0, 1, &vertex_buffer, &vertex_buffer_offset);
@@ -175,6 +175,8 @@ int				PScript_RunParticleEffectState (vec3_t org, vec3_t dir, float count, int
 int				PScript_ParticleTrail (vec3_t startpos, vec3_t end, int type, float timeinterval, int dlkey, vec3_t axis[3], trailstate_t **tsk);
 static qboolean P_LoadParticleSet (char *name, qboolean implicit, qboolean showwarning);
 static void		R_Particles_KillAllEffects (void);
+static void		PScript_FreeSimulation (void);
+static void		PScript_Benchmark_f (void);
 
 static void buildsintable (void)
 {
@@ -418,6 +420,7 @@ typedef struct part_type_s
 
 	int					loaded; // 0 if not loaded, 1 if automatically loaded, 2 if user loaded
 	particle_t		   *particles;
+	particle_t		   *flashes; // particles without a lifetime, drawn once and freed by the next simulation
 	clippeddecal_t	   *clippeddecals;
 	beamseg_t		   *beams;
 	struct part_type_s *nexttorun;
@@ -674,61 +677,429 @@ static qboolean Q1BSP_RecursiveHullCheck (hull_t *hull, int num, float p1f, floa
 	return Q1BSP_RecursiveHullTrace (&ctx, num, p1f, p2f, p1, p2, trace) != rht_impact;
 }
 
-float CL_TraceLine (vec3_t start, vec3_t end, vec3_t impact, vec3_t normal, int *entnum)
-{ // FIXME: not sure what to do about startsolid.
-	int		  i;
-	trace_t	  trace;
-	float	  frac = 1;
-	entity_t *ent;
-	vec3_t	  relstart, relend;
-	VectorCopy (end, impact);
-	VectorSet (normal, 0, 0, 1);
-
-	static int num_trace_line_ents;
-	static int trace_line_ents[MAX_EDICTS];
-	static int cache_valid_count = -1;
-	if (cache_valid_count != r_trace_line_cache_counter)
-	{
-		num_trace_line_ents = 0;
+/*
+===============================================================================
+
+Brush entity trace acceleration
+
+Every brush entity of the client is a leaf of a four wide bounding volume
+hierarchy. The tree is rebuilt when InvalidateTraceLineCache fires; when
+entities just move, the leaf bounds are refit and propagated to the root.
+Traces test all four child boxes of a node at once and only descend into
+the hulls of entities whose bounds the segment actually touches.
+
+===============================================================================
+*/
+
+#define TRACE_BVH_WIDTH		  4
+#define TRACE_BVH_STACK		  64
+#define TRACE_BVH_EMPTY_BOUND 1e30f
+
+typedef struct
+{
+	float bmin[3][TRACE_BVH_WIDTH]; // SoA bounds of the children
+	float bmax[3][TRACE_BVH_WIDTH];
+	int	  child[TRACE_BVH_WIDTH]; // >= 0 is a node, < 0 is entity -1 - child
+} tracebvhnode_t;
+
+typedef struct
+{
+	int		 entnum;
+	qmodel_t *model; // to catch model changes that didn't invalidate the cache
+	vec3_t	 origin; // at the last refit
+	vec3_t	 center; // only valid while building
+} tracebvhleaf_t;
+
+typedef struct
+{
+	vec3_t start, end;	   // in
+	vec3_t impact, normal; // out
+	float  frac;
+	int	   entity;
+} cltraceline_t;
+
+static tracebvhnode_t *trace_bvh_nodes;
+static int			   trace_bvh_numnodes;
+static tracebvhleaf_t *trace_bvh_leafs;
+static int			   trace_bvh_numleafs;
+static int			   trace_bvh_maxleafs;
+static int			   trace_bvh_sortaxis;
+static int			   trace_bvh_cachecount = -1;
+static int			   trace_bvh_framecount = -1;
+
+/*
+===============
+CL_TraceBVHCompareLeafs
+===============
+*/
+static int CL_TraceBVHCompareLeafs (const void *a, const void *b)
+{
+	const float ca = ((const tracebvhleaf_t *)a)->center[trace_bvh_sortaxis];
+	const float cb = ((const tracebvhleaf_t *)b)->center[trace_bvh_sortaxis];
+	return (ca > cb) - (ca < cb);
+}
+
+/*
+===============
+CL_TraceBVHSplit
+
+Sorts the leafs along the longest axis of their centers and returns the
+size of the first half
+===============
+*/
+static int CL_TraceBVHSplit (tracebvhleaf_t *leafs, int count)
+{
+	vec3_t mins, maxs;
+	int	   i, k;
+
+	VectorCopy (leafs[0].center, mins);
+	VectorCopy (leafs[0].center, maxs);
+	for (i = 1; i < count; i++)
+	{
+		for (k = 0; k < 3; k++)
+		{
+			mins[k] = q_min (mins[k], leafs[i].center[k]);
+			maxs[k] = q_max (maxs[k], leafs[i].center[k]);
+		}
+	}
+	VectorSubtract (maxs, mins, maxs);
+	trace_bvh_sortaxis = (maxs[0] >= maxs[1] && maxs[0] >= maxs[2]) ? 0 : (maxs[1] >= maxs[2]) ? 1 : 2;
+	qsort (leafs, count, sizeof (*leafs), CL_TraceBVHCompareLeafs);
+	return count / 2;
+}
+
+/*
+===============
+CL_TraceBVHBuildNode
+
+Nodes are allocated before their children, so walking them backwards
+always visits children first
+===============
+*/
+static int CL_TraceBVHBuildNode (int first, int count)
+{
+	const int		node = trace_bvh_numnodes++;
+	tracebvhleaf_t *leafs = &trace_bvh_leafs[first];
+	int				groupfirst[TRACE_BVH_WIDTH], groupcount[TRACE_BVH_WIDTH];
+	int				numgroups = 0, i;
+
+	if (count <= TRACE_BVH_WIDTH)
+	{
+		for (i = 0; i < count; i++)
+		{
+			groupfirst[numgroups] = first + i;
+			groupcount[numgroups++] = 1;
+		}
+	}
+	else
+	{
+		const int half = CL_TraceBVHSplit (leafs, count);
+		const int lower = CL_TraceBVHSplit (leafs, half);
+		const int upper = CL_TraceBVHSplit (leafs + half, count - half);
+
+		groupfirst[0] = first;
+		groupcount[0] = lower;
+		groupfirst[1] = first + lower;
+		groupcount[1] = half - lower;
+		groupfirst[2] = first + half;
+		groupcount[2] = upper;
+		groupfirst[3] = first + half + upper;
+		groupcount[3] = count - half - upper;
+		numgroups = 4;
+	}
+
+	for (i = 0; i < TRACE_BVH_WIDTH; i++)
+	{
+		int child;
+		if (i >= numgroups)
+			child = -1 - MAX_EDICTS; // never hit, its bounds stay empty
+		else if (groupcount[i] == 1)
+			child = -1 - groupfirst[i];
+		else
+			child = CL_TraceBVHBuildNode (groupfirst[i], groupcount[i]);
+		trace_bvh_nodes[node].child[i] = child;
+	}
+	return node;
+}
+
+/*
+===============
+CL_TraceBVHRefit
+===============
+*/
+static void CL_TraceBVHRefit (void)
+{
+	int i, j, k;
+
+	for (i = trace_bvh_numnodes - 1; i >= 0; i--)
+	{
+		tracebvhnode_t *node = &trace_bvh_nodes[i];
+		for (j = 0; j < TRACE_BVH_WIDTH; j++)
+		{
+			const int child = node->child[j];
+			if (child >= 0)
+			{
+				const tracebvhnode_t *sub = &trace_bvh_nodes[child];
+				for (k = 0; k < 3; k++)
+				{
+					node->bmin[k][j] = q_min (q_min (sub->bmin[k][0], sub->bmin[k][1]), q_min (sub->bmin[k][2], sub->bmin[k][3]));
+					node->bmax[k][j] = q_max (q_max (sub->bmax[k][0], sub->bmax[k][1]), q_max (sub->bmax[k][2], sub->bmax[k][3]));
+				}
+			}
+			else if (-1 - child < trace_bvh_numleafs)
+			{
+				// the hull is traced unrotated relative to the origin, so these bounds match it exactly.
+				// the model bounds are already spread by a unit, one more covers DIST_EPSILON
+				tracebvhleaf_t *leaf = &trace_bvh_leafs[-1 - child];
+				for (k = 0; k < 3; k++)
+				{
+					node->bmin[k][j] = leaf->origin[k] + leaf->model->mins[k] - 1;
+					node->bmax[k][j] = leaf->origin[k] + leaf->model->maxs[k] + 1;
+				}
+			}
+			else
+			{
+				for (k = 0; k < 3; k++)
+				{
+					node->bmin[k][j] = TRACE_BVH_EMPTY_BOUND;
+					node->bmax[k][j] = -TRACE_BVH_EMPTY_BOUND;
+				}
+			}
+		}
+	}
+}
+
+/*
+===============
+CL_CacheTraceLineEnts
+
+Brings the hierarchy up to date, must be called on the main thread before
+tracing. Unless forced, moved entities are only picked up once per frame.
+===============
+*/
+static void CL_CacheTraceLineEnts (qboolean force)
+{
+	qboolean moved = false;
+	int		 i;
+
+	if (!force && trace_bvh_framecount == host_framecount && trace_bvh_cachecount == r_trace_line_cache_counter)
+		return;
+	trace_bvh_framecount = host_framecount;
+
+	for (i = 0; i < trace_bvh_numleafs && trace_bvh_cachecount == r_trace_line_cache_counter; i++)
+	{
+		tracebvhleaf_t *leaf = &trace_bvh_leafs[i];
+		entity_t	   *ent = &cl.entities[leaf->entnum];
+		if (leaf->entnum >= cl.num_entities || ent->model != leaf->model)
+			trace_bvh_cachecount = -1;
+		else if (!VectorCompare (ent->origin, leaf->origin))
+		{
+			VectorCopy (ent->origin, leaf->origin);
+			moved = true;
+		}
+	}
+
+	if (trace_bvh_cachecount != r_trace_line_cache_counter)
+	{
+		if (trace_bvh_maxleafs < cl.num_entities)
+		{
+			trace_bvh_maxleafs = cl.num_entities;
+			trace_bvh_leafs = Mem_Realloc (trace_bvh_leafs, sizeof (*trace_bvh_leafs) * trace_bvh_maxleafs);
+			trace_bvh_nodes = Mem_Realloc (trace_bvh_nodes, sizeof (*trace_bvh_nodes) * trace_bvh_maxleafs);
+		}
+
+		trace_bvh_numleafs = 0;
 		for (i = 0; i < cl.num_entities; i++)
 		{
-			ent = &cl.entities[i];
+			entity_t	   *ent = &cl.entities[i];
+			tracebvhleaf_t *leaf;
 			if (!ent->model || ent->model->needload || ent->model->type != mod_brush)
 				continue;
-			trace_line_ents[num_trace_line_ents++] = i;
+			leaf = &trace_bvh_leafs[trace_bvh_numleafs++];
+			leaf->entnum = i;
+			leaf->model = ent->model;
+			VectorCopy (ent->origin, leaf->origin);
+			VectorAdd (ent->model->mins, ent->model->maxs, leaf->center);
+			VectorMA (ent->origin, 0.5f, leaf->center, leaf->center);
 		}
-		cache_valid_count = r_trace_line_cache_counter;
+
+		trace_bvh_numnodes = 0;
+		if (trace_bvh_numleafs)
+			CL_TraceBVHBuildNode (0, trace_bvh_numleafs);
+		trace_bvh_cachecount = r_trace_line_cache_counter;
+		moved = true;
 	}
 
-	if (entnum)
-		*entnum = 0;
-	for (i = 0; i < num_trace_line_ents; i++)
+	if (moved)
+		CL_TraceBVHRefit ();
+}
+
+/*
+===============
+CL_FreeTraceLineEnts
+===============
+*/
+static void CL_FreeTraceLineEnts (void)
+{
+	SAFE_FREE (trace_bvh_nodes);
+	SAFE_FREE (trace_bvh_leafs);
+	trace_bvh_numnodes = trace_bvh_numleafs = trace_bvh_maxleafs = 0;
+	trace_bvh_cachecount = -1;
+}
+
+/*
+===============
+CL_TraceBVHHitMask
+
+Returns a bit for every child box the segment enters before maxfrac. nearplane
+and farplane pick the box planes facing the segment per axis.
+===============
+*/
+static FORCE_INLINE uint32_t
+CL_TraceBVHHitMask (const tracebvhnode_t *node, const vec3_t start, const vec3_t invdir, const int nearplane[3], const int farplane[3], float maxfrac)
+{
+	const float *const planes[2][3] = {
+		{node->bmin[0], node->bmin[1], node->bmin[2]},
+		{node->bmax[0], node->bmax[1], node->bmax[2]},
+	};
+	uint32_t mask = 0;
+	int		 i, k;
+
+#if defined(USE_SIMD)
+	if (use_simd)
+	{
+#if defined(USE_SSE2)
+		__m128 tnear = _mm_setzero_ps ();
+		__m128 tfar = _mm_set1_ps (maxfrac);
+		for (k = 0; k < 3; k++)
+		{
+			const __m128 org = _mm_set1_ps (start[k]);
+			const __m128 inv = _mm_set1_ps (invdir[k]);
+			tnear = _mm_max_ps (tnear, _mm_mul_ps (_mm_sub_ps (_mm_loadu_ps (planes[nearplane[k]][k]), org), inv));
+			tfar = _mm_min_ps (tfar, _mm_mul_ps (_mm_sub_ps (_mm_loadu_ps (planes[farplane[k]][k]), org), inv));
+		}
+		return (uint32_t)_mm_movemask_ps (_mm_cmple_ps (tnear, tfar));
+#elif defined(USE_NEON)
+		static const int32x4_t shift = {0, 1, 2, 3};
+		float32x4_t			   tnear = vdupq_n_f32 (0.0f);
+		float32x4_t			   tfar = vdupq_n_f32 (maxfrac);
+		for (k = 0; k < 3; k++)
+		{
+			const float32x4_t org = vdupq_n_f32 (start[k]);
+			const float32x4_t inv = vdupq_n_f32 (invdir[k]);
+			tnear = vmaxq_f32 (tnear, vmulq_f32 (vsubq_f32 (vld1q_f32 (planes[nearplane[k]][k]), org), inv));
+			tfar = vminq_f32 (tfar, vmulq_f32 (vsubq_f32 (vld1q_f32 (planes[farplane[k]][k]), org), inv));
+		}
+		return vaddvq_u32 (vshlq_u32 (vshrq_n_u32 (vcleq_f32 (tnear, tfar), 31), shift));
+#endif
+	}
+#endif
+
+	for (i = 0; i < TRACE_BVH_WIDTH; i++)
 	{
-		ent = &cl.entities[trace_line_ents[i]];
+		float tnear = 0.0f, tfar = maxfrac;
+		for (k = 0; k < 3; k++)
+		{
+			tnear = q_max (tnear, (planes[nearplane[k]][k][i] - start[k]) * invdir[k]);
+			tfar = q_min (tfar, (planes[farplane[k]][k][i] - start[k]) * invdir[k]);
+		}
+		if (tnear <= tfar)
+			mask |= 1u << i;
+	}
+	return mask;
+}
+
+/*
+===============
+CL_TraceLineBatch
+
+Safe to call from workers, as long as CL_CacheTraceLineEnts ran on the main
+thread since the entities last changed
+===============
+*/
+static void CL_TraceLineBatch (cltraceline_t *lines, int count)
+{
+	int stack[TRACE_BVH_STACK];
+	int i, k;
 
-		// FIXME: deal with rotations
-		VectorSubtract (start, ent->origin, relstart);
-		VectorSubtract (end, ent->origin, relend);
+	for (i = 0; i < count; i++)
+	{ // FIXME: not sure what to do about startsolid.
+		cltraceline_t *line = &lines[i];
+		vec3_t		   invdir;
+		int			   nearplane[3], farplane[3];
+		int			   numstack = 0;
+
+		VectorCopy (line->end, line->impact);
+		VectorSet (line->normal, 0, 0, 1);
+		line->frac = 1;
+		line->entity = 0;
+		if (!trace_bvh_numnodes)
+			continue;
 
-		memset (&trace, 0, sizeof (trace));
-		trace.fraction = 1;
-		Q1BSP_RecursiveHullCheck (&ent->model->hulls[0], ent->model->hulls[0].firstclipnode, 0, 1, relstart, relend, &trace);
+		// segments parallel to an axis get a huge but finite slope, so 0 * inv stays 0
+		for (k = 0; k < 3; k++)
+		{
+			const float d = line->end[k] - line->start[k];
+			invdir[k] = (fabsf (d) > 1e-20f) ? 1.0f / d : ((d < 0.0f) ? -1e30f : 1e30f);
+			nearplane[k] = invdir[k] < 0.0f;
+			farplane[k] = !nearplane[k];
+		}
 
-		if (frac > trace.fraction)
+		stack[numstack++] = 0;
+		while (numstack > 0 && line->frac > 0)
 		{
-			frac = trace.fraction;
+			const tracebvhnode_t *node = &trace_bvh_nodes[stack[--numstack]];
+			uint32_t			  mask = CL_TraceBVHHitMask (node, line->start, invdir, nearplane, farplane, line->frac);
 
-			// FIXME: deal with rotations.
-			VectorAdd (trace.endpos, ent->origin, impact);
-			VectorCopy (trace.plane.normal, normal);
+			while (mask)
+			{
+				const int child = node->child[FindFirstBitNonZero (mask)];
+				mask &= mask - 1;
 
-			if (entnum)
-				*entnum = i;
-			if (frac <= 0)
-				break;
+				if (child >= 0)
+					stack[numstack++] = child;
+				else
+				{
+					const tracebvhleaf_t *leaf = &trace_bvh_leafs[-1 - child];
+					trace_t				  trace;
+					vec3_t				  relstart, relend;
+
+					// FIXME: deal with rotations
+					VectorSubtract (line->start, leaf->origin, relstart);
+					VectorSubtract (line->end, leaf->origin, relend);
+
+					memset (&trace, 0, sizeof (trace));
+					trace.fraction = 1;
+					Q1BSP_RecursiveHullCheck (&leaf->model->hulls[0], leaf->model->hulls[0].firstclipnode, 0, 1, relstart, relend, &trace);
+
+					if (line->frac > trace.fraction)
+					{
+						line->frac = trace.fraction;
+
+						// FIXME: deal with rotations.
+						VectorAdd (trace.endpos, leaf->origin, line->impact);
+						VectorCopy (trace.plane.normal, line->normal);
+						line->entity = leaf->entnum;
+					}
+				}
+			}
 		}
 	}
-	return frac;
+}
+
+float CL_TraceLine (vec3_t start, vec3_t end, vec3_t impact, vec3_t normal, int *entnum)
+{
+	cltraceline_t line;
+
+	CL_CacheTraceLineEnts (false);
+	VectorCopy (start, line.start);
+	VectorCopy (end, line.end);
+	CL_TraceLineBatch (&line, 1);
+	VectorCopy (line.impact, impact);
+	VectorCopy (line.normal, normal);
+	if (entnum)
+		*entnum = line.entity;
+	return line.frac;
 }
 
 // these are not the actual values, but they'll do
@@ -1354,6 +1725,13 @@ static void P_ResetToDefaults (part_type_t *ptype)
 		free_particles = ptype->particles;
 		ptype->particles = parts;
 	}
+	while (ptype->flashes)
+	{
+		parts = ptype->flashes->next;
+		ptype->flashes->next = free_particles;
+		free_particles = ptype->flashes;
+		ptype->flashes = parts;
+	}
 
 	// if we're in the runstate loop through and remove from linked list
 	if (ptype->state & PS_INRUNLIST)
@@ -3286,6 +3664,7 @@ void PScript_InitParticles (void)
 	Cvar_RegisterVariable (&r_lightflicker);
 
 	Cmd_AddCommand ("r_partredirect", P_PartRedirect_f);
+	Cmd_AddCommand ("r_partbenchmark", PScript_Benchmark_f);
 
 	// #if _DEBUG
 	Cmd_AddCommand ("r_partinfo", P_PartInfo_f);
@@ -3352,6 +3731,8 @@ void PScript_Shutdown (void)
 	decals = NULL;
 	Mem_Free (trailstates);
 	trailstates = NULL;
+	PScript_FreeSimulation ();
+	CL_FreeTraceLineEnts ();
 
 	free_particles = NULL;
 	free_decals = NULL;
@@ -3528,6 +3909,7 @@ void PScript_ClearParticles (qboolean load)
 	{
 		part_type[i].clippeddecals = NULL;
 		part_type[i].particles = NULL;
+		part_type[i].flashes = NULL;
 		part_type[i].beams = NULL;
 	}
 
@@ -6185,206 +6567,943 @@ static void R_AddTexturedParticle (scenetris_t *t, particle_t *p, plooks_t *type
 	t->numidx += 6;
 }
 
-static void PScript_DrawParticleTypes (cb_context_t *cbx, float pframetime)
+/*
+===============================================================================
+
+Simulation
+
+PScript_SimulateParticles advances every type in the run list once per frame
+on the main thread, before the scene is drawn. Types don't depend on each
+other, so each one is simulated by its own worker task. The workers only
+queue what would allocate (emitters, trails, impact effects and decals) and
+the particles that need a collision trace. Once all of them are done the
+traces run as one batch and the queues are replayed in run list order.
+PScript_DrawParticleTypes then only turns the simulated state into vertices.
+
+===============================================================================
+*/
+
+#define PARTICLE_TRACE_CHUNK 64
+
+typedef struct
 {
-	void (*bdraw) (scenetris_t * t, beamseg_t * p, plooks_t * type);
-	void (*tdraw) (scenetris_t * t, particle_t * p, plooks_t * type);
+	particle_t *p; // NULL for the single emit of a particle without lifetime
+	vec3_t		org;
+	vec3_t		dir; // end of the segment for trails
+	qboolean	trail;
+} particleemit_t;
 
-	vec3_t			oldorg;
-	vec3_t			stop, normal;
-	part_type_t	   *type, *lastvalidtype;
-	particle_t	   *p, *kill;
-	clippeddecal_t *d, *dkill;
-	ramp_t		   *ramp;
-	float			grav;
-	vec3_t			friction;
-	scenetris_t	   *scenetri;
-	float			dist;
-	particle_t	   *kill_list, *kill_first; // the kill list is to stop particles from being freed and reused whilst still in this loop
-											// which is bad because beams need to find out when particles died. Reuse can do wierd things.
-											// remember that they're not drawn instantly either.
-	beamseg_t	   *b, *bkill;
+typedef struct
+{
+	particle_t	*p;
+	part_type_t *type;
+} particletrace_t;
 
-	int			 traces = r_particle_tracelimit.value;
-	int			 rampind;
-	static float flurrytime;
-	qboolean	 doflurry;
-	int			 batchflags;
-	unsigned int i, o;
+typedef struct
+{
+	part_type_t *type;
 
-	if (r_plooksdirty)
+	// the kill list is to stop particles from being freed and reused whilst the queues are still replayed
+	// which is bad because beams need to find out when particles died. Reuse can do wierd things.
+	particle_t	   *kill_first, *kill_last;
+	clippeddecal_t *dead_decals_first, *dead_decals_last;
+	beamseg_t	   *dead_beams_first, *dead_beams_last;
+
+	particleemit_t *emits;
+	int				numemits, maxemits;
+	particle_t	  **clips; // moved far enough since their last trace
+	int				numclips, maxclips;
+	int				numparticles;
+	unsigned int	flurryseed; // drawn from rand () on the main thread, workers must not call rand ()
+} particlesim_t;
+
+typedef struct
+{
+	float	 frametime;
+	qboolean doflurry;
+} particlesimjob_t;
+
+static particlesim_t   *part_sims;
+static int				part_maxsims;
+static particletrace_t *part_traces;
+static cltraceline_t   *part_tracelines; // same order as part_traces
+static int				part_maxtraces;
+static float			part_oldtime;
+static int				part_numsimulated;
+static int				part_numtraced;
+
+/*
+===============
+PScript_FreeSimulation
+===============
+*/
+static void PScript_FreeSimulation (void)
+{
+	while (part_maxsims > 0)
 	{
-		int j, k;
+		part_maxsims--;
+		Mem_Free (part_sims[part_maxsims].emits);
+		Mem_Free (part_sims[part_maxsims].clips);
+	}
+	SAFE_FREE (part_sims);
+	SAFE_FREE (part_traces);
+	SAFE_FREE (part_tracelines);
+	part_maxtraces = 0;
+}
+
+/*
+===============
+PScript_UpdateLooks
+===============
+*/
+static void PScript_UpdateLooks (void)
+{
+	int j, k;
 
-		pe_default = PScript_FindParticleType ("PE_DEFAULT");
-		pe_size2 = PScript_FindParticleType ("PE_SIZE2");
-		pe_size3 = PScript_FindParticleType ("PE_SIZE3");
-		pe_defaulttrail = PScript_FindParticleType ("PE_DEFAULTTRAIL");
+	pe_default = PScript_FindParticleType ("PE_DEFAULT");
+	pe_size2 = PScript_FindParticleType ("PE_SIZE2");
+	pe_size3 = PScript_FindParticleType ("PE_SIZE3");
+	pe_defaulttrail = PScript_FindParticleType ("PE_DEFAULTTRAIL");
 
-		for (j = 0; j < numparticletypes; j++)
+	for (j = 0; j < numparticletypes; j++)
+	{
+		// set the fallback
+		part_type[j].slooks = &part_type[j].looks;
+		for (k = j - 1; k-- > 0;)
 		{
-			// set the fallback
-			part_type[j].slooks = &part_type[j].looks;
-			for (k = j - 1; k-- > 0;)
+			if (!memcmp (&part_type[j].looks, &part_type[k].looks, sizeof (plooks_t)))
 			{
-				if (!memcmp (&part_type[j].looks, &part_type[k].looks, sizeof (plooks_t)))
-				{
-					part_type[j].slooks = part_type[k].slooks;
-					break;
-				}
+				part_type[j].slooks = part_type[k].slooks;
+				break;
 			}
 		}
-		r_plooksdirty = false;
-		CL_RegisterParticles ();
-		PScript_RecalculateSkyTris ();
 	}
+	r_plooksdirty = false;
+	CL_RegisterParticles ();
+	PScript_RecalculateSkyTris ();
+}
 
-	VectorScale (vup, 1.5, pup);
-	VectorScale (vright, 1.5, pright);
+static inline void PScript_SimKillParticle (particlesim_t *sim, particle_t *p)
+{
+	p->next = sim->kill_first;
+	sim->kill_first = p;
+	if (!sim->kill_last) // branch here is probably faster than list traversal later
+		sim->kill_last = p;
+}
 
-	kill_list = kill_first = NULL;
+static inline void PScript_SimKillDecal (particlesim_t *sim, clippeddecal_t *d)
+{
+	d->next = sim->dead_decals_first;
+	sim->dead_decals_first = d;
+	if (!sim->dead_decals_last)
+		sim->dead_decals_last = d;
+}
 
-	flurrytime -= pframetime;
-	if (flurrytime < 0)
-	{
-		doflurry = true;
-		flurrytime = 0.1 + frandom () * 0.3;
-	}
-	else
-		doflurry = false;
+static inline void PScript_SimKillBeam (particlesim_t *sim, beamseg_t *b)
+{
+	b->next = sim->dead_beams_first;
+	sim->dead_beams_first = b;
+	if (!sim->dead_beams_last)
+		sim->dead_beams_last = b;
+}
 
-	if (!free_decals)
+static void PScript_SimQueueEmit (particlesim_t *sim, particle_t *p, vec3_t org, vec3_t dir, qboolean trail)
+{
+	particleemit_t *emit;
+
+	if (sim->numemits == sim->maxemits)
 	{
-		// mark some as dead, so we can keep spawning new ones next frame.
-		for (i = 0; i < 256; i++)
-		{
-			decals[r_decalrecycle].die = -1;
-			if (++r_decalrecycle >= r_numdecals)
-				r_decalrecycle = 0;
-		}
+		sim->maxemits = q_max (sim->maxemits * 2, 256);
+		sim->emits = Mem_Realloc (sim->emits, sizeof (*sim->emits) * sim->maxemits);
 	}
-	if (!free_particles)
+	emit = &sim->emits[sim->numemits++];
+	emit->p = p;
+	VectorCopy (org, emit->org);
+	VectorCopy (dir, emit->dir);
+	emit->trail = trail;
+}
+
+static inline float PScript_SimCRandom (particlesim_t *sim)
+{
+	sim->flurryseed = sim->flurryseed * 1103515245u + 12345u;
+	return ((sim->flurryseed >> 16) & 0x7fff) * (2.0f / 0x7fff) - 1.0f;
+}
+
+static void PScript_SimQueueClip (particlesim_t *sim, particle_t *p)
+{
+	if (sim->numclips == sim->maxclips)
 	{
-		// mark some as dead.
-		for (i = 0; i < 256; i++)
-		{
-			particles[r_particlerecycle].die = -1;
-			if (++r_particlerecycle >= r_numparticles)
-				r_particlerecycle = 0;
-		}
+		sim->maxclips = q_max (sim->maxclips * 2, 256);
+		sim->clips = Mem_Realloc (sim->clips, sizeof (*sim->clips) * sim->maxclips);
 	}
+	sim->clips[sim->numclips++] = p;
+}
 
-	for (type = part_run_list, lastvalidtype = NULL; type != NULL; type = type->nexttorun)
-	{
-		if (type->clippeddecals)
-		{
-			if (cl_numstris && cl_stris[cl_numstris - 1].texture == type->looks.texture && cl_stris[cl_numstris - 1].blendmode == type->looks.blendmode &&
-				cl_stris[cl_numstris - 1].beflags == 0)
-				scenetri = &cl_stris[cl_numstris - 1];
-			else
-			{
-				if (cl_numstris == cl_maxstris)
-				{
-					cl_maxstris += 8;
-					cl_stris = Mem_Realloc (cl_stris, sizeof (*cl_stris) * cl_maxstris);
+/*
+===============
+PScript_SimulateType
+
+Runs on a worker, must not touch anything but its own type and sim
+===============
+*/
+static void PScript_SimulateType (particlesim_t *sim, float pframetime, qboolean doflurry)
+{
+	part_type_t	   *type = sim->type;
+	vec3_t			oldorg;
+	vec3_t			stop;
+	particle_t	   *p, *kill;
+	clippeddecal_t *d, *dkill;
+	ramp_t		   *ramp;
+	float			grav;
+	vec3_t			friction;
+	beamseg_t	   *b, *bkill;
+	int				rampind;
+
+	sim->kill_first = sim->kill_last = NULL;
+	sim->dead_decals_first = sim->dead_decals_last = NULL;
+	sim->dead_beams_first = sim->dead_beams_last = NULL;
+	sim->numemits = 0;
+	sim->numclips = 0;
+	sim->numparticles = 0;
+
+	if (type->clippeddecals)
+	{
+		for (;;)
+		{
+			dkill = type->clippeddecals;
+			if (dkill && dkill->die < particletime)
+			{
+				type->clippeddecals = dkill->next;
+				PScript_SimKillDecal (sim, dkill);
+				continue;
+			}
+			break;
+		}
+		for (d = type->clippeddecals; d; d = d->next)
+		{
+			for (;;)
+			{
+				dkill = d->next;
+				if (dkill && dkill->die < particletime)
+				{
+					d->next = dkill->next;
+					PScript_SimKillDecal (sim, dkill);
+					continue;
+				}
+				break;
+			}
+
+			if (d->die - particletime <= type->die)
+			{
+				switch (type->rampmode)
+				{
+				case RAMP_NEAREST:
+					rampind = (int)(type->rampindexes * (type->die - (d->die - particletime)) / type->die);
+					if (rampind >= type->rampindexes)
+						rampind = type->rampindexes - 1;
+					ramp = type->ramp + rampind;
+					VectorCopy (ramp->rgb, d->rgba);
+					d->rgba[3] = ramp->alpha;
+					break;
+				case RAMP_LERP:
+				{
+					float frac = (type->rampindexes * (type->die - (d->die - particletime)) / type->die);
+					int	  s1, s2;
+					s1 = frac;
+					s2 = s1 + 1;
+					if (s1 > type->rampindexes - 1)
+						s1 = type->rampindexes - 1;
+					if (s2 > type->rampindexes - 1)
+						s2 = type->rampindexes - 1;
+					frac -= s1;
+					VectorInterpolate (type->ramp[s1].rgb, frac, type->ramp[s2].rgb, d->rgba);
+					FloatInterpolate (type->ramp[s1].alpha, frac, type->ramp[s2].alpha, d->rgba[3]);
+				}
+				break;
+				case RAMP_DELTA: // particle ramps
+					ramp = type->ramp + (int)(type->rampindexes * (type->die - (d->die - particletime)) / type->die);
+					VectorMA (d->rgba, pframetime, ramp->rgb, d->rgba);
+					d->rgba[3] -= pframetime * ramp->alpha;
+					break;
+				case RAMP_NONE: // particle changes acording to it's preset properties.
+					if (particletime < (d->die - type->die + type->rgbchangetime))
+					{
+						d->rgba[0] += pframetime * type->rgbchange[0];
+						d->rgba[1] += pframetime * type->rgbchange[1];
+						d->rgba[2] += pframetime * type->rgbchange[2];
+					}
+					d->rgba[3] += pframetime * type->alphachange;
+				}
+			}
+		}
+	}
+
+	if (!type->die)
+	{
+		// particles without a lifetime are drawn exactly once, the ones from the last frame go away now
+		while ((p = type->flashes))
+		{
+			type->flashes = p->next;
+			PScript_SimKillParticle (sim, p);
+		}
+		type->flashes = type->particles;
+		type->particles = NULL;
+
+		for (p = type->flashes; p; p = p->next)
+		{
+			// make sure emitter runs at least once
+			if (type->emit >= 0 && type->emitstart <= 0)
+				PScript_SimQueueEmit (sim, NULL, p->org, p->vel, false);
+			sim->numparticles++;
+		}
+
+		// the same goes for beams, the ones drawn last frame are dead
+		while ((b = type->beams) && (b->flags & BS_DEAD))
+		{
+			type->beams = b->next;
+			PScript_SimKillBeam (sim, b);
+		}
+
+		for (; b; b = b->next)
+		{
+			// clean up dead entries ahead of current
+			for (;;)
+			{
+				bkill = b->next;
+				if (bkill && (bkill->flags & BS_DEAD))
+				{
+					b->next = bkill->next;
+					PScript_SimKillBeam (sim, bkill);
+					continue;
+				}
+				break;
+			}
+
+			// no BS_NODRAW implies b->next != NULL
+			// BS_NODRAW should imply b->next == NULL or b->next->flags & BS_DEAD
+			if (!(b->flags & BS_NODRAW) && b->next)
+			{
+				VectorSubtract (b->next->p->org, b->p->org, b->next->dir);
+				VectorNormalize (b->next->dir);
+			}
+
+			b->flags |= BS_DEAD;
+		}
+
+		return;
+	}
+
+	// kill off early ones, trailstates are delinked once the run list is done
+	for (;;)
+	{
+		kill = type->particles;
+		if (kill && kill->die < particletime)
+		{
+			type->particles = kill->next;
+			PScript_SimKillParticle (sim, kill);
+			continue;
+		}
+		break;
+	}
+
+	grav = type->gravity * pframetime;
+	friction[0] = 1 - type->friction[0] * pframetime;
+	friction[1] = 1 - type->friction[1] * pframetime;
+	friction[2] = 1 - type->friction[2] * pframetime;
+
+	for (p = type->particles; p; p = p->next)
+	{
+		for (;;)
+		{
+			kill = p->next;
+			if (kill && kill->die < particletime)
+			{
+				p->next = kill->next;
+				PScript_SimKillParticle (sim, kill);
+				continue;
+			}
+			break;
+		}
+
+		sim->numparticles++;
+
+		VectorCopy (p->org, oldorg);
+		if (type->flags & PT_VELOCITY)
+		{
+			p->org[0] += p->vel[0] * pframetime;
+			p->org[1] += p->vel[1] * pframetime;
+			p->org[2] += p->vel[2] * pframetime;
+			p->vel[2] -= grav;
+			if (type->flags & PT_FRICTION)
+			{
+				p->vel[0] *= friction[0];
+				p->vel[1] *= friction[1];
+				p->vel[2] *= friction[2];
+			}
+			if (type->flurry && doflurry)
+			{ // these should probably be partially synced,
+				p->vel[0] += PScript_SimCRandom (sim) * type->flurry;
+				p->vel[1] += PScript_SimCRandom (sim) * type->flurry;
+			}
+		}
+
+		p->angle += p->rotationspeed * pframetime;
+
+		switch (type->rampmode)
+		{
+		case RAMP_NEAREST:
+			rampind = (int)(type->rampindexes * (type->die - (p->die - particletime)) / type->die);
+			if (rampind >= type->rampindexes)
+				rampind = type->rampindexes - 1;
+			ramp = type->ramp + rampind;
+			VectorCopy (ramp->rgb, p->rgba);
+			p->rgba[3] = ramp->alpha;
+			p->scale = ramp->scale;
+			break;
+		case RAMP_LERP:
+		{
+			float frac = (type->rampindexes * (type->die - (p->die - particletime)) / type->die);
+			int	  s1, s2;
+			s1 = frac;
+			s2 = s1 + 1;
+			if (s1 > type->rampindexes - 1)
+				s1 = type->rampindexes - 1;
+			if (s2 > type->rampindexes - 1)
+				s2 = type->rampindexes - 1;
+			frac -= s1;
+			VectorInterpolate (type->ramp[s1].rgb, frac, type->ramp[s2].rgb, p->rgba);
+			FloatInterpolate (type->ramp[s1].alpha, frac, type->ramp[s2].alpha, p->rgba[3]);
+			FloatInterpolate (type->ramp[s1].scale, frac, type->ramp[s2].scale, p->scale);
+		}
+		break;
+		case RAMP_DELTA: // particle ramps
+			rampind = (int)(type->rampindexes * (type->die - (p->die - particletime)) / type->die);
+			if (rampind >= type->rampindexes)
+				rampind = type->rampindexes - 1;
+			ramp = type->ramp + rampind;
+			VectorMA (p->rgba, pframetime, ramp->rgb, p->rgba);
+			p->rgba[3] -= pframetime * ramp->alpha;
+			p->scale += pframetime * ramp->scale;
+			break;
+		case RAMP_NONE: // particle changes acording to it's preset properties.
+			if (particletime < (p->die - type->die + type->rgbchangetime))
+			{
+				p->rgba[0] += pframetime * type->rgbchange[0];
+				p->rgba[1] += pframetime * type->rgbchange[1];
+				p->rgba[2] += pframetime * type->rgbchange[2];
+			}
+			p->rgba[3] += pframetime * type->alphachange;
+			p->scale += pframetime * type->scaledelta;
+		}
+
+		if (type->emit >= 0)
+		{
+			if (type->emittime < 0)
+				PScript_SimQueueEmit (sim, p, oldorg, p->org, true);
+			else if (p->state.nextemit < particletime)
+				PScript_SimQueueEmit (sim, p, p->org, p->vel, false);
+		}
+
+		if (type->cliptype >= 0 && r_bouncysparks.value)
+		{
+			VectorSubtract (p->org, p->oldorg, stop);
+			if (!type->clipbounce || DotProduct (stop, stop) > 10 * 10)
+				PScript_SimQueueClip (sim, p);
+		}
+	}
+
+	// beams are dealt with here
+
+	// kill early entries
+	for (;;)
+	{
+		bkill = type->beams;
+		if (bkill && (bkill->flags & BS_DEAD || bkill->p->die < particletime) && !(bkill->flags & BS_LASTSEG))
+		{
+			type->beams = bkill->next;
+			PScript_SimKillBeam (sim, bkill);
+			continue;
+		}
+		break;
+	}
+
+	b = type->beams;
+	if (b)
+	{
+		for (;;)
+		{
+			if (b->next)
+			{
+				// mark dead entries
+				if (b->flags & (BS_LASTSEG | BS_DEAD | BS_NODRAW))
+				{
+					// kill some more dead entries
+					for (;;)
+					{
+						bkill = b->next;
+						if (bkill && (bkill->flags & BS_DEAD) && !(bkill->flags & BS_LASTSEG))
+						{
+							b->next = bkill->next;
+							PScript_SimKillBeam (sim, bkill);
+							continue;
+						}
+						break;
+					}
+
+					if (!bkill) // have to check so we don't hit NULL->next
+						continue;
+				}
+				else
+				{
+					if (!(b->next->flags & BS_DEAD))
+					{
+						VectorSubtract (b->next->p->org, b->p->org, b->next->dir);
+						VectorNormalize (b->next->dir);
+					}
+
+					if (b->p->die < particletime)
+						b->flags |= BS_DEAD;
+				}
+			}
+			else
+			{
+				if (b->p->die < particletime) // end of the list check
+					b->flags |= BS_DEAD;
+
+				break;
+			}
+
+			if (b->p->die < particletime)
+				b->flags |= BS_DEAD;
+
+			b = b->next;
+		}
+	}
+}
+
+/*
+===============
+PScript_SimulateTypeTask
+===============
+*/
+static void PScript_SimulateTypeTask (int index, void *data)
+{
+	const particlesimjob_t *job = (const particlesimjob_t *)data;
+	PScript_SimulateType (&part_sims[index], job->frametime, job->doflurry);
+}
+
+/*
+===============
+PScript_TraceTask
+===============
+*/
+static void PScript_TraceTask (int index, void *data)
+{
+	const int numtraces = *(const int *)data;
+	const int first = index * PARTICLE_TRACE_CHUNK;
+
+	CL_TraceLineBatch (&part_tracelines[first], q_min (numtraces - first, PARTICLE_TRACE_CHUNK));
+}
+
+/*
+===============
+PScript_CollideParticle
+===============
+*/
+static void PScript_CollideParticle (const particletrace_t *t, cltraceline_t *line, float pframetime)
+{
+	part_type_t *type = t->type;
+	particle_t	*p = t->p;
+	float		 dist;
+
+	if (line->frac < 1)
+	{
+		if (type->clipbounce < 0)
+		{
+			p->die = -1;
+#ifdef USE_DECALS
+			if (type->clipbounce == -2)
+			{ // this type of particle splatters itself as a decal when it hits a wall.
+				decalctx_t ctx;
+				float	   m;
+				vec3_t	   vec = {0.5, 0.5, 0.431};
+				qmodel_t  *model;
+
+				ctx.entity = line->entity;
+				if (!ctx.entity)
+				{
+					model = cl.worldmodel;
+					VectorCopy (p->org, ctx.center);
+				}
+				else if (line->entity)
+				{ // this trace hit a door or something.
+					entity_t *ent = CL_EntityNum (line->entity);
+					model = ent->model;
+					VectorSubtract (p->org, ent->origin, ctx.center);
+					// FIXME: rotate center+normal around entity.
 				}
-				scenetri = &cl_stris[cl_numstris++];
-				scenetri->texture = type->looks.texture;
-				scenetri->blendmode = type->looks.blendmode;
-				scenetri->beflags = 0;
-				scenetri->firstidx = cl_numstrisidx;
-				scenetri->firstvert = cl_numstrisvert;
-				scenetri->numvert = 0;
-				scenetri->numidx = 0;
+				else
+					return; // err, no idea.
+
+				VectorScale (line->normal, -1, ctx.normal);
+				VectorNormalize (ctx.normal);
+
+				VectorNormalize (vec);
+				CrossProduct (ctx.normal, vec, ctx.tangent1);
+				RotatePointAroundVector (ctx.tangent2, ctx.normal, ctx.tangent1, frandom () * 360);
+				CrossProduct (ctx.normal, ctx.tangent2, ctx.tangent1);
+
+				VectorNormalize (ctx.tangent1);
+				VectorNormalize (ctx.tangent2);
+
+				ctx.ptype = type;
+				ctx.scale1 = type->s2 - type->s1;
+				ctx.bias1 = type->s1 + (ctx.scale1 * 0.5);
+				ctx.scale2 = type->t2 - type->t1;
+				ctx.bias2 = type->t1 + (ctx.scale2 * 0.5);
+				m = p->scale * (1.5 + frandom () * 0.5) * 0.5; // decals should be a little bigger, for some reason.
+				ctx.scale0 = 2.0 / m;
+				ctx.scale1 /= m;
+				ctx.scale2 /= m;
+
+				// inserts decals through a callback.
+				Mod_ClipDecal (
+					model, ctx.center, ctx.normal, ctx.tangent2, ctx.tangent1, m, type->surfflagmask, type->surfflagmatch, PScript_AddDecals, &ctx);
 			}
+#endif
+			return;
+		}
+		else if (part_type + type->cliptype == type)
+		{										   // bounce
+			dist = DotProduct (p->vel, line->normal); // * (-1-(rand()/(float)0x7fff)/2);
+			dist *= -type->clipbounce;
+			VectorMA (p->vel, dist, line->normal, p->vel);
+			VectorCopy (line->impact, p->org);
+
+			if (!*type->texname && VectorLength (p->vel) < 1000 * pframetime && type->looks.type == PT_NORMAL)
+			{
+				p->die = -1;
+				return;
+			}
+		}
+		else
+		{
+			p->die = -1;
+			VectorNormalize (p->vel);
+
+			if (type->clipbounce)
+			{
+				VectorScale (line->normal, type->clipbounce, line->normal);
+				PScript_RunParticleEffectState (line->impact, line->normal, type->clipcount / part_type[type->cliptype].count, type->cliptype, NULL);
+			}
+			else
+				PScript_RunParticleEffectState (line->impact, p->vel, type->clipcount / part_type[type->cliptype].count, type->cliptype, NULL);
+			return;
+		}
+	}
+	VectorCopy (p->org, p->oldorg);
+}
+
+/*
+===============
+PScript_SimulateParticles
+===============
+*/
+void PScript_SimulateParticles (void)
+{
+	static float	 flurrytime;
+	particlesimjob_t job;
+	part_type_t		*type, *lastvalidtype;
+	particlesim_t	*sim;
+	particle_t		*p;
+	entity_t		*ent;
+	vec3_t			 axis[3];
+	int				 numsims, numclips, numtraces, traces;
+	int				 i, j;
+	const qboolean	 use_tasks = !Tasks_IsWorker () && (Tasks_NumWorkers () > 1);
+
+	job.frametime = cl.time - part_oldtime;
+	if (job.frametime < 0)
+		job.frametime = 0;
+	if (job.frametime > 1)
+		job.frametime = 1;
+	part_oldtime = cl.time;
+
+	if (!r_particles.value)
+		return;
+
+	if (r_plooksdirty)
+		PScript_UpdateLooks ();
+
+	if (r_part_rain.value && r_fteparticles.value)
+	{
+		for (i = 0; i < cl.num_entities; i++)
+		{
+			ent = &cl.entities[i];
+			if (!ent->model || ent->model->needload)
+				continue;
+			if (!ent->model->skytris)
+				continue;
+			AngleVectors (ent->angles, axis[0], axis[1], axis[2]);
+			// this timer, as well as the per-tri timer, are unable to deal with certain rates+sizes. it would be good to fix that...
+			// it would also be nice to do mdls too...
+			P_AddRainParticles (ent->model, axis, ent->origin, job.frametime);
+		}
+	}
+
+	flurrytime -= job.frametime;
+	if (flurrytime < 0)
+	{
+		job.doflurry = true;
+		flurrytime = 0.1 + frandom () * 0.3;
+	}
+	else
+		job.doflurry = false;
+
+	if (!free_decals)
+	{
+		// mark some as dead, so we can keep spawning new ones next frame.
+		for (i = 0; i < 256; i++)
+		{
+			decals[r_decalrecycle].die = -1;
+			if (++r_decalrecycle >= r_numdecals)
+				r_decalrecycle = 0;
+		}
+	}
+	if (!free_particles)
+	{
+		// mark some as dead.
+		for (i = 0; i < 256; i++)
+		{
+			particles[r_particlerecycle].die = -1;
+			if (++r_particlerecycle >= r_numparticles)
+				r_particlerecycle = 0;
+		}
+	}
+
+	numsims = 0;
+	for (type = part_run_list; type != NULL; type = type->nexttorun)
+		numsims++;
+	if (numsims > part_maxsims)
+	{
+		part_sims = Mem_Realloc (part_sims, sizeof (*part_sims) * numsims);
+		memset (part_sims + part_maxsims, 0, sizeof (*part_sims) * (numsims - part_maxsims));
+		part_maxsims = numsims;
+	}
+	for (type = part_run_list, i = 0; type != NULL; type = type->nexttorun, i++)
+	{
+		part_sims[i].type = type;
+		if (job.doflurry && type->flurry)
+			part_sims[i].flurryseed = rand ();
+	}
+
+	if (use_tasks && numsims > 1)
+	{
+		task_handle_t task = Task_AllocateAssignIndexedFuncAndSubmit (PScript_SimulateTypeTask, numsims, &job, sizeof (job));
+		Task_Join (task, SDL_MUTEX_MAXWAIT);
+	}
+	else
+	{
+		for (i = 0; i < numsims; i++)
+			PScript_SimulateType (&part_sims[i], job.frametime, job.doflurry);
+	}
+
+	// decals and beams can be reused right away
+	numclips = 0;
+	for (i = 0; i < numsims; i++)
+	{
+		sim = &part_sims[i];
+		if (sim->dead_decals_first)
+		{
+			sim->dead_decals_last->next = free_decals;
+			free_decals = sim->dead_decals_first;
+		}
+		if (sim->dead_beams_first)
+		{
+			sim->dead_beams_last->next = free_beams;
+			free_beams = sim->dead_beams_first;
+		}
+		numclips += sim->numclips;
+	}
+
+	// hand out the trace budget in run list order, then trace the whole batch
+	numtraces = 0;
+	traces = r_particle_tracelimit.value;
+	if (q_min (numclips, traces) > part_maxtraces)
+	{
+		part_maxtraces = q_min (numclips, traces);
+		part_traces = Mem_Realloc (part_traces, sizeof (*part_traces) * part_maxtraces);
+		part_tracelines = Mem_Realloc (part_tracelines, sizeof (*part_tracelines) * part_maxtraces);
+	}
+	for (i = 0; i < numsims; i++)
+	{
+		sim = &part_sims[i];
+		for (j = 0; j < sim->numclips; j++)
+		{
+			p = sim->clips[j];
+			if (traces-- > 0)
+			{
+				part_traces[numtraces].p = p;
+				part_traces[numtraces].type = sim->type;
+				VectorCopy (p->oldorg, part_tracelines[numtraces].start);
+				VectorCopy (p->org, part_tracelines[numtraces].end);
+				numtraces++;
+			}
+			else
+				VectorCopy (p->org, p->oldorg);
+		}
+	}
+
+	if (numtraces)
+	{
+		CL_CacheTraceLineEnts (true);
+		if (use_tasks && numtraces > PARTICLE_TRACE_CHUNK)
+		{
+			task_handle_t task = Task_AllocateAssignIndexedFuncAndSubmit (
+				PScript_TraceTask, (numtraces + PARTICLE_TRACE_CHUNK - 1) / PARTICLE_TRACE_CHUNK, &numtraces, sizeof (numtraces));
+			Task_Join (task, SDL_MUTEX_MAXWAIT);
+		}
+		else
+		{
+			for (i = 0; i * PARTICLE_TRACE_CHUNK < numtraces; i++)
+				PScript_TraceTask (i, &numtraces);
+		}
+	}
+
+	// everything that spawns new particles runs here, in the same order the types were simulated
+	for (i = 0; i < numsims; i++)
+	{
+		sim = &part_sims[i];
+		type = sim->type;
+		for (j = 0; j < sim->numemits; j++)
+		{
+			particleemit_t *emit = &sim->emits[j];
+			if (emit->trail)
+				PScript_ParticleTrail (emit->org, emit->dir, type->emit, job.frametime, 0, NULL, &emit->p->state.trailstate);
+			else
+			{
+				if (emit->p)
+					emit->p->state.nextemit = particletime + type->emittime + frandom () * type->emitrand;
+				PScript_RunParticleEffectState (emit->org, emit->dir, 1, type->emit, NULL);
+			}
+		}
+	}
+	for (i = 0; i < numtraces; i++)
+		PScript_CollideParticle (&part_traces[i], &part_tracelines[i], job.frametime);
+
+	// lazy delete for particles is done here
+	part_numsimulated = 0;
+	for (i = 0; i < numsims; i++)
+	{
+		sim = &part_sims[i];
+		part_numsimulated += sim->numparticles;
+		if (!sim->kill_first)
+			continue;
+		if (sim->type->die && sim->type->emittime < 0)
+		{
+			for (p = sim->kill_first; p; p = p->next)
+				PScript_DelinkTrailstate (&p->state.trailstate);
+		}
+		sim->kill_last->next = free_particles;
+		free_particles = sim->kill_first;
+	}
+	part_numtraced = numtraces;
+
+	// delete from run list if necessary
+	for (type = part_run_list, lastvalidtype = NULL; type != NULL; type = type->nexttorun)
+	{
+		if (!type->particles && !type->flashes && !type->beams && !type->clippeddecals)
+		{
+			if (!lastvalidtype)
+				part_run_list = type->nexttorun;
+			else
+				lastvalidtype->nexttorun = type->nexttorun;
+			type->state &= ~PS_INRUNLIST;
+		}
+		else
+			lastvalidtype = type;
+	}
+
+	particletime += job.frametime;
+}
+
+/*
+===============================================================================
+
+Vertex generation
+
+===============================================================================
+*/
+
+static scenetris_t *PScript_NewSceneTris (gltexture_t *texture, blendmode_t blendmode, int beflags)
+{
+	scenetris_t *scenetri;
+
+	if (cl_numstris == cl_maxstris)
+	{
+		cl_maxstris += 8;
+		cl_stris = Mem_Realloc (cl_stris, sizeof (*cl_stris) * cl_maxstris);
+	}
+	scenetri = &cl_stris[cl_numstris++];
+	scenetri->texture = texture;
+	scenetri->blendmode = blendmode;
+	scenetri->beflags = beflags;
+	scenetri->firstidx = cl_numstrisidx;
+	scenetri->firstvert = cl_numstrisvert;
+	scenetri->numvert = 0;
+	scenetri->numidx = 0;
+	return scenetri;
+}
+
+static scenetris_t *PScript_SceneTrisForType (part_type_t *type, int beflags)
+{
+	if (cl_numstris && cl_stris[cl_numstris - 1].texture == type->looks.texture && cl_stris[cl_numstris - 1].blendmode == type->looks.blendmode &&
+		cl_stris[cl_numstris - 1].beflags == beflags)
+		return &cl_stris[cl_numstris - 1];
+	return PScript_NewSceneTris (type->looks.texture, type->looks.blendmode, beflags);
+}
+
+static inline scenetris_t *PScript_SceneTrisWithRoom (scenetris_t *scenetri)
+{
+	// generate a new mesh if the old one overflowed. yay smc...
+	if (cl_numstrisvert - scenetri->firstvert >= MAX_INDICES - 6)
+		return PScript_NewSceneTris (scenetri->texture, scenetri->blendmode, scenetri->beflags);
+	return scenetri;
+}
+
+/*
+===============
+PScript_EmitParticleVertices
 
-			for (;;)
-			{
-				dkill = type->clippeddecals;
-				if (dkill && dkill->die < particletime)
-				{
-					type->clippeddecals = dkill->next;
-					dkill->next = free_decals;
-					free_decals = dkill;
-					continue;
-				}
-				break;
-			}
-			for (d = type->clippeddecals; d; d = d->next)
-			{
-				for (;;)
-				{
-					dkill = d->next;
-					if (dkill && dkill->die < particletime)
-					{
-						d->next = dkill->next;
-						dkill->next = free_decals;
-						free_decals = dkill;
-						continue;
-					}
-					break;
-				}
+Only reads what PScript_SimulateParticles left behind
+===============
+*/
+static void PScript_EmitParticleVertices (void)
+{
+	void (*bdraw) (scenetris_t * t, beamseg_t * p, plooks_t * type);
+	void (*tdraw) (scenetris_t * t, particle_t * p, plooks_t * type);
 
-				if (d->die - particletime <= type->die)
-				{
-					switch (type->rampmode)
-					{
-					case RAMP_NEAREST:
-						rampind = (int)(type->rampindexes * (type->die - (d->die - particletime)) / type->die);
-						if (rampind >= type->rampindexes)
-							rampind = type->rampindexes - 1;
-						ramp = type->ramp + rampind;
-						VectorCopy (ramp->rgb, d->rgba);
-						d->rgba[3] = ramp->alpha;
-						break;
-					case RAMP_LERP:
-					{
-						float frac = (type->rampindexes * (type->die - (d->die - particletime)) / type->die);
-						int	  s1, s2;
-						s1 = frac;
-						s2 = s1 + 1;
-						if (s1 > type->rampindexes - 1)
-							s1 = type->rampindexes - 1;
-						if (s2 > type->rampindexes - 1)
-							s2 = type->rampindexes - 1;
-						frac -= s1;
-						VectorInterpolate (type->ramp[s1].rgb, frac, type->ramp[s2].rgb, d->rgba);
-						FloatInterpolate (type->ramp[s1].alpha, frac, type->ramp[s2].alpha, d->rgba[3]);
-					}
-					break;
-					case RAMP_DELTA: // particle ramps
-						ramp = type->ramp + (int)(type->rampindexes * (type->die - (d->die - particletime)) / type->die);
-						VectorMA (d->rgba, pframetime, ramp->rgb, d->rgba);
-						d->rgba[3] -= pframetime * ramp->alpha;
-						break;
-					case RAMP_NONE: // particle changes acording to it's preset properties.
-						if (particletime < (d->die - type->die + type->rgbchangetime))
-						{
-							d->rgba[0] += pframetime * type->rgbchange[0];
-							d->rgba[1] += pframetime * type->rgbchange[1];
-							d->rgba[2] += pframetime * type->rgbchange[2];
-						}
-						d->rgba[3] += pframetime * type->alphachange;
-					}
-				}
+	part_type_t	   *type;
+	particle_t	   *p;
+	clippeddecal_t *d;
+	beamseg_t	   *b;
+	scenetris_t	   *scenetri;
+	int				batchflags;
 
-				if (cl_numstrisvert - scenetri->firstvert >= MAX_INDICES - 6)
-				{
-					// generate a new mesh if the old one overflowed. yay smc...
-					if (cl_numstris == cl_maxstris)
-					{
-						cl_maxstris += 8;
-						cl_stris = Mem_Realloc (cl_stris, sizeof (*cl_stris) * cl_maxstris);
-					}
-					scenetri = &cl_stris[cl_numstris++];
-					scenetri->texture = scenetri[-1].texture;
-					scenetri->blendmode = scenetri[-1].blendmode;
-					scenetri->beflags = scenetri[-1].beflags;
-					scenetri->firstidx = cl_numstrisidx;
-					scenetri->firstvert = cl_numstrisvert;
-					scenetri->numvert = 0;
-					scenetri->numidx = 0;
-				}
+	if (r_plooksdirty)
+		return; // shared looks are only valid after the next simulation
+
+	VectorScale (vup, 1.5, pup);
+	VectorScale (vright, 1.5, pright);
+
+	for (type = part_run_list; type != NULL; type = type->nexttorun)
+	{
+		if (type->clippeddecals)
+		{
+			scenetri = PScript_SceneTrisForType (type, 0);
+			for (d = type->clippeddecals; d; d = d->next)
+			{
+				scenetri = PScript_SceneTrisWithRoom (scenetri);
 				R_AddClippedDecal (scenetri, d, type->slooks);
 			}
 		}
@@ -6423,490 +7542,54 @@ static void PScript_DrawParticleTypes (cb_context_t *cbx, float pframetime)
 			break;
 		}
 
-		if (cl_numstris && cl_stris[cl_numstris - 1].texture == type->looks.texture && cl_stris[cl_numstris - 1].blendmode == type->looks.blendmode &&
-			cl_stris[cl_numstris - 1].beflags == batchflags)
-			scenetri = &cl_stris[cl_numstris - 1];
-		else
-		{
-			if (cl_numstris == cl_maxstris)
-			{
-				cl_maxstris += 8;
-				cl_stris = Mem_Realloc (cl_stris, sizeof (*cl_stris) * cl_maxstris);
-			}
-			scenetri = &cl_stris[cl_numstris++];
-			scenetri->texture = type->looks.texture;
-			scenetri->blendmode = type->looks.blendmode;
-			scenetri->beflags = batchflags;
-			scenetri->firstidx = cl_numstrisidx;
-			scenetri->firstvert = cl_numstrisvert;
-			scenetri->numvert = 0;
-			scenetri->numidx = 0;
-		}
+		if (!tdraw && !bdraw)
+			continue;
+
+		scenetri = PScript_SceneTrisForType (type, batchflags);
 
 		if (!type->die)
 		{
-			while ((p = type->particles))
+			if (tdraw)
 			{
-				if (scenetri && tdraw)
+				for (p = type->flashes; p; p = p->next)
 				{
-					if (cl_numstrisvert - scenetri->firstvert >= MAX_INDICES - 6)
-					{
-						// generate a new mesh if the old one overflowed. yay smc...
-						if (cl_numstris == cl_maxstris)
-						{
-							cl_maxstris += 8;
-							cl_stris = Mem_Realloc (cl_stris, sizeof (*cl_stris) * cl_maxstris);
-						}
-						scenetri = &cl_stris[cl_numstris++];
-						scenetri->texture = scenetri[-1].texture;
-						scenetri->blendmode = scenetri[-1].blendmode;
-						scenetri->beflags = scenetri[-1].beflags;
-						scenetri->firstidx = cl_numstrisidx;
-						scenetri->firstvert = cl_numstrisvert;
-						scenetri->numvert = 0;
-						scenetri->numidx = 0;
-					}
+					scenetri = PScript_SceneTrisWithRoom (scenetri);
 					tdraw (scenetri, p, type->slooks);
 				}
-
-				// make sure emitter runs at least once
-				if (type->emit >= 0 && type->emitstart <= 0)
-					PScript_RunParticleEffectState (p->org, p->vel, 1, type->emit, NULL);
-
-				type->particles = p->next;
-				p->next = kill_list;
-				kill_list = p;
-				if (!kill_first) // branch here is probably faster than list traversal later
-					kill_first = p;
-			}
-
-			if (type->beams)
-			{
-				b = type->beams;
-			}
-
-			while ((b = type->beams) && (b->flags & BS_DEAD))
-			{
-				type->beams = b->next;
-				b->next = free_beams;
-				free_beams = b;
 			}
 
-			while (b)
+			if (bdraw)
 			{
-				if (!(b->flags & BS_NODRAW))
+				for (b = type->beams; b; b = b->next)
 				{
-					// no BS_NODRAW implies b->next != NULL
-					// BS_NODRAW should imply b->next == NULL or b->next->flags & BS_DEAD
-					VectorCopy (b->next->p->org, stop);
-					VectorCopy (b->p->org, oldorg);
-					VectorSubtract (stop, oldorg, b->next->dir);
-					VectorNormalize (b->next->dir);
-					if (bdraw)
+					if (!(b->flags & BS_NODRAW) && b->next)
 						bdraw (scenetri, b, type->slooks);
 				}
-
-				// clean up dead entries ahead of current
-				for (;;)
-				{
-					bkill = b->next;
-					if (bkill && (bkill->flags & BS_DEAD))
-					{
-						b->next = bkill->next;
-						bkill->next = free_beams;
-						free_beams = bkill;
-						continue;
-					}
-					break;
-				}
-
-				b->flags |= BS_DEAD;
-				b = b->next;
-			}
-
-			goto endtype;
-		}
-
-		// kill off early ones.
-		if (type->emittime < 0)
-		{
-			for (;;)
-			{
-				kill = type->particles;
-				if (kill && kill->die < particletime)
-				{
-					PScript_DelinkTrailstate (&kill->state.trailstate);
-					type->particles = kill->next;
-					kill->next = kill_list;
-					kill_list = kill;
-					if (!kill_first)
-						kill_first = kill;
-					continue;
-				}
-				break;
-			}
-		}
-		else
-		{
-			for (;;)
-			{
-				kill = type->particles;
-				if (kill && kill->die < particletime)
-				{
-					type->particles = kill->next;
-					kill->next = kill_list;
-					kill_list = kill;
-					if (!kill_first)
-						kill_first = kill;
-					continue;
-				}
-				break;
 			}
 		}
-
-		grav = type->gravity * pframetime;
-		friction[0] = 1 - type->friction[0] * pframetime;
-		friction[1] = 1 - type->friction[1] * pframetime;
-		friction[2] = 1 - type->friction[2] * pframetime;
-
-		for (p = type->particles; p; p = p->next)
+		else if (tdraw) // beams of types with a lifetime are only simulated
 		{
-			if (type->emittime < 0)
-			{
-				for (;;)
-				{
-					kill = p->next;
-					if (kill && kill->die < particletime)
-					{
-						PScript_DelinkTrailstate (&kill->state.trailstate);
-						p->next = kill->next;
-						kill->next = kill_list;
-						kill_list = kill;
-						if (!kill_first)
-							kill_first = kill;
-						continue;
-					}
-					break;
-				}
-			}
-			else
-			{
-				for (;;)
-				{
-					kill = p->next;
-					if (kill && kill->die < particletime)
-					{
-						p->next = kill->next;
-						kill->next = kill_list;
-						kill_list = kill;
-						if (!kill_first)
-							kill_first = kill;
-						continue;
-					}
-					break;
-				}
-			}
-
-			VectorCopy (p->org, oldorg);
-			if (type->flags & PT_VELOCITY)
-			{
-				p->org[0] += p->vel[0] * pframetime;
-				p->org[1] += p->vel[1] * pframetime;
-				p->org[2] += p->vel[2] * pframetime;
-				p->vel[2] -= grav;
-				if (type->flags & PT_FRICTION)
-				{
-					p->vel[0] *= friction[0];
-					p->vel[1] *= friction[1];
-					p->vel[2] *= friction[2];
-				}
-				if (type->flurry && doflurry)
-				{ // these should probably be partially synced,
-					p->vel[0] += crandom () * type->flurry;
-					p->vel[1] += crandom () * type->flurry;
-				}
-			}
-
-			p->angle += p->rotationspeed * pframetime;
-
-			switch (type->rampmode)
-			{
-			case RAMP_NEAREST:
-				rampind = (int)(type->rampindexes * (type->die - (p->die - particletime)) / type->die);
-				if (rampind >= type->rampindexes)
-					rampind = type->rampindexes - 1;
-				ramp = type->ramp + rampind;
-				VectorCopy (ramp->rgb, p->rgba);
-				p->rgba[3] = ramp->alpha;
-				p->scale = ramp->scale;
-				break;
-			case RAMP_LERP:
-			{
-				float frac = (type->rampindexes * (type->die - (p->die - particletime)) / type->die);
-				int	  s1, s2;
-				s1 = frac;
-				s2 = s1 + 1;
-				if (s1 > type->rampindexes - 1)
-					s1 = type->rampindexes - 1;
-				if (s2 > type->rampindexes - 1)
-					s2 = type->rampindexes - 1;
-				frac -= s1;
-				VectorInterpolate (type->ramp[s1].rgb, frac, type->ramp[s2].rgb, p->rgba);
-				FloatInterpolate (type->ramp[s1].alpha, frac, type->ramp[s2].alpha, p->rgba[3]);
-				FloatInterpolate (type->ramp[s1].scale, frac, type->ramp[s2].scale, p->scale);
-			}
-			break;
-			case RAMP_DELTA: // particle ramps
-				rampind = (int)(type->rampindexes * (type->die - (p->die - particletime)) / type->die);
-				if (rampind >= type->rampindexes)
-					rampind = type->rampindexes - 1;
-				ramp = type->ramp + rampind;
-				VectorMA (p->rgba, pframetime, ramp->rgb, p->rgba);
-				p->rgba[3] -= pframetime * ramp->alpha;
-				p->scale += pframetime * ramp->scale;
-				break;
-			case RAMP_NONE: // particle changes acording to it's preset properties.
-				if (particletime < (p->die - type->die + type->rgbchangetime))
-				{
-					p->rgba[0] += pframetime * type->rgbchange[0];
-					p->rgba[1] += pframetime * type->rgbchange[1];
-					p->rgba[2] += pframetime * type->rgbchange[2];
-				}
-				p->rgba[3] += pframetime * type->alphachange;
-				p->scale += pframetime * type->scaledelta;
-			}
-
-			if (type->emit >= 0)
-			{
-				if (type->emittime < 0)
-					PScript_ParticleTrail (oldorg, p->org, type->emit, pframetime, 0, NULL, &p->state.trailstate);
-				else if (p->state.nextemit < particletime)
-				{
-					p->state.nextemit = particletime + type->emittime + frandom () * type->emitrand;
-					PScript_RunParticleEffectState (p->org, p->vel, 1, type->emit, NULL);
-				}
-			}
-
-			if (type->cliptype >= 0 && r_bouncysparks.value)
-			{
-				VectorSubtract (p->org, p->oldorg, stop);
-				if (!type->clipbounce || DotProduct (stop, stop) > 10 * 10)
-				{
-					int e;
-					if (traces-- > 0 && CL_TraceLine (p->oldorg, p->org, stop, normal, &e) < 1)
-					{
-						if (type->clipbounce < 0)
-						{
-							p->die = -1;
-#ifdef USE_DECALS
-							if (type->clipbounce == -2)
-							{ // this type of particle splatters itself as a decal when it hits a wall.
-								decalctx_t ctx;
-								float	   m;
-								vec3_t	   vec = {0.5, 0.5, 0.431};
-								qmodel_t  *model;
-
-								ctx.entity = e;
-								if (!ctx.entity)
-								{
-									model = cl.worldmodel;
-									VectorCopy (p->org, ctx.center);
-								}
-								else if (e)
-								{ // this trace hit a door or something.
-									entity_t *ent = CL_EntityNum (e);
-									model = ent->model;
-									VectorSubtract (p->org, ent->origin, ctx.center);
-									// FIXME: rotate center+normal around entity.
-								}
-								else
-									continue; // err, no idea.
-
-								VectorScale (normal, -1, ctx.normal);
-								VectorNormalize (ctx.normal);
-
-								VectorNormalize (vec);
-								CrossProduct (ctx.normal, vec, ctx.tangent1);
-								RotatePointAroundVector (ctx.tangent2, ctx.normal, ctx.tangent1, frandom () * 360);
-								CrossProduct (ctx.normal, ctx.tangent2, ctx.tangent1);
-
-								VectorNormalize (ctx.tangent1);
-								VectorNormalize (ctx.tangent2);
-
-								ctx.ptype = type;
-								ctx.scale1 = type->s2 - type->s1;
-								ctx.bias1 = type->s1 + (ctx.scale1 * 0.5);
-								ctx.scale2 = type->t2 - type->t1;
-								ctx.bias2 = type->t1 + (ctx.scale2 * 0.5);
-								m = p->scale * (1.5 + frandom () * 0.5) * 0.5; // decals should be a little bigger, for some reason.
-								ctx.scale0 = 2.0 / m;
-								ctx.scale1 /= m;
-								ctx.scale2 /= m;
-
-								// inserts decals through a callback.
-								Mod_ClipDecal (
-									model, ctx.center, ctx.normal, ctx.tangent2, ctx.tangent1, m, type->surfflagmask, type->surfflagmatch, PScript_AddDecals,
-									&ctx);
-							}
-#endif
-							continue;
-						}
-						else if (part_type + type->cliptype == type)
-						{										// bounce
-							dist = DotProduct (p->vel, normal); // * (-1-(rand()/(float)0x7fff)/2);
-							dist *= -type->clipbounce;
-							VectorMA (p->vel, dist, normal, p->vel);
-							VectorCopy (stop, p->org);
-
-							if (!*type->texname && VectorLength (p->vel) < 1000 * pframetime && type->looks.type == PT_NORMAL)
-							{
-								p->die = -1;
-								continue;
-							}
-						}
-						else
-						{
-							p->die = -1;
-							VectorNormalize (p->vel);
-
-							if (type->clipbounce)
-							{
-								VectorScale (normal, type->clipbounce, normal);
-								PScript_RunParticleEffectState (stop, normal, type->clipcount / part_type[type->cliptype].count, type->cliptype, NULL);
-							}
-							else
-								PScript_RunParticleEffectState (stop, p->vel, type->clipcount / part_type[type->cliptype].count, type->cliptype, NULL);
-							continue;
-						}
-					}
-					VectorCopy (p->org, p->oldorg);
-				}
-			}
-			if (scenetri && tdraw)
+			for (p = type->particles; p; p = p->next)
 			{
-				if (cl_numstrisvert - scenetri->firstvert >= MAX_INDICES - 6)
-				{
-					// generate a new mesh if the old one overflowed. yay smc...
-					if (cl_numstris == cl_maxstris)
-					{
-						cl_maxstris += 8;
-						cl_stris = Mem_Realloc (cl_stris, sizeof (*cl_stris) * cl_maxstris);
-					}
-					scenetri = &cl_stris[cl_numstris++];
-					scenetri->texture = scenetri[-1].texture;
-					scenetri->blendmode = scenetri[-1].blendmode;
-					scenetri->beflags = scenetri[-1].beflags;
-					scenetri->firstidx = cl_numstrisidx;
-					scenetri->firstvert = cl_numstrisvert;
-					scenetri->numvert = 0;
-					scenetri->numidx = 0;
-				}
+				if (p->die < 0)
+					continue; // hit something this frame
+				scenetri = PScript_SceneTrisWithRoom (scenetri);
 				tdraw (scenetri, p, type->slooks);
 			}
 		}
-
-		// beams are dealt with here
-
-		// kill early entries
-		for (;;)
-		{
-			bkill = type->beams;
-			if (bkill && (bkill->flags & BS_DEAD || bkill->p->die < particletime) && !(bkill->flags & BS_LASTSEG))
-			{
-				type->beams = bkill->next;
-				bkill->next = free_beams;
-				free_beams = bkill;
-				continue;
-			}
-			break;
-		}
-
-		b = type->beams;
-		if (b)
-		{
-			for (;;)
-			{
-				if (b->next)
-				{
-					// mark dead entries
-					if (b->flags & (BS_LASTSEG | BS_DEAD | BS_NODRAW))
-					{
-						// kill some more dead entries
-						for (;;)
-						{
-							bkill = b->next;
-							if (bkill && (bkill->flags & BS_DEAD) && !(bkill->flags & BS_LASTSEG))
-							{
-								b->next = bkill->next;
-								bkill->next = free_beams;
-								free_beams = bkill;
-								continue;
-							}
-							break;
-						}
-
-						if (!bkill) // have to check so we don't hit NULL->next
-							continue;
-					}
-					else
-					{
-						if (!(b->next->flags & BS_DEAD))
-						{
-							VectorCopy (b->next->p->org, stop);
-							VectorCopy (b->p->org, oldorg);
-							VectorSubtract (stop, oldorg, b->next->dir);
-							VectorNormalize (b->next->dir);
-							if (bdraw)
-							{
-								VectorAdd (stop, oldorg, stop);
-								VectorScale (stop, 0.5, stop);
-							}
-						}
-
-						if (b->p->die < particletime)
-							b->flags |= BS_DEAD;
-					}
-				}
-				else
-				{
-					if (b->p->die < particletime) // end of the list check
-						b->flags |= BS_DEAD;
-
-					break;
-				}
-
-				if (b->p->die < particletime)
-					b->flags |= BS_DEAD;
-
-				b = b->next;
-			}
-		}
-
-	endtype:
-
-		// delete from run list if necessary
-		if (!type->particles && !type->beams && !type->clippeddecals)
-		{
-			if (!lastvalidtype)
-				part_run_list = type->nexttorun;
-			else if (lastvalidtype->nexttorun == type)
-				lastvalidtype->nexttorun = type->nexttorun;
-			else
-				lastvalidtype->nexttorun->nexttorun = type->nexttorun;
-			type->state &= ~PS_INRUNLIST;
-		}
-		else
-			lastvalidtype = type;
 	}
+}
 
-	// lazy delete for particles is done here
-	if (kill_list)
-	{
-		kill_first->next = free_particles;
-		free_particles = kill_list;
-	}
+/*
+===============
+PScript_DrawParticleTypes
+===============
+*/
+static void PScript_DrawParticleTypes (cb_context_t *cbx)
+{
+	unsigned int i, o;
 
-	particletime += pframetime;
+	PScript_EmitParticleVertices ();
 
 	if (!cl_numstris)
 		return;
@@ -6951,19 +7634,6 @@ PScript_DrawParticles
 */
 void PScript_DrawParticles (cb_context_t *cbx)
 {
-	int			 i;
-	entity_t	*ent;
-	vec3_t		 axis[3];
-	float		 pframetime;
-	static float oldtime;
-
-	pframetime = cl.time - oldtime;
-	if (pframetime < 0)
-		pframetime = 0;
-	if (pframetime > 1)
-		pframetime = 1;
-	oldtime = cl.time;
-
 	current_buffer_index = (current_buffer_index + 1) % 2;
 	cl_numstris = 0;
 	cl_numstrisvert = 0;
@@ -6974,23 +7644,113 @@ void PScript_DrawParticles (cb_context_t *cbx)
 	if (!r_particles.value)
 		return;
 
-	if (r_part_rain.value && r_fteparticles.value)
+	PScript_DrawParticleTypes (cbx);
+}
+
+/*
+===============
+PScript_Benchmark_f
+
+r_partbenchmark [frames] [effect ...]
+
+Keeps spawning the effects (TR_ names as trails) around the view and times
+both stages without drawing anything
+===============
+*/
+static void PScript_Benchmark_f (void)
+{
+	static const char *default_effects[] = {"TE_EXPLOSION", "TE_GUNSHOT", "TE_SPIKE", "TE_TELEPORT", "TR_ROCKET", "TR_BLOOD"};
+	const int		   frames = (Cmd_Argc () > 1) ? q_max (1, atoi (Cmd_Argv (1))) : 1000;
+	const double	   saved_time = cl.time;
+	const char		  *names[32];
+	int				   effects[32];
+	qboolean		   trails[32];
+	int				   numnames, numeffects = 0;
+	int				   frame, i, j, peak = 0, peakverts = 0;
+	int64_t			   updates = 0, traced = 0;
+	double			   simulate = 0.0, emit = 0.0;
+	vec3_t			   org, end;
+
+	if (Cmd_Argc () > 2)
+	{
+		numnames = q_min (Cmd_Argc () - 2, (int)countof (names));
+		for (i = 0; i < numnames; i++)
+			names[i] = Cmd_Argv (i + 2);
+	}
+	else
 	{
-		for (i = 0; i < cl.num_entities; i++)
+		numnames = countof (default_effects);
+		for (i = 0; i < numnames; i++)
+			names[i] = default_effects[i];
+	}
+	for (i = 0; i < numnames; i++)
+	{
+		effects[numeffects] = PScript_FindParticleType (names[i]);
+		if (effects[numeffects] == P_INVALID)
 		{
-			ent = &cl.entities[i];
-			if (!ent->model || ent->model->needload)
-				continue;
-			if (!ent->model->skytris)
-				continue;
-			AngleVectors (ent->angles, axis[0], axis[1], axis[2]);
-			// this timer, as well as the per-tri timer, are unable to deal with certain rates+sizes. it would be good to fix that...
-			// it would also be nice to do mdls too...
-			P_AddRainParticles (ent->model, axis, ent->origin, pframetime);
+			Con_Printf ("effect %s not found\n", names[i]);
+			continue;
 		}
+		trails[numeffects++] = !q_strncasecmp (names[i], "TR_", 3);
 	}
+	if (!numeffects || !r_particles.value)
+	{
+		Con_Printf ("nothing to benchmark\n");
+		return;
+	}
+
+	// the vertex buffers get overwritten
+	GL_WaitForDeviceIdle ();
+	if (r_plooksdirty)
+		PScript_UpdateLooks ();
+	PScript_ClearParticles (false);
+	srand (0);
+	for (frame = 0; frame < frames; frame++)
+	{
+		cl.time += 1.0 / 72.0;
+
+		for (i = 0; i < numeffects; i++)
+		{
+			for (j = 0; j < 3; j++)
+			{
+				org[j] = r_refdef.vieworg[j] + (rand () % 1024) - 512;
+				end[j] = org[j] + (rand () % 256) - 128;
+			}
+			if (trails[i])
+				PScript_ParticleTrail (org, end, effects[i], 1.0 / 72.0, 0, NULL, NULL);
+			else if (frame % 8 == 0)
+				PScript_RunParticleEffectState (org, NULL, 1, effects[i], NULL);
+		}
+
+		const double start = Sys_DoubleTime ();
+		PScript_SimulateParticles ();
+		const double simulated = Sys_DoubleTime ();
+		cl_numstris = 0;
+		cl_numstrisvert = 0;
+		cl_numstrisidx = 0;
+		cl_curstrisvert = cl_strisvert[current_buffer_index];
+		cl_curstrisidx = cl_strisidx[current_buffer_index];
+		PScript_EmitParticleVertices ();
+		emit += Sys_DoubleTime () - simulated;
+		simulate += simulated - start;
+
+		updates += part_numsimulated;
+		traced += part_numtraced;
+		peak = q_max (peak, part_numsimulated);
+		peakverts = q_max (peakverts, (int)cl_numstrisvert);
+	}
+	cl.time = saved_time;
+	part_oldtime = cl.time;
+	PScript_ClearParticles (false);
+	cl_numstris = 0;
+	cl_numstrisvert = 0;
+	cl_numstrisidx = 0;
 
-	PScript_DrawParticleTypes (cbx, pframetime);
+	Con_Printf (
+		"%d frames, %d particles and %d vertices peak, %.1f traces per frame\n", frames, peak, peakverts, (double)traced / frames);
+	Con_Printf (
+		"simulate %.1f ms (%.2f M particles/s), vertices %.1f ms (%d workers)\n", simulate * 1000.0, updates / simulate / 1e6, emit * 1000.0,
+		Tasks_NumWorkers ());
 }
 
 /*
@@ -363,6 +363,8 @@ void R_MarkVisSurfacesSIMD (qboolean *use_tasks)
 	uint32_t	*vis = (uint32_t *)mark_surfaces_state.vis;
 	uint32_t	*surfvis = (uint32_t *)cl.worldmodel->surfvis;
 	soa_aabb_t	*leafbounds = cl.worldmodel->soa_leafbounds;
+	uint32_t	 occludedleafs = 0;
+	uint32_t	 occludedsurfaces = 0;
 
 	// iterate through leaves, marking surfaces
 	for (i = 0; i < numleafs; i += 32)
@@ -378,6 +380,11 @@ void R_MarkVisSurfacesSIMD (qboolean *use_tasks)
 			mask &= ~(1u << j);
 
 			mleaf_t *leaf = &cl.worldmodel->leafs[1 + i + j];
+			if (R_OcclusionCullBox (leaf->minmaxs, leaf->minmaxs + 3))
+			{
+				++occludedleafs;
+				continue;
+			}
 			if (r_drawworld_cheatsafe && (leaf->contents != CONTENTS_SKY || r_oldskyleaf.value))
 			{
 				unsigned int nummarksurfaces = leaf->nummarksurfaces;
@@ -397,6 +404,7 @@ void R_MarkVisSurfacesSIMD (qboolean *use_tasks)
 		}
 	}
 
+	Atomic_AddUInt32 (&rs_occludedleafs, occludedleafs);
 	if (indirect)
 		return;
 
@@ -413,6 +421,11 @@ void R_MarkVisSurfacesSIMD (qboolean *use_tasks)
 			const int j = FindFirstBitNonZero (mask);
 			mask &= ~(1u << j);
 
+			if (R_OcclusionCullSurface (i + j))
+			{
+				++occludedsurfaces;
+				continue;
+			}
 			surf = &cl.worldmodel->surfaces[i + j];
 			++brushpolys;
 			R_ChainSurface (surf, chain_world);
@@ -426,6 +439,7 @@ void R_MarkVisSurfacesSIMD (qboolean *use_tasks)
 	}
 
 	Atomic_AddUInt32 (&rs_brushpolys, brushpolys); // count wpolys here
+	Atomic_AddUInt32 (&rs_occludedsurfaces, occludedsurfaces);
 	R_SetupWorldCBXTexRanges (*use_tasks);
 }
 
@@ -449,11 +463,19 @@ void R_MarkLeafsSIMD (int index, void *unused)
 	*mask = R_CullBoxSIMD (&leafbounds[index * 4], *mask);
 
 	uint32_t mask_iter = *mask;
+	uint32_t occludedleafs = 0;
 	while (mask_iter != 0)
 	{
 		const int i = FindFirstBitNonZero (mask_iter);
 
 		mleaf_t *leaf = &cl.worldmodel->leafs[1 + first_leaf + i];
+		if (R_OcclusionCullBox (leaf->minmaxs, leaf->minmaxs + 3))
+		{
+			*mask &= ~(1u << i);
+			mask_iter &= ~(1u << i);
+			++occludedleafs;
+			continue;
+		}
 		if (r_drawworld_cheatsafe && (leaf->contents != CONTENTS_SKY || r_oldskyleaf.value))
 		{
 			unsigned int nummarksurfaces = leaf->nummarksurfaces;
@@ -473,6 +495,8 @@ void R_MarkLeafsSIMD (int index, void *unused)
 		}
 		mask_iter &= bit_mask;
 	}
+	if (occludedleafs)
+		Atomic_AddUInt32 (&rs_occludedleafs, occludedleafs);
 }
 
 /*
@@ -493,12 +517,22 @@ void R_BackfaceCullSurfacesSIMD (int index, void *unused)
 
 	const int worker_index = Tasks_GetWorkerIndex ();
 	uint32_t  mask_iter = *mask;
+	uint32_t  occludedsurfaces = 0;
 	while (mask_iter != 0)
 	{
 		const int i = FindFirstBitNonZero (mask_iter);
 
+		if (R_OcclusionCullSurface ((index * 32) + i))
+		{
+			*mask &= ~(1u << i);
+			mask_iter &= ~(1u << i);
+			++occludedsurfaces;
+			continue;
+		}
 		surf = &cl.worldmodel->surfaces[(index * 32) + i];
-		if (surf->lightmaptexturenum >= 0)
+		if (!r_gpulightmapupdate.value)
+			R_RenderDynamicLightmaps (surf);
+		else if (surf->lightmaptexturenum >= 0)
 			lightmaps[surf->lightmaptexturenum].modified[worker_index] |= surf->styles_bitmap;
 		if (surf->texinfo->texture->warpimage)
 			Atomic_StoreUInt32 (&surf->texinfo->texture->update_warp, true);
@@ -506,6 +540,8 @@ void R_BackfaceCullSurfacesSIMD (int index, void *unused)
 		const uint32_t bit_mask = ~(1u << i);
 		mask_iter &= bit_mask;
 	}
+	if (occludedsurfaces)
+		Atomic_AddUInt32 (&rs_occludedsurfaces, occludedsurfaces);
 }
 #endif // defined(USE_SIMD)
 
@@ -635,6 +671,7 @@ void R_MarkLeafsParallel (int index, void *unused)
 	uint32_t		*mask = (uint32_t *)mark_surfaces_state.vis + index;
 	atomic_uint32_t *surfvis = (atomic_uint32_t *)cl.worldmodel->surfvis;
 	unsigned int	 first_leaf = index * 32 + 1;
+	uint32_t		 occludedleafs = 0;
 
 	uint32_t mask_iter = *mask;
 	while (mask_iter != 0)
@@ -648,6 +685,12 @@ void R_MarkLeafsParallel (int index, void *unused)
 			*mask &= bit_mask;
 			continue;
 		}
+		if (R_OcclusionCullBox (leaf->minmaxs, leaf->minmaxs + 3))
+		{
+			*mask &= bit_mask;
+			++occludedleafs;
+			continue;
+		}
 		if (!leaf->efrags)
 			*mask &= bit_mask;
 		if (r_drawworld_cheatsafe && (leaf->contents != CONTENTS_SKY || r_oldskyleaf.value))
@@ -663,6 +706,8 @@ void R_MarkLeafsParallel (int index, void *unused)
 				R_MarkDeps (leaf->combined_deps, Tasks_GetWorkerIndex ());
 		}
 	}
+	if (occludedleafs)
+		Atomic_AddUInt32 (&rs_occludedleafs, occludedleafs);
 }
 
 /*
@@ -680,6 +725,7 @@ void R_BackfaceCullSurfacesParallel (int index, void *unused)
 		return;
 
 	const int worker_index = Tasks_GetWorkerIndex ();
+	uint32_t  occludedsurfaces = 0;
 	while (mask_iter != 0)
 	{
 		const int	   i = FindFirstBitNonZero (mask_iter);
@@ -690,14 +736,23 @@ void R_BackfaceCullSurfacesParallel (int index, void *unused)
 
 		if (R_BackFaceCull (surf))
 			*surfvis &= bit_mask;
+		else if (R_OcclusionCullSurface ((index * 32) + i))
+		{
+			*surfvis &= bit_mask;
+			++occludedsurfaces;
+		}
 		else
 		{
-			if (surf->lightmaptexturenum >= 0)
+			if (!r_gpulightmapupdate.value)
+				R_RenderDynamicLightmaps (surf);
+			else if (surf->lightmaptexturenum >= 0)
 				lightmaps[surf->lightmaptexturenum].modified[worker_index] |= surf->styles_bitmap;
 			if (surf->texinfo->texture->warpimage)
 				Atomic_StoreUInt32 (&surf->texinfo->texture->update_warp, true);
 		}
 	}
+	if (occludedsurfaces)
+		Atomic_AddUInt32 (&rs_occludedsurfaces, occludedsurfaces);
 }
 
 /*
@@ -711,6 +766,8 @@ void R_MarkVisSurfaces (qboolean *use_tasks)
 	msurface_t *surf;
 	mleaf_t	   *leaf;
 	uint32_t	brushpolys = 0;
+	uint32_t	occludedleafs = 0;
+	uint32_t	occludedsurfaces = 0;
 	uint32_t   *vis = (uint32_t *)mark_surfaces_state.vis;
 	uint32_t   *surfvis = (uint32_t *)cl.worldmodel->surfvis;
 
@@ -721,6 +778,11 @@ void R_MarkVisSurfaces (qboolean *use_tasks)
 		{
 			if (R_CullBox (leaf->minmaxs, leaf->minmaxs + 3))
 				continue;
+			if (R_OcclusionCullBox (leaf->minmaxs, leaf->minmaxs + 3))
+			{
+				++occludedleafs;
+				continue;
+			}
 
 			if (r_drawworld_cheatsafe && (leaf->contents != CONTENTS_SKY || r_oldskyleaf.value))
 			{
@@ -738,17 +800,21 @@ void R_MarkVisSurfaces (qboolean *use_tasks)
 					if (surf->visframe != r_visframecount)
 					{
 						surf->visframe = r_visframecount;
-						if (!R_BackFaceCull (surf))
+						if (R_BackFaceCull (surf))
+							continue;
+						if (R_OcclusionCullSurface (leaf->firstmarksurface[j]))
 						{
-							++brushpolys;
-							R_ChainSurface (surf, chain_world);
-							if (!r_gpulightmapupdate.value)
-								R_RenderDynamicLightmaps (surf);
-							else if (surf->lightmaptexturenum >= 0)
-								lightmaps[surf->lightmaptexturenum].modified[0] |= surf->styles_bitmap;
-							if (surf->texinfo->texture->warpimage)
-								Atomic_StoreUInt32 (&surf->texinfo->texture->update_warp, true);
+							++occludedsurfaces;
+							continue;
 						}
+						++brushpolys;
+						R_ChainSurface (surf, chain_world);
+						if (!r_gpulightmapupdate.value)
+							R_RenderDynamicLightmaps (surf);
+						else if (surf->lightmaptexturenum >= 0)
+							lightmaps[surf->lightmaptexturenum].modified[0] |= surf->styles_bitmap;
+						if (surf->texinfo->texture->warpimage)
+							Atomic_StoreUInt32 (&surf->texinfo->texture->update_warp, true);
 					}
 				}
 			}
@@ -759,10 +825,12 @@ void R_MarkVisSurfaces (qboolean *use_tasks)
 		}
 	}
 
+	Atomic_AddUInt32 (&rs_occludedleafs, occludedleafs);
 	if (indirect)
 		return;
 
 	Atomic_AddUInt32 (&rs_brushpolys, brushpolys); // count wpolys here
+	Atomic_AddUInt32 (&rs_occludedsurfaces, occludedsurfaces);
 	R_SetupWorldCBXTexRanges (*use_tasks);
 }
 
@@ -1249,8 +1317,6 @@ void R_DrawTextureChains (cb_context_t *cbx, qmodel_t *model, entity_t *ent, tex
 	else
 		entalpha = 1;
 
-	if (!r_gpulightmapupdate.value)
-		R_UploadLightmaps ();
 	R_DrawTextureChains_Multitexture (cbx, model, ent, chain, entalpha, 0, model->numtextures);
 }
 
@@ -1265,8 +1331,6 @@ void R_DrawWorld (cb_context_t *cbx, int index)
 		return;
 
 	R_BeginDebugUtilsLabel (cbx, "World");
-	if (!r_gpulightmapupdate.value)
-		R_UploadLightmaps ();
 	R_DrawTextureChains_Multitexture (cbx, cl.worldmodel, NULL, chain_world, 1, world_texstart[index], world_texend[index]);
 	R_EndDebugUtilsLabel (cbx);
 }
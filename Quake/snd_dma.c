@@ -31,11 +31,14 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 static void S_Play (void);
 static void S_PlayVol (void);
 static void S_SoundList (void);
+static void S_MixBenchmark_f (void);
 static void S_Update_ (void);
 void		S_StopAllSounds (qboolean clear, qboolean keep_statics);
 static void S_StopAllSoundsC (void);
+static void S_RunCommands (void);
+static void S_SpatializeChannels (void);
 
-void S_SetUnderwaterIntensity (float intensity);
+void S_SetUnderwaterIntensity (float target, float frametime);
 
 // =======================================================================
 // Internal sound data & structures
@@ -63,6 +66,17 @@ int paintedtime; // sample PAIRS
 int					  s_rawend;
 portable_samplepair_t s_rawsamples[MAX_RAW_SAMPLES];
 
+// S_RawSamples resampling state, carried over between calls so blocks join seamlessly
+#define RAW_RESAMPLE_BLOCK 1024
+static struct
+{
+	const resampler_t *r;
+	int				   channels;
+	int				   pos, phase;
+	float			   in[2][RESAMPLE_MAX_TAPS + RAW_RESAMPLE_BLOCK]; // taps frames of history, then the new block
+	float			   out[2][RAW_RESAMPLE_BLOCK];
+} rawresample;
+
 #define MAX_SFX 1024
 static sfx_t *known_sfx = NULL; // hunk allocated [MAX_SFX]
 static int	  num_sfx;
@@ -73,6 +87,64 @@ static qboolean sound_started = false;
 
 SDL_mutex *snd_mutex;
 
+// the game thread posts sound starts/stops and listener updates here, the
+// mixer thread runs them with snd_mutex held right before it mixes
+typedef enum
+{
+	SND_CMD_START,
+	SND_CMD_STOP,
+	SND_CMD_LISTENER,
+} sndcmd_type_t;
+
+typedef struct
+{
+	sndcmd_type_t type;
+	union
+	{
+		struct
+		{
+			int	   entnum;
+			int	   entchannel;
+			sfx_t *sfx;
+			vec3_t origin;
+			float  fvol;
+			float  attenuation;
+		} start;
+		struct
+		{
+			int entnum;
+			int entchannel;
+		} stop;
+		struct
+		{
+			vec3_t origin;
+			vec3_t forward;
+			vec3_t right;
+			vec3_t up;
+			int	   viewentity;
+			float	 frametime;
+			qboolean update_ambients;
+			int		 ambient_levels[NUM_AMBIENTS]; // -1 turns the channel off
+			float	 underwater;				   // < 0 leaves the underwater effect alone
+		} listener;
+	};
+} sndcmd_t;
+
+static void S_ListenerCmd (const sndcmd_t *cmd);
+
+#define SND_CMD_QUEUE_SIZE 1024 // must be a power of two
+#define SND_MIX_PERIOD_MS  5	// mixer wakes up at least this often
+
+static sndcmd_t		   snd_cmds[SND_CMD_QUEUE_SIZE];
+static atomic_uint32_t snd_cmd_head; // only written by the game thread
+static atomic_uint32_t snd_cmd_tail; // only written with snd_mutex held
+
+static SDL_Thread	  *snd_mixthread;
+static SDL_sem		   *snd_mixwake;
+static atomic_uint32_t snd_mixthread_quit;
+
+static int listener_viewentity;
+
 cvar_t bgmvolume = {"bgmvolume", "1", CVAR_ARCHIVE};
 cvar_t sfxvolume = {"volume", "0.7", CVAR_ARCHIVE};
 
@@ -115,11 +187,10 @@ static void S_SoundInfo_f (void)
 	Con_Printf ("%5d submission_chunk\n", shm->submission_chunk);
 	Con_Printf ("%5d total_channels\n", total_channels);
 	Con_Printf ("%p dma buffer\n", shm->buffer);
-}
-
-static void SND_Callback_sfxvolume (cvar_t *var)
-{
-	SND_InitScaletable ();
+	Con_Printf ("%5d sounds loaded in the background\n", snd_loadstats.queued);
+	Con_Printf ("%5d sounds loaded on demand\n", snd_loadstats.sync_loads);
+	Con_Printf ("%5d late starts, max %.1f ms\n", snd_loadstats.late_starts, snd_loadstats.late_max * 1000.0 / shm->speed);
+	Con_Printf ("%5d load stalls, max %.1f ms, total %.1f ms\n", snd_loadstats.stalls, snd_loadstats.stall_max * 1000.0, snd_loadstats.stall_time * 1000.0);
 }
 
 static void SND_Callback_snd_filterquality (cvar_t *var)
@@ -153,6 +224,82 @@ void S_Startup (void)
 	}
 }
 
+/*
+================
+S_MixFrame
+
+Everything the mixer does, with snd_mutex held
+================
+*/
+static void S_MixFrame (void)
+{
+	SDL_LockMutex (snd_mutex);
+	S_RunCommands ();
+	if (sound_started && !snd_blocked)
+	{
+		S_SpatializeChannels ();
+		S_Update_ ();
+	}
+	SDL_UnlockMutex (snd_mutex);
+}
+
+/*
+================
+S_MixThread
+
+Wakes up on the audio callback, or every SND_MIX_PERIOD_MS if the device
+doesn't have one, so mixing keeps up no matter how long a frame takes
+================
+*/
+static int S_MixThread (void *unused)
+{
+	SDL_SetThreadPriority (SDL_THREAD_PRIORITY_HIGH);
+	while (!Atomic_LoadUInt32 (&snd_mixthread_quit))
+	{
+		SDL_SemWaitTimeout (snd_mixwake, SND_MIX_PERIOD_MS);
+		S_MixFrame ();
+	}
+	return 0;
+}
+
+/*
+================
+S_WakeMixer
+
+Called from the audio callback once the device consumed a chunk
+================
+*/
+void S_WakeMixer (void)
+{
+	if (snd_mixwake && !SDL_SemValue (snd_mixwake))
+		SDL_SemPost (snd_mixwake);
+}
+
+static void S_StartMixThread (void)
+{
+	snd_mixwake = SDL_CreateSemaphore (0);
+	Atomic_StoreUInt32 (&snd_mixthread_quit, false);
+	snd_mixthread = SDL_CreateThread (S_MixThread, "Mixer", NULL);
+	if (!snd_mixthread)
+		Con_Printf ("Couldn't create mixer thread, mixing on the main thread\n");
+}
+
+static void S_StopMixThread (void)
+{
+	if (snd_mixthread)
+	{
+		Atomic_StoreUInt32 (&snd_mixthread_quit, true);
+		SDL_SemPost (snd_mixwake);
+		SDL_WaitThread (snd_mixthread, NULL);
+		snd_mixthread = NULL;
+	}
+	if (snd_mixwake)
+	{
+		SDL_DestroySemaphore (snd_mixwake);
+		snd_mixwake = NULL;
+	}
+}
+
 /*
 ================
 S_Init
@@ -185,6 +332,10 @@ void S_Init (void)
 	Cvar_RegisterVariable (&snd_filterquality);
 	Cvar_RegisterVariable (&snd_waterfx);
 	Cvar_RegisterVariable (&snd_pauselooping);
+	S_InitResample ();
+
+	// doesn't need a sound device
+	Cmd_AddCommand ("snd_mixbenchmark", S_MixBenchmark_f);
 
 	if (safemode || COM_CheckParm ("-nosound"))
 		return;
@@ -209,11 +360,8 @@ void S_Init (void)
 		Cvar_SetQuick (&snd_mixspeed, com_argv[i + 1]);
 	}
 
-	Cvar_SetCallback (&sfxvolume, SND_Callback_sfxvolume);
 	Cvar_SetCallback (&snd_filterquality, &SND_Callback_snd_filterquality);
 
-	SND_InitScaletable ();
-
 	known_sfx = (sfx_t *)Mem_Alloc (MAX_SFX * sizeof (sfx_t));
 	num_sfx = 0;
 
@@ -233,6 +381,8 @@ void S_Init (void)
 	S_CodecInit ();
 
 	S_StopAllSounds (true, false);
+
+	S_StartMixThread ();
 }
 
 // =======================================================================
@@ -243,6 +393,8 @@ void S_Shutdown (void)
 	if (!sound_started)
 		return;
 
+	S_StopMixThread ();
+
 	sound_started = 0;
 	snd_blocked = 0;
 
@@ -321,9 +473,9 @@ sfx_t *S_PrecacheSound (const char *name)
 
 	sfx = S_FindName (name);
 
-	// cache it in
+	// cache it in, in the background
 	if (precache.value)
-		S_LoadSound (sfx);
+		S_QueueSound (sfx);
 
 	return sfx;
 }
@@ -356,7 +508,7 @@ channel_t *SND_PickChannel (int entnum, int entchannel)
 		}
 
 		// don't let monster sounds override player sounds
-		if (snd_channels[ch_idx].entnum == cl.viewentity && entnum != cl.viewentity && snd_channels[ch_idx].sfx)
+		if (snd_channels[ch_idx].entnum == listener_viewentity && entnum != listener_viewentity && snd_channels[ch_idx].sfx)
 			continue;
 
 		if (snd_channels[ch_idx].end - paintedtime < life_left)
@@ -390,7 +542,7 @@ void SND_Spatialize (channel_t *ch)
 	vec3_t source_vec;
 
 	// anything coming from the view entity will always be full volume
-	if (ch->entnum == cl.viewentity)
+	if (ch->entnum == listener_viewentity)
 	{
 		ch->leftvol = ch->master_vol;
 		ch->rightvol = ch->master_vol;
@@ -429,21 +581,18 @@ void SND_Spatialize (channel_t *ch)
 // Start a sound effect
 // =======================================================================
 
-void S_StartSound (int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float fvol, float attenuation)
+static void S_StartSoundCmd (int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float fvol, float attenuation)
 {
 	channel_t  *target_chan, *check;
 	sfxcache_t *sc;
 	int			ch_idx;
 	int			skip;
-
-	SDL_LockMutex (snd_mutex);
-	if (!sound_started || !sfx || nosound.value)
-		goto unlock_mutex;
+	qboolean	loading;
 
 	// pick a channel to play on
 	target_chan = SND_PickChannel (entnum, entchannel);
 	if (!target_chan)
-		goto unlock_mutex;
+		return;
 
 	// spatialize
 	memset (target_chan, 0, sizeof (*target_chan));
@@ -455,14 +604,22 @@ void S_StartSound (int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float
 	SND_Spatialize (target_chan);
 
 	if (!target_chan->leftvol && !target_chan->rightvol)
-		goto unlock_mutex;
+		return;
 
 	// new channel
-	sc = S_LoadSound (sfx);
+	sc = S_PeekSound (sfx, &loading);
 	if (!sc)
 	{
-		target_chan->sfx = NULL;
-		goto unlock_mutex; // couldn't load the sound's data
+		if (loading)
+		{
+			// the mixer starts it once the data is there
+			target_chan->sfx = sfx;
+			target_chan->loading = true;
+			target_chan->end = paintedtime;
+		}
+		else
+			target_chan->sfx = NULL;
+		return; // couldn't load the sound's data (yet)
 	}
 
 	target_chan->sfx = sfx;
@@ -494,29 +651,111 @@ void S_StartSound (int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float
 			break;
 		}
 	}
-
-unlock_mutex:
-	SDL_UnlockMutex (snd_mutex);
 }
 
-void S_StopSound (int entnum, int entchannel)
+static void S_StopSoundCmd (int entnum, int entchannel)
 {
 	int i;
 
-	SDL_LockMutex (snd_mutex);
-
 	for (i = 0; i < MAX_DYNAMIC_CHANNELS; i++)
 	{
 		if (snd_channels[i].entnum == entnum && snd_channels[i].entchannel == entchannel)
 		{
 			snd_channels[i].end = 0;
 			snd_channels[i].sfx = NULL;
-			goto unlock_mutex;
+			return;
 		}
 	}
+}
 
-unlock_mutex:
-	SDL_UnlockMutex (snd_mutex);
+/*
+=================
+S_RunCommands
+
+Applies everything the game thread posted since the last time, in order.
+Whoever holds snd_mutex may do this, which keeps the mutex-taking functions
+below ordered with the sounds started before them.
+=================
+*/
+static void S_RunCommands (void)
+{
+	const uint32_t head = Atomic_LoadUInt32 (&snd_cmd_head);
+	uint32_t	   tail = Atomic_LoadUInt32 (&snd_cmd_tail);
+
+	for (; tail != head; ++tail)
+	{
+		const sndcmd_t *cmd = &snd_cmds[tail & (SND_CMD_QUEUE_SIZE - 1)];
+		switch (cmd->type)
+		{
+		case SND_CMD_START:
+			S_StartSoundCmd (cmd->start.entnum, cmd->start.entchannel, cmd->start.sfx, (float *)cmd->start.origin, cmd->start.fvol, cmd->start.attenuation);
+			break;
+		case SND_CMD_STOP:
+			S_StopSoundCmd (cmd->stop.entnum, cmd->stop.entchannel);
+			break;
+		case SND_CMD_LISTENER:
+			S_ListenerCmd (cmd);
+			break;
+		}
+	}
+
+	Atomic_StoreUInt32 (&snd_cmd_tail, tail);
+}
+
+/*
+=================
+S_PostCommand
+
+Lock-free for a single game thread. If the mixer fell that far behind, the
+queue is drained here instead, which keeps the order intact.
+=================
+*/
+static void S_PostCommand (const sndcmd_t *cmd)
+{
+	const uint32_t head = Atomic_LoadUInt32 (&snd_cmd_head);
+
+	if (head - Atomic_LoadUInt32 (&snd_cmd_tail) >= SND_CMD_QUEUE_SIZE)
+	{
+		SDL_LockMutex (snd_mutex);
+		S_RunCommands ();
+		SDL_UnlockMutex (snd_mutex);
+	}
+
+	snd_cmds[head & (SND_CMD_QUEUE_SIZE - 1)] = *cmd;
+	Atomic_StoreUInt32 (&snd_cmd_head, head + 1);
+}
+
+void S_StartSound (int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float fvol, float attenuation)
+{
+	sndcmd_t cmd;
+
+	if (!sound_started || !sfx || nosound.value)
+		return;
+
+	// the mixer never loads anything itself
+	S_QueueSound (sfx);
+
+	cmd.type = SND_CMD_START;
+	cmd.start.entnum = entnum;
+	cmd.start.entchannel = entchannel;
+	cmd.start.sfx = sfx;
+	VectorCopy (origin, cmd.start.origin);
+	cmd.start.fvol = fvol;
+	cmd.start.attenuation = attenuation;
+	S_PostCommand (&cmd);
+}
+
+void S_StopSound (int entnum, int entchannel)
+{
+	sndcmd_t cmd;
+
+	if (!sound_started)
+		return;
+
+	cmd.type = SND_CMD_STOP;
+	cmd.stop.entnum = entnum;
+	cmd.stop.entchannel = entchannel;
+	S_PostCommand (&cmd);
 }
 
 void S_StopAllSounds (qboolean clear, qboolean keep_statics)
@@ -530,6 +769,8 @@ void S_StopAllSounds (qboolean clear, qboolean keep_statics)
 	if (!sound_started)
 		goto unlock_mutex;
 
+	S_RunCommands ();
+
 	if (!keep_statics)
 		total_channels = MAX_DYNAMIC_CHANNELS + NUM_AMBIENTS; // no statics
 
@@ -599,6 +840,7 @@ void S_StaticSound (sfx_t *sfx, vec3_t origin, float vol, float attenuation)
 		return;
 
 	SDL_LockMutex (snd_mutex);
+	S_RunCommands ();
 
 	if (total_channels == MAX_CHANNELS)
 	{
@@ -607,6 +849,7 @@ void S_StaticSound (sfx_t *sfx, vec3_t origin, float vol, float attenuation)
 	}
 
 	ss = &snd_channels[total_channels];
+	memset (ss, 0, sizeof (*ss));
 	total_channels++;
 
 	sc = S_LoadSound (sfx);
@@ -656,39 +899,37 @@ static float S_UnderwaterIntensityForContents (int contents)
 S_UpdateAmbientSounds
 ===================
 */
-static void S_UpdateAmbientSounds (void)
+static void S_UpdateAmbientSounds (sndcmd_t *cmd)
 {
 	mleaf_t		*l;
 	int			 ambient_channel;
-	channel_t	*chan;
 	static float vol, levels[NUM_AMBIENTS]; // Spike: fixing ambient levels not changing at high enough framerates due to integer precison.
 
-	SDL_LockMutex (snd_mutex);
+	cmd->listener.update_ambients = false;
+	cmd->listener.underwater = -1.f;
 
 	// no ambients when disconnected
 	if (cls.state != ca_connected || cls.signon != SIGNONS)
 	{
-		S_SetUnderwaterIntensity (0.f);
-		goto unlock_mutex;
+		cmd->listener.underwater = 0.f;
+		return;
 	}
 	// calc ambient sound levels
 	if (!cl.worldmodel || cl.worldmodel->needload)
-		goto unlock_mutex;
+		return;
 
-	l = Mod_PointInLeaf (listener_origin, cl.worldmodel);
-	S_SetUnderwaterIntensity (l ? S_UnderwaterIntensityForContents (l->contents) : 0.f);
+	l = Mod_PointInLeaf (cmd->listener.origin, cl.worldmodel);
+	cmd->listener.underwater = l ? S_UnderwaterIntensityForContents (l->contents) : 0.f;
+	cmd->listener.update_ambients = true;
 	if (!l || !ambient_level.value)
 	{
 		for (ambient_channel = 0; ambient_channel < NUM_AMBIENTS; ambient_channel++)
-			snd_channels[ambient_channel].sfx = NULL;
-		goto unlock_mutex;
+			cmd->listener.ambient_levels[ambient_channel] = -1;
+		return;
 	}
 
 	for (ambient_channel = 0; ambient_channel < NUM_AMBIENTS; ambient_channel++)
 	{
-		chan = &snd_channels[ambient_channel];
-		chan->sfx = ambient_sfx[ambient_channel];
-
 		vol = (int)(ambient_level.value * l->ambient_sound_level[ambient_channel]);
 		if (vol < 8)
 			vol = 0;
@@ -700,18 +941,109 @@ static void S_UpdateAmbientSounds (void)
 			if (levels[ambient_channel] > vol)
 				levels[ambient_channel] = vol;
 		}
-		else if (chan->master_vol > vol)
+		else if (levels[ambient_channel] > vol)
 		{
 			levels[ambient_channel] -= (host_frametime * ambient_fade.value);
 			if (levels[ambient_channel] < vol)
 				levels[ambient_channel] = vol;
 		}
 
-		chan->leftvol = chan->rightvol = chan->master_vol = levels[ambient_channel];
+		cmd->listener.ambient_levels[ambient_channel] = levels[ambient_channel];
 	}
+}
 
-unlock_mutex:
-	SDL_UnlockMutex (snd_mutex);
+/*
+===================
+S_ListenerCmd
+
+Mixer side of S_Update
+===================
+*/
+static void S_ListenerCmd (const sndcmd_t *cmd)
+{
+	int ambient_channel;
+
+	VectorCopy (cmd->listener.origin, listener_origin);
+	VectorCopy (cmd->listener.forward, listener_forward);
+	VectorCopy (cmd->listener.right, listener_right);
+	VectorCopy (cmd->listener.up, listener_up);
+	listener_viewentity = cmd->listener.viewentity;
+
+	if (cmd->listener.underwater >= 0.f)
+		S_SetUnderwaterIntensity (cmd->listener.underwater, cmd->listener.frametime);
+
+	if (!cmd->listener.update_ambients)
+		return;
+
+	for (ambient_channel = 0; ambient_channel < NUM_AMBIENTS; ambient_channel++)
+	{
+		channel_t *chan = &snd_channels[ambient_channel];
+		if (cmd->listener.ambient_levels[ambient_channel] < 0)
+		{
+			chan->sfx = NULL;
+			continue;
+		}
+		chan->sfx = ambient_sfx[ambient_channel];
+		chan->leftvol = chan->rightvol = chan->master_vol = cmd->listener.ambient_levels[ambient_channel];
+	}
+}
+
+/*
+===================
+S_RawSamplesResample
+
+Windowed sinc path of S_RawSamples, converts in blocks and keeps the filter
+history in rawresample
+===================
+*/
+static void S_RawSamplesResample (const resampler_t *r, int samples, int width, int channels, byte *data, float volume)
+{
+	const int history = S_ResamplerTaps (r);
+	int		  i, c, n, count, pos, phase;
+
+	for (; samples > 0; samples -= n, data += n * width * channels)
+	{
+		n = q_min (samples, RAW_RESAMPLE_BLOCK);
+		for (c = 0; c < 2; c++)
+		{
+			float *in = rawresample.in[c] + history;
+			const int src = (channels == 2) ? c : 0;
+			if (width == 2)
+				for (i = 0; i < n; i++)
+					in[i] = ((short *)data)[i * channels + src];
+			else
+				for (i = 0; i < n; i++)
+					in[i] = (data[i * channels + src] - 128) * 256;
+		}
+
+		do
+		{
+			pos = rawresample.pos;
+			phase = rawresample.phase;
+			count = S_Resample (r, rawresample.in[0], history + n, &pos, &phase, rawresample.out[0], RAW_RESAMPLE_BLOCK);
+			if (channels == 2)
+				S_Resample (r, rawresample.in[1], history + n, &rawresample.pos, &rawresample.phase, rawresample.out[1], RAW_RESAMPLE_BLOCK);
+			else
+			{
+				memcpy (rawresample.out[1], rawresample.out[0], count * sizeof (float));
+				rawresample.pos = pos;
+				rawresample.phase = phase;
+			}
+
+			for (i = 0; i < count; i++)
+			{
+				const int dst = s_rawend & (MAX_RAW_SAMPLES - 1);
+				s_rawend++;
+				s_rawsamples[dst].left = rawresample.out[0][i] * volume;
+				s_rawsamples[dst].right = rawresample.out[1][i] * volume;
+			}
+		} while (count == RAW_RESAMPLE_BLOCK);
+
+		// keep the last taps frames as history for the next block
+		for (c = 0; c < 2; c++)
+			memmove (rawresample.in[c], rawresample.in[c] + n, history * sizeof (float));
+		rawresample.pos -= n;
+	}
 }
 
 /*
@@ -731,13 +1063,30 @@ void S_RawSamples (int samples, int rate, int width, int channels, byte *data, f
 	float scale;
 	int	  intVolume;
 
+	// the mixer thread reads s_rawend and moves paintedtime
+	SDL_LockMutex (snd_mutex);
+
+	const resampler_t *r = S_GetResampler (rate, shm->speed, (int)snd_resample.value);
+	if (s_rawend < paintedtime || r != rawresample.r || channels != rawresample.channels)
+	{
+		// new stream or an underrun, forget the history
+		memset (rawresample.in, 0, sizeof (rawresample.in));
+		rawresample.r = r;
+		rawresample.channels = channels;
+		if (r)
+			rawresample.pos = S_ResamplerTaps (r) - S_ResamplerTaps (r) / 2 + 1;
+		rawresample.phase = 0;
+	}
+
 	if (s_rawend < paintedtime)
 		s_rawend = paintedtime;
 
 	scale = (float)rate / shm->speed;
 	intVolume = (int)(256 * volume);
 
-	if (channels == 2 && width == 2)
+	if (r)
+		S_RawSamplesResample (r, samples, width, channels, data, 256.0f * volume);
+	else if (channels == 2 && width == 2)
 	{
 		for (i = 0;; i++)
 		{
@@ -797,34 +1146,24 @@ void S_RawSamples (int samples, int rate, int width, int channels, byte *data, f
 			s_rawsamples[dst].right = (((byte *)data)[src] - 128) * intVolume;
 		}
 	}
+
+	SDL_UnlockMutex (snd_mutex);
 }
 
 /*
 ============
-S_Update
+S_SpatializeChannels
 
-Called once each time through the main loop
+Mixer side, right before mixing
 ============
 */
-void S_Update (vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
+static void S_SpatializeChannels (void)
 {
 	int		   i, j;
 	int		   total;
 	channel_t *ch;
 	channel_t *combine;
 
-	SDL_LockMutex (snd_mutex);
-	if (!sound_started || (snd_blocked > 0))
-		goto unlock_mutex;
-
-	VectorCopy (origin, listener_origin);
-	VectorCopy (forward, listener_forward);
-	VectorCopy (right, listener_right);
-	VectorCopy (up, listener_up);
-
-	// update general area ambient sound sources
-	S_UpdateAmbientSounds ();
-
 	combine = NULL;
 
 	// update spatialization for static and dynamic sounds
@@ -893,15 +1232,41 @@ void S_Update (vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
 
 		Con_Printf ("----(%i)----\n", total);
 	}
+}
+
+/*
+============
+S_Update
+
+Called once each time through the main loop, only hands the listener over
+to the mixer
+============
+*/
+void S_Update (vec3_t origin, vec3_t forward, vec3_t right, vec3_t up)
+{
+	sndcmd_t cmd;
+
+	if (!sound_started || (snd_blocked > 0))
+		return;
+
+	cmd.type = SND_CMD_LISTENER;
+	VectorCopy (origin, cmd.listener.origin);
+	VectorCopy (forward, cmd.listener.forward);
+	VectorCopy (right, cmd.listener.right);
+	VectorCopy (up, cmd.listener.up);
+	cmd.listener.viewentity = cl.viewentity;
+	cmd.listener.frametime = host_frametime;
+
+	// update general area ambient sound sources
+	S_UpdateAmbientSounds (&cmd);
+
+	S_PostCommand (&cmd);
 
 	// add raw data from streamed samples
 	//	BGM_Update();	// moved to the main loop just before S_Update ()
 
-	// mix some sound
-	S_Update_ ();
-
-unlock_mutex:
-	SDL_UnlockMutex (snd_mutex);
+	if (!snd_mixthread)
+		S_MixFrame ();
 }
 
 static void GetSoundtime (void)
@@ -935,9 +1300,9 @@ static void GetSoundtime (void)
 
 void S_ExtraUpdate (void)
 {
-	if (snd_noextraupdate.value)
-		return; // don't pollute timings
-	S_Update_ ();
+	if (snd_noextraupdate.value || snd_mixthread)
+		return; // don't pollute timings, the mixer thread keeps going on its own
+	S_MixFrame ();
 }
 
 static void S_Update_ (void)
@@ -1022,13 +1387,17 @@ void S_ClearAll (void)
 {
 	SDL_LockMutex (snd_mutex);
 
+	S_RunCommands ();
+
 	for (int i = 0; i < num_sfx; ++i)
+		S_UnloadSound (&known_sfx[i]);
+
+	// the mixer won't load them on its own, and every map wants them
+	if (sound_started && precache.value)
 	{
-		if (known_sfx[i].cache)
-		{
-			Mem_Free (known_sfx[i].cache);
-			known_sfx[i].cache = NULL;
-		}
+		for (int i = 0; i < NUM_AMBIENTS; ++i)
+			if (ambient_sfx[i])
+				S_QueueSound (ambient_sfx[i]);
 	}
 
 	SDL_UnlockMutex (snd_mutex);
@@ -1110,6 +1479,118 @@ static void S_SoundList (void)
 	Con_Printf ("%i sounds, %i bytes\n", num_sfx, total); // johnfitz -- added count
 }
 
+/*
+==================
+S_MixBenchmark_f
+
+Mixes a fixed set of channels into a private 44.1 kHz stereo buffer as fast
+as possible. The sound device, if there is one, is held while this runs.
+==================
+*/
+static void S_MixBenchmark_f (void)
+{
+	static const int speed = 44100;
+	const int		 numchannels = (Cmd_Argc () > 1) ? CLAMP (1, atoi (Cmd_Argv (1)), MAX_CHANNELS) : 256;
+	const int		 numsamples = ((Cmd_Argc () > 2) ? CLAMP (1.0f, (float)atof (Cmd_Argv (2)), 60.0f) : 10.0f) * speed;
+	const int		 chunk = 512;
+	const int		 length = numsamples + speed;
+	dma_t			 bench;
+	volatile dma_t	*saved_shm;
+	channel_t		*saved_channels;
+	int				 saved_total_channels, saved_paintedtime, saved_rawend;
+	sfx_t			 sfx[2];
+	unsigned int	 seed = 1;
+	double			 start, elapsed;
+	int				 i;
+
+	// one 8 bit and one 16 bit sound, long enough to never stop during the run
+	memset (sfx, 0, sizeof (sfx));
+	for (i = 0; i < 2; i++)
+	{
+		const int	width = i + 1;
+		sfxcache_t *sc = (sfxcache_t *)Mem_Alloc (sizeof (sfxcache_t) + length * width);
+		q_snprintf (sfx[i].name, sizeof (sfx[i].name), "*benchmark%d", width * 8);
+		sc->length = length;
+		sc->loopstart = -1;
+		sc->speed = speed;
+		sc->width = width;
+		for (int j = 0; j < length * width; j++)
+		{
+			seed = seed * 1103515245 + 12345;
+			sc->data[j] = seed >> 24;
+		}
+		sfx[i].cache = sc;
+	}
+
+	SDL_LockMutex (snd_mutex);
+	if (sound_started)
+		SNDDMA_LockBuffer ();
+
+	saved_shm = shm;
+	saved_channels = (channel_t *)Mem_AllocNonZero (sizeof (snd_channels));
+	memcpy (saved_channels, snd_channels, sizeof (snd_channels));
+	saved_total_channels = total_channels;
+	saved_paintedtime = paintedtime;
+	saved_rawend = s_rawend;
+
+	memset (&bench, 0, sizeof (bench));
+	bench.channels = 2;
+	bench.samplebits = 16;
+	bench.speed = speed;
+	bench.samples = 16384;
+	bench.buffer = (unsigned char *)Mem_Alloc (bench.samples * sizeof (short));
+	shm = &bench;
+
+	memset (snd_channels, 0, sizeof (snd_channels));
+	total_channels = numchannels;
+	paintedtime = 0;
+	s_rawend = 0;
+	for (i = 0; i < numchannels; i++)
+	{
+		channel_t *ch = &snd_channels[i];
+		seed = seed * 1103515245 + 12345;
+		ch->sfx = &sfx[i & 1];
+		ch->pos = (seed >> 8) % speed;
+		ch->end = length - ch->pos;
+		ch->leftvol = 32 + (seed >> 16) % 224;
+		ch->rightvol = 32 + (seed >> 20) % 224;
+	}
+
+	start = Sys_DoubleTime ();
+	while (paintedtime < numsamples)
+	{
+		// keep some volume ramps going, like moving sources would
+		for (i = (paintedtime / chunk) % 8; i < numchannels; i += 8)
+		{
+			seed = seed * 1103515245 + 12345;
+			snd_channels[i].leftvol = 32 + (seed >> 16) % 224;
+			snd_channels[i].rightvol = 32 + (seed >> 20) % 224;
+		}
+		S_PaintChannels (q_min (paintedtime + chunk, numsamples));
+	}
+	elapsed = Sys_DoubleTime () - start;
+
+	shm = saved_shm;
+	memcpy (snd_channels, saved_channels, sizeof (snd_channels));
+	total_channels = saved_total_channels;
+	paintedtime = saved_paintedtime;
+	s_rawend = saved_rawend;
+	Mem_Free (saved_channels);
+	Mem_Free (bench.buffer);
+
+	if (sound_started)
+		SNDDMA_Submit ();
+	SDL_UnlockMutex (snd_mutex);
+
+	Mem_Free (sfx[0].cache);
+	Mem_Free (sfx[1].cache);
+
+	Con_Printf (
+		"%d channels, %d samples in %.1f ms: %.1f ns/sample, %.2f ns/channel-sample (%s%s)\n", numchannels, numsamples, elapsed * 1000.0,
+		elapsed * 1e9 / numsamples, elapsed * 1e9 / numsamples / numchannels, use_simd ? "simd" : "scalar",
+		(sndspeed.value == 11025) ? ", lowpass" : "");
+}
+
 void S_LocalSound (const char *name)
 {
 	sfx_t *sfx;
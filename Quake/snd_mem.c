@@ -22,31 +22,33 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 
-extern SDL_mutex *snd_mutex;
+sfxloadstats_t snd_loadstats;
 
 /*
 ================
 ResampleSfx
+
+r selects the windowed sinc resampler, NULL keeps nearest sample stepping
 ================
 */
-static void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
+static void ResampleSfx (sfxcache_t *sc, int inrate, int inwidth, byte *data, int outspeed, qboolean as8bit, const resampler_t *r)
 {
-	int			outcount;
-	int			srcsample;
-	float		stepscale;
-	int			i;
-	int			sample, samplefrac, fracstep;
-	sfxcache_t *sc = sfx->cache;
+	int	  outcount;
+	int	  srcsample;
+	float stepscale;
+	int	  i;
+	int	  sample, samplefrac, fracstep;
+	int	  inlength = sc->length;
 
-	stepscale = (float)inrate / shm->speed; // this is usually 0.5, 1, or 2
+	stepscale = (float)inrate / outspeed; // this is usually 0.5, 1, or 2
 
-	outcount = sc->length / stepscale;
+	outcount = r ? S_ResampleLength (r, sc->length) : sc->length / stepscale;
 	sc->length = outcount;
 	if (sc->loopstart != -1)
-		sc->loopstart = sc->loopstart / stepscale;
+		sc->loopstart = r ? S_ResampleLength (r, sc->loopstart) : sc->loopstart / stepscale;
 
-	sc->speed = shm->speed;
-	if (loadas8bit.value)
+	sc->speed = outspeed;
+	if (as8bit)
 		sc->width = 1;
 	else
 		sc->width = inwidth;
@@ -60,6 +62,34 @@ static void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 		for (i = 0; i < outcount; i++)
 			((signed char *)sc->data)[i] = (int)((unsigned char)(data[i]) - 128);
 	}
+	else if (r)
+	{
+		// pad with silence so the kernel can center on every input sample
+		const int pad = S_ResamplerTaps (r);
+		float	 *in = (float *)Mem_Alloc ((inlength + 2 * pad) * sizeof (float));
+		float	 *out = (float *)Mem_Alloc (outcount * sizeof (float));
+		int		  pos = pad - pad / 2 + 1, phase = 0;
+
+		for (i = 0; i < inlength; i++)
+		{
+			if (inwidth == 2)
+				in[pad + i] = LittleShort (((short *)data)[i]);
+			else
+				in[pad + i] = (int)((unsigned char)(data[i]) - 128) * 256;
+		}
+		S_Resample (r, in, inlength + 2 * pad, &pos, &phase, out, outcount);
+		for (i = 0; i < outcount; i++)
+		{
+			sample = CLAMP (-32768, Q_rint (out[i]), 32767);
+			if (sc->width == 2)
+				((short *)sc->data)[i] = sample;
+			else
+				((signed char *)sc->data)[i] = sample >> 8;
+		}
+
+		Mem_Free (in);
+		Mem_Free (out);
+	}
 	else
 	{
 		// general case
@@ -83,18 +113,250 @@ static void ResampleSfx (sfx_t *sfx, int inrate, int inwidth, byte *data)
 
 //=============================================================================
 
+/*
+==============
+S_DecodeSound
+
+Builds the cache for a wav file already in memory. Doesn't touch any shared
+state, so it is safe to call from a worker.
+==============
+*/
+static sfxcache_t *S_DecodeSound (const char *name, byte *data, int size, int outspeed, qboolean as8bit, int quality)
+{
+	wavinfo_t		   info;
+	int				   len;
+	float			   stepscale;
+	sfxcache_t		  *sc;
+	const resampler_t *r;
+
+	info = GetWavinfo (name, data, size);
+	if (info.channels != 1)
+	{
+		Con_Printf ("%s is a stereo sample\n", name);
+		return NULL;
+	}
+
+	if (info.width != 1 && info.width != 2)
+	{
+		Con_Printf ("%s is not 8 or 16 bit\n", name);
+		return NULL;
+	}
+
+	r = S_GetResampler (info.rate, outspeed, quality);
+	stepscale = (float)info.rate / outspeed;
+	len = r ? S_ResampleLength (r, info.samples) : info.samples / stepscale;
+
+	len = len * info.width * info.channels;
+
+	if (info.samples == 0 || len == 0)
+	{
+		Con_Printf ("%s has zero samples\n", name);
+		return NULL;
+	}
+
+	sc = (sfxcache_t *)Mem_Alloc (len + sizeof (sfxcache_t));
+	if (!sc)
+		return NULL;
+	sc->length = info.samples;
+	sc->loopstart = info.loopstart;
+	sc->speed = info.rate;
+	sc->width = info.width;
+	sc->stereo = info.channels;
+
+	ResampleSfx (sc, sc->speed, sc->width, data + info.dataofs, outspeed, as8bit, r);
+	return sc;
+}
+
+/*
+===============================================================================
+
+Background loading
+
+S_PrecacheSound hands the file read, decode and resample to a worker, so
+neither the precache nor the first S_StartSound of a sound has to wait for
+the disk. The file is located on the calling thread because pak reads share
+one handle, the worker reads it through its own FILE.
+
+===============================================================================
+*/
+
+typedef struct sfxload_s
+{
+	sfx_t		   *sfx;
+	task_handle_t	task;
+	atomic_uint32_t done;
+	FILE		   *file;
+	int				filesize;
+	int				outspeed;
+	qboolean		as8bit;
+	int				quality;
+	sfxcache_t	   *cache; // result, NULL once done means the sound couldn't be loaded
+} sfxload_t;
+
+/*
+==============
+S_LoadSoundTask
+==============
+*/
+static void S_LoadSoundTask (void *payload)
+{
+	sfxload_t *load = *(sfxload_t **)payload;
+	byte	  *data = (byte *)Mem_AllocNonZero (load->filesize);
+
+	if (fread (data, 1, load->filesize, load->file) == (size_t)load->filesize)
+		load->cache = S_DecodeSound (load->sfx->name, data, load->filesize, load->outspeed, load->as8bit, load->quality);
+	else
+		Con_Printf ("Couldn't load sound/%s\n", load->sfx->name);
+
+	fclose (load->file);
+	load->file = NULL;
+	Mem_Free (data);
+
+	Atomic_StoreUInt32 (&load->done, true);
+}
+
+/*
+==============
+S_QueueLoad
+==============
+*/
+static void S_QueueLoad (sfx_t *s)
+{
+	char	   namebuffer[256];
+	sfxload_t *load;
+	FILE	  *f;
+	int		   size;
+
+	load = (sfxload_t *)Mem_Alloc (sizeof (sfxload_t));
+	load->sfx = s;
+	load->task = INVALID_TASK_HANDLE;
+	s->load = load;
+
+	q_snprintf (namebuffer, sizeof (namebuffer), "sound/%s", s->name);
+	size = COM_FOpenFile (namebuffer, &f, NULL);
+	if (!f || size <= 0)
+	{
+		// keep the failed load around so the mixer doesn't retry every frame
+		Con_Printf ("Couldn't load %s\n", namebuffer);
+		if (f)
+			fclose (f);
+		Atomic_StoreUInt32 (&load->done, true);
+		return;
+	}
+
+	load->file = f;
+	load->filesize = size;
+	load->outspeed = shm->speed;
+	load->as8bit = loadas8bit.value != 0;
+	load->quality = (int)snd_resample.value;
+
+	++snd_loadstats.queued;
+	load->task = Task_AllocateAssignFuncAndSubmit (S_LoadSoundTask, &load, sizeof (load));
+}
+
+/*
+==============
+S_FinishLoad
+
+Takes over the result of a background load, returns false if it is still
+running and wait isn't set
+==============
+*/
+static qboolean S_FinishLoad (sfx_t *s, qboolean wait)
+{
+	sfxload_t *load = s->load;
+
+	if (load->task != INVALID_TASK_HANDLE)
+	{
+		if (!Atomic_LoadUInt32 (&load->done))
+		{
+			if (!wait)
+				return false;
+
+			const double start = Sys_DoubleTime ();
+			Task_Join (load->task, SDL_MUTEX_MAXWAIT);
+			const double stall = Sys_DoubleTime () - start;
+			++snd_loadstats.stalls;
+			snd_loadstats.stall_time += stall;
+			snd_loadstats.stall_max = q_max (snd_loadstats.stall_max, stall);
+		}
+		else
+			Task_Join (load->task, SDL_MUTEX_MAXWAIT);
+		load->task = INVALID_TASK_HANDLE;
+	}
+
+	// the load stays attached until S_UnloadSound, so the game thread can
+	// tell a queued sound from a new one without taking snd_mutex
+	s->cache = load->cache;
+	return true;
+}
+
+/*
+==============
+S_QueueSound
+
+Starts loading the sound in the background unless that already happened.
+Game thread only: s->load is only ever written there, and s->cache is only
+written by the mixer once s->load is set.
+==============
+*/
+void S_QueueSound (sfx_t *s)
+{
+	if (s->load || s->cache)
+		return;
+
+	SDL_LockMutex (snd_mutex);
+	S_QueueLoad (s);
+	SDL_UnlockMutex (snd_mutex);
+}
+
+/*
+==============
+S_PeekSound
+
+Returns the cache if the sound is ready, never loads anything itself.
+*loading tells a pending load from a failed or missing one. Called with
+snd_mutex held.
+==============
+*/
+sfxcache_t *S_PeekSound (sfx_t *s, qboolean *loading)
+{
+	*loading = false;
+	if (!s->cache && s->load)
+		*loading = !S_FinishLoad (s, false);
+	return s->cache;
+}
+
+/*
+==============
+S_UnloadSound
+==============
+*/
+void S_UnloadSound (sfx_t *s)
+{
+	SDL_LockMutex (snd_mutex);
+
+	if (s->load)
+	{
+		S_FinishLoad (s, true);
+		SAFE_FREE (s->load);
+	}
+	SAFE_FREE (s->cache);
+
+	SDL_UnlockMutex (snd_mutex);
+}
+
 /*
 ==============
 S_LoadSound
+
+Blocking version of S_PeekSound, loads the sound if nobody asked for it yet
 ==============
 */
 sfxcache_t *S_LoadSound (sfx_t *s)
 {
 	char		namebuffer[256];
-	byte	   *data = NULL;
-	wavinfo_t	info;
-	int			len;
-	float		stepscale;
+	byte	   *data;
 	sfxcache_t *sc = NULL;
 
 	SDL_LockMutex (snd_mutex);
@@ -106,7 +368,13 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 		goto unlock_mutex;
 	}
 
-	//	Con_Printf ("S_LoadSound: %x\n", (int)stackbuf);
+	// already on its way
+	if (s->load)
+	{
+		S_FinishLoad (s, true);
+		sc = s->cache;
+		goto unlock_mutex;
+	}
 
 	// load it in
 	q_strlcpy (namebuffer, "sound/", sizeof (namebuffer));
@@ -122,44 +390,11 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 		goto unlock_mutex;
 	}
 
-	info = GetWavinfo (s->name, data, com_filesize);
-	if (info.channels != 1)
-	{
-		Con_Printf ("%s is a stereo sample\n", s->name);
-		goto unlock_mutex;
-	}
-
-	if (info.width != 1 && info.width != 2)
-	{
-		Con_Printf ("%s is not 8 or 16 bit\n", s->name);
-		goto unlock_mutex;
-	}
-
-	stepscale = (float)info.rate / shm->speed;
-	len = info.samples / stepscale;
-
-	len = len * info.width * info.channels;
-
-	if (info.samples == 0 || len == 0)
-	{
-		Con_Printf ("%s has zero samples\n", s->name);
-		goto unlock_mutex;
-	}
-
-	sc = (sfxcache_t *)Mem_Alloc (len + sizeof (sfxcache_t));
-	if (!sc)
-		goto unlock_mutex;
-	sc->length = info.samples;
-	sc->loopstart = info.loopstart;
-	sc->speed = info.rate;
-	sc->width = info.width;
-	sc->stereo = info.channels;
-
-	s->cache = sc;
-	ResampleSfx (s, sc->speed, sc->width, data + info.dataofs);
+	++snd_loadstats.sync_loads;
+	sc = s->cache = S_DecodeSound (s->name, data, com_filesize, shm->speed, loadas8bit.value != 0, (int)snd_resample.value);
+	Mem_Free (data);
 
 unlock_mutex:
-	Mem_Free (data);
 	SDL_UnlockMutex (snd_mutex);
 	return sc;
 }
@@ -172,79 +407,82 @@ WAV loading
 ===============================================================================
 */
 
-static byte *data_p;
-static byte *iff_end;
-static byte *last_chunk;
-static byte *iff_data;
-static int	 iff_chunk_len;
-
-static short GetLittleShort (void)
+typedef struct
+{
+	byte *data_p;
+	byte *iff_end;
+	byte *last_chunk;
+	byte *iff_data;
+	int	  iff_chunk_len;
+} wavparse_t;
+
+static short GetLittleShort (wavparse_t *wp)
 {
 	unsigned short val = 0;
-	val = *data_p;
-	val = val + (((unsigned short)(*(data_p + 1))) << 8);
-	data_p += 2;
+	val = *wp->data_p;
+	val = val + (((unsigned short)(*(wp->data_p + 1))) << 8);
+	wp->data_p += 2;
 	return val;
 }
 
-static int GetLittleLong (void)
+static int GetLittleLong (wavparse_t *wp)
 {
 	unsigned int val = 0;
-	val = *data_p;
-	val = val + (((unsigned int)(*(data_p + 1))) << 8);
-	val = val + (((unsigned int)(*(data_p + 2))) << 16);
-	val = val + (((unsigned int)(*(data_p + 3))) << 24);
-	data_p += 4;
+	val = *wp->data_p;
+	val = val + (((unsigned int)(*(wp->data_p + 1))) << 8);
+	val = val + (((unsigned int)(*(wp->data_p + 2))) << 16);
+	val = val + (((unsigned int)(*(wp->data_p + 3))) << 24);
+	wp->data_p += 4;
 	return val;
 }
 
-static void FindNextChunk (const char *name)
+static void FindNextChunk (wavparse_t *wp, const char *name)
 {
 	while (1)
 	{
 		// Need at least 8 bytes for a chunk
-		if (last_chunk + 8 >= iff_end)
+		if (wp->last_chunk + 8 >= wp->iff_end)
 		{
-			data_p = NULL;
+			wp->data_p = NULL;
 			return;
 		}
 
-		data_p = last_chunk + 4;
-		iff_chunk_len = GetLittleLong ();
-		if (iff_chunk_len < 0 || iff_chunk_len > iff_end - data_p)
+		wp->data_p = wp->last_chunk + 4;
+		wp->iff_chunk_len = GetLittleLong (wp);
+		if (wp->iff_chunk_len < 0 || wp->iff_chunk_len > wp->iff_end - wp->data_p)
 		{
-			data_p = NULL;
-			Con_DPrintf2 ("bad \"%s\" chunk length (%d)\n", name, iff_chunk_len);
+			wp->data_p = NULL;
+			Con_DPrintf2 ("bad \"%s\" chunk length (%d)\n", name, wp->iff_chunk_len);
 			return;
 		}
-		last_chunk = data_p + ((iff_chunk_len + 1) & ~1);
-		data_p -= 8;
-		if (!strncmp ((char *)data_p, name, 4))
+		wp->last_chunk = wp->data_p + ((wp->iff_chunk_len + 1) & ~1);
+		wp->data_p -= 8;
+		if (!strncmp ((char *)wp->data_p, name, 4))
 			return;
 	}
 }
 
-static void FindChunk (const char *name)
+static void FindChunk (wavparse_t *wp, const char *name)
 {
-	last_chunk = iff_data;
-	FindNextChunk (name);
+	wp->last_chunk = wp->iff_data;
+	FindNextChunk (wp, name);
 }
 
 #if 0
-static void DumpChunks (void)
+static void DumpChunks (wavparse_t *wp)
 {
 	char	str[5];
 
 	str[4] = 0;
-	data_p = iff_data;
+	wp->data_p = wp->iff_data;
 	do
 	{
-		memcpy (str, data_p, 4);
-		data_p += 4;
-		iff_chunk_len = GetLittleLong();
-		Con_Printf ("0x%x : %s (%d)\n", (int)(data_p - 4), str, iff_chunk_len);
-		data_p += (iff_chunk_len + 1) & ~1;
-	} while (data_p < iff_end);
+		memcpy (str, wp->data_p, 4);
+		wp->data_p += 4;
+		wp->iff_chunk_len = GetLittleLong (wp);
+		Con_Printf ("0x%x : %s (%d)\n", (int)(wp->data_p - 4), str, wp->iff_chunk_len);
+		wp->data_p += (wp->iff_chunk_len + 1) & ~1;
+	} while (wp->data_p < wp->iff_end);
 }
 #endif
 
@@ -255,71 +493,72 @@ GetWavinfo
 */
 wavinfo_t GetWavinfo (const char *name, byte *wav, int wavlength)
 {
-	wavinfo_t info;
-	int		  i;
-	int		  format;
-	int		  samples;
+	wavinfo_t  info;
+	int		   i;
+	int		   format;
+	int		   samples;
+	wavparse_t wp;
 
 	memset (&info, 0, sizeof (info));
 
 	if (!wav)
 		return info;
 
-	iff_data = wav;
-	iff_end = wav + wavlength;
+	wp.iff_data = wav;
+	wp.iff_end = wav + wavlength;
 
 	// find "RIFF" chunk
-	FindChunk ("RIFF");
-	if (!(data_p && !strncmp ((char *)data_p + 8, "WAVE", 4)))
+	FindChunk (&wp, "RIFF");
+	if (!(wp.data_p && !strncmp ((char *)wp.data_p + 8, "WAVE", 4)))
 	{
 		Con_Printf ("%s missing RIFF/WAVE chunks\n", name);
 		return info;
 	}
 
 	// get "fmt " chunk
-	iff_data = data_p + 12;
+	wp.iff_data = wp.data_p + 12;
 #if 0
-	DumpChunks ();
+	DumpChunks (&wp);
 #endif
 
-	FindChunk ("fmt ");
-	if (!data_p)
+	FindChunk (&wp, "fmt ");
+	if (!wp.data_p)
 	{
 		Con_Printf ("%s is missing fmt chunk\n", name);
 		return info;
 	}
-	data_p += 8;
-	format = GetLittleShort ();
+	wp.data_p += 8;
+	format = GetLittleShort (&wp);
 	if (format != WAV_FORMAT_PCM)
 	{
 		Con_Printf ("%s is not Microsoft PCM format\n", name);
 		return info;
 	}
 
-	info.channels = GetLittleShort ();
-	info.rate = GetLittleLong ();
-	data_p += 4 + 2;
-	i = GetLittleShort ();
+	info.channels = GetLittleShort (&wp);
+	info.rate = GetLittleLong (&wp);
+	wp.data_p += 4 + 2;
+	i = GetLittleShort (&wp);
 	if (i != 8 && i != 16)
 		return info;
 	info.width = i / 8;
 
 	// get cue chunk
-	FindChunk ("cue ");
-	if (data_p)
+	FindChunk (&wp, "cue ");
+	if (wp.data_p)
 	{
-		data_p += 32;
-		info.loopstart = GetLittleLong ();
+		wp.data_p += 32;
+		info.loopstart = GetLittleLong (&wp);
 		//	Con_Printf("loopstart=%d\n", sfx->loopstart);
 
 		// if the next chunk is a LIST chunk, look for a cue length marker
-		FindNextChunk ("LIST");
-		if (data_p)
+		FindNextChunk (&wp, "LIST");
+		if (wp.data_p)
 		{
-			if (!strncmp ((char *)data_p + 28, "mark", 4))
+			if (!strncmp ((char *)wp.data_p + 28, "mark", 4))
 			{ // this is not a proper parse, but it works with cooledit...
-				data_p += 24;
-				i = GetLittleLong (); // samples in loop
+				wp.data_p += 24;
+				i = GetLittleLong (&wp); // samples in loop
 				info.samples = info.loopstart + i;
 				//		Con_Printf("looped length: %i\n", i);
 			}
@@ -329,15 +568,15 @@ wavinfo_t GetWavinfo (const char *name, byte *wav, int wavlength)
 		info.loopstart = -1;
 
 	// find data chunk
-	FindChunk ("data");
-	if (!data_p)
+	FindChunk (&wp, "data");
+	if (!wp.data_p)
 	{
 		Con_Printf ("%s is missing data chunk\n", name);
 		return info;
 	}
 
-	data_p += 4;
-	samples = GetLittleLong () / info.width;
+	wp.data_p += 4;
+	samples = GetLittleLong (&wp) / info.width;
 
 	if (info.samples)
 	{
@@ -347,7 +586,7 @@ wavinfo_t GetWavinfo (const char *name, byte *wav, int wavlength)
 	else
 		info.samples = samples;
 
-	info.dataofs = data_p - wav;
+	info.dataofs = wp.data_p - wav;
 
 	return info;
 }
@@ -24,44 +24,26 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "quakedef.h"
 
 #define PAINTBUFFER_SIZE 2048
-portable_samplepair_t paintbuffer[PAINTBUFFER_SIZE];
-int					  snd_scaletable[32][256];
-int					 *snd_p, snd_linear_count;
-short				 *snd_out;
+#define SND_RAMP_LENGTH	 64 // samples a volume change is spread over, so it doesn't click
 
-static int snd_vol;
+// planar float mix, in the units of the old integer paintbuffer (16 bit sample * 256)
+static float paint_left[PAINTBUFFER_SIZE];
+static float paint_right[PAINTBUFFER_SIZE];
+// final interleaved stereo samples, ready to go to the DMA buffer
+static short paint_out[PAINTBUFFER_SIZE * 2];
 
-static void Snd_WriteLinearBlastStereo16 (void)
-{
-	int i;
-	int val;
-
-	for (i = 0; i < snd_linear_count; i += 2)
-	{
-		val = snd_p[i] / 256;
-		if (val > SHRT_MAX)
-			snd_out[i] = SHRT_MAX;
-		else if (val < SHRT_MIN)
-			snd_out[i] = SHRT_MIN;
-		else
-			snd_out[i] = val;
+static float snd_vol;
 
-		val = snd_p[i + 1] / 256;
-		if (val > SHRT_MAX)
-			snd_out[i + 1] = SHRT_MAX;
-		else if (val < SHRT_MIN)
-			snd_out[i + 1] = SHRT_MIN;
-		else
-			snd_out[i + 1] = val;
-	}
-}
+#define PAINT_CLIP_MIN (-32768.0f * 256.0f)
+#define PAINT_CLIP_MAX (32767.0f * 256.0f)
 
 static void S_TransferStereo16 (int endtime)
 {
-	int lpos;
-	int lpaintedtime;
+	int	   lpos;
+	int	   lpaintedtime;
+	int	   count;
+	short *src = paint_out;
 
-	snd_p = (int *)paintbuffer;
 	lpaintedtime = paintedtime;
 
 	while (lpaintedtime < endtime)
@@ -69,27 +51,23 @@ static void S_TransferStereo16 (int endtime)
 		// handle recirculating buffer issues
 		lpos = lpaintedtime & ((shm->samples >> 1) - 1);
 
-		snd_out = (short *)shm->buffer + (lpos << 1);
-
-		snd_linear_count = (shm->samples >> 1) - lpos;
-		if (lpaintedtime + snd_linear_count > endtime)
-			snd_linear_count = endtime - lpaintedtime;
-
-		snd_linear_count <<= 1;
+		count = (shm->samples >> 1) - lpos;
+		if (lpaintedtime + count > endtime)
+			count = endtime - lpaintedtime;
 
 		// write a linear blast of samples
-		Snd_WriteLinearBlastStereo16 ();
+		memcpy ((short *)shm->buffer + (lpos << 1), src, count * 2 * sizeof (short));
 
-		snd_p += snd_linear_count;
-		lpaintedtime += (snd_linear_count >> 1);
+		src += count * 2;
+		lpaintedtime += count;
 	}
 }
 
 static void S_TransferPaintBuffer (int endtime)
 {
-	int	 out_idx, out_mask;
-	int	 count, step, val;
-	int *p;
+	int	   out_idx, out_mask;
+	int	   count, step;
+	short *p;
 
 	if (shm->samplebits == 16 && shm->channels == 2)
 	{
@@ -97,7 +75,7 @@ static void S_TransferPaintBuffer (int endtime)
 		return;
 	}
 
-	p = (int *)paintbuffer;
+	p = paint_out;
 	count = (endtime - paintedtime) * shm->channels;
 	out_mask = shm->samples - 1;
 	out_idx = paintedtime * shm->channels & out_mask;
@@ -108,13 +86,8 @@ static void S_TransferPaintBuffer (int endtime)
 		short *out = (short *)shm->buffer;
 		while (count--)
 		{
-			val = *p / 256;
+			out[out_idx] = *p;
 			p += step;
-			if (val > SHRT_MAX)
-				val = SHRT_MAX;
-			else if (val < SHRT_MIN)
-				val = SHRT_MIN;
-			out[out_idx] = val;
 			out_idx = (out_idx + 1) & out_mask;
 		}
 	}
@@ -123,13 +96,8 @@ static void S_TransferPaintBuffer (int endtime)
 		unsigned char *out = shm->buffer;
 		while (count--)
 		{
-			val = *p / 256;
+			out[out_idx] = (*p / 256) + 128;
 			p += step;
-			if (val > SHRT_MAX)
-				val = SHRT_MAX;
-			else if (val < SHRT_MIN)
-				val = SHRT_MIN;
-			out[out_idx] = (val / 256) + 128;
 			out_idx = (out_idx + 1) & out_mask;
 		}
 	}
@@ -138,13 +106,8 @@ static void S_TransferPaintBuffer (int endtime)
 		signed char *out = (signed char *)shm->buffer;
 		while (count--)
 		{
-			val = *p / 256;
+			out[out_idx] = (*p / 256);
 			p += step;
-			if (val > SHRT_MAX)
-				val = SHRT_MAX;
-			else if (val < SHRT_MIN)
-				val = SHRT_MIN;
-			out[out_idx] = (val / 256);
 			out_idx = (out_idx + 1) & out_mask;
 		}
 	}
@@ -162,7 +125,7 @@ kernel has room for M+1 floats
 f_c is the filter cutoff frequency, as a fraction of the samplerate
 ==============
 */
-static void S_MakeBlackmanWindowKernel (float *kernel, int M, float f_c)
+void S_MakeBlackmanWindowKernel (float *kernel, int M, float f_c)
 {
 	int i;
 	for (i = 0; i <= M; i++)
@@ -237,7 +200,7 @@ kernel is 4x faster, because we can skip 3/4 of the input samples that are
 known to be 0 and skip 3/4 of the filter kernel.
 ==============
 */
-static void S_ApplyFilter (filter_t *filter, int *data, int stride, int count)
+static void S_ApplyFilter (filter_t *filter, float *data, int count)
 {
 	int			 i, j;
 	const int	 kernelsize = filter->kernelsize;
@@ -250,10 +213,7 @@ static void S_ApplyFilter (filter_t *filter, int *data, int stride, int count)
 	// memory holds the previous filter->kernelsize samples of input.
 	memcpy (input, filter->memory, filter->kernelsize * sizeof (float));
 
-	for (i = 0; i < count; i++)
-	{
-		input[filter->kernelsize + i] = data[i * stride] / (32768.0 * 256.0);
-	}
+	memcpy (input + filter->kernelsize, data, count * sizeof (float));
 
 	// copy out the last filter->kernelsize samples to 'memory' for next time
 	memcpy (filter->memory, input + count, filter->kernelsize * sizeof (float));
@@ -276,7 +236,7 @@ static void S_ApplyFilter (filter_t *filter, int *data, int stride, int count)
 
 		// 4.0 factor is to increase volume by 12 dB; this is to make up the
 		// volume drop caused by the zero-filling this filter does.
-		data[i * stride] = (val[0] + val[1] + val[2] + val[3]) * (32768.0 * 256.0 * 4.0);
+		data[i] = (val[0] + val[1] + val[2] + val[3]) * 4.0f;
 
 		parity = (parity + 1) % 4;
 	}
@@ -290,12 +250,12 @@ static void S_ApplyFilter (filter_t *filter, int *data, int stride, int count)
 ==============
 S_LowpassFilter
 
-lowpass filters 24-bit integer samples in 'data' (stored in 32-bit ints).
+lowpass filters one channel of the planar mix in 'data'.
 assumes 44100Hz sample rate, and lowpasses at around 5kHz
 memory should be a zero-filled filter_t struct
 ==============
 */
-static void S_LowpassFilter (int *data, int stride, int count, filter_t *memory)
+static void S_LowpassFilter (float *data, int count, filter_t *memory)
 {
 	int	  M;
 	float bw, f_c;
@@ -328,7 +288,7 @@ static void S_LowpassFilter (int *data, int stride, int count, filter_t *memory)
 	f_c = (bw * 11025 / 2.0) / 44100.0;
 
 	S_UpdateFilter (memory, M, f_c);
-	S_ApplyFilter (memory, data, stride, count);
+	S_ApplyFilter (memory, data, count);
 }
 
 /*
@@ -348,40 +308,171 @@ static struct
 
 extern cvar_t snd_waterfx;
 
-void S_SetUnderwaterIntensity (float target)
+void S_SetUnderwaterIntensity (float target, float frametime)
 {
 	target *= CLAMP (0.f, snd_waterfx.value, 2.f);
 	if (underwater.intensity < target)
 	{
-		underwater.intensity += host_frametime * 4.f;
+		underwater.intensity += frametime * 4.f;
 		underwater.intensity = q_min (underwater.intensity, target);
 	}
 	else if (underwater.intensity > target)
 	{
-		underwater.intensity -= host_frametime * 4.f;
+		underwater.intensity -= frametime * 4.f;
 		underwater.intensity = q_max (underwater.intensity, target);
 	}
 	underwater.alpha = exp (-underwater.intensity * log (12.f));
 }
 
-static void S_UnderwaterFilter (int endtime)
+/*
+===============================================================================
+
+FINAL MIX
+
+===============================================================================
+*/
+
+/*
+==============
+S_ClipPaintBuffer
+
+clip each sample to 0dB, then reduce by 6dB (to leave some headroom for
+the lowpass filter and the music). the lowpass will smooth out the clipping
+==============
+*/
+static void S_ClipPaintBuffer (int count)
 {
-	int i;
-	if (!underwater.intensity)
+	int i = 0;
+
+#if defined(USE_SIMD)
+	if (use_simd)
 	{
-		if (endtime > 0)
+#if defined(USE_SSE2)
+		const __m128 vmin = _mm_set1_ps (PAINT_CLIP_MIN);
+		const __m128 vmax = _mm_set1_ps (PAINT_CLIP_MAX);
+		const __m128 vhalf = _mm_set1_ps (0.5f);
+		for (; i + 4 <= count; i += 4)
 		{
-			underwater.accum[0] = paintbuffer[endtime - 1].left;
-			underwater.accum[1] = paintbuffer[endtime - 1].right;
+			_mm_storeu_ps (paint_left + i, _mm_mul_ps (_mm_min_ps (_mm_max_ps (_mm_loadu_ps (paint_left + i), vmin), vmax), vhalf));
+			_mm_storeu_ps (paint_right + i, _mm_mul_ps (_mm_min_ps (_mm_max_ps (_mm_loadu_ps (paint_right + i), vmin), vmax), vhalf));
 		}
-		return;
+#elif defined(USE_NEON)
+		const float32x4_t vmin = vdupq_n_f32 (PAINT_CLIP_MIN);
+		const float32x4_t vmax = vdupq_n_f32 (PAINT_CLIP_MAX);
+		for (; i + 4 <= count; i += 4)
+		{
+			vst1q_f32 (paint_left + i, vmulq_n_f32 (vminq_f32 (vmaxq_f32 (vld1q_f32 (paint_left + i), vmin), vmax), 0.5f));
+			vst1q_f32 (paint_right + i, vmulq_n_f32 (vminq_f32 (vmaxq_f32 (vld1q_f32 (paint_right + i), vmin), vmax), 0.5f));
+		}
+#endif
 	}
-	for (i = 0; i < endtime; i++)
+#endif
+
+	for (; i < count; i++)
 	{
-		underwater.accum[0] += underwater.alpha * (paintbuffer[i].left - underwater.accum[0]);
-		underwater.accum[1] += underwater.alpha * (paintbuffer[i].right - underwater.accum[1]);
-		paintbuffer[i].left = (int)underwater.accum[0];
-		paintbuffer[i].right = (int)underwater.accum[1];
+		paint_left[i] = CLAMP (PAINT_CLIP_MIN, paint_left[i], PAINT_CLIP_MAX) * 0.5f;
+		paint_right[i] = CLAMP (PAINT_CLIP_MIN, paint_right[i], PAINT_CLIP_MAX) * 0.5f;
+	}
+}
+
+/*
+==============
+S_FinishPaintBuffer
+
+Clips the mix (unless the lowpass needed that done already), runs the
+underwater filter, adds the music and converts to 16 bit stereo in a single
+pass. The underwater filter is recursive, so only the dry path is vectorized.
+==============
+*/
+static void S_FinishPaintBuffer (int count, qboolean clipped)
+{
+	const float clip_scale = clipped ? 1.0f : 0.5f;
+	const int	music = CLAMP (0, s_rawend - paintedtime, count); // samples that have music under them
+	int			i = 0;
+
+	if (!underwater.intensity && count > 0)
+	{
+		underwater.accum[0] = CLAMP (PAINT_CLIP_MIN, paint_left[count - 1], PAINT_CLIP_MAX) * clip_scale;
+		underwater.accum[1] = CLAMP (PAINT_CLIP_MIN, paint_right[count - 1], PAINT_CLIP_MAX) * clip_scale;
+
+#if defined(USE_SIMD)
+		if (use_simd)
+		{
+			float ml[4], mr[4];
+#if defined(USE_SSE2)
+			const __m128 vmin = _mm_set1_ps (PAINT_CLIP_MIN);
+			const __m128 vmax = _mm_set1_ps (PAINT_CLIP_MAX);
+			const __m128 vscale = _mm_set1_ps (clip_scale);
+			const __m128 vhalf = _mm_set1_ps (0.5f);
+			const __m128 vout = _mm_set1_ps (1.0f / 256.0f);
+#elif defined(USE_NEON)
+			const float32x4_t vmin = vdupq_n_f32 (PAINT_CLIP_MIN);
+			const float32x4_t vmax = vdupq_n_f32 (PAINT_CLIP_MAX);
+#endif
+			for (; i + 4 <= count; i += 4)
+			{
+				if (i < music)
+				{
+					for (int j = 0; j < 4; j++)
+					{
+						const portable_samplepair_t *raw = &s_rawsamples[(paintedtime + i + j) & (MAX_RAW_SAMPLES - 1)];
+						ml[j] = (i + j < music) ? raw->left : 0.0f;
+						mr[j] = (i + j < music) ? raw->right : 0.0f;
+					}
+				}
+#if defined(USE_SSE2)
+				__m128 l = _mm_mul_ps (_mm_min_ps (_mm_max_ps (_mm_loadu_ps (paint_left + i), vmin), vmax), vscale);
+				__m128 r = _mm_mul_ps (_mm_min_ps (_mm_max_ps (_mm_loadu_ps (paint_right + i), vmin), vmax), vscale);
+				if (i < music)
+				{
+					// lower music by 6db to match sfx
+					l = _mm_add_ps (l, _mm_mul_ps (_mm_loadu_ps (ml), vhalf));
+					r = _mm_add_ps (r, _mm_mul_ps (_mm_loadu_ps (mr), vhalf));
+				}
+				const __m128i lr = _mm_packs_epi32 (_mm_cvttps_epi32 (_mm_mul_ps (l, vout)), _mm_cvttps_epi32 (_mm_mul_ps (r, vout)));
+				_mm_storeu_si128 ((__m128i *)(paint_out + i * 2), _mm_unpacklo_epi16 (lr, _mm_srli_si128 (lr, 8)));
+#elif defined(USE_NEON)
+				float32x4_t l = vmulq_n_f32 (vminq_f32 (vmaxq_f32 (vld1q_f32 (paint_left + i), vmin), vmax), clip_scale);
+				float32x4_t r = vmulq_n_f32 (vminq_f32 (vmaxq_f32 (vld1q_f32 (paint_right + i), vmin), vmax), clip_scale);
+				if (i < music)
+				{
+					// lower music by 6db to match sfx
+					l = vmlaq_n_f32 (l, vld1q_f32 (ml), 0.5f);
+					r = vmlaq_n_f32 (r, vld1q_f32 (mr), 0.5f);
+				}
+				int16x4x2_t lr;
+				lr.val[0] = vqmovn_s32 (vcvtq_s32_f32 (vmulq_n_f32 (l, 1.0f / 256.0f)));
+				lr.val[1] = vqmovn_s32 (vcvtq_s32_f32 (vmulq_n_f32 (r, 1.0f / 256.0f)));
+				vst2_s16 (paint_out + i * 2, lr);
+#endif
+			}
+		}
+#endif
+	}
+
+	for (; i < count; i++)
+	{
+		float l = CLAMP (PAINT_CLIP_MIN, paint_left[i], PAINT_CLIP_MAX) * clip_scale;
+		float r = CLAMP (PAINT_CLIP_MIN, paint_right[i], PAINT_CLIP_MAX) * clip_scale;
+
+		if (underwater.intensity)
+		{
+			underwater.accum[0] += underwater.alpha * (l - underwater.accum[0]);
+			underwater.accum[1] += underwater.alpha * (r - underwater.accum[1]);
+			l = underwater.accum[0];
+			r = underwater.accum[1];
+		}
+
+		if (i < music)
+		{
+			// lower music by 6db to match sfx
+			const portable_samplepair_t *raw = &s_rawsamples[(paintedtime + i) & (MAX_RAW_SAMPLES - 1)];
+			l += raw->left * 0.5f;
+			r += raw->right * 0.5f;
+		}
+
+		paint_out[i * 2] = (short)CLAMP ((float)SHRT_MIN, l / 256.0f, (float)SHRT_MAX);
+		paint_out[i * 2 + 1] = (short)CLAMP ((float)SHRT_MIN, r / 256.0f, (float)SHRT_MAX);
 	}
 }
 
@@ -393,8 +484,131 @@ CHANNEL MIXING
 ===============================================================================
 */
 
-static void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int endtime, int paintbufferstart);
-static void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int endtime, int paintbufferstart);
+static inline float SND_Sample (const sfxcache_t *sc, int pos)
+{
+	if (sc->width == 1)
+		return ((const signed char *)sc->data)[pos] * 256.0f;
+	return ((const short *)sc->data)[pos];
+}
+
+/*
+==============
+SND_PaintSamples
+
+Mixes count samples of the sound starting at pos at constant gains
+==============
+*/
+static void SND_PaintSamples (const sfxcache_t *sc, int pos, float *left, float *right, int count, float lgain, float rgain)
+{
+	int i = 0;
+
+#if defined(USE_SIMD)
+	if (use_simd)
+	{
+#if defined(USE_SSE2)
+		const __m128 vl = _mm_set1_ps (lgain);
+		const __m128 vr = _mm_set1_ps (rgain);
+		for (; i + 8 <= count; i += 8)
+		{
+			__m128i data;
+			if (sc->width == 1) // 8 bit samples end up in the high byte, just like sample << 8
+				data = _mm_unpacklo_epi8 (_mm_setzero_si128 (), _mm_loadl_epi64 ((const __m128i *)((const signed char *)sc->data + pos + i)));
+			else
+				data = _mm_loadu_si128 ((const __m128i *)((const short *)sc->data + pos + i));
+			const __m128 lo = _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpacklo_epi16 (data, data), 16));
+			const __m128 hi = _mm_cvtepi32_ps (_mm_srai_epi32 (_mm_unpackhi_epi16 (data, data), 16));
+			_mm_storeu_ps (left + i, _mm_add_ps (_mm_loadu_ps (left + i), _mm_mul_ps (lo, vl)));
+			_mm_storeu_ps (left + i + 4, _mm_add_ps (_mm_loadu_ps (left + i + 4), _mm_mul_ps (hi, vl)));
+			_mm_storeu_ps (right + i, _mm_add_ps (_mm_loadu_ps (right + i), _mm_mul_ps (lo, vr)));
+			_mm_storeu_ps (right + i + 4, _mm_add_ps (_mm_loadu_ps (right + i + 4), _mm_mul_ps (hi, vr)));
+		}
+#elif defined(USE_NEON)
+		for (; i + 8 <= count; i += 8)
+		{
+			int16x8_t data;
+			if (sc->width == 1)
+				data = vshll_n_s8 (vld1_s8 ((const int8_t *)sc->data + pos + i), 8);
+			else
+				data = vld1q_s16 ((const int16_t *)sc->data + pos + i);
+			const float32x4_t lo = vcvtq_f32_s32 (vmovl_s16 (vget_low_s16 (data)));
+			const float32x4_t hi = vcvtq_f32_s32 (vmovl_s16 (vget_high_s16 (data)));
+			vst1q_f32 (left + i, vmlaq_n_f32 (vld1q_f32 (left + i), lo, lgain));
+			vst1q_f32 (left + i + 4, vmlaq_n_f32 (vld1q_f32 (left + i + 4), hi, lgain));
+			vst1q_f32 (right + i, vmlaq_n_f32 (vld1q_f32 (right + i), lo, rgain));
+			vst1q_f32 (right + i + 4, vmlaq_n_f32 (vld1q_f32 (right + i + 4), hi, rgain));
+		}
+#endif
+	}
+#endif
+
+	for (; i < count; i++)
+	{
+		const float sample = SND_Sample (sc, pos + i);
+		left[i] += sample * lgain;
+		right[i] += sample * rgain;
+	}
+}
+
+/*
+==============
+SND_PaintChannel
+
+Volume changes are ramped over SND_RAMP_LENGTH samples, the rest is mixed
+at constant gain
+==============
+*/
+static void SND_PaintChannel (channel_t *ch, sfxcache_t *sc, int count, int paintbufferstart)
+{
+	float *left = paint_left + paintbufferstart;
+	float *right = paint_right + paintbufferstart;
+	int	   leftvol = ch->leftvol;
+	int	   rightvol = ch->rightvol;
+
+	if (sc->width == 1)
+	{
+		// 8 bit sounds used to be mixed through a 256 entry table
+		leftvol = q_min (leftvol, 255);
+		rightvol = q_min (rightvol, 255);
+	}
+
+	if (leftvol * snd_vol != ch->target[0] || rightvol * snd_vol != ch->target[1])
+	{
+		ch->target[0] = leftvol * snd_vol;
+		ch->target[1] = rightvol * snd_vol;
+		ch->ramp = SND_RAMP_LENGTH;
+	}
+
+	if (ch->ramp > 0)
+	{
+		const int	n = q_min (count, ch->ramp);
+		const float lstep = (ch->target[0] - ch->gain[0]) / ch->ramp;
+		const float rstep = (ch->target[1] - ch->gain[1]) / ch->ramp;
+
+		for (int i = 0; i < n; i++)
+		{
+			const float sample = SND_Sample (sc, ch->pos + i);
+			ch->gain[0] += lstep;
+			ch->gain[1] += rstep;
+			left[i] += sample * ch->gain[0];
+			right[i] += sample * ch->gain[1];
+		}
+
+		ch->ramp -= n;
+		if (!ch->ramp)
+		{
+			ch->gain[0] = ch->target[0];
+			ch->gain[1] = ch->target[1];
+		}
+
+		left += n;
+		right += n;
+		ch->pos += n;
+		count -= n;
+	}
+
+	SND_PaintSamples (sc, ch->pos, left, right, count, ch->gain[0], ch->gain[1]);
+	ch->pos += count;
+}
 
 extern cvar_t snd_pauselooping;
 
@@ -404,9 +618,11 @@ void S_PaintChannels (int endtime)
 	int			end, ltime, count;
 	channel_t  *ch;
 	sfxcache_t *sc;
+	qboolean	loading;
+	qboolean	clipped;
 	qboolean	pause_loops = snd_pauselooping.value && (cl.paused || (sv.active && svs.maxclients == 1 && key_dest != key_game));
 
-	snd_vol = sfxvolume.value * 256;
+	snd_vol = sfxvolume.value;
 
 	while (paintedtime < endtime)
 	{
@@ -416,7 +632,8 @@ void S_PaintChannels (int endtime)
 			end = paintedtime + PAINTBUFFER_SIZE;
 
 		// clear the paint buffer
-		memset (paintbuffer, 0, (end - paintedtime) * sizeof (portable_samplepair_t));
+		memset (paint_left, 0, (end - paintedtime) * sizeof (float));
+		memset (paint_right, 0, (end - paintedtime) * sizeof (float));
 
 		// paint in the channels.
 		ch = snd_channels;
@@ -424,11 +641,24 @@ void S_PaintChannels (int endtime)
 		{
 			if (!ch->sfx)
 				continue;
-			if (!ch->leftvol && !ch->rightvol)
+			if (!ch->leftvol && !ch->rightvol && !ch->gain[0] && !ch->gain[1])
 				continue;
-			sc = S_LoadSound (ch->sfx);
+			sc = S_PeekSound (ch->sfx, &loading);
 			if (!sc)
+			{
+				if (!loading)
+					ch->sfx = NULL; // couldn't load the sound's data
 				continue;
+			}
+			if (ch->loading)
+			{
+				// data arrived after the sound was started, play it from the top now
+				const int late = paintedtime - ch->end;
+				++snd_loadstats.late_starts;
+				snd_loadstats.late_max = q_max (snd_loadstats.late_max, late);
+				ch->loading = false;
+				ch->end = paintedtime + sc->length;
+			}
 			if (sc->loopstart >= 0 && pause_loops)
 				continue;
 
@@ -443,12 +673,9 @@ void S_PaintChannels (int endtime)
 
 				if (count > 0)
 				{
-					// the last param to SND_PaintChannelFrom is the index
+					// the last param to SND_PaintChannel is the index
 					// to start painting to in the paintbuffer, usually 0.
-					if (sc->width == 1)
-						SND_PaintChannelFrom8 (ch, sc, count, ltime - paintedtime);
-					else
-						SND_PaintChannelFrom16 (ch, sc, count, ltime - paintedtime);
+					SND_PaintChannel (ch, sc, count, ltime - paintedtime);
 
 					ltime += count;
 				}
@@ -470,126 +697,22 @@ void S_PaintChannels (int endtime)
 			}
 		}
 
-		// clip each sample to 0dB, then reduce by 6dB (to leave some headroom for
-		// the lowpass filter and the music). the lowpass will smooth out the
-		// clipping
-		for (i = 0; i < end - paintedtime; i++)
-		{
-			paintbuffer[i].left = CLAMP (-32768 * 256, paintbuffer[i].left, 32767 * 256) / 2;
-			paintbuffer[i].right = CLAMP (-32768 * 256, paintbuffer[i].right, 32767 * 256) / 2;
-		}
-
 		// apply a lowpass filter
+		clipped = false;
 		if (sndspeed.value == 11025 && shm->speed == 44100)
 		{
 			static filter_t memory_l, memory_r;
-			S_LowpassFilter ((int *)paintbuffer, 2, end - paintedtime, &memory_l);
-			S_LowpassFilter (((int *)paintbuffer) + 1, 2, end - paintedtime, &memory_r);
+			S_ClipPaintBuffer (end - paintedtime);
+			S_LowpassFilter (paint_left, end - paintedtime, &memory_l);
+			S_LowpassFilter (paint_right, end - paintedtime, &memory_r);
+			clipped = true;
 		}
 
-		S_UnderwaterFilter (end - paintedtime);
-
-		// paint in the music
-		if (s_rawend >= paintedtime)
-		{ // copy from the streaming sound source
-			int s;
-			int stop;
-
-			stop = (end < s_rawend) ? end : s_rawend;
-
-			for (i = paintedtime; i < stop; i++)
-			{
-				s = i & (MAX_RAW_SAMPLES - 1);
-				// lower music by 6db to match sfx
-				paintbuffer[i - paintedtime].left += s_rawsamples[s].left / 2;
-				paintbuffer[i - paintedtime].right += s_rawsamples[s].right / 2;
-			}
-			//	if (i != end)
-			//		Con_Printf ("partial stream\n");
-			//	else
-			//		Con_Printf ("full stream\n");
-		}
+		// clip, underwater, music
+		S_FinishPaintBuffer (end - paintedtime, clipped);
 
 		// transfer out according to DMA format
 		S_TransferPaintBuffer (end);
 		paintedtime = end;
 	}
 }
-
-void SND_InitScaletable (void)
-{
-	int i, j;
-	int scale;
-
-	for (i = 0; i < 32; i++)
-	{
-		scale = i * 8 * 256 * sfxvolume.value;
-		for (j = 0; j < 256; j++)
-		{
-			/* When compiling with gcc-4.1.0 at optimisations O1 and
-			   higher, the tricky signed char type conversion is not
-			   guaranteed. Therefore we explicity calculate the signed
-			   value from the index as required. From Kevin Shanahan.
-			   See: http://gcc.gnu.org/bugzilla/show_bug.cgi?id=26719
-			*/
-			//	snd_scaletable[i][j] = ((signed char)j) * scale;
-			snd_scaletable[i][j] = ((j < 128) ? j : j - 256) * scale;
-		}
-	}
-}
-
-static void SND_PaintChannelFrom8 (channel_t *ch, sfxcache_t *sc, int count, int paintbufferstart)
-{
-	int			   data;
-	int			  *lscale, *rscale;
-	unsigned char *sfx;
-	int			   i;
-
-	if (ch->leftvol > 255)
-		ch->leftvol = 255;
-	if (ch->rightvol > 255)
-		ch->rightvol = 255;
-
-	lscale = snd_scaletable[ch->leftvol >> 3];
-	rscale = snd_scaletable[ch->rightvol >> 3];
-	sfx = (unsigned char *)sc->data + ch->pos;
-
-	for (i = 0; i < count; i++)
-	{
-		data = sfx[i];
-		paintbuffer[paintbufferstart + i].left += lscale[data];
-		paintbuffer[paintbufferstart + i].right += rscale[data];
-	}
-
-	ch->pos += count;
-}
-
-static void SND_PaintChannelFrom16 (channel_t *ch, sfxcache_t *sc, int count, int paintbufferstart)
-{
-	int			  data;
-	int			  left, right;
-	int			  leftvol, rightvol;
-	signed short *sfx;
-	int			  i;
-
-	leftvol = ch->leftvol * snd_vol;
-	rightvol = ch->rightvol * snd_vol;
-	leftvol /= 256;
-	rightvol /= 256;
-	sfx = (signed short *)sc->data + ch->pos;
-
-	for (i = 0; i < count; i++)
-	{
-		data = sfx[i];
-		// this was causing integer overflow as observed in quakespasm
-		// with the warpspasm mod moved >>8 to left/right volume above.
-		//	left = (data * leftvol) >> 8;
-		//	right = (data * rightvol) >> 8;
-		left = data * leftvol;
-		right = data * rightvol;
-		paintbuffer[paintbufferstart + i].left += left;
-		paintbuffer[paintbufferstart + i].right += right;
-	}
-
-	ch->pos += count;
-}
@@ -0,0 +1,55 @@
+/*
+ * snd_null.c -- sound stubs for the dedicated server build
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "quakedef.h"
+
+void S_Init (void) {}
+
+void S_Shutdown (void) {}
+
+void S_ClearAll (void) {}
+
+void S_Update (vec3_t origin, vec3_t forward, vec3_t right, vec3_t up) {}
+
+void S_StartSound (int entnum, int entchannel, sfx_t *sfx, vec3_t origin, float fvol, float attenuation) {}
+
+void S_StaticSound (sfx_t *sfx, vec3_t origin, float vol, float attenuation) {}
+
+void S_StopAllSounds (qboolean clear, qboolean keep_statics) {}
+
+void S_LocalSound (const char *name) {}
+
+sfx_t *S_PrecacheSound (const char *sample)
+{
+	return NULL;
+}
+
+sfxcache_t *S_LoadSound (sfx_t *s)
+{
+	return NULL;
+}
+
+qboolean BGM_Init (void)
+{
+	return false;
+}
+
+void BGM_Shutdown (void) {}
+
+void BGM_Update (void) {}
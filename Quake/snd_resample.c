@@ -0,0 +1,362 @@
+/*
+Copyright (C) 1996-2001 Id Software, Inc.
+Copyright (C) 2010-2014 QuakeSpasm developers
+
+This program is free software; you can redistribute it and/or
+modify it under the terms of the GNU General Public License
+as published by the Free Software Foundation; either version 2
+of the License, or (at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+
+See the GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+*/
+// snd_resample.c -- windowed sinc sample rate conversion for sfx and raw streams
+
+#include "quakedef.h"
+
+/*
+===============================================================================
+
+Polyphase resampler
+
+The rate ratio is reduced to L/M. Output sample i sits at input position
+i * M / L, so only L fractional positions ever occur and each gets its own
+precomputed kernel of taps weights. Ratios that don't reduce to L <= 1024
+still step exactly, but use the nearest of 1024 kernels.
+
+snd_resample 0 keeps the old nearest sample stepping, 1 and 2 select 32 and
+64 tap kernels. Downsampling widens the kernels by the ratio, so the cutoff
+follows the output Nyquist frequency.
+
+===============================================================================
+*/
+
+cvar_t snd_resample = {"snd_resample", "1", CVAR_ARCHIVE};
+
+#define RESAMPLE_MAX_PHASES 1024
+#define RESAMPLE_MAX_CACHED 16
+
+struct resampler_s
+{
+	int	   inrate, outrate, quality;
+	int	   L, M;
+	int	   phases; // kernel count, L capped to RESAMPLE_MAX_PHASES
+	int	   taps;   // multiple of 4, at most RESAMPLE_MAX_TAPS
+	float *kernels;
+};
+
+static resampler_t resamplers[RESAMPLE_MAX_CACHED];
+static int		   num_resamplers;
+static SDL_mutex  *resample_mutex;
+
+/*
+================
+S_MakeResampler
+================
+*/
+static void S_MakeResampler (resampler_t *r, int inrate, int outrate, int quality)
+{
+	int	   a = inrate, b = outrate;
+	int	   taps, order, p, k;
+	float  bw, f_c;
+	float *prototype;
+
+	while (b)
+	{
+		const int t = a % b;
+		a = b;
+		b = t;
+	}
+	r->inrate = inrate;
+	r->outrate = outrate;
+	r->quality = quality;
+	r->L = outrate / a;
+	r->M = inrate / a;
+	r->phases = q_min (r->L, RESAMPLE_MAX_PHASES);
+
+	// the Blackman transition band is about 5.5 / taps wide, bw puts its
+	// upper end right at the Nyquist frequency of the lower of both rates
+	if (quality >= 2)
+	{
+		taps = 64;
+		bw = 0.91f;
+	}
+	else
+	{
+		taps = 32;
+		bw = 0.83f;
+	}
+	if (r->M > r->L)
+		taps = (int)ceil ((double)taps * r->M / r->L);
+	taps = q_min ((taps + 3) & ~3, RESAMPLE_MAX_TAPS);
+	r->taps = taps;
+
+	// one prototype at phases times the input rate, split into the phases
+	order = taps * r->phases;
+	f_c = bw * 0.5f * q_min (1.0f, (float)r->L / r->M) / r->phases;
+	prototype = (float *)Mem_Alloc ((order + 1) * sizeof (float));
+	S_MakeBlackmanWindowKernel (prototype, order, f_c);
+
+	r->kernels = (float *)Mem_Alloc (r->phases * taps * sizeof (float));
+	for (p = 0; p < r->phases; p++)
+		for (k = 0; k < taps; k++)
+			r->kernels[p * taps + k] = prototype[(taps - 1 - k) * r->phases + p] * r->phases;
+
+	Mem_Free (prototype);
+}
+
+/*
+================
+S_GetResampler
+
+Returns the shared resampler for a rate pair, or NULL if the old nearest
+sample stepping should be used. Safe to call from any thread.
+================
+*/
+const resampler_t *S_GetResampler (int inrate, int outrate, int quality)
+{
+	resampler_t *r = NULL;
+	int			 i;
+
+	if (quality <= 0 || inrate <= 0 || outrate <= 0 || inrate == outrate)
+		return NULL;
+
+	SDL_LockMutex (resample_mutex);
+	for (i = 0; i < num_resamplers; i++)
+	{
+		if (resamplers[i].inrate == inrate && resamplers[i].outrate == outrate && resamplers[i].quality == quality)
+		{
+			r = &resamplers[i];
+			break;
+		}
+	}
+	if (!r && num_resamplers < RESAMPLE_MAX_CACHED)
+	{
+		r = &resamplers[num_resamplers];
+		S_MakeResampler (r, inrate, outrate, quality);
+		++num_resamplers;
+	}
+	SDL_UnlockMutex (resample_mutex);
+
+	return r;
+}
+
+/*
+================
+S_ResamplerTaps
+================
+*/
+int S_ResamplerTaps (const resampler_t *r)
+{
+	return r->taps;
+}
+
+/*
+================
+S_ResampleDot
+================
+*/
+static inline float S_ResampleDot (const float *kernel, const float *in, int taps)
+{
+	float sum = 0.0f;
+	int	  k = 0;
+
+#if defined(USE_SIMD)
+	if (use_simd)
+	{
+#if defined(USE_SSE2)
+		__m128 acc = _mm_setzero_ps ();
+		for (; k < taps; k += 4)
+			acc = _mm_add_ps (acc, _mm_mul_ps (_mm_loadu_ps (kernel + k), _mm_loadu_ps (in + k)));
+		acc = _mm_add_ps (acc, _mm_movehl_ps (acc, acc));
+		acc = _mm_add_ss (acc, _mm_shuffle_ps (acc, acc, 1));
+		return _mm_cvtss_f32 (acc);
+#elif defined(USE_NEON)
+		float32x4_t acc = vdupq_n_f32 (0.0f);
+		for (; k < taps; k += 4)
+			acc = vmlaq_f32 (acc, vld1q_f32 (kernel + k), vld1q_f32 (in + k));
+		const float32x2_t pair = vadd_f32 (vget_low_f32 (acc), vget_high_f32 (acc));
+		return vget_lane_f32 (vpadd_f32 (pair, pair), 0);
+#endif
+	}
+#endif
+
+	for (; k < taps; k++)
+		sum += kernel[k] * in[k];
+	return sum;
+}
+
+/*
+================
+S_Resample
+
+Resamples one channel of planar float input. pos is the index of the first
+input sample under the kernel for the next output, phase its fraction in
+1/L steps; both carry over to the next call, made relative to in[0]. An
+output is centered on in[pos + taps / 2 - 1]. Stops once maxout samples were
+written or the kernel would run past inframes, returns the output count.
+================
+*/
+int S_Resample (const resampler_t *r, const float *in, int inframes, int *pos, int *phase, float *out, int maxout)
+{
+	int n = 0;
+	int p = *pos, ph = *phase;
+
+	while (n < maxout && p + r->taps <= inframes)
+	{
+		const int kernel = (r->phases == r->L) ? ph : (int)((int64_t)ph * r->phases / r->L);
+		out[n++] = S_ResampleDot (r->kernels + kernel * r->taps, in + p, r->taps);
+		ph += r->M;
+		while (ph >= r->L)
+		{
+			ph -= r->L;
+			++p;
+		}
+	}
+
+	*pos = p;
+	*phase = ph;
+	return n;
+}
+
+/*
+================
+S_ResampleLength
+================
+*/
+int S_ResampleLength (const resampler_t *r, int inframes)
+{
+	return (int)((int64_t)inframes * r->L / r->M);
+}
+
+/*
+===============================================================================
+
+Benchmark
+
+===============================================================================
+*/
+
+/*
+================
+S_ResampleNearest
+
+Same stepping as the snd_resample 0 path in ResampleSfx
+================
+*/
+static int S_ResampleNearest (const float *in, int inrate, int inframes, int outrate, float *out)
+{
+	const float stepscale = (float)inrate / outrate;
+	const int	fracstep = stepscale * 256;
+	const int	outcount = inframes / stepscale;
+	int			i, samplefrac = 0;
+
+	for (i = 0; i < outcount; i++)
+	{
+		out[i] = in[samplefrac >> 8];
+		samplefrac += fracstep;
+	}
+	return outcount;
+}
+
+/*
+================
+S_ResampleSNR
+
+Signal to noise ratio of a resampled tone against the exact one, leaving
+out the edges where the kernel runs into silence
+================
+*/
+static double S_ResampleSNR (const float *out, int count, double freq, int outrate, double amplitude)
+{
+	double signal = 0.0, noise = 0.0;
+	int	   i;
+
+	for (i = count / 8; i < count - count / 8; i++)
+	{
+		const double ref = amplitude * sin (2.0 * M_PI * freq * i / outrate);
+		signal += ref * ref;
+		noise += (out[i] - ref) * (out[i] - ref);
+	}
+	return (noise > 0.0) ? 10.0 * log10 (signal / noise) : 999.0;
+}
+
+/*
+================
+S_ResampleBenchmark_f
+
+snd_resamplebenchmark [inrate] [outrate] [tone Hz]
+================
+*/
+static void S_ResampleBenchmark_f (void)
+{
+	const int	 inrate = (Cmd_Argc () > 1) ? CLAMP (1000, atoi (Cmd_Argv (1)), 192000) : 11025;
+	const int	 outrate = (Cmd_Argc () > 2) ? CLAMP (1000, atoi (Cmd_Argv (2)), 192000) : (shm ? shm->speed : 44100);
+	const double freq = (Cmd_Argc () > 3) ? CLAMP (1.0, atof (Cmd_Argv (3)), inrate * 0.45) : 1000.0;
+	const double amplitude = 16384.0;
+	const int	 inframes = inrate * 4;
+	const int	 maxout = (int)((int64_t)inframes * outrate / inrate) + 16;
+	float		*in, *out;
+	int			 quality, i;
+
+	if (inrate == outrate)
+	{
+		Con_Printf ("nothing to resample at %d Hz\n", inrate);
+		return;
+	}
+
+	// the tone is padded with silence so the kernel can center on every sample
+	in = (float *)Mem_Alloc ((inframes + 2 * RESAMPLE_MAX_TAPS) * sizeof (float));
+	out = (float *)Mem_Alloc (maxout * sizeof (float));
+	for (i = 0; i < inframes; i++)
+		in[RESAMPLE_MAX_TAPS + i] = amplitude * sin (2.0 * M_PI * freq * i / inrate);
+
+	Con_Printf ("%.0f Hz tone, %d -> %d Hz (%s)\n", freq, inrate, outrate, use_simd ? "simd" : "scalar");
+	for (quality = 0; quality <= 2; quality++)
+	{
+		const resampler_t *r = S_GetResampler (inrate, outrate, quality);
+		const double	   start = Sys_DoubleTime ();
+		int				   count, runs = 0;
+		double			   elapsed;
+
+		do
+		{
+			if (r)
+			{
+				int pos = RESAMPLE_MAX_TAPS - r->taps / 2 + 1, phase = 0;
+				count = S_Resample (r, in, inframes + 2 * RESAMPLE_MAX_TAPS, &pos, &phase, out, S_ResampleLength (r, inframes));
+			}
+			else
+				count = S_ResampleNearest (in + RESAMPLE_MAX_TAPS, inrate, inframes, outrate, out);
+			++runs;
+			elapsed = Sys_DoubleTime () - start;
+		} while (elapsed < 0.25);
+
+		Con_Printf (
+			"  snd_resample %d: %3d taps, %7.1f Msamples/s, SNR %5.1f dB\n", quality, r ? r->taps : 1, (double)count * runs / elapsed / 1e6,
+			S_ResampleSNR (out, count, freq, outrate, amplitude));
+	}
+
+	Mem_Free (in);
+	Mem_Free (out);
+}
+
+/*
+================
+S_InitResample
+================
+*/
+void S_InitResample (void)
+{
+	Cvar_RegisterVariable (&snd_resample);
+	Cmd_AddCommand ("snd_resamplebenchmark", S_ResampleBenchmark_f);
+	resample_mutex = SDL_CreateMutex ();
+}
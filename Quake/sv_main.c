@@ -36,6 +36,51 @@ unsigned int sv_protocol_pext2 = PEXT2_SUPPORTED_SERVER; // spike
 
 static cvar_t sv_netsort = {"sv_netsort", "1", CVAR_NONE};
 static cvar_t sv_smoothplatformlerps = {"sv_smoothplatformlerps", "1", CVAR_NONE};
+static cvar_t sv_predictmovetype = {"sv_predictmovetype", "0", CVAR_NONE}; // send the player's movetype so clients can predict it
+
+extern cvar_t sv_friction;
+extern cvar_t sv_edgefriction;
+extern cvar_t sv_stopspeed;
+extern cvar_t sv_gravity;
+extern cvar_t sv_maxvelocity;
+extern cvar_t sv_nostep;
+extern cvar_t sv_maxspeed;
+extern cvar_t sv_accelerate;
+extern cvar_t sv_altnoclip;
+
+// the physics settings client side prediction needs, sent to PEXT2_PREDINFO clients as serverinfo keys
+static cvar_t *const sv_predictionvars[] = {&sv_friction, &sv_edgefriction, &sv_stopspeed, &sv_gravity,	 &sv_maxvelocity,
+											&sv_nostep,	  &sv_maxspeed,		&sv_accelerate, &sv_altnoclip};
+
+/*
+=============
+SV_WritePredictionVar
+=============
+*/
+static void SV_WritePredictionVar (sizebuf_t *msg, cvar_t *var)
+{
+	MSG_WriteByte (msg, svc_stufftext);
+	MSG_WriteString (msg, va ("svi %s \"%s\"\n", var->name, var->string));
+}
+
+/*
+=============
+SV_PredictionVarChanged
+=============
+*/
+static void SV_PredictionVarChanged (cvar_t *var)
+{
+	int i;
+
+	if (var->flags & CVAR_NOTIFY)
+		Host_Callback_Notify (var);
+	if (!sv.active)
+		return;
+
+	for (i = 0; i < svs.maxclients; i++)
+		if (svs.clients[i].active && (svs.clients[i].protocol_pext2 & PEXT2_PREDINFO))
+			SV_WritePredictionVar (&svs.clients[i].message, var);
+}
 
 /*
 =============
@@ -232,7 +277,10 @@ static unsigned int MSGFTE_DeltaCalcBits (entity_state_t *from, entity_state_t *
 	return bits;
 }
 
-static void MSGFTE_WriteEntityUpdate (unsigned int bits, entity_state_t *state, sizebuf_t *msg, unsigned int pext2, unsigned int protocolflags)
+// worst case size of an update written by MSGFTE_WriteEntityUpdate
+#define MSGFTE_MAX_UPDATE_SIZE 64
+
+static void MSGFTE_WriteEntityUpdate (unsigned int bits, entity_state_t *state, msg_writer_t *w, unsigned int pext2, unsigned int protocolflags)
 {
 	unsigned int predbits = 0;
 	if (bits & UF_MOVETYPE)
@@ -291,128 +339,152 @@ static void MSGFTE_WriteEntityUpdate (unsigned int bits, entity_state_t *state,
 	if (bits & 0x0000ff00)
 		bits |= UF_EXTEND1;
 
-	MSG_WriteByte (msg, (bits >> 0) & 0xff);
+	MSGW_WriteByte (w, (bits >> 0) & 0xff);
 	if (bits & UF_EXTEND1)
-		MSG_WriteByte (msg, (bits >> 8) & 0xff);
+		MSGW_WriteByte (w, (bits >> 8) & 0xff);
 	if (bits & UF_EXTEND2)
-		MSG_WriteByte (msg, (bits >> 16) & 0xff);
+		MSGW_WriteByte (w, (bits >> 16) & 0xff);
 	if (bits & UF_EXTEND3)
-		MSG_WriteByte (msg, (bits >> 24) & 0xff);
+		MSGW_WriteByte (w, (bits >> 24) & 0xff);
 
 	if (bits & UF_FRAME)
 	{
 		if (bits & UF_16BIT)
-			MSG_WriteShort (msg, state->frame);
+			MSGW_WriteShort (w, state->frame);
 		else
-			MSG_WriteByte (msg, state->frame);
+			MSGW_WriteByte (w, state->frame);
 	}
 	if (bits & UF_ORIGINXY)
 	{
-		MSG_WriteCoord (msg, state->origin[0], protocolflags);
-		MSG_WriteCoord (msg, state->origin[1], protocolflags);
+		MSGW_WriteCoord (w, state->origin[0], protocolflags);
+		MSGW_WriteCoord (w, state->origin[1], protocolflags);
 	}
 	if (bits & UF_ORIGINZ)
-		MSG_WriteCoord (msg, state->origin[2], protocolflags);
+		MSGW_WriteCoord (w, state->origin[2], protocolflags);
 
 	if ((bits & UF_PREDINFO) && !(pext2 & PEXT2_PREDINFO))
 	{ /*if we have pred info, (always) use more precise angles*/
 		if (bits & UF_ANGLESXZ)
 		{
-			MSG_WriteAngle16 (msg, state->angles[0], protocolflags);
-			MSG_WriteAngle16 (msg, state->angles[2], protocolflags);
+			MSGW_WriteAngle16 (w, state->angles[0], protocolflags);
+			MSGW_WriteAngle16 (w, state->angles[2], protocolflags);
 		}
 		if (bits & UF_ANGLESY)
-			MSG_WriteAngle16 (msg, state->angles[1], protocolflags);
+			MSGW_WriteAngle16 (w, state->angles[1], protocolflags);
 	}
 	else
 	{
 		if (bits & UF_ANGLESXZ)
 		{
-			MSG_WriteAngle (msg, state->angles[0], protocolflags);
-			MSG_WriteAngle (msg, state->angles[2], protocolflags);
+			MSGW_WriteAngle (w, state->angles[0], protocolflags);
+			MSGW_WriteAngle (w, state->angles[2], protocolflags);
 		}
 		if (bits & UF_ANGLESY)
-			MSG_WriteAngle (msg, state->angles[1], protocolflags);
+			MSGW_WriteAngle (w, state->angles[1], protocolflags);
 	}
 
 	if ((bits & (UF_EFFECTS | UF_EFFECTS2)) == (UF_EFFECTS | UF_EFFECTS2))
-		MSG_WriteLong (msg, state->effects);
+		MSGW_WriteLong (w, state->effects);
 	else if (bits & UF_EFFECTS2)
-		MSG_WriteShort (msg, state->effects);
+		MSGW_WriteShort (w, state->effects);
 	else if (bits & UF_EFFECTS)
-		MSG_WriteByte (msg, state->effects);
+		MSGW_WriteByte (w, state->effects);
 
 	if (bits & UF_PREDINFO)
 	{
 		/*movetype is set above somewhere*/
 		predbits |= SVFTE_DeltaPredCalcBits (NULL, state);
 
-		MSG_WriteByte (msg, predbits);
+		MSGW_WriteByte (w, predbits);
 		if (predbits & UFP_MOVETYPE)
-			MSG_WriteByte (msg, state->pmovetype);
+			MSGW_WriteByte (w, state->pmovetype);
 		if (predbits & UFP_VELOCITYXY)
 		{
-			MSG_WriteShort (msg, state->velocity[0]);
-			MSG_WriteShort (msg, state->velocity[1]);
+			MSGW_WriteShort (w, state->velocity[0]);
+			MSGW_WriteShort (w, state->velocity[1]);
 		}
 		if (predbits & UFP_VELOCITYZ)
-			MSG_WriteShort (msg, state->velocity[2]);
+			MSGW_WriteShort (w, state->velocity[2]);
 	}
 
 	if (bits & UF_MODEL)
 	{
 		if (bits & UF_16BIT)
-			MSG_WriteShort (msg, state->modelindex);
+			MSGW_WriteShort (w, state->modelindex);
 		else
-			MSG_WriteByte (msg, state->modelindex);
+			MSGW_WriteByte (w, state->modelindex);
 	}
 	if (bits & UF_SKIN)
 	{
 		if (bits & UF_16BIT)
-			MSG_WriteShort (msg, state->skin);
+			MSGW_WriteShort (w, state->skin);
 		else
-			MSG_WriteByte (msg, state->skin);
+			MSGW_WriteByte (w, state->skin);
 	}
 	if (bits & UF_COLORMAP)
-		MSG_WriteByte (msg, state->colormap & 0xff);
+		MSGW_WriteByte (w, state->colormap & 0xff);
 	if (bits & UF_FLAGS)
-		MSG_WriteByte (msg, state->eflags);
+		MSGW_WriteByte (w, state->eflags);
 
 	if (bits & UF_ALPHA)
-		MSG_WriteByte (msg, (state->alpha - 1) & 0xff);
+		MSGW_WriteByte (w, (state->alpha - 1) & 0xff);
 	if (bits & UF_SCALE)
-		MSG_WriteByte (msg, state->scale);
+		MSGW_WriteByte (w, state->scale);
 
 	if (bits & UF_TAGINFO)
 	{
-		MSG_WriteEntity (msg, state->tagentity, pext2);
-		MSG_WriteByte (msg, state->tagindex);
+		MSGW_WriteEntity (w, state->tagentity, pext2);
+		MSGW_WriteByte (w, state->tagindex);
 	}
 
 	if (bits & UF_TRAILEFFECT)
 	{
 		if (state->emiteffectnum)
 		{ // 3 spare bits. so that's nice (this is guarenteed to be 14 bits max due to precaches using the upper two bits).
-			MSG_WriteShort (msg, (state->traileffectnum & 0x3fff) | 0x8000);
-			MSG_WriteShort (msg, state->emiteffectnum & 0x3fff);
+			MSGW_WriteShort (w, (state->traileffectnum & 0x3fff) | 0x8000);
+			MSGW_WriteShort (w, state->emiteffectnum & 0x3fff);
 		}
 		else
-			MSG_WriteShort (msg, state->traileffectnum & 0x3fff);
+			MSGW_WriteShort (w, state->traileffectnum & 0x3fff);
 	}
 
 	if (bits & UF_COLORMOD)
 	{
-		MSG_WriteByte (msg, state->colormod[0]);
-		MSG_WriteByte (msg, state->colormod[1]);
-		MSG_WriteByte (msg, state->colormod[2]);
+		MSGW_WriteByte (w, state->colormod[0]);
+		MSGW_WriteByte (w, state->colormod[1]);
+		MSGW_WriteByte (w, state->colormod[2]);
 	}
 
 #ifdef LERP_BANDAID
 	if (bits & UF_UNUSED2)
-		MSG_WriteShort (msg, state->lerp);
+		MSGW_WriteShort (w, state->lerp);
 #endif
 }
 
+/*
+=============
+SVFTE_WriteEntityDelta
+
+The entity number followed by its update, as one reserved fragment
+=============
+*/
+static void SVFTE_WriteEntityDelta (sizebuf_t *msg, unsigned int entnum, unsigned int bits, entity_state_t *state, unsigned int pext2, unsigned int protocolflags)
+{
+	msg_writer_t w;
+
+	MSGW_Begin (&w, msg, 3 + MSGFTE_MAX_UPDATE_SIZE);
+	if (entnum >= 0x4000)
+	{
+		MSGW_WriteShort (&w, 0x4000 | (entnum & 0x3fff));
+		MSGW_WriteByte (&w, entnum >> 14);
+	}
+	else
+		MSGW_WriteShort (&w, entnum);
+	//				SV_EmitDeltaEntIndex(msg, j, false, true);
+	MSGFTE_WriteEntityUpdate (bits, state, &w, pext2, protocolflags);
+	MSGW_Commit (&w);
+}
+
 static struct entity_num_state_s *snapshot_entstate;
 static size_t					  snapshot_numents;
 static size_t					  snapshot_maxents;
@@ -759,15 +831,7 @@ static void SVFTE_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_
 				else
 					logbits = netbits = entbits;
 
-				if (entnum >= 0x4000)
-				{
-					MSG_WriteShort (msg, 0x4000 | (entnum & 0x3fff));
-					MSG_WriteByte (msg, entnum >> 14);
-				}
-				else
-					MSG_WriteShort (msg, entnum);
-				//				SV_EmitDeltaEntIndex(msg, j, false, true);
-				MSGFTE_WriteEntityUpdate (netbits, &state->state, msg, client->protocol_pext2, sv.protocolflags);
+				SVFTE_WriteEntityDelta (msg, entnum, netbits, &state->state, client->protocol_pext2, sv.protocolflags);
 			}
 		}
 
@@ -930,7 +994,8 @@ static void SVFTE_BuildSnapshotForClient (client_t *client)
 			ents[numents].state.modelindex = 0;
 		if (ent == clent) // add velocity, but we only care for the local player (should add prediction for other entities some time too).
 		{
-			ents[numents].state.pmovetype = 0; // ent->v.movetype;	//fixme: we don't do prediction, so don't tell the client that it can try
+			// off by default: FTE/QSS clients start predicting with their own physics as soon as they see a movetype
+			ents[numents].state.pmovetype = sv_predictmovetype.value ? ent->v.movetype : 0;
 			if ((int)ent->v.flags & FL_ONGROUND)
 				eflags |= EFLAGS_ONGROUND;
 			ents[numents].state.velocity[0] = ent->v.velocity[0] * 8;
@@ -952,7 +1017,8 @@ static void SVFTE_BuildSnapshotForClient (client_t *client)
 
 void MSG_WriteStaticOrBaseLine (sizebuf_t *buf, int idx, entity_state_t *state, unsigned int protocol_pext2, unsigned int protocol, unsigned int protocolflags)
 {
-	int i;
+	int			 i;
+	msg_writer_t w;
 	if (protocol_pext2 & PEXT2_REPLACEMENTDELTAS)
 	{
 		if (idx >= 0)
@@ -962,7 +1028,9 @@ void MSG_WriteStaticOrBaseLine (sizebuf_t *buf, int idx, entity_state_t *state,
 		}
 		else
 			MSG_WriteByte (buf, svcfte_spawnstatic2);
-		MSGFTE_WriteEntityUpdate (MSGFTE_DeltaCalcBits (&nullentitystate, state), state, buf, protocol_pext2, protocolflags);
+		MSGW_Begin (&w, buf, MSGFTE_MAX_UPDATE_SIZE);
+		MSGFTE_WriteEntityUpdate (MSGFTE_DeltaCalcBits (&nullentitystate, state), state, &w, protocol_pext2, protocolflags);
+		MSGW_Commit (&w);
 	}
 	else
 	{
@@ -1016,6 +1084,100 @@ void MSG_WriteStaticOrBaseLine (sizebuf_t *buf, int idx, entity_state_t *state,
 }
 static void SV_Pext_f (void);
 
+/*
+===============
+SV_MsgBenchmark_f
+
+Writes the same fixed snapshot of entity deltas through SVFTE_WriteEntityDelta, the code that
+SVFTE_WriteEntitiesToClient uses, once with the msg_writer_t reservation and once with every
+fragment going through the spill buffer and SZ_Write, and checks that both give the same bytes
+===============
+*/
+static void SV_MsgBenchmark_f (void)
+{
+	static const struct
+	{
+		const char	*name;
+		unsigned int protocolflags;
+	} configs[] = {
+		{"float coords, short angles", PRFL_FLOATCOORD | PRFL_SHORTANGLE},
+		{"16-bit coords, byte angles", 0},
+	};
+	const int		iterations = (Cmd_Argc () > 1) ? q_max (1, atoi (Cmd_Argv (1))) : 10000;
+	const int		numents = (Cmd_Argc () > 2) ? CLAMP (1, atoi (Cmd_Argv (2)), MAX_EDICTS - 1) : 600;
+	entity_state_t *states = (entity_state_t *)Mem_Alloc (sizeof (entity_state_t) * numents);
+	unsigned int   *bits = (unsigned int *)Mem_Alloc (sizeof (unsigned int) * numents);
+	unsigned int	seed = 1;
+	sizebuf_t		buf[2];
+	double			elapsed[2];
+	int				c, e, i, pass;
+
+// same LCG as the load bots, the snapshot must be the same on every run
+#define BENCHMARK_RAND() ((seed = seed * 1103515245u + 12345u) >> 16 & 0x7fff)
+
+	// previous and current state of each entity: most move, some turn or animate
+	for (e = 0; e < numents; e++)
+	{
+		entity_state_t from = nullentitystate;
+		for (i = 0; i < 3; i++)
+		{
+			from.origin[i] = (BENCHMARK_RAND () - 0x4000) * 0.125f;
+			from.angles[i] = BENCHMARK_RAND () * (360.0f / 0x8000);
+		}
+		from.modelindex = 1 + BENCHMARK_RAND () % 255;
+		from.frame = BENCHMARK_RAND () % 32;
+		from.skin = BENCHMARK_RAND () % 4 == 0;
+
+		states[e] = from;
+		if (BENCHMARK_RAND () % 4 != 0)
+			for (i = 0; i < 3; i++)
+				states[e].origin[i] += (BENCHMARK_RAND () % 33) - 16;
+		if (BENCHMARK_RAND () % 4 == 0)
+			states[e].angles[1] = BENCHMARK_RAND () * (360.0f / 0x8000);
+		if (BENCHMARK_RAND () % 3 == 0)
+			states[e].frame = (states[e].frame + 1) % 32;
+		if (BENCHMARK_RAND () % 16 == 0)
+			states[e].effects = EF_MUZZLEFLASH;
+		bits[e] = MSGFTE_DeltaCalcBits (&from, &states[e]);
+	}
+#undef BENCHMARK_RAND
+
+	for (pass = 0; pass < 2; pass++)
+	{
+		buf[pass].maxsize = numents * (3 + MSGFTE_MAX_UPDATE_SIZE);
+		buf[pass].data = (byte *)Mem_Alloc (buf[pass].maxsize);
+		buf[pass].allowoverflow = false;
+		buf[pass].overflowed = false;
+	}
+
+	for (c = 0; c < (int)countof (configs); c++)
+	{
+		for (pass = 0; pass < 2; pass++)
+		{
+			msgw_unreserved = (pass == 1);
+			const double start = Sys_DoubleTime ();
+			for (i = 0; i < iterations; i++)
+			{
+				buf[pass].cursize = 0;
+				for (e = 0; e < numents; e++)
+					SVFTE_WriteEntityDelta (&buf[pass], e + 1, bits[e], &states[e], PEXT2_SUPPORTED_SERVER, configs[c].protocolflags);
+			}
+			elapsed[pass] = Sys_DoubleTime () - start;
+		}
+		msgw_unreserved = false;
+
+		Con_Printf (
+			"%s: %d entities, %d times, %d bytes: reserved %.1f ns, unreserved %.1f ns per entity, output %s\n", configs[c].name, numents, iterations,
+			buf[0].cursize, elapsed[0] * 1e9 / ((double)numents * iterations), elapsed[1] * 1e9 / ((double)numents * iterations),
+			(buf[0].cursize == buf[1].cursize && !memcmp (buf[0].data, buf[1].data, buf[0].cursize)) ? "identical" : "DIFFERENT");
+	}
+
+	Mem_Free (buf[0].data);
+	Mem_Free (buf[1].data);
+	Mem_Free (bits);
+	Mem_Free (states);
+}
+
 /*
 ===============
 SV_Protocol_f
@@ -1113,28 +1275,16 @@ void SV_Init (void)
 {
 	int			  i;
 	const char	 *p;
-	extern cvar_t sv_maxvelocity;
-	extern cvar_t sv_gravity;
-	extern cvar_t sv_nostep;
 	extern cvar_t sv_freezenonclients;
-	extern cvar_t sv_friction;
-	extern cvar_t sv_edgefriction;
-	extern cvar_t sv_stopspeed;
-	extern cvar_t sv_maxspeed;
-	extern cvar_t sv_accelerate;
 	extern cvar_t sv_idealpitchscale;
 	extern cvar_t sv_aim;
-	extern cvar_t sv_altnoclip; // johnfitz
 
 	Cvar_RegisterVariable (&sv_maxvelocity);
 	Cvar_RegisterVariable (&sv_gravity);
 	Cvar_RegisterVariable (&sv_friction);
-	Cvar_SetCallback (&sv_gravity, Host_Callback_Notify);
-	Cvar_SetCallback (&sv_friction, Host_Callback_Notify);
 	Cvar_RegisterVariable (&sv_edgefriction);
 	Cvar_RegisterVariable (&sv_stopspeed);
 	Cvar_RegisterVariable (&sv_maxspeed);
-	Cvar_SetCallback (&sv_maxspeed, Host_Callback_Notify);
 	Cvar_RegisterVariable (&sv_accelerate);
 	Cvar_RegisterVariable (&sv_idealpitchscale);
 	Cvar_RegisterVariable (&sv_aim);
@@ -1144,9 +1294,13 @@ void SV_Init (void)
 	Cvar_RegisterVariable (&sv_altnoclip); // johnfitz
 	Cvar_RegisterVariable (&sv_netsort);
 	Cvar_RegisterVariable (&sv_smoothplatformlerps);
+	Cvar_RegisterVariable (&sv_predictmovetype);
+	for (i = 0; i < (int)countof (sv_predictionvars); i++)
+		Cvar_SetCallback (sv_predictionvars[i], SV_PredictionVarChanged);
 
 	Cmd_AddCommand ("pext", SV_Pext_f);
 	Cmd_AddCommand ("sv_protocol", &SV_Protocol_f); // johnfitz
+	Cmd_AddCommand ("sv_msgbenchmark", SV_MsgBenchmark_f);
 
 	for (i = 0; i < MAX_MODELS; i++)
 		q_snprintf (localmodels[i], 8, "*%i", i);
@@ -1557,6 +1711,11 @@ retry:
 	MSG_WriteByte (&client->message, svc_setview);
 	MSG_WriteShort (&client->message, NUM_FOR_EDICT (client->edict));
 
+	// physics settings for client side prediction
+	if (client->protocol_pext2 & PEXT2_PREDINFO)
+		for (i = 0; i < countof (sv_predictionvars); i++)
+			SV_WritePredictionVar (&client->message, sv_predictionvars[i]);
+
 	MSG_WriteByte (&client->message, svc_signonnum);
 	MSG_WriteByte (&client->message, 1);
 
@@ -1887,6 +2046,7 @@ void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_t overflow
 	qboolean	 sort = sv_netsort.value > 1;
 	float		 scale;
 	const char	*model;
+	msg_writer_t w;
 
 	// with sv_netsort = 1, sort only if (any client) overflowed in the last 10 seconds
 	if (sv_netsort.value == 1 && dev_overflows.packetsize + 10 > realtime)
@@ -2112,58 +2272,60 @@ void SV_WriteEntitiesToClient (client_t *client, sizebuf_t *msg, size_t overflow
 		//
 		// write the message
 		//
-		MSG_WriteByte (msg, bits | U_SIGNAL);
+		MSGW_Begin (&w, msg, 48); // bits, entity, 5 bytes and 6 floats at most, then 5 bytes for fitzquake
+		MSGW_WriteByte (&w, bits | U_SIGNAL);
 
 		if (bits & U_MOREBITS)
-			MSG_WriteByte (msg, bits >> 8);
+			MSGW_WriteByte (&w, bits >> 8);
 
 		// johnfitz -- PROTOCOL_FITZQUAKE
 		if (bits & U_EXTEND1)
-			MSG_WriteByte (msg, bits >> 16);
+			MSGW_WriteByte (&w, bits >> 16);
 		if (bits & U_EXTEND2)
-			MSG_WriteByte (msg, bits >> 24);
+			MSGW_WriteByte (&w, bits >> 24);
 		// johnfitz
 
 		if (bits & U_LONGENTITY)
-			MSG_WriteShort (msg, e);
+			MSGW_WriteShort (&w, e);
 		else
-			MSG_WriteByte (msg, e);
+			MSGW_WriteByte (&w, e);
 
 		if (bits & U_MODEL)
-			MSG_WriteByte (msg, ent->v.modelindex);
+			MSGW_WriteByte (&w, ent->v.modelindex);
 		if (bits & U_FRAME)
-			MSG_WriteByte (msg, ent->v.frame);
+			MSGW_WriteByte (&w, ent->v.frame);
 		if (bits & U_COLORMAP)
-			MSG_WriteByte (msg, ent->v.colormap);
+			MSGW_WriteByte (&w, ent->v.colormap);
 		if (bits & U_SKIN)
-			MSG_WriteByte (msg, ent->v.skin);
+			MSGW_WriteByte (&w, ent->v.skin);
 		if (bits & U_EFFECTS)
-			MSG_WriteByte (msg, (int)ent->v.effects & sv.effectsmask);
+			MSGW_WriteByte (&w, (int)ent->v.effects & sv.effectsmask);
 		if (bits & U_ORIGIN1)
-			MSG_WriteCoord (msg, origin[0], sv.protocolflags);
+			MSGW_WriteCoord (&w, origin[0], sv.protocolflags);
 		if (bits & U_ANGLE1)
-			MSG_WriteAngle (msg, ent->v.angles[0], sv.protocolflags);
+			MSGW_WriteAngle (&w, ent->v.angles[0], sv.protocolflags);
 		if (bits & U_ORIGIN2)
-			MSG_WriteCoord (msg, origin[1], sv.protocolflags);
+			MSGW_WriteCoord (&w, origin[1], sv.protocolflags);
 		if (bits & U_ANGLE2)
-			MSG_WriteAngle (msg, ent->v.angles[1], sv.protocolflags);
+			MSGW_WriteAngle (&w, ent->v.angles[1], sv.protocolflags);
 		if (bits & U_ORIGIN3)
-			MSG_WriteCoord (msg, origin[2], sv.protocolflags);
+			MSGW_WriteCoord (&w, origin[2], sv.protocolflags);
 		if (bits & U_ANGLE3)
-			MSG_WriteAngle (msg, ent->v.angles[2], sv.protocolflags);
+			MSGW_WriteAngle (&w, ent->v.angles[2], sv.protocolflags);
 
 		// johnfitz -- PROTOCOL_FITZQUAKE
 		if (bits & U_ALPHA)
-			MSG_WriteByte (msg, ent->alpha);
+			MSGW_WriteByte (&w, ent->alpha);
 		if (bits & U_SCALE)
-			MSG_WriteByte (msg, scale);
+			MSGW_WriteByte (&w, scale);
 		if (bits & U_FRAME2)
-			MSG_WriteByte (msg, (int)ent->v.frame >> 8);
+			MSGW_WriteByte (&w, (int)ent->v.frame >> 8);
 		if (bits & U_MODEL2)
-			MSG_WriteByte (msg, (int)ent->v.modelindex >> 8);
+			MSGW_WriteByte (&w, (int)ent->v.modelindex >> 8);
 		if (bits & U_LERPFINISH)
-			MSG_WriteByte (msg, (byte)(Q_rint ((ent->v.nextthink - qcvm->time) * 255)));
+			MSGW_WriteByte (&w, (byte)(Q_rint ((ent->v.nextthink - qcvm->time) * 255)));
 		// johnfitz
+		MSGW_Commit (&w);
 
 		if ((size_t)msg->cursize > origmaxsize)
 		{
@@ -3128,7 +3290,7 @@ void SV_SpawnServer (const char *server)
 	// allocate server memory
 	/* Host_ClearMemory() called above already cleared the whole sv structure */
 	qcvm->max_edicts = CLAMP (MIN_EDICTS, (int)max_edicts.value, MAX_EDICTS);  // johnfitz -- max_edicts cvar
-	qcvm->edicts = (edict_t *)Mem_Alloc (qcvm->max_edicts * qcvm->edict_size); // ericw -- sv.edicts switched to use malloc()
+	qcvm->edicts = (edict_t *)Mem_ArenaAlloc (MEM_TAG_SERVER, qcvm->max_edicts * qcvm->edict_size);
 	assert (qcvm->free_edicts_head == NULL);
 	assert (qcvm->free_edicts_tail == NULL);
 
@@ -3229,6 +3391,9 @@ void SV_SpawnServer (const char *server)
 	SV_Physics ();
 	SV_Physics ();
 
+	// nobody is connected to hear what happened while settling
+	SV_ClearDatagram ();
+
 	// create a baseline for more efficient communications
 	SV_CreateBaseline ();
 	qcvm->min_edicts = qcvm->num_edicts;
@@ -3246,5 +3411,8 @@ void SV_SpawnServer (const char *server)
 			SV_SendServerinfo (host_client);
 	}
 
+	// start reading the maps we are likely to change to next
+	Mod_PreloadMaps (qcvm->worldmodel->entities, sv.name);
+
 	Con_DPrintf ("Server spawned.\n");
 }
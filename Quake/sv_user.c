@@ -572,14 +572,13 @@ qboolean SV_ReadClientMessage (void)
 
 /*
 ==================
-SV_RunClients
+SV_ReadClientMessages
 ==================
 */
-void SV_RunClients (void)
+void SV_ReadClientMessages (void)
 {
 	int i;
 
-	// receive from clients first
 	// Spike -- reworked this to query the network code for an active connection.
 	// this allows the network code to serve multiple clients with the same listening port.
 	// this solves server-side nats, which is important for coop etc.
@@ -602,6 +601,19 @@ void SV_RunClients (void)
 			}
 		}
 	}
+}
+
+/*
+==================
+SV_RunClients
+==================
+*/
+void SV_RunClients (void)
+{
+	int i;
+
+	// receive from clients first
+	SV_ReadClientMessages ();
 
 	// then do the per-frame stuff
 	for (i = 0, host_client = svs.clients; i < svs.maxclients; i++, host_client++)
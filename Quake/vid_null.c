@@ -0,0 +1,213 @@
+/*
+ * vid_null.c -- video and renderer stubs for the dedicated server build
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "quakedef.h"
+
+viddef_t		vid;
+modestate_t		modestate = MS_UNINIT;
+vulkanglobals_t vulkan_globals;
+unsigned int	d_8to24table[256];
+
+int		 glwidth, glheight;
+qboolean scr_disabled_for_loading;
+qboolean in_update_screen;
+
+vec3_t vup;
+vec3_t vpn;
+vec3_t vright;
+vec3_t r_origin;
+int	   r_trace_line_cache_counter;
+
+gltexture_t *char_texture;
+qpic_t		*pic_ovr, *pic_ins;
+
+// never registered, but read by code shared with the client
+cvar_t r_novis = {"r_novis", "0", CVAR_ARCHIVE};
+cvar_t r_lerpmove = {"r_lerpmove", "1", CVAR_ARCHIVE};
+cvar_t r_nolerp_list = {"r_nolerp_list", "", CVAR_NONE};
+cvar_t r_fteparticles = {"r_fteparticles", "1", CVAR_ARCHIVE};
+cvar_t r_particledesc = {"r_particledesc", "classic"};
+cvar_t scr_viewsize = {"viewsize", "100", CVAR_ARCHIVE};
+cvar_t scr_sbarscale = {"scr_sbarscale", "1", CVAR_ARCHIVE};
+
+void VID_Init (void) {}
+
+void VID_Shutdown (void) {}
+
+void VID_Lock (void) {}
+
+qboolean VID_HasMouseOrInputFocus (void)
+{
+	return false;
+}
+
+qboolean VID_IsMinimized (void)
+{
+	return true;
+}
+
+void PL_ErrorDialog (const char *text) {}
+
+void Draw_Init (void) {}
+
+void Draw_NewGame (void) {}
+
+void Draw_Character (cb_context_t *cbx, int x, int y, int num) {}
+
+void Draw_String (cb_context_t *cbx, int x, int y, const char *str) {}
+
+void Draw_Pic (cb_context_t *cbx, int x, int y, qpic_t *pic, float alpha, qboolean alpha_blend) {}
+
+void Draw_SubPic (cb_context_t *cbx, float x, float y, float w, float h, qpic_t *pic, float s1, float t1, float s2, float t2, float *rgb, float alpha) {}
+
+void Draw_ConsoleBackground (cb_context_t *cbx) {}
+
+basicvertex_t *Draw_AllocateQuad (cb_context_t *cbx, vulkan_pipeline_t pipeline, gltexture_t *texture)
+{
+	static basicvertex_t discard[6];
+	return discard;
+}
+
+qpic_t *Draw_PicFromWad2 (const char *name, unsigned int texflags)
+{
+	return NULL;
+}
+
+qpic_t *Draw_TryCachePic (const char *path, unsigned int texflags)
+{
+	return NULL;
+}
+
+void GL_SetCanvas (cb_context_t *cbx, canvastype newcanvas) {}
+
+void SCR_Init (void) {}
+
+void SCR_UpdateScreen (qboolean use_tasks) {}
+
+void SCR_BeginLoadingPlaque (void) {}
+
+void SCR_EndLoadingPlaque (void) {}
+
+void SCR_CenterPrintClear (void) {}
+
+void R_Init (void) {}
+
+void R_NewGame (void) {}
+
+void R_TranslateNewPlayerSkin (int playernum) {}
+
+byte *R_VertexAllocate (int size, VkBuffer *buffer, VkDeviceSize *buffer_offset)
+{
+	Sys_Error ("R_VertexAllocate: no renderer in the dedicated server");
+	return NULL;
+}
+
+int R_LightPoint (vec3_t p, float ofs, lightcache_t *cache, vec3_t *lightcolor)
+{
+	VectorCopy (vec3_origin, *lightcolor);
+	return 0;
+}
+
+void R_ClearParticles (void) {}
+
+void R_ParticleExplosion (vec3_t org) {}
+
+void R_BlobExplosion (vec3_t org) {}
+
+void R_RunParticleEffect (vec3_t org, vec3_t dir, int color, int count) {}
+
+void PScript_InitParticles (void) {}
+
+void PScript_ClearParticles (qboolean load) {}
+
+void PScript_UpdateModelEffects (qmodel_t *mod) {}
+
+void PScript_SimulateParticles (void) {}
+
+int PScript_FindParticleType (const char *fullname)
+{
+	return -1;
+}
+
+int PScript_RunParticleEffectState (vec3_t org, vec3_t dir, float count, int typenum, struct trailstate_s **tsk)
+{
+	return 1;
+}
+
+int PScript_RunParticleEffectTypeString (vec3_t org, vec3_t dir, float count, const char *name)
+{
+	return 1;
+}
+
+int PScript_ParticleTrail (vec3_t startpos, vec3_t end, int type, float timeinterval, int dlkey, vec3_t axis[3], struct trailstate_s **tsk)
+{
+	return 1;
+}
+
+void TexMgr_Init (void) {}
+
+void TexMgr_NewGame (void) {}
+
+void TexMgr_FreeTexturesForOwner (qmodel_t *owner) {}
+
+gltexture_t *TexMgr_LoadImage (
+	qmodel_t *owner, const char *name, int width, int height, enum srcformat format, byte *data, const char *source_file, src_offset_t source_offset,
+	unsigned flags)
+{
+	return NULL;
+}
+
+byte *Image_LoadImage (const char *name, int *width, int *height, enum srcformat *fmt)
+{
+	return NULL;
+}
+
+void GL_MakeAliasModelDisplayLists (qmodel_t *m, aliashdr_t *hdr) {}
+
+void GLMesh_UploadBuffers (qmodel_t *m, aliashdr_t *hdr, unsigned short *indexes, byte *vertexes, aliasmesh_t *desc, jointpose_t *joints) {}
+
+void GLMesh_DeleteMeshBuffers (aliashdr_t *hdr) {}
+
+void GLMesh_DeleteAllMeshBuffers (void) {}
+
+void GL_DeleteBModelAccelerationStructures (void) {}
+
+void Sky_ClearAll (void) {}
+
+void Sky_LoadSkyBox (const char *name) {}
+
+void Sky_LoadTexture (qmodel_t *mod, texture_t *mt, int tex_index) {}
+
+void Sky_LoadTextureQ64 (qmodel_t *mod, texture_t *mt, int tex_index) {}
+
+void Sky_SetSkyfog (float value) {}
+
+const char *Sky_GetSkyCommand (qboolean always)
+{
+	return NULL;
+}
+
+void Fog_Update (float density, float red, float green, float blue, float time) {}
+
+void Fog_ResetFade (void) {}
+
+const char *Fog_GetFogCommand (qboolean always)
+{
+	return NULL;
+}